@@ -0,0 +1,52 @@
+#ifndef CPU_H
+#define CPU_H
+
+/*=============== C P U . h ===============*/
+
+/*
+BY:   George Cheney
+      16.472 / 16.572 Embedded Real Time Systems
+      Electrical and Computer Engineering Dept.
+      UMASS Lowell
+*/
+
+/*
+PURPOSE
+Define CPU/Compiler specific data types and constants.
+
+Host copy of Prog1/CPU.h for the Linux tools. The 32 bit types use
+int so they stay 32 bits wide under LP64 compilers.
+
+CHANGES
+01-24-2012 gpc - Added CPU_CHAR and CPU_BOOLEAN
+*/
+
+
+/*----- t y p e    d e f i n i t i o n s -----*/
+
+/* Boolean data type constants */
+typedef enum
+{
+   false = 0,
+   true = 1,
+} Boolean;
+
+#ifndef TRUE
+#define TRUE  1
+#define FALSE 0
+#endif
+
+/* CPU specific data types */
+typedef signed char        CPU_INT08S;
+typedef unsigned char      CPU_INT08U;
+typedef short              CPU_INT16S;
+typedef unsigned short     CPU_INT16U;
+typedef int                CPU_INT32S;
+typedef unsigned int       CPU_INT32U;
+typedef long long          CPU_INT64S;
+typedef unsigned long long CPU_INT64U;
+typedef char               CPU_CHAR;
+typedef unsigned char      CPU_BOOLEAN;
+typedef void               CPU_VOID;
+
+#endif
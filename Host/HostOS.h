@@ -0,0 +1,46 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			               HostOS.h
+-----------------------------------------------------------------------
+Stands in for the station's includes.h so Prog 4 and Prog 5 App
+modules that do not touch the hardware can be compiled into the host
+tools:
+
+    gcc -include HostOS.h -I../Prog5/App ... ../Prog5/App/Module.c
+-----------------------------------------------------------------------*/
+
+#ifndef HOSTOS_H
+#define HOSTOS_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+//The station's includes.h checks this; defining it here skips it.
+#define INCLUDES_PRESENT
+
+//No CRC unit here: Crc32.c computes CRCs from tables.
+#define Crc32Software
+
+//No flash here: FlashLog.c keeps the log in a file (FlashSimOpen()).
+#define FlashSimulated
+
+//No STLM75 here: LocalTemp.c reads a simulated one (I2CSimSet()).
+#define I2CSimulated
+
+//No wfi here: the host drives Prog 4's ExecRunReady() itself.
+#define ExecSimulated
+
+//No DMA controller here: SerDma.c drives a model of it (DmaSimTick()).
+#define DmaSimulated
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CPU.h"
+
+#endif
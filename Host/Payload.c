@@ -0,0 +1,111 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			               Payload.c
+-----------------------------------------------------------------------
+Host copy of the Prog 5 message formatting (ConstructMessage() and
+ConstructError()). The reply text matches the station byte for byte.
+-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "Payload.h"
+#include "pktParser.h"
+#include "Reading.h"
+#include "ReplyFrame.h"
+#include "MsgDesc.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+
+//Define the message types with real names. The sensor types' layouts
+//are in Prog 5 MsgDesc.c.
+#define NodePacket 'I'
+
+/*-------------------- C o n s t r u c t M e s s a g e ( ) -------------------------------------
+	Purpose:	Create the reply text for a payload
+        Parameters:     address of payload, character string
+        Return:         TRUE -  A payload message was created
+                        FALSE - A error message was created
+*/
+CPU_BOOLEAN ConstructMessage(Payload *payload, CPU_CHAR *message){
+    const MsgHandler *handler;
+
+    //Error Payload
+    if(payload->payloadLen < 0){
+        ConstructError(payload, message);
+        return FALSE;
+    }
+
+    //Info Message - Wrong Address
+    if(payload->dstAddr != StationAddr){
+        sprintf(message, "IBad ADR");
+        return FALSE;
+    }
+
+    //Info Message - Bad Type, or a reading too short for its fields
+    handler = MsgHandlerFind(payload->msgType);
+    if(!handler->format(handler->desc, payload->srcAddr, payload->data,
+                        payload->payloadLen - PayloadHeaderDiff, message)){
+        sprintf(message, "IBad Type");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*-------------------- C o n s t r u c t F r a m e ( ) -------------------------------------
+	Purpose:	Create the binary reply frame for a payload (see ReplyFrame.h)
+        Parameters:     address of payload, its decoded reading or NULL if it has none,
+                        frame space
+        Return:         Frame length in bytes
+*/
+CPU_INT08U ConstructFrame(Payload *payload, const Reading *rdg, CPU_INT08U *frame){
+    CPU_INT08U info[2];
+    CPU_INT08S dataLen = payload->payloadLen - PayloadHeaderDiff;
+
+    if(payload->payloadLen < 0){
+        info[0] = (CPU_INT08U)(0 - payload->payloadLen);
+        return FrameBuild(frame, FrameError, 0, info, 1);
+    }
+    if(payload->dstAddr != StationAddr){
+        info[0] = FrameBadAddr;
+        return FrameBuild(frame, FrameInfo, payload->srcAddr, info, 1);
+    }
+    if(payload->msgType == NodePacket)
+        return FrameBuild(frame, NodePacket, payload->srcAddr, payload->data, dataLen);
+    if(rdg != NULL)
+        return FrameReading(frame, payload->msgType, payload->srcAddr, rdg);
+
+    info[0] = FrameBadType;
+    info[1] = payload->msgType;
+    return FrameBuild(frame, FrameInfo, payload->srcAddr, info, 2);
+}
+
+/*-------------------- C o n s t r u c t E r r o r ( ) -----------------------------
+	Purpose:	Create the error text for an Error Message Payload
+        Error Values:   Preamble Byte 1 Error       -1
+                        Preamble Byte 2 Error       -2
+                        Preamble Byte 3 Error       -3
+                        Checksum Error              -4
+                        Packet Too Short Error      -5
+*/
+CPU_VOID ConstructError(Payload *payload, CPU_CHAR *message){
+
+    switch(0 - payload->payloadLen){
+    case E1:
+        sprintf(message, "EP1");
+        break;
+    case E2:
+        sprintf(message, "EP2");
+        break;
+    case E3:
+        sprintf(message, "EP3");
+        break;
+    case E4:
+        sprintf(message, "ECS");
+        break;
+    case E5:
+        sprintf(message, "EBad Size");
+        break;
+    }
+}
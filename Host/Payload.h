@@ -0,0 +1,36 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			               Payload.h
+-----------------------------------------------------------------------
+Host copy of the Prog 5 payload layout and message formatting, so the
+host tools print the same reply text as the station.
+-----------------------------------------------------------------------*/
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include "CPU.h"
+#include "Reading.h"
+
+#define StationAddr 1
+#define PayloadHeaderDiff 8  //Amount of header before the data starts in the payload.
+#define PayloadMaxData 10     // Longest data field: a node ID
+
+typedef struct
+{
+	CPU_INT08S payloadLen; // Number of data bytes
+	CPU_INT08U dstAddr; // Destination address
+	CPU_INT08U srcAddr; // Address of sending node
+	CPU_CHAR msgType; // ASCII Message Type
+	CPU_INT08U data[PayloadMaxData]; // Data bytes, laid out as MsgDesc.h says
+} Payload;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_BOOLEAN ConstructMessage(Payload *payload, CPU_CHAR *messageStr);
+CPU_INT08U ConstructFrame(Payload *payload, const Reading *rdg, CPU_INT08U *frame);
+CPU_VOID ConstructError(Payload *payload, CPU_CHAR *message);
+
+#endif
@@ -0,0 +1,2307 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktBench.c
+-----------------------------------------------------------------------
+Host benchmarks for the packet pipeline. Each benchmark is a
+subcommand:
+
+  pktBench ingest [-m MB] [-r runs] [-f file]
+      Writes a pktGen capture of the given size, then parses it with
+      every Prog 1 reader mode (fgetc, fread blocks, mmap, read(),
+      io_uring with and without O_DIRECT). Each mode runs once with
+      the file dropped from the page cache and then -r times warm.
+
+  pktBench aggregate [-n nodes] [-i secs] [-H hours]
+      Runs simulated time through the station's Aggregate module with
+      each node reporting every -i seconds. Compares the reply bytes
+      of sending every reading with sending only window summaries.
+      Built with AggReportFrom 0 so every level is counted; the
+      station sends levels 1..2 by default.
+
+  pktBench deadband [-n nodes] [-i secs] [-H hours]
+      Runs the same simulated traffic through the station's Deadband
+      filter, once with its default thresholds and once reporting any
+      change, and counts the reply bytes saved.
+
+  pktBench replies [-p packets]
+      Builds the station's text and binary replies for generated traffic
+      with some corrupted, foreign and unknown-type packets mixed in,
+      compares their size and link capacity, then decodes the binary
+      stream and checks the text regenerated from it against the
+      station's own text.
+
+  pktBench dedup [-n nodes] [-i secs] [-r relay%] [-d ms] [-H hours]
+      Simulates mesh relaying: -r percent of packets arrive one or two
+      more times, up to -d ms late. Runs the stream through the
+      station's DupCache and counts copies caught, copies missed and
+      new packets wrongly dropped. Rebuild with -DDupSets=, -DDupWays=
+      or -DDupTtl= to try other cache sizes.
+
+  pktBench crc [-p packets] [-m MB]
+      Times the software CRC-32 (slice-by-8 and a word at a time) and
+      the parser on checksum and CRC mode traffic against the time one
+      byte takes at 921600 baud, then corrupts packets with 1 to 4
+      flipped bits and a 32 bit burst and counts the ones each mode lets through.
+
+  pktBench multi [-p payloads] [-b baud]
+      Sends the same payloads as single packets and as aggregate frames
+      of 2 to GenMaxAgg payloads, and compares bytes per payload and the
+      payloads per second the link carries at -b baud. Each stream is
+      parsed back and its payload count checked.
+
+  pktBench seq [-n nodes] [-p packets] [-l loss%] [-d dup%] [-r late%] [-w late]
+      Sends numbered packets from each node round robin over a link that
+      loses -l percent, repeats -d percent and delays -r percent by up
+      to -w of the node's own packets. Runs the arrivals through the
+      parser and the station's SeqTrack and compares its lost, duplicate
+      and reordered counts with what the link really did.
+
+  pktBench decode [-p payloads] [-r runs]
+      Formats generated payloads and decodes their readings with the
+      station's message handler table, and with the per-type switch and
+      union it replaced. Checks that both give the same text and
+      readings, then times each. Also registers a new type at run time
+      and checks that it decodes and that unknown types are counted.
+
+  pktBench flashlog [-f file] [-n readings] [-c cuts]
+      Runs readings through the station's FlashLog on a simulated flash
+      kept in -f file: times it, estimates the flash busy time on the
+      station, and shows how evenly the pages wear. Then reopens the
+      file and checks the log is found again, cuts the power -c times
+      part way through programming, and checks that every record read
+      back is whole and in order, and that the export frames decode.
+
+  pktBench history [-n nodes] [-i secs] [-H hours] [-j ms]
+      Sends every reading type from each node once per -i seconds, up
+      to -j ms early or late, into the station's History. Gives the
+      bytes per sample against a flash log record, the append and
+      decode times and how many hours the pool holds, and checks every
+      series reads back as the newest of what was appended. Rebuild
+      with -DHistBlocks= or -DHistBlockSize= to try other pool sizes.
+
+  pktBench pool [-s secs] [-b blocks]
+      Runs bursty traffic through a model of the parser, payload and
+      reply tasks for -s simulated seconds, with their queue buffers
+      from the station's BfrPool: once split 3 and 3, as the queues had
+      them, and once shared from -b blocks with Payload.c's minimums.
+      Counts packets lost to the full input buffer and the stalls and
+      stalled time of each producer, for a reply backlog, an input
+      burst behind slow payloads, and both.
+
+  pktBench temp [-s secs] [-l ms] [-f fail%]
+      Runs the station's local temperature sampler for -s simulated
+      seconds against a simulated STLM75 whose reads take -l ms and
+      fail -f percent of the time. Checks that each payload decodes as
+      the payload task would and is within a degree of the true mean
+      over its window, and counts late and failed reads.
+
+  pktBench txdma [-p replies] [-l bytes] [-w wrap%] [-b baud]
+      Sends replies of 10 to 80 bytes through the station's DMA transmit
+      driver against the register level model of DMA1 channel 7 and
+      USART2. The reply task takes -l byte times to wake after each
+      transfer-complete interrupt; -w percent of the replies wrap in the
+      circular buffer and go as two spans. Checks that the line carries
+      every byte in order, that a start while busy is refused, and that
+      there is one interrupt per span, and gives the line use and the
+      replies a second the link could carry at -b baud, with the
+      interrupts and wakes the byte at a time driver took for them.
+
+  pktBench rxdma [-p packets] [-l bytes] [-g gap%]
+      Sends packets of 10 to 80 bytes into the station's circular DMA
+      receive driver through the model of DMA1 channel 6 and USART2;
+      -g percent of them are followed by an idle line. The parser task
+      takes -l byte times to wake after each half-transfer,
+      transfer-complete or idle line interrupt, then reads the ring a
+      span at a time until it is empty. Checks that every byte is read
+      in order, with none lost unless the ring overran, and gives the
+      wakes and interrupts a packet against the RXNE interrupts the
+      byte at a time driver takes, and how long bytes wait in the ring.
+
+Build:  gcc -O2 -include HostOS.h -I../Prog5/App -DNodeCacheNodes=256 -DAggReportFrom=0 -o pktBench
+            pktBench.c pktParser.c pktGen.c Payload.c ../Prog1/pktReader.c ../Prog1/Error.c
+            ../Prog5/App/Reading.c ../Prog5/App/NodeCache.c ../Prog5/App/Aggregate.c
+            ../Prog5/App/Deadband.c ../Prog5/App/ReplyFrame.c replyDecode.c
+            ../Prog5/App/DupCache.c ../Prog5/App/Crc32.c ../Prog5/App/SeqTrack.c
+            ../Prog5/App/MsgDesc.c ../Prog5/App/FlashLog.c ../Prog5/App/History.c
+            ../Prog5/App/BfrPool.c ../Prog5/App/LocalTemp.c ../Prog5/App/SerDma.c
+-----------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "CPU.h"
+#include "pktParser.h"
+#include "pktGen.h"
+#include "Payload.h"
+#include "../Prog1/pktReader.h"
+#include "Reading.h"
+#include "NodeCache.h"
+#include "Aggregate.h"
+#include "Deadband.h"
+#include "ReplyFrame.h"
+#include "replyDecode.h"
+#include "DupCache.h"
+#include "Crc32.h"
+#include "SeqTrack.h"
+#include "MsgDesc.h"
+#include "FlashLog.h"
+#include "History.h"
+#include "BfrPool.h"
+#include "LocalTemp.h"
+#include "SerDma.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define NsPerSec 1000000000LL
+#define GenBlock (64 * 1024)      // Capture bytes written at a time
+#define TicksPerSec 1000          // Station OS tick rate
+#define FastBaud 921600           // Fastest UART rate the station link is run at
+#define LinkBaud 9600             // Station link rate
+#define BitsPerByte 10            // Start, 8 data and stop bits
+#define SimStepUs 10              // Simulation time step
+#define SimIBfr 4                 // Station input buffer bytes (SerIODriver.h BfrSize)
+#define SimBlockSize 80           // BfrQ.h BfrQSize
+#define SplitBfrs 3               // Buffers each queue had to itself
+#define PayloadClient 0           // The pool simulation's clients, in BfrQInit() order
+#define ReplyClient 1
+
+typedef struct
+{
+	const CPU_CHAR *name;         // Column title
+	PktReadMode mode;             // Reader requested
+	CPU_BOOLEAN direct;           // Ask for O_DIRECT
+} IngestMode;
+
+static const IngestMode IngestModes[] =
+{
+	{ "fgetc",       ReadFgetc,   FALSE },
+	{ "fread",       ReadStdio,   FALSE },
+	{ "mmap",        ReadMmap,    FALSE },
+	{ "read",        ReadSyscall, FALSE },
+	{ "uring",       ReadUring,   FALSE },
+	{ "uring+direct",ReadUring,   TRUE  },
+};
+
+static const CPU_CHAR *ModeNames[] = { "auto", "fgetc", "fread", "mmap", "read", "uring" };
+
+typedef struct
+{
+	CPU_INT64U packets;           // Payloads decoded
+	CPU_INT64U bytes;             // Capture bytes consumed
+	CPU_INT64S wallNs;            // Elapsed time
+	CPU_INT64S cpuNs;             // User + system time
+	PktReadMode used;             // Mode after any fallback
+} IngestRun;
+
+/*-------------------- N o w N s ( ) -------------------------------------
+	Purpose:	Monotonic clock in nanoseconds.
+*/
+static CPU_INT64S NowNs(CPU_VOID){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CPU_INT64S)ts.tv_sec * NsPerSec + ts.tv_nsec;
+}
+
+/*-------------------- C p u N s ( ) -------------------------------------
+	Purpose:	User plus system CPU time of this process in nanoseconds.
+*/
+static CPU_INT64S CpuNs(CPU_VOID){
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ((CPU_INT64S)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * NsPerSec
+	     + ((CPU_INT64S)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+}
+
+/*-------------------- W r i t e C a p t u r e ( ) -------------------------------------
+	Purpose:	Write a capture of at least the given size from pktGen traffic.
+	Return:		The number of packets written, or 0 if the file could not be written.
+*/
+static CPU_INT64U WriteCapture(const CPU_CHAR *name, CPU_INT64U size){
+	FILE *f = fopen(name, "wb");
+	CPU_INT08U *block = malloc(GenBlock + GenMaxPkt);
+	CPU_INT64U written = 0, packets = 0;
+	PktGen gen;
+
+	if (f == NULL){
+		perror(name);
+		return 0;
+	}
+	PktGenInit(&gen, 472);
+	while (written < size){
+		CPU_INT32U fill = 0;
+
+		while (fill < GenBlock){
+			CPU_INT08U src = (CPU_INT08U)(PktGenRand(&gen) | 2);
+
+			fill += PktGenNext(&gen, block + fill, StationAddr, src);
+			packets++;
+		}
+		fwrite(block, 1, fill, f);
+		written += fill;
+	}
+	fflush(f);
+	fdatasync(fileno(f));
+	fclose(f);
+	free(block);
+	return packets;
+}
+
+/*-------------------- D r o p C a c h e ( ) -------------------------------------
+	Purpose:	Evict the capture from the page cache so the next run reads the device.
+*/
+static CPU_VOID DropCache(const CPU_CHAR *name){
+	int fd = open(name, O_RDONLY);
+
+	if (fd < 0) return;
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+/*-------------------- R u n I n g e s t ( ) -------------------------------------
+	Purpose:	Parse the whole capture with one reader mode.
+	Return:		FALSE if the capture could not be opened.
+*/
+static CPU_BOOLEAN RunIngest(const CPU_CHAR *name, const IngestMode *m, IngestRun *run){
+	CPU_INT08U payload[64];
+	ParserCtx ctx;
+	PktReader *rdr;
+	CPU_INT16S c;
+	CPU_INT64S wall0, cpu0;
+
+	memset(run, 0, sizeof(*run));
+	ParserCtxInit(&ctx);
+	wall0 = NowNs();
+	cpu0 = CpuNs();
+	if ((rdr = OpenPktReader(name, m->mode, m->direct)) == NULL) return FALSE;
+	run->used = rdr->mode;
+	while ((c = GetByte(rdr)) != EOF){
+		run->bytes++;
+		if (ParseByte(&ctx, payload, (CPU_INT08U)c))
+			run->packets++;
+	}
+	ClosePktFile(rdr);
+	run->wallNs = NowNs() - wall0;
+	run->cpuNs = CpuNs() - cpu0;
+	return TRUE;
+}
+
+/*-------------------- I n g e s t ( ) -------------------------------------
+	Purpose:	Compare the capture readers on a cold and a warm page cache.
+*/
+static int Ingest(int argc, char *argv[]){
+	CPU_INT64U mb = 128;
+	CPU_INT32U runs = 3;
+	const CPU_CHAR *name = "/var/tmp/pktIngest.dat";
+	CPU_INT64U packets;
+	CPU_INT32U i, r;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:r:f:")) != -1){
+		switch (opt){
+		case 'm': mb = strtoull(optarg, NULL, 0); break;
+		case 'r': runs = strtoul(optarg, NULL, 0); break;
+		case 'f': name = optarg; break;
+		default:  return 2;
+		}
+	}
+
+	if ((packets = WriteCapture(name, mb << 20)) == 0) return 1;
+	printf("capture          %s, %llu MB, %llu packets\n\n", name, mb, packets);
+	printf("%-13s %-6s %10s %10s %10s %12s\n", "mode", "used", "cold MB/s", "warm MB/s", "cpu ms", "packets");
+
+	for (i = 0; i < sizeof(IngestModes) / sizeof(IngestModes[0]); i++){
+		const IngestMode *m = &IngestModes[i];
+		IngestRun cold, warm, best;
+
+		DropCache(name);
+		if (!RunIngest(name, m, &cold)) return 1;
+		best = cold;
+		best.wallNs = 0;
+		for (r = 0; r < runs; r++){
+			RunIngest(name, m, &warm);
+			if (best.wallNs == 0 || warm.wallNs < best.wallNs) best = warm;
+		}
+		printf("%-13s %-6s %10.0f %10.0f %10.0f %12llu%s\n", m->name, ModeNames[cold.used],
+		       cold.bytes / 1e6 / (cold.wallNs / 1e9),
+		       best.wallNs ? best.bytes / 1e6 / (best.wallNs / 1e9) : 0.0,
+		       best.wallNs ? best.cpuNs / 1e6 : cold.cpuNs / 1e6,
+		       cold.packets, cold.packets == packets ? "" : "  MISMATCH");
+	}
+	unlink(name);
+	return 0;
+}
+
+/*-------------------- C o u n t S u m m a r y ( ) -------------------------------------
+	Purpose:	Aggregate report function: count the bytes a summary record sends.
+*/
+static CPU_INT64U summaryBytes[AggLevels], summaryRecs[AggLevels];
+
+static CPU_VOID CountSummary(const AggSummary *summary){
+	CPU_CHAR message[80];
+
+	AggregateFormat(summary, message);
+	summaryBytes[summary->level] += strlen(message);
+	summaryRecs[summary->level]++;
+}
+
+/*-------------------- A g g r e g a t e ( ) -------------------------------------
+	Purpose:	Compare the reply traffic of raw readings with window summaries.
+*/
+static int Aggregate(int argc, char *argv[]){
+	CPU_INT32U nodes = 16;
+	CPU_INT32U interval = 10;
+	CPU_INT32U hours = 24;
+	CPU_INT64U rawBytes = 0, keptBytes = 0, readings = 0, packets = 0;
+	CPU_INT64S updateNs = 0;
+	CPU_INT64U ticks, t, step, sent;
+	CPU_INT32S level, from;
+	CPU_INT08U pkt[GenMaxPkt];
+	CPU_CHAR message[80];
+	Payload payload;
+	ParserCtx ctx;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:i:H:")) != -1){
+		switch (opt){
+		case 'n': nodes = strtoul(optarg, NULL, 0); break;
+		case 'i': interval = strtoul(optarg, NULL, 0); break;
+		case 'H': hours = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (nodes < 1 || nodes > 254 || nodes > NodeCacheNodes || interval < 1) return 2;
+
+	PktGenInit(&gen, 30);
+	ParserCtxInit(&ctx);
+	NodeCacheInit();
+	AggregateInit(0);
+	ticks = (CPU_INT64U)hours * 3600 * TicksPerSec;
+	step = (CPU_INT64U)interval * TicksPerSec / nodes;
+
+	for (t = 0; t < ticks; t += step ? step : 1){
+		CPU_INT08U src = (CPU_INT08U)(2 + packets % nodes);
+		CPU_INT08U len = PktGenNext(&gen, pkt, StationAddr, src);
+		CPU_INT08U i;
+		CPU_BOOLEAN summarized = FALSE;
+		Reading rdg;
+
+		packets++;
+		AggregateTick((CPU_INT32U)t, CountSummary);
+		for (i = 0; i < len; i++)
+			if (ParseByte(&ctx, &payload, pkt[i]))
+				break;
+		ConstructMessage(&payload, message);
+		rawBytes += strlen(message);
+
+		if (payload.msgType != 'D' &&
+		    DecodeReading(payload.msgType, payload.data, payload.payloadLen - PayloadHeaderDiff, &rdg)){
+			CPU_INT64S t0 = NowNs();
+
+			NodeCacheUpdate(src, payload.msgType, &rdg, (CPU_INT32U)t);
+			summarized = AggregateUpdate(src, payload.msgType, rdg.value);
+			updateNs += NowNs() - t0;
+			readings += summarized;
+		}
+		if (!summarized)
+			keptBytes += strlen(message);
+	}
+	AggregateTick((CPU_INT32U)ticks, CountSummary);
+
+	printf("simulated        %u nodes, one packet each per %u s, %u hours\n", nodes, interval, hours);
+	printf("packets          %llu (%llu readings summarized)\n", packets, readings);
+	printf("every reading    %llu bytes, %.1f s of a 9600 baud link\n", rawBytes, rawBytes * 10 / 9600.0);
+	for (level = 0; level < AggLevels; level++)
+		printf("level %d          %llu summary records, %llu bytes\n", level, summaryRecs[level], summaryBytes[level]);
+	//Date stamps and IDs are sent as they are in every case.
+	for (from = 0; from < AggLevels; from++){
+		for (sent = keptBytes, level = from; level < AggLevels; level++)
+			sent += summaryBytes[level];
+		printf("levels %d..%d only %llu bytes, %.1f s of a 9600 baud link, %.1fx fewer\n",
+		       from, AggLevels - 1, sent, sent * 10 / 9600.0, rawBytes / (double)sent);
+	}
+	printf("update cost      %.0f ns per reading (cache + aggregate)\n", readings ? updateNs / (double)readings : 0.0);
+	return 0;
+}
+
+/*-------------------- R u n D e a d b a n d ( ) -------------------------------------
+	Purpose:	Send simulated traffic through the deadband filter.
+	Return:		Reply bytes with and without the filter.
+*/
+static CPU_VOID RunDeadband(CPU_INT32U nodes, CPU_INT32U interval, CPU_INT32U hours,
+                            CPU_INT64U *rawBytes, CPU_INT64U *sentBytes, DeadbandStats *stats){
+	CPU_INT64U ticks = (CPU_INT64U)hours * 3600 * TicksPerSec;
+	CPU_INT64U step = (CPU_INT64U)interval * TicksPerSec / nodes;
+	CPU_INT64U t, packets = 0;
+	CPU_INT08U pkt[GenMaxPkt];
+	CPU_CHAR message[80];
+	Payload payload;
+	ParserCtx ctx;
+	PktGen gen;
+
+	PktGenInit(&gen, 31);
+	ParserCtxInit(&ctx);
+	NodeCacheInit();
+	*rawBytes = *sentBytes = 0;
+
+	for (t = 0; t < ticks; t += step ? step : 1){
+		CPU_INT08U src = (CPU_INT08U)(2 + packets++ % nodes);
+		CPU_INT08U len = PktGenNext(&gen, pkt, StationAddr, src);
+		CPU_INT08U i;
+		Reading rdg;
+
+		for (i = 0; i < len; i++)
+			if (ParseByte(&ctx, &payload, pkt[i]))
+				break;
+		ConstructMessage(&payload, message);
+		*rawBytes += strlen(message);
+
+		if (DecodeReading(payload.msgType, payload.data, payload.payloadLen - PayloadHeaderDiff, &rdg)){
+			NodeCacheUpdate(src, payload.msgType, &rdg, (CPU_INT32U)t);
+			if (!DeadbandPass(src, payload.msgType, &rdg, (CPU_INT32U)t))
+				continue;
+		}
+		*sentBytes += strlen(message);
+	}
+	DeadbandGetStats(stats);
+}
+
+/*-------------------- D e a d b a n d ( ) -------------------------------------
+	Purpose:	Show the reply bytes the deadband filter saves.
+*/
+static int Deadband(int argc, char *argv[]){
+	static const DeadbandCfg AnyChange = {1, 0, 1, DeadbandSilence};
+	CPU_INT32U nodes = 16;
+	CPU_INT32U interval = 10;
+	CPU_INT32U hours = 24;
+	CPU_INT64U rawBytes, sentBytes;
+	DeadbandStats stats;
+	CPU_INT32U pass, type;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:i:H:")) != -1){
+		switch (opt){
+		case 'n': nodes = strtoul(optarg, NULL, 0); break;
+		case 'i': interval = strtoul(optarg, NULL, 0); break;
+		case 'H': hours = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (nodes < 1 || nodes > 254 || nodes > NodeCacheNodes || interval < 1) return 2;
+
+	printf("simulated        %u nodes, one packet each per %u s, %u hours\n", nodes, interval, hours);
+	for (pass = 0; pass < 2; pass++){
+		DeadbandInit();
+		if (pass == 1)
+			for (type = 0; type < RdgSpare; type++)
+				if (type != RdgD) DeadbandSet(ReadingTypeChar(type), &AnyChange);
+
+		RunDeadband(nodes, interval, hours, &rawBytes, &sentBytes, &stats);
+		printf("\n%s\n", pass == 0 ? "default thresholds" : "any change");
+		for (type = 0; type < RdgSpare; type++)
+			printf("  %c  %8u emitted %8u suppressed\n", ReadingTypeChar(type), stats.emitted[type], stats.suppressed[type]);
+		printf("  every reading  %llu bytes, %.1f s of a 9600 baud link\n", rawBytes, rawBytes * 10 / 9600.0);
+		printf("  filtered       %llu bytes, %.1f s of a 9600 baud link, %.1f%% saved\n",
+		       sentBytes, sentBytes * 10 / 9600.0, 100.0 * (rawBytes - sentBytes) / rawBytes);
+	}
+	return 0;
+}
+
+/*-------------------- S t a t i o n T e x t ( ) -------------------------------------
+	Purpose:	Write the text reply the station sends for a payload, including
+			the prefix ReplyError() puts on error and info messages
+			(the station builds with ShortReplies).
+*/
+static CPU_VOID StationText(Payload *payload, CPU_CHAR *text){
+	CPU_CHAR message[80];
+
+	if (ConstructMessage(payload, text))
+		return;
+	strcpy(message, text);
+	sprintf(text, "\n*** ERR: %s\n", message + 1);
+}
+
+/*-------------------- R e p l i e s ( ) -------------------------------------
+	Purpose:	Compare text and binary replies, and check that the binary
+			replies carry everything the text ones do.
+*/
+static int Replies(int argc, char *argv[]){
+	static const CPU_INT32U Bauds[] = { 9600, 115200 };
+	CPU_INT32U packets = 1000000;
+	CPU_INT64U textBytes = 0, binBytes = 0, readings = 0, mismatches = 0, decoded = 0;
+	CPU_INT08U *stream;
+	CPU_CHAR (*texts)[80];
+	CPU_INT08U pkt[GenMaxPkt];
+	CPU_CHAR text[80];
+	CPU_INT64S t0, decodeNs;
+	CPU_INT32U n, b;
+	ReplyDecoder dec;
+	ReplyRecord rec;
+	Payload payload;
+	Reading rdg;
+	CPU_BOOLEAN isReading;
+	ParserCtx ctx;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:")) != -1){
+		switch (opt){
+		case 'p': packets = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (packets < 1) return 2;
+
+	stream = malloc((size_t)packets * FrameMaxLen);
+	texts = malloc((size_t)packets * sizeof(*texts));
+	if (stream == NULL || texts == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	PktGenInit(&gen, 32);
+	ParserCtxInit(&ctx);
+	for (n = 0; n < packets; n++){
+		CPU_INT32U r = PktGenRand(&gen) % 1000;
+		CPU_INT08U src = (CPU_INT08U)(2 + PktGenRand(&gen) % 200);
+		CPU_INT08U len, i;
+
+		if (r < 10){
+			len = PktGenType(&gen, pkt, StationAddr, src, 'X');     // Unknown type
+		}else if (r < 30){
+			len = PktGenNext(&gen, pkt, 7, src);                     // Another station's
+		}else{
+			len = PktGenNext(&gen, pkt, StationAddr, src);
+			if (r < 40) pkt[len - 1] ^= 0x55;                        // Bad checksum
+		}
+		for (i = 0; i < len; i++)
+			if (ParseByte(&ctx, &payload, pkt[i]))
+				break;
+
+		StationText(&payload, texts[n]);
+		textBytes += strlen(texts[n]);
+		if (payload.payloadLen > 0 && payload.dstAddr == StationAddr && payload.msgType != 'I' && payload.msgType != 'X')
+			readings++;
+		isReading = payload.payloadLen > 0 && payload.dstAddr == StationAddr &&
+		            DecodeReading(payload.msgType, payload.data, payload.payloadLen - PayloadHeaderDiff, &rdg);
+		binBytes += ConstructFrame(&payload, isReading ? &rdg : NULL, stream + binBytes);
+	}
+
+	//Decode once for timing, then again checking every record.
+	ReplyDecoderInit(&dec);
+	t0 = NowNs();
+	for (b = 0; b < binBytes; b++)
+		decoded += ReplyDecodeByte(&dec, stream[b], &rec);
+	decodeNs = NowNs() - t0;
+
+	ReplyDecoderInit(&dec);
+	for (n = 0, b = 0; b < binBytes; b++)
+		if (ReplyDecodeByte(&dec, stream[b], &rec)){
+			ReplyRecordText(&rec, text);
+			if (n >= packets || strcmp(text, texts[n]) != 0){
+				if (mismatches++ < 5)
+					printf("mismatch %u: station \"%s\" decoded \"%s\"\n", n, n < packets ? texts[n] : "", text);
+			}
+			n++;
+		}
+
+	printf("packets          %u (%llu readings)\n", packets, readings);
+	printf("text replies     %llu bytes, %.1f per packet\n", textBytes, textBytes / (double)packets);
+	printf("binary replies   %llu bytes, %.1f per packet, %.1fx smaller\n",
+	       binBytes, binBytes / (double)packets, textBytes / (double)binBytes);
+	for (b = 0; b < sizeof(Bauds) / sizeof(Bauds[0]); b++)
+		printf("%6u baud      text %6.0f replies/s   binary %6.0f replies/s\n", Bauds[b],
+		       Bauds[b] / 10.0 / (textBytes / (double)packets), Bauds[b] / 10.0 / (binBytes / (double)packets));
+	printf("decoded          %llu frames, %llu CRC errors, %llu bytes skipped\n",
+	       dec.frames, dec.crcErrors, dec.skipped);
+	printf("round trip       %llu of %u texts differ\n", mismatches + (packets - n), packets);
+	printf("decode cost      %.1f ns per frame, %.0f MB/s\n",
+	       decoded ? decodeNs / (double)decoded : 0.0, binBytes * 1000.0 / decodeNs);
+
+	free(stream);
+	free(texts);
+	return mismatches != 0 || n != packets;
+}
+
+typedef struct
+{
+	CPU_INT64U time;              // Arrival in ticks
+	CPU_INT32U id;                // Packet number; copies share it
+	CPU_BOOLEAN copy;             // A relayed copy
+	CPU_INT08U len;
+	CPU_INT08U pkt[GenMaxPkt];
+} Arrival;
+
+/*-------------------- B y T i m e ( ) -------------------------------------
+	Purpose:	qsort order for arrivals: by time, originals before their copies.
+*/
+static int ByTime(const void *a, const void *b){
+	const Arrival *x = a, *y = b;
+
+	if (x->time != y->time) return x->time < y->time ? -1 : 1;
+	if (x->id != y->id) return x->id < y->id ? -1 : 1;
+	return x->copy - y->copy;
+}
+
+/*-------------------- D e d u p ( ) -------------------------------------
+	Purpose:	Measure how well the duplicate cache catches relayed copies.
+*/
+static int Dedup(int argc, char *argv[]){
+	CPU_INT32U nodes = 64;
+	CPU_INT32U interval = 10;
+	CPU_INT32U relay = 50;
+	CPU_INT32U delay = 500;
+	CPU_INT32U hours = 1;
+	CPU_INT64U ticks, step, t, caught = 0, missed = 0, wrong = 0, copies = 0;
+	CPU_INT64U n, count = 0, max;
+	CPU_INT64S lookupNs = 0;
+	Arrival *arrivals;
+	DupCacheStats stats;
+	Payload payload;
+	ParserCtx ctx;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:i:r:d:H:")) != -1){
+		switch (opt){
+		case 'n': nodes = strtoul(optarg, NULL, 0); break;
+		case 'i': interval = strtoul(optarg, NULL, 0); break;
+		case 'r': relay = strtoul(optarg, NULL, 0); break;
+		case 'd': delay = strtoul(optarg, NULL, 0); break;
+		case 'H': hours = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (nodes < 1 || nodes > 254 || interval < 1 || relay > 100 || delay < 1) return 2;
+
+	ticks = (CPU_INT64U)hours * 3600 * TicksPerSec;
+	step = (CPU_INT64U)interval * TicksPerSec / nodes;
+	if (step == 0) step = 1;
+	max = (ticks / step + 1) * 3;
+	arrivals = malloc(max * sizeof(*arrivals));
+	if (arrivals == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	//Each node reports in turn; some packets are relayed once or twice more.
+	PktGenInit(&gen, 34);
+	for (t = 0, n = 0; t < ticks; t += step, n++){
+		Arrival *a = &arrivals[count++];
+		CPU_INT32U extra = PktGenRand(&gen) % 100 < relay ? 1 + PktGenRand(&gen) % 2 : 0;
+
+		a->time = t;
+		a->id = (CPU_INT32U)n;
+		a->copy = FALSE;
+		a->len = PktGenNext(&gen, a->pkt, StationAddr, (CPU_INT08U)(2 + n % nodes));
+		while (extra-- > 0){
+			Arrival *c = &arrivals[count++];
+
+			*c = *a;
+			c->time = t + 1 + PktGenRand(&gen) % delay;
+			c->copy = TRUE;
+			copies++;
+		}
+	}
+	qsort(arrivals, count, sizeof(*arrivals), ByTime);
+
+	ParserCtxInit(&ctx);
+	DupCacheInit();
+	for (n = 0; n < count; n++){
+		Arrival *a = &arrivals[n];
+		CPU_INT64S t0;
+		CPU_BOOLEAN seen;
+		CPU_INT08U i;
+
+		for (i = 0; i < a->len; i++)
+			if (ParseByte(&ctx, &payload, a->pkt[i]))
+				break;
+		if (payload.payloadLen <= 0)
+			continue;
+		//Same key the station uses: source, type and data bytes.
+		t0 = NowNs();
+		seen = DupCacheSeen(&payload.srcAddr, payload.payloadLen - PacketHeaderDiff - 1, (CPU_INT32U)a->time);
+		lookupNs += NowNs() - t0;
+		if (a->copy){
+			if (seen) caught++;
+			else missed++;
+		}else if (seen)
+			wrong++;
+	}
+	DupCacheGetStats(&stats);
+
+	printf("cache            %u sets x %u ways, %u tick TTL, %u bytes\n",
+	       DupSets, DupWays, DupTtl, (CPU_INT32U)(DupSets * DupWays * 8));
+	printf("simulated        %u nodes, one packet each per %u s, %u%% relayed up to %u ms late, %u hours\n",
+	       nodes, interval, relay, delay, hours);
+	printf("arrivals         %llu (%llu packets, %llu relayed copies)\n", count, count - copies, copies);
+	printf("copies dropped   %llu (%.2f%%)\n", caught, copies ? 100.0 * caught / copies : 0.0);
+	printf("copies missed    %llu\n", missed);
+	printf("wrongly dropped  %llu new packets\n", wrong);
+	printf("hit rate         %.2f%% of %u lookups, %u live entries evicted\n",
+	       stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0, stats.lookups, stats.evictions);
+	printf("lookup cost      %.1f ns\n", stats.lookups ? lookupNs / (double)stats.lookups : 0.0);
+	free(arrivals);
+	return 0;
+}
+
+/*-------------------- P a r s e S t r e a m ( ) -------------------------------------
+	Purpose:	Parse a capture held in memory.
+	Return:		Nanoseconds taken; *good gets the number of good payloads.
+*/
+static CPU_INT64S ParseStream(const CPU_INT08U *stream, CPU_INT64U len, CPU_INT64U *good){
+	CPU_INT64S t0 = NowNs();
+	Payload payload;
+	ParserCtx ctx;
+	CPU_INT64U b;
+
+	ParserCtxInit(&ctx);
+	*good = 0;
+	for (b = 0; b < len; b++)
+		if (ParseByte(&ctx, &payload, stream[b]) && payload.payloadLen > 0)
+			do
+				(*good)++;
+			while (ParseMore(&ctx, &payload));
+	return NowNs() - t0;
+}
+
+/*-------------------- C o r r u p t ( ) -------------------------------------
+	Purpose:	Flip bits in a packet from byte first on: flips random bits, or
+			with flips 0 a burst of BurstBits bits starting at a random bit.
+*/
+#define BurstBits 32
+
+static CPU_VOID Corrupt(PktGen *gen, CPU_INT08U *pkt, CPU_INT08U first, CPU_INT08U len, CPU_INT32U flips){
+	CPU_INT32U bits = (len - first) * 8;
+	CPU_INT32U bit, i;
+
+	if (flips == 0){
+		//Both ends of the burst flip, the bits between at random
+		bit = PktGenRand(gen) % (bits - BurstBits + 1);
+		for (i = 0; i < BurstBits; i++)
+			if (i == 0 || i == BurstBits - 1 || (PktGenRand(gen) & 1))
+				pkt[first + (bit + i) / 8] ^= (CPU_INT08U)(1 << ((bit + i) % 8));
+		return;
+	}
+	for (i = 0; i < flips; i++){
+		bit = PktGenRand(gen) % bits;
+		pkt[first + bit / 8] ^= (CPU_INT08U)(1 << (bit % 8));
+	}
+}
+
+/*-------------------- C r c ( ) -------------------------------------
+	Purpose:	Show what CRC mode costs and what it catches that the checksum misses.
+*/
+static int Crc(int argc, char *argv[]){
+	static const CPU_CHAR *ModeName[] = { "checksum", "CRC-32" };
+	static const CPU_CHAR *FlipName[] = { "burst", "1", "2", "3", "4" };
+	static const CPU_INT08U DataAt[] = { 5, 4 };      // Where dst is in each framing
+	static const CPU_INT08U Overhead[] = { 5, 8 };    // Bytes that are not payload
+	CPU_INT32U packets = 1000000;
+	CPU_INT32U mb = 64;
+	CPU_INT64U size, b, len[2], good;
+	CPU_INT64S ns, budgetNs = NsPerSec * 10 / FastBaud;
+	CPU_INT08U *block, *stream[2];
+	CPU_INT32U crc = 0, mode, flips, n;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:m:")) != -1){
+		switch (opt){
+		case 'p': packets = strtoul(optarg, NULL, 0); break;
+		case 'm': mb = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (packets < 1 || mb < 1) return 2;
+
+	size = (CPU_INT64U)mb << 20;
+	block = malloc(size);
+	stream[0] = malloc((size_t)packets * GenMaxPkt);
+	stream[1] = malloc((size_t)packets * GenMaxPkt);
+	if (block == NULL || stream[0] == NULL || stream[1] == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	Crc32Init();
+	PktGenInit(&gen, 35);
+	for (b = 0; b < size; b++)
+		block[b] = (CPU_INT08U)PktGenRand(&gen);
+
+	printf("budget           %lld ns per byte at %u baud\n", budgetNs, FastBaud);
+
+	ns = NowNs();
+	crc = Crc32Block(Crc32Seed, block, (CPU_INT32U)size);
+	ns = NowNs() - ns;
+	printf("slice-by-8       %.2f ns per byte, %.0f MB/s\n", ns / (double)size, size * 1000.0 / ns);
+
+	ns = NowNs();
+	{
+		CPU_INT32U c = Crc32Seed, w;
+
+		for (b = 0; b < size; b += 4){
+			memcpy(&w, block + b, 4);
+			c = Crc32Word(c, w);
+		}
+		if (c != crc) printf("word at a time CRC differs!\n");
+	}
+	ns = NowNs() - ns;
+	printf("word at a time   %.2f ns per byte, %.0f MB/s\n", ns / (double)size, size * 1000.0 / ns);
+
+	//The same traffic framed both ways
+	for (mode = 0; mode < 2; mode++){
+		PktGenInit(&gen, 36);
+		gen.crcMode = (CPU_BOOLEAN)mode;
+		for (len[mode] = 0, n = 0; n < packets; n++)
+			len[mode] += PktGenNext(&gen, stream[mode] + len[mode], StationAddr, (CPU_INT08U)(2 + n % 200));
+		ns = ParseStream(stream[mode], len[mode], &good);
+		printf("parse %-10s %.2f ns per byte (%.3f%% of budget), %.1f bytes per packet, %llu good\n",
+		       ModeName[mode], ns / (double)len[mode], 100.0 * ns / len[mode] / budgetNs,
+		       len[mode] / (double)packets, good);
+	}
+
+	//Corrupt one packet at a time and see whether a payload still comes out
+	printf("\nundetected corruption, %u packets each\n", packets / 10);
+	printf("  flips      checksum     CRC-32\n");
+	for (flips = 1; flips <= 5; flips++){
+		CPU_INT32U f = flips % 5;       // 0 for the burst, last
+		CPU_INT64U missed[2];
+
+		for (mode = 0; mode < 2; mode++){
+			PktGenInit(&gen, 37);
+			gen.crcMode = (CPU_BOOLEAN)mode;
+			missed[mode] = 0;
+			for (n = 0; n < packets / 10; n++){
+				CPU_INT08U pkt[GenMaxPkt], orig[GenMaxPkt];
+				CPU_INT08U plen = PktGenNext(&gen, pkt, StationAddr, (CPU_INT08U)(2 + n % 200));
+				CPU_INT08U i;
+				Payload payload;
+				ParserCtx ctx;
+
+				//Damage everything from dst on; the preamble and length are left
+				//alone so both framings stay in step.
+				memcpy(orig, pkt, plen);
+				Corrupt(&gen, pkt, DataAt[mode], plen, f);
+				ParserCtxInit(&ctx);
+				for (i = 0; i < plen; i++)
+					if (ParseByte(&ctx, &payload, pkt[i]))
+						break;
+				if (payload.payloadLen > 0 && memcmp(&payload.dstAddr, &orig[DataAt[mode]], plen - Overhead[mode]) != 0)
+					missed[mode]++;
+			}
+		}
+		printf("  %-6s   %9llu  %9llu\n", FlipName[f], missed[0], missed[1]);
+	}
+
+	free(block);
+	free(stream[0]);
+	free(stream[1]);
+	return 0;
+}
+
+/*-------------------- M u l t i ( ) -------------------------------------
+	Purpose:	Measure what aggregate frames buy in payloads per second.
+*/
+static int Multi(int argc, char *argv[]){
+	CPU_INT32U payloads = 1000000;
+	CPU_INT32U baud = LinkBaud;
+	CPU_INT08U *stream;
+	CPU_INT08U srcAddrs[GenMaxAgg];
+	CPU_INT64U len, good;
+	CPU_INT64S ns;
+	CPU_INT32U per, n, i;
+	double bytes, rate, single = 0;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:b:")) != -1){
+		switch (opt){
+		case 'p': payloads = strtoul(optarg, NULL, 0); break;
+		case 'b': baud = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (payloads < 1 || baud < BitsPerByte) return 2;
+
+	stream = malloc((size_t)payloads * GenMaxPkt);
+	if (stream == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	printf("%u payloads at %u baud\n", payloads, baud);
+	printf("  per frame  bytes/payload  payloads/s   gain   parse ns/payload  parsed\n");
+	for (per = 1; per <= GenMaxAgg; per++){
+		//Same seed, so every row carries the same readings
+		PktGenInit(&gen, 38);
+		for (len = 0, n = 0; n < payloads; n += per){
+			CPU_INT32U count = payloads - n < per ? payloads - n : per;
+
+			for (i = 0; i < count; i++)
+				srcAddrs[i] = (CPU_INT08U)(2 + (n + i) % 200);
+			if (per == 1)
+				len += PktGenNext(&gen, stream + len, StationAddr, srcAddrs[0]);
+			else
+				len += PktGenAggregate(&gen, stream + len, StationAddr, srcAddrs, (CPU_INT08U)count);
+		}
+		ns = ParseStream(stream, len, &good);
+		bytes = len / (double)payloads;
+		rate = baud / (double)BitsPerByte / bytes;
+		if (per == 1) single = rate;
+		printf("  %9u  %13.2f  %10.1f  %5.2fx  %16.1f  %s\n", per, bytes, rate, rate / single,
+		       ns / (double)payloads, good == payloads ? "ok" : "MISMATCH");
+	}
+
+	free(stream);
+	return 0;
+}
+
+/*-------------------- S e q ( ) -------------------------------------
+	Purpose:	Check the sequence tracker's counts against a link with known faults.
+*/
+static int Seq(int argc, char *argv[]){
+	CPU_INT32U nodes = 64;
+	CPU_INT32U packets = 1000000;
+	CPU_INT32U loss = 2, dup = 1, late = 2, window = 8;
+	CPU_INT64U n, count = 0, lost = 0, dups = 0, reordered = 0;
+	CPU_INT64S ns, trackNs;
+	CPU_INT32U nextSeq[GenNodes], newest[GenNodes];
+	CPU_INT32U *trueSeq;
+	CPU_INT08U *seen, *src, *seq;
+	Arrival *arrivals;
+	SeqStats stats;
+	Payload payload;
+	ParserCtx ctx;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:p:l:d:r:w:")) != -1){
+		switch (opt){
+		case 'n': nodes = strtoul(optarg, NULL, 0); break;
+		case 'p': packets = strtoul(optarg, NULL, 0); break;
+		case 'l': loss = strtoul(optarg, NULL, 0); break;
+		case 'd': dup = strtoul(optarg, NULL, 0); break;
+		case 'r': late = strtoul(optarg, NULL, 0); break;
+		case 'w': window = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (nodes < 1 || nodes > 254 || packets < 1 || loss + dup > 100 || late > 100 || window < 1) return 2;
+
+	arrivals = malloc((size_t)packets * 2 * sizeof(*arrivals));
+	trueSeq = malloc((size_t)packets * sizeof(*trueSeq));
+	seen = calloc(packets, 1);
+	src = malloc((size_t)packets * 2);
+	seq = malloc((size_t)packets * 2);
+	if (arrivals == NULL || trueSeq == NULL || seen == NULL || src == NULL || seq == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	//Stream positions stand in for time; a late packet moves up to
+	//window rounds of every node's packets back.
+	PktGenInit(&gen, 39);
+	gen.seqMode = TRUE;
+	memset(nextSeq, 0, sizeof(nextSeq));
+	for (n = 0; n < packets; n++){
+		CPU_INT08U addr = (CPU_INT08U)(2 + n % nodes);
+		CPU_INT32U roll = PktGenRand(&gen) % 100;
+		Arrival *a = &arrivals[count];
+
+		a->id = (CPU_INT32U)n;
+		a->copy = FALSE;
+		a->len = PktGenNext(&gen, a->pkt, StationAddr, addr);
+		a->time = n * 2;
+		trueSeq[n] = nextSeq[addr]++;
+		if (roll < loss)
+			continue;
+		if (PktGenRand(&gen) % 100 < late)
+			a->time += 2 * (1 + PktGenRand(&gen) % (window * nodes));
+		count++;
+		if (roll < loss + dup){
+			Arrival *c = &arrivals[count++];
+
+			*c = *a;
+			c->time = a->time + 1;
+			c->copy = TRUE;
+		}
+	}
+	qsort(arrivals, count, sizeof(*arrivals), ByTime);
+
+	//What the link really did, from the full sequence numbers
+	memset(newest, 0, sizeof(newest));
+	for (n = 0; n < count; n++){
+		CPU_INT32U id = arrivals[n].id;
+		CPU_INT08U addr = arrivals[n].pkt[6];
+
+		if (seen[id]){
+			dups++;
+			continue;
+		}
+		seen[id] = 1;
+		if (trueSeq[id] + 1 < newest[addr])
+			reordered++;
+		if (trueSeq[id] + 1 > newest[addr])
+			newest[addr] = trueSeq[id] + 1;
+	}
+	for (n = 0; n < packets; n++)
+		if (!seen[n]) lost++;
+
+	//Parse each arrival and strip its number the way the payload task does
+	ParserCtxInit(&ctx);
+	SeqTrackInit();
+	ns = NowNs();
+	for (n = 0; n < count; n++){
+		Arrival *a = &arrivals[n];
+		CPU_INT08U i;
+
+		for (i = 0; i < a->len; i++)
+			if (ParseByte(&ctx, &payload, a->pkt[i]))
+				break;
+		if (payload.payloadLen <= PayloadHeaderDiff || !(payload.msgType & SeqFlag))
+			continue;
+		payload.payloadLen--;
+		payload.msgType &= ~SeqFlag;
+		src[n] = payload.srcAddr;
+		seq[n] = (payload.data)[payload.payloadLen - PayloadHeaderDiff];
+		SeqTrack(src[n], seq[n]);
+	}
+	ns = NowNs() - ns;
+	SeqTrackGetStats(&stats);
+
+	//The tracker alone, on the same numbers
+	SeqTrackInit();
+	trackNs = NowNs();
+	for (n = 0; n < count; n++)
+		SeqTrack(src[n], seq[n]);
+	trackNs = NowNs() - trackNs;
+
+	printf("tracker          %u nodes, %u number window\n", SeqNodes, SeqWindow);
+	printf("link             %u nodes, %u packets, %u%% lost, %u%% repeated, %u%% up to %u late\n",
+	       nodes, packets, loss, dup, late, window);
+	printf("                 link      tracker\n");
+	printf("  received  %10llu  %10u\n", count, stats.received);
+	printf("  lost      %10llu  %10u\n", lost, stats.lost);
+	printf("  repeated  %10llu  %10u\n", dups, stats.duplicates);
+	printf("  reordered %10llu  %10u\n", reordered, stats.reordered);
+	printf("  too late  %10s  %10u\n", "", stats.tooLate);
+	printf("  restarts  %10u  %10u\n", 0, stats.restarts);
+	printf("cost             %.1f ns per packet tracked, %.1f ns parsed and tracked\n",
+	       trackNs / (double)count, ns / (double)count);
+
+	free(arrivals);
+	free(trueSeq);
+	free(seen);
+	free(src);
+	free(seq);
+	return 0;
+}
+
+//The payload data union and switch the MsgDesc table replaced, kept to
+//check and time the table against.
+typedef union
+{
+	CPU_INT16U pres;
+	CPU_INT32U dateTime;
+	struct { CPU_INT16S dewPt; CPU_INT08U hum; } hum;
+	CPU_INT08U id[PayloadMaxData + 1];
+	CPU_INT08U depth[2];
+	CPU_INT16U rad;
+	CPU_INT16S temp;
+	struct { CPU_INT08U speed[2]; CPU_INT16U dir; } wind;
+} SwitchData;
+
+/*-------------------- S w i t c h M e s s a g e ( ) -------------------------------------
+	Purpose:	The old ConstructMessage() switch, for a reading or ID payload.
+	Return:		FALSE for an unknown type.
+*/
+static CPU_BOOLEAN SwitchMessage(const Payload *payload, CPU_CHAR *message){
+	SwitchData d;
+	CPU_INT32U ts;
+
+	memcpy(&d, payload->data, PayloadMaxData);
+	switch (payload->msgType){
+	case 'B': sprintf(message, "\nN%u P = %u\n", payload->srcAddr, d.pres); break;
+	case 'D':
+		ts = ((d.dateTime >> 24) & 0xFF) | ((d.dateTime << 8) & 0xFF0000) | ((d.dateTime >> 8) & 0xFF00) | (d.dateTime << 24);
+		sprintf(message, "\nN%u TS = %u/%u/%u %u:%u\n", payload->srcAddr,
+		        (ts & 0xF0000) >> 16, (ts & 0xF800) >> 11, (ts & 0xFFF00000) >> 20, (ts & 0x7C0) >> 6, ts & 0x3F);
+		break;
+	case 'H': sprintf(message, "\nN%u DP = %u H = %u\n", payload->srcAddr, d.hum.dewPt, d.hum.hum); break;
+	case 'I':
+		d.id[payload->payloadLen - PayloadHeaderDiff] = '\0';
+		sprintf(message, "\nN%u ID = %s\n", payload->srcAddr, d.id);
+		break;
+	case 'P':
+		sprintf(message, "\nN%u = %u.%u%u\n", payload->srcAddr, ((d.depth[0] & 0xF0) >> 4) * 10 + (d.depth[0] & 0x0F),
+		        (d.depth[1] & 0xF0) >> 4, d.depth[1] & 0x0F);
+		break;
+	case 'R': sprintf(message, "\nN%u R = %u\n", payload->srcAddr, d.rad); break;
+	case 'T': sprintf(message, "\nN%u T = %i\n", payload->srcAddr, d.temp); break;
+	case 'W':
+		sprintf(message, "\nN%u SP = %u.%u  DIR = %u\n", payload->srcAddr,
+		        ((d.wind.speed[0] & 0xF0) >> 4) * 100 + (d.wind.speed[0] & 0x0F) * 10 + ((d.wind.speed[1] & 0xF0) >> 4),
+		        d.wind.speed[1] & 0x0F, d.wind.dir);
+		break;
+	default:
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------- S w i t c h R e a d i n g ( ) -------------------------------------
+	Purpose:	The old DecodeReading() switch.
+*/
+static CPU_BOOLEAN SwitchReading(CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08S dataLen, Reading *rdg){
+	static const CPU_INT08U Sizes[NumRdgTypes] = {2, 4, 3, 2, 2, 2, 4};
+	ReadingType type = ReadingIndex(msgType);
+
+	if (type == NumRdgTypes || dataLen < Sizes[type])
+		return FALSE;
+	rdg->aux = 0;
+	switch (type){
+	case RdgB:
+	case RdgR: rdg->value = data[0] | (data[1] << 8); break;
+	case RdgT: rdg->value = (CPU_INT16S)(data[0] | (data[1] << 8)); break;
+	case RdgD:
+		rdg->value = (CPU_INT32S)(((CPU_INT32U)data[0] << 24) | ((CPU_INT32U)data[1] << 16) | ((CPU_INT32U)data[2] << 8) | data[3]);
+		break;
+	case RdgH:
+		rdg->aux = (CPU_INT16S)(data[0] | (data[1] << 8));
+		rdg->value = data[2];
+		break;
+	case RdgP:
+	case RdgW:
+		rdg->value = (data[0] >> 4) * 1000 + (data[0] & 0x0F) * 100 + (data[1] >> 4) * 10 + (data[1] & 0x0F);
+		if (type == RdgW) rdg->aux = (CPU_INT16S)(data[2] | (data[3] << 8));
+		break;
+	default:
+		return FALSE;
+	}
+	return TRUE;
+}
+
+//A sensor type added at run time: light level in lux, one little endian word.
+static const MsgDesc LuxDesc = { 'L', 2, "\nN%u L = %u\n", 1, { {0, 2, 0, 0, FieldValue, 1} } };
+
+/*-------------------- N o S u m m a r y ( ) -------------------------------------
+	Purpose:	Aggregate handler for the lux type: the host keeps no summaries.
+*/
+static CPU_BOOLEAN NoSummary(CPU_INT32U node, CPU_CHAR msgType, CPU_INT32S value){
+	return FALSE;
+}
+
+static const MsgHandler LuxHandler = { &LuxDesc, MsgReading, MsgFormat, NoSummary };
+
+/*-------------------- D e c o d e ( ) -------------------------------------
+	Purpose:	Check the handler table against the switch it replaced and time both.
+*/
+static int Decode(int argc, char *argv[]){
+	CPU_INT32U payloads = 200000;
+	CPU_INT32U runs = 5;
+	CPU_INT32U n, r, textDiffs = 0, rdgDiffs = 0;
+	CPU_INT64S ns[4] = {0, 0, 0, 0};
+	CPU_INT64U sink = 0;
+	CPU_CHAR text[2][80];
+	const MsgHandler *handler;
+	CPU_INT32U unknown;
+	Payload lux, *set;
+	Reading rdg;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:r:")) != -1){
+		switch (opt){
+		case 'p': payloads = strtoul(optarg, NULL, 0); break;
+		case 'r': runs = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (payloads < 1 || runs < 1) return 2;
+
+	set = malloc((size_t)payloads * sizeof(*set));
+	if (set == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	//Parse generated packets, with some negative temperatures and dew points
+	PktGenInit(&gen, 40);
+	for (n = 0; n < payloads; n++){
+		CPU_INT08U pkt[GenMaxPkt];
+		CPU_INT08U len, i;
+		ParserCtx ctx;
+
+		if (n % 7 == 0){
+			gen.nodes[n % 200 + 2].temp = -(CPU_INT16S)(n % 30);
+			gen.nodes[n % 200 + 2].dewPt = -(CPU_INT16S)(n % 25);
+		}
+		len = PktGenNext(&gen, pkt, StationAddr, (CPU_INT08U)(2 + n % 200));
+		ParserCtxInit(&ctx);
+		for (i = 0; i < len; i++)
+			if (ParseByte(&ctx, &set[n], pkt[i]))
+				break;
+	}
+
+	for (n = 0; n < payloads; n++){
+		const Payload *p = &set[n];
+		CPU_INT08S dataLen = p->payloadLen - PayloadHeaderDiff;
+		Reading a, b;
+		CPU_BOOLEAN okA, okB;
+
+		SwitchMessage(p, text[0]);
+		handler = MsgHandlerFind(p->msgType);
+		handler->format(handler->desc, p->srcAddr, p->data, dataLen, text[1]);
+		if (strcmp(text[0], text[1]) != 0 && textDiffs++ < 3)
+			printf("text differs: %s vs %s", text[0], text[1]);
+		okA = SwitchReading(p->msgType, p->data, dataLen, &a);
+		okB = DecodeReading(p->msgType, p->data, dataLen, &b);
+		if (okA != okB || (okA && (a.value != b.value || a.aux != b.aux)))
+			rdgDiffs++;
+	}
+
+	//A type registered at run time, then a type with no handler
+	lux.payloadLen = PayloadHeaderDiff + 2;
+	lux.dstAddr = StationAddr;
+	lux.srcAddr = 9;
+	lux.msgType = 'L';
+	lux.data[0] = 0x34;
+	lux.data[1] = 0x12;
+	if (!MsgRegister('L', &LuxHandler) || ReadingIndex('L') == NumRdgTypes)
+		printf("registered type 'L' has no reading slot\n");
+	if (!ConstructMessage(&lux, text[0]) || strcmp(text[0], "\nN9 L = 4660\n") != 0 ||
+	    !DecodeReading('L', lux.data, 2, &rdg) || rdg.value != 0x1234)
+		printf("registered type 'L' failed\n");
+	MsgRegister('L', NULL);
+	unknown = MsgUnknownCount();
+	if (ConstructMessage(&lux, text[0]) || DecodeReading('L', lux.data, 2, &rdg) ||
+	    MsgUnknownCount() != unknown + 1)
+		printf("unregistered type 'L' not counted as unknown\n");
+
+	for (r = 0; r < runs; r++){
+		CPU_INT64S t;
+
+		t = NowNs();
+		for (n = 0; n < payloads; n++){
+			SwitchMessage(&set[n], text[0]);
+			sink += (CPU_INT08U)text[0][3];
+		}
+		ns[0] += NowNs() - t;
+
+		t = NowNs();
+		for (n = 0; n < payloads; n++){
+			handler = MsgHandlerFind(set[n].msgType);
+			handler->format(handler->desc, set[n].srcAddr, set[n].data,
+			                set[n].payloadLen - PayloadHeaderDiff, text[1]);
+			sink += (CPU_INT08U)text[1][3];
+		}
+		ns[1] += NowNs() - t;
+
+		t = NowNs();
+		for (n = 0; n < payloads; n++)
+			if (SwitchReading(set[n].msgType, set[n].data, set[n].payloadLen - PayloadHeaderDiff, &rdg))
+				sink += rdg.value;
+		ns[2] += NowNs() - t;
+
+		t = NowNs();
+		for (n = 0; n < payloads; n++)
+			if (DecodeReading(set[n].msgType, set[n].data, set[n].payloadLen - PayloadHeaderDiff, &rdg))
+				sink += rdg.value;
+		ns[3] += NowNs() - t;
+	}
+
+	printf("payloads         %u x %u runs (checksum %llu)\n", payloads, runs, sink & 0xFF);
+	printf("text             %u differ\n", textDiffs);
+	printf("readings         %u differ\n", rdgDiffs);
+	printf("                 switch     table\n");
+	printf("  reply text   %7.1f   %7.1f ns per payload\n",
+	       ns[0] / (double)payloads / runs, ns[1] / (double)payloads / runs);
+	printf("  reading      %7.1f   %7.1f ns per payload\n",
+	       ns[2] / (double)payloads / runs, ns[3] / (double)payloads / runs);
+
+	free(set);
+	return 0;
+}
+
+#define LogFlushEvery 128     // Readings per flush, standing in for the log task
+#define ProgramUs 52          // Half-word program time on the station, typical
+#define EraseUs 20000         // Page erase time, typical
+
+//What FlashLog hands back in a read, checked as it comes.
+static struct
+{
+	CPU_INT32U n;             // Records read
+	CPU_INT32U bad;           // Records not as written, or out of order
+	CPU_INT32U first, last;   // Reading numbers of the first and last records
+	CPU_BOOLEAN ended;        // The NULL after the last record came
+} logCheck;
+
+/*-------------------- L o g R e a d i n g ( ) -------------------------------------
+	Purpose:	Put reading number i in the flash log. Every field follows from
+	                i, so a record read back can be checked on its own.
+*/
+static CPU_VOID LogReading(CPU_INT32U i){
+	Reading rdg;
+
+	rdg.value = (CPU_INT32S)(i * 7);
+	rdg.aux = (CPU_INT16S)(i & 0x7FFF);
+	FlashLogPut((CPU_INT08U)(i % 200 + 2), "BDHPRTW"[i % 7], &rdg, i);
+	if (i % LogFlushEvery == LogFlushEvery - 1)
+		FlashLogFlush();
+}
+
+/*-------------------- C h e c k L o g R e c o r d ( ) -------------------------------------
+	Purpose:	FlashLogRead() function: check each record against its number.
+*/
+static CPU_VOID CheckLogRecord(const LogRecord *rec){
+	CPU_INT32U i;
+
+	if (rec == NULL){
+		logCheck.ended = TRUE;
+		return;
+	}
+	i = rec->time;
+	if (rec->value != (CPU_INT32S)(i * 7) || rec->aux != (CPU_INT16S)(i & 0x7FFF) ||
+	    rec->node != i % 200 + 2 || rec->msgType != "BDHPRTW"[i % 7] ||
+	    (logCheck.n > 0 && i <= logCheck.last))
+		logCheck.bad++;
+	if (logCheck.n++ == 0)
+		logCheck.first = i;
+	logCheck.last = i;
+}
+
+/*-------------------- C h e c k L o g ( ) -------------------------------------
+	Purpose:	Read the whole log back through CheckLogRecord().
+*/
+static CPU_VOID CheckLog(CPU_VOID){
+	memset(&logCheck, 0, sizeof(logCheck));
+	FlashLogRead(CheckLogRecord);
+	if (!logCheck.ended)
+		logCheck.bad++;
+}
+
+/*-------------------- F l a s h L o g B e n c h ( ) -------------------------------------
+	Purpose:	Endurance, throughput and power failure tests of the flash log.
+*/
+static int FlashLogBench(int argc, char *argv[]){
+	const CPU_CHAR *path = "/tmp/flashlog.bin";
+	CPU_INT32U readings = 2000000;
+	CPU_INT32U cuts = 200;
+	CPU_INT32U wear[LogPages];
+	CPU_INT32U i, c, minWear, maxWear, kept, frameDiffs = 0;
+	CPU_INT64S t0, ns;
+	CPU_INT64U programs;
+	CPU_INT08U frame[FrameMaxLen];
+	CPU_CHAR text[2][80];
+	ReplyDecoder dec;
+	ReplyRecord rec;
+	LogRecord log;
+	LogStats stats;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:n:c:")) != -1){
+		switch (opt){
+		case 'f': path = optarg; break;
+		case 'n': readings = strtoul(optarg, NULL, 0); break;
+		case 'c': cuts = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (readings < 1) return 2;
+
+	//A fresh log
+	remove(path);
+	if (!FlashSimOpen(path)){
+		fprintf(stderr, "cannot open %s\n", path);
+		return 1;
+	}
+	FlashLogInit();
+
+	t0 = NowNs();
+	for (i = 0; i < readings; i++)
+		LogReading(i);
+	FlashLogFlush();
+	ns = NowNs() - t0;
+
+	FlashLogGetStats(&stats);
+	FlashSimGetWear(wear);
+	minWear = maxWear = wear[0];
+	for (c = 1; c < LogPages; c++){
+		if (wear[c] < minWear) minWear = wear[c];
+		if (wear[c] > maxWear) maxWear = wear[c];
+	}
+	programs = (CPU_INT64U)stats.logged * (sizeof(LogRecord) / 2) + (CPU_INT64U)stats.erases * 3;
+	printf("readings         %u logged, %u dropped, %u failed\n", stats.logged, stats.dropped, stats.failed);
+	printf("host             %.1f ns per reading\n", ns / (double)readings);
+	printf("station flash    %.0f us busy per reading (%u half-words, %u erases)\n",
+	       (programs * ProgramUs + (CPU_INT64U)stats.erases * EraseUs) / (double)readings,
+	       (CPU_INT32U)programs, stats.erases);
+	printf("page wear        %u to %u erases over %u pages\n", minWear, maxWear, LogPages);
+
+	CheckLog();
+	printf("log              %u records, readings %u to %u, %u bad\n",
+	       logCheck.n, logCheck.first, logCheck.last, logCheck.bad);
+
+	//Found again after a reset
+	kept = logCheck.n;
+	FlashSimClose();
+	FlashSimOpen(path);
+	FlashLogInit();
+	FlashLogGetStats(&stats);
+	CheckLog();
+	printf("reopened         %u records (%u before), readings %u to %u, %u bad\n",
+	       stats.records, kept, logCheck.first, logCheck.last, logCheck.bad);
+
+	//Power failures part way through a flush
+	PktGenInit(&gen, 17);
+	for (c = 0; c < cuts; c++){
+		CPU_INT32U n;
+
+		FlashSimCutAfter((CPU_INT32S)(PktGenRand(&gen) % (LogFlushEvery * sizeof(LogRecord) / 2)));
+		for (n = 0; n < LogFlushEvery; n++)
+			LogReading(i++);
+		FlashSimClose();
+		FlashSimOpen(path);
+		FlashLogInit();
+	}
+	//Then a clean run, which must all be there at the end
+	c = i;
+	for (; i < c + 10 * LogFlushEvery; i++)
+		LogReading(i);
+	FlashLogFlush();
+	FlashLogGetStats(&stats);
+	CheckLog();
+	printf("power cuts       %u: %u records, %u bad, last %u readings %s\n", cuts, logCheck.n, logCheck.bad,
+	       10 * LogFlushEvery, logCheck.last == i - 1 && stats.records == logCheck.n ? "all there" : "MISSING");
+
+	//Queue overflow: the payload task never waits. Multiples of
+	//LogFlushEvery never trigger a flush.
+	for (c = 0; c < LogBfrRecs + 10; c++)
+		LogReading(i++ * LogFlushEvery);
+	FlashLogGetStats(&stats);
+	printf("queue full       %u dropped (expect 10)\n", stats.dropped);
+	FlashLogFlush();
+
+	//Export frames decode to the same text
+	ReplyDecoderInit(&dec);
+	for (c = 0; c < 1000; c++){
+		CPU_INT08U len, b;
+
+		log.time = c * 977;
+		log.value = (CPU_INT32S)(c * 123457) - 50000000;
+		log.aux = (CPU_INT16S)(c * 31 - 9000);
+		log.node = (CPU_INT08U)c;
+		log.msgType = "BDHPRTW"[c % 7];
+		FlashLogFormat(&log, text[0]);
+		len = FrameLogRecord(frame, &log);
+		text[1][0] = '\0';
+		for (b = 0; b < len; b++)
+			if (ReplyDecodeByte(&dec, frame[b], &rec))
+				ReplyRecordText(&rec, text[1]);
+		if (strcmp(text[0], text[1]) != 0)
+			frameDiffs++;
+	}
+	printf("export frames    %u of 1000 texts differ\n", frameDiffs);
+
+	FlashSimClose();
+	return 0;
+}
+
+//What HistoryRead() hands back, checked against what was appended.
+static struct
+{
+	HistSample *expect;       // Every sample appended, series after series
+	CPU_INT32U *appended;     // Samples appended to each series
+	CPU_INT32U perSeries;     // Room for each series in expect
+	CPU_INT32U series;        // Series being read
+	CPU_INT32U pos;           // Its next expected sample
+	CPU_INT32U bad;           // Samples not as appended
+} histCheck;
+
+static CPU_INT64U histSink;
+
+/*-------------------- S i n k H i s t S a m p l e ( ) -------------------------------------
+	Purpose:	HistoryRead() function for the timing run: touch each sample.
+*/
+static CPU_VOID SinkHistSample(const HistSample *sample){
+	histSink += sample->time + sample->value;
+}
+
+/*-------------------- C h e c k H i s t S a m p l e ( ) -------------------------------------
+	Purpose:	HistoryRead() function: check each sample against the appended one.
+*/
+static CPU_VOID CheckHistSample(const HistSample *sample){
+	const HistSample *e = &histCheck.expect[histCheck.series * histCheck.perSeries + histCheck.pos];
+
+	if (histCheck.pos++ >= histCheck.appended[histCheck.series] ||
+	    sample->node != e->node || sample->msgType != e->msgType ||
+	    sample->time != e->time || sample->value != e->value || sample->aux != e->aux)
+		histCheck.bad++;
+}
+
+/*-------------------- H i s t o r y B e n c h ( ) -------------------------------------
+	Purpose:	Compression, speed and reach of the station's reading history.
+*/
+static int HistoryBench(int argc, char *argv[]){
+	CPU_INT32U nodes = 16;
+	CPU_INT32U interval = 60;
+	CPU_INT32U hours = 24;
+	CPU_INT32U jitter = 250;
+	CPU_INT32U rounds, events, numSeries, r, n, k, s, e, held, read;
+	CPU_INT32U minSpan = 0xFFFFFFFF, maxSpan = 0;
+	CPU_INT08U pkt[GenMaxPkt];
+	CPU_INT64S t0, appendNs, readNs;
+	HistSample *event;
+	HistStats stats;
+	Payload payload;
+	ParserCtx ctx;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:i:H:j:")) != -1){
+		switch (opt){
+		case 'n': nodes = strtoul(optarg, NULL, 0); break;
+		case 'i': interval = strtoul(optarg, NULL, 0); break;
+		case 'H': hours = strtoul(optarg, NULL, 0); break;
+		case 'j': jitter = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (nodes < 1 || nodes > 254 || nodes > NodeCacheNodes || interval < 1 || hours < 1 ||
+	    jitter * 2 >= interval * TicksPerSec) return 2;
+
+	rounds = hours * 3600 / interval;
+	events = rounds * nodes * RdgSpare;
+	numSeries = nodes * RdgSpare;
+	event = malloc((size_t)events * sizeof(*event));
+	histCheck.expect = malloc((size_t)events * sizeof(*histCheck.expect));
+	histCheck.appended = calloc(numSeries, sizeof(*histCheck.appended));
+	if (event == NULL || histCheck.expect == NULL || histCheck.appended == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	histCheck.perSeries = rounds;
+
+	//Every node sends every reading type once a round, spread over the
+	//round and each up to -j ms early or late. The readings are decoded
+	//and the nodes given cache slots first, so only appends are timed.
+	PktGenInit(&gen, 41);
+	ParserCtxInit(&ctx);
+	NodeCacheInit();
+	HistoryInit();
+	for (e = 0, r = 0; r < rounds; r++)
+		for (n = 0; n < nodes; n++)
+			for (k = 0; k < RdgSpare; k++){
+				CPU_INT08U src = (CPU_INT08U)(2 + n);
+				CPU_INT08U len = PktGenType(&gen, pkt, StationAddr, src, ReadingTypeChar((ReadingType)k));
+				HistSample *x = &event[e++];
+				CPU_INT08U i;
+				Reading rdg;
+
+				for (i = 0; i < len; i++)
+					if (ParseByte(&ctx, &payload, pkt[i]))
+						break;
+				DecodeReading(payload.msgType, payload.data, payload.payloadLen - PayloadHeaderDiff, &rdg);
+				x->node = src;
+				x->msgType = payload.msgType;
+				x->time = jitter + (CPU_INT32U)(((CPU_INT64U)r * nodes + n) * interval * TicksPerSec / nodes)
+				          + PktGenRand(&gen) % (2 * jitter + 1) - jitter;
+				x->value = rdg.value;
+				x->aux = rdg.aux;
+				NodeCacheUpdate(src, x->msgType, &rdg, x->time);
+
+				s = n * RdgSpare + k;
+				histCheck.expect[s * rounds + histCheck.appended[s]] = *x;
+				histCheck.expect[s * rounds + histCheck.appended[s]++].time = x->time / HistTimeUnit * HistTimeUnit;
+			}
+
+	t0 = NowNs();
+	for (e = 0; e < events; e++){
+		Reading rdg;
+
+		rdg.value = event[e].value;
+		rdg.aux = event[e].aux;
+		HistoryAppend(event[e].node, event[e].msgType, &rdg, event[e].time);
+	}
+	appendNs = NowNs() - t0;
+	HistoryGetStats(&stats);
+
+	t0 = NowNs();
+	read = HistoryReadAll(SinkHistSample);
+	readNs = NowNs() - t0;
+
+	//Each series must read back as the newest of what was appended to it
+	for (s = 0; s < numSeries; s++){
+		CPU_INT32U node = 2 + s / RdgSpare;
+		CPU_CHAR type = ReadingTypeChar((ReadingType)(s % RdgSpare));
+
+		held = HistoryRead(node, type, SinkHistSample);
+		histCheck.series = s;
+		histCheck.pos = histCheck.appended[s] - held;
+		HistoryRead(node, type, CheckHistSample);
+		if (held > 0){
+			const HistSample *x = &histCheck.expect[s * rounds];
+			CPU_INT32U span = x[histCheck.appended[s] - 1].time - x[histCheck.appended[s] - held].time;
+
+			if (span < minSpan) minSpan = span;
+			if (span > maxSpan) maxSpan = span;
+		}else
+			minSpan = 0;
+	}
+
+	printf("simulated        %u nodes, %u reading types each per %u s (+-%u ms), %u hours\n",
+	       nodes, RdgSpare, interval, jitter, hours);
+	printf("pool             %u blocks of %u bytes, %u in use\n", HistBlocks, HistBlockSize, stats.blocksUsed);
+	printf("samples          %u appended, %u held, %u evicted, %u without a slot\n",
+	       stats.appended, stats.samples, stats.evicted, stats.noSlot);
+	printf("size             %.2f bytes per sample in the pool, %u as a log record: %.1fx smaller\n",
+	       stats.blocksUsed * (double)HistBlockSize / stats.samples, (CPU_INT32U)sizeof(LogRecord),
+	       sizeof(LogRecord) * stats.samples / (stats.blocksUsed * (double)HistBlockSize));
+	printf("history kept     %.1f to %.1f hours per series\n",
+	       minSpan / (3600.0 * TicksPerSec), maxSpan / (3600.0 * TicksPerSec));
+	printf("append           %.1f ns per sample\n", appendNs / (double)events);
+	printf("decode           %.1f ns per sample (%u read)\n", read ? readNs / (double)read : 0.0, read);
+	printf("check            %u of %u samples read back wrong%s\n", histCheck.bad, stats.samples,
+	       read == stats.samples ? "" : ", count MISMATCH");
+
+	free(event);
+	free(histCheck.expect);
+	free(histCheck.appended);
+	return 0;
+}
+
+//A pool simulation workload: packets come in bursts, the payload task
+//takes procUs over each (slowUs every slowEvery-th) and answers every
+//replyEvery-th with replyLen bytes. Both directions run at the baud rate.
+typedef struct
+{
+	const CPU_CHAR *name;
+	CPU_INT32U baud;
+	CPU_INT32U pktLen;            // Bytes in a packet
+	CPU_INT32U burst;             // Mean packets in a burst, back to back
+	CPU_INT32U burstMs;           // Time from one burst to the next
+	CPU_INT32U procUs, slowEvery, slowUs;
+	CPU_INT32U replyEvery, replyLen;
+} PoolLoad;
+
+static const PoolLoad PoolLoads[] =
+{
+	{ "reply backlog", 9600, 16, 6, 1000, 500, 0, 0, 1, 30 },
+	{ "input burst", 9600, 16, 8, 1000, 500, 6, 60000, 8, 20 },
+	{ "both", 9600, 16, 6, 800, 500, 10, 40000, 2, 30 },
+};
+
+typedef struct
+{
+	CPU_INT32U lost;              // Packets with a byte dropped from the full input buffer
+	PoolStats payloadQ, replyQ;
+} PoolRun;
+
+//A queue's filled buffers, oldest first
+typedef struct
+{
+	CPU_INT08U *blocks[PoolMaxBlocks];
+	CPU_INT08U in, out, n;
+} SimQ;
+
+/*-------------------- S i m Q P u t ( ) -------------------------------------
+	Purpose:	Queue a filled buffer.
+*/
+static CPU_VOID SimQPut(SimQ *q, CPU_INT08U *block){
+	q->blocks[q->in] = block;
+	q->in = (CPU_INT08U)((q->in + 1) % PoolMaxBlocks);
+	q->n++;
+}
+
+/*-------------------- S i m Q G e t ( ) -------------------------------------
+	Purpose:	Take the oldest filled buffer.
+*/
+static CPU_INT08U *SimQGet(SimQ *q){
+	CPU_INT08U *block = q->blocks[q->out];
+
+	q->out = (CPU_INT08U)((q->out + 1) % PoolMaxBlocks);
+	q->n--;
+	return block;
+}
+
+/*-------------------- R u n P o o l ( ) -------------------------------------
+	Purpose:	Run a workload through the station's parser, payload and reply
+	                stages with their buffers drawn from one pool.
+	Parameters:	workload, pool blocks, each queue's minimum and cap, seconds
+*/
+static CPU_VOID RunPool(const PoolLoad *load, CPU_INT08U blocks, CPU_INT08U payMin, CPU_INT08U payMax,
+                        CPU_INT08U repMin, CPU_INT08U repMax, CPU_INT32U secs, PoolRun *run){
+	static CPU_INT08U space[PoolMaxBlocks * SimBlockSize];
+	CPU_INT32U byteUs = BitsPerByte * 1000000 / load->baud;
+	CPU_INT32U end = secs * 1000000;
+	CPU_INT32U now, nextByte = 0, nextBurst = 0, pktLeft = 0, burstLeft = 0, payloads = 0;
+	CPU_INT32U payBusy = 0, repBusy = 0;
+	CPU_INT08U iBfr[SimIBfr], iIn = 0, iOut = 0, iN = 0;
+	CPU_INT08U *parserBlk = NULL, *payBlk = NULL, *repBlk = NULL;
+	CPU_BOOLEAN damaged = FALSE, payReply = FALSE, payDone = FALSE;
+	SimQ payQ, repQ;
+	BfrPool pool;
+	PktGen gen;
+
+	memset(&payQ, 0, sizeof(payQ));
+	memset(&repQ, 0, sizeof(repQ));
+	memset(run, 0, sizeof(*run));
+	PktGenInit(&gen, 43);
+	BfrPoolInit(&pool, space, blocks, SimBlockSize);
+	BfrPoolAddClient(&pool, payMin, payMax, &payQ);
+	BfrPoolAddClient(&pool, repMin, repMax, &repQ);
+
+	for (now = 0; now < end; now += SimStepUs){
+		//Reply task: send a buffer at the baud rate, then hand it back
+		if (repBlk != NULL && now >= repBusy){
+			BfrPoolGive(&pool, ReplyClient, repBlk, now);
+			repBlk = NULL;
+		}
+		if (repBlk == NULL && repQ.n > 0){
+			repBlk = SimQGet(&repQ);
+			repBusy = now + load->replyLen * byteUs;
+		}
+
+		//Payload task: handle a payload, then hold it until a reply buffer comes
+		if (payBlk != NULL && !payDone && now >= payBusy)
+			payDone = TRUE;
+		if (payDone && payReply){
+			CPU_INT08U *b = BfrPoolTake(&pool, ReplyClient, now);
+
+			if (b != NULL){
+				SimQPut(&repQ, b);
+				payReply = FALSE;
+			}
+		}
+		if (payDone && !payReply){
+			BfrPoolGive(&pool, PayloadClient, payBlk, now);
+			payBlk = NULL;
+			payDone = FALSE;
+		}
+		if (payBlk == NULL && payQ.n > 0){
+			payBlk = SimQGet(&payQ);
+			payloads++;
+			payBusy = now + (load->slowEvery && payloads % load->slowEvery == 0 ? load->slowUs : load->procUs);
+			payReply = payloads % load->replyEvery == 0;
+		}
+
+		//Parser: always holding a write buffer, empties the input buffer at once
+		if (parserBlk == NULL)
+			parserBlk = BfrPoolTake(&pool, PayloadClient, now);
+		while (parserBlk != NULL && iN > 0){
+			CPU_INT08U mark = iBfr[iOut];
+
+			iOut = (CPU_INT08U)((iOut + 1) % SimIBfr);
+			iN--;
+			if (mark == 2)
+				run->lost++;
+			else if (mark == 1){
+				SimQPut(&payQ, parserBlk);
+				parserBlk = BfrPoolTake(&pool, PayloadClient, now);
+			}
+		}
+
+		//The link: bursts of back to back packets
+		if (burstLeft == 0 && pktLeft == 0 && now >= nextBurst){
+			burstLeft = 1 + PktGenRand(&gen) % (2 * load->burst - 1);
+			nextBurst += load->burstMs * 1000;
+		}
+		if ((pktLeft > 0 || burstLeft > 0) && now >= nextByte){
+			if (pktLeft == 0){
+				pktLeft = load->pktLen;
+				burstLeft--;
+				damaged = FALSE;
+			}
+			pktLeft--;
+			if (iN == SimIBfr){
+				damaged = TRUE;
+				if (pktLeft == 0)
+					run->lost++;
+			}else{
+				iBfr[iIn] = (CPU_INT08U)(pktLeft > 0 ? 0 : damaged ? 2 : 1);
+				iIn = (CPU_INT08U)((iIn + 1) % SimIBfr);
+				iN++;
+			}
+			nextByte = now + byteUs;
+		}
+	}
+	BfrPoolGetStats(&pool, PayloadClient, &run->payloadQ, now);
+	BfrPoolGetStats(&pool, ReplyClient, &run->replyQ, now);
+}
+
+/*-------------------- M e a n H e l d ( ) -------------------------------------
+	Purpose:	Time weighted mean of the buffers a queue held.
+*/
+static double MeanHeld(const PoolStats *stats){
+	double sum = 0, total = 0;
+	CPU_INT08U i;
+
+	for (i = 0; i < PoolLevelBins; i++){
+		sum += (double)i * stats->levelTime[i];
+		total += stats->levelTime[i];
+	}
+	return total > 0 ? sum / total : 0;
+}
+
+/*-------------------- P r i n t P o o l R u n ( ) -------------------------------------
+	Purpose:	One row of the pool table.
+*/
+static CPU_VOID PrintPoolRun(const CPU_CHAR *title, const PoolRun *run){
+	printf("  %-14s %6u %9u %10.0f %9u %10.0f %6.2f %4.2f %6u %2u\n", title, run->lost,
+	       run->payloadQ.stalls, run->payloadQ.stallTime / 1000.0,
+	       run->replyQ.stalls, run->replyQ.stallTime / 1000.0,
+	       MeanHeld(&run->payloadQ), MeanHeld(&run->replyQ), run->payloadQ.peak, run->replyQ.peak);
+}
+
+/*-------------------- P o o l B e n c h ( ) -------------------------------------
+	Purpose:	Stalls and lost packets with split and shared queue buffers.
+*/
+static int PoolBench(int argc, char *argv[]){
+	CPU_INT32U secs = 600;
+	CPU_INT32U blocks = 2 * SplitBfrs;
+	CPU_CHAR title[32];
+	PoolRun split, shared;
+	CPU_INT32U i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:b:")) != -1){
+		switch (opt){
+		case 's': secs = strtoul(optarg, NULL, 0); break;
+		case 'b': blocks = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (secs < 1 || secs > 4000 || blocks < 3 || blocks > PoolMaxBlocks) return 2;
+
+	sprintf(title, "shared %u", blocks);
+	for (i = 0; i < sizeof(PoolLoads) / sizeof(PoolLoads[0]); i++){
+		const PoolLoad *load = &PoolLoads[i];
+
+		//Split: each queue owns SplitBfrs. Shared: Payload.c's minimums, the rest to either.
+		RunPool(load, 2 * SplitBfrs, SplitBfrs, SplitBfrs, SplitBfrs, SplitBfrs, secs, &split);
+		RunPool(load, (CPU_INT08U)blocks, 2, (CPU_INT08U)(blocks - 1), 1, (CPU_INT08U)(blocks - 2), secs, &shared);
+
+		printf("%s: bursts of ~%u %u byte packets every %u ms at %u baud, %u us a payload",
+		       load->name, load->burst, load->pktLen, load->burstMs, load->baud, load->procUs);
+		if (load->slowEvery)
+			printf(" (%u ms every %u)", load->slowUs / 1000, load->slowEvery);
+		printf(", a %u byte reply to 1 in %u, %u s\n", load->replyLen, load->replyEvery, secs);
+		printf("  %-14s %6s %9s %10s %9s %10s %11s %9s\n", "", "lost",
+		       "parser", "stalled", "payload", "stalled", "mean held", "most");
+		printf("  %-14s %6s %9s %10s %9s %10s %11s %9s\n", "buffers", "pkts",
+		       "stalls", "ms", "stalls", "ms", "pay rep", "pay rep");
+		PrintPoolRun("split 3 + 3", &split);
+		PrintPoolRun(title, &shared);
+	}
+	return 0;
+}
+
+/*-------------------- T r u e T e m p ( ) -------------------------------------
+	Purpose:	The simulated room temperature at a tick in 1/256 degrees C:
+	                15 to 27 degrees and back each day, with +-0.25 of noise.
+*/
+static CPU_INT32S TrueTemp(CPU_INT32U tick, PktGen *gen){
+	CPU_INT32U halfDay = 12 * 3600 * TicksPerSec;
+	CPU_INT32U t = tick % (2 * halfDay);
+	double rise = (double)(t < halfDay ? t : 2 * halfDay - t) / halfDay;
+
+	return (CPU_INT32S)((15.0 + 12.0 * rise) * 256) + (CPU_INT32S)(PktGenRand(gen) % 129) - 64;
+}
+
+/*-------------------- T e m p B e n c h ( ) -------------------------------------
+	Purpose:	The local temperature sampler against a simulated STLM75.
+*/
+static int TempBench(int argc, char *argv[]){
+	CPU_INT32U secs = 24 * 3600;
+	CPU_INT32U latency = 1;
+	CPU_INT32U fail = 0;
+	CPU_INT32U tick, payloads = 0, badRecs = 0, farOff = 0;
+	CPU_INT32S windowSum = 0, windowN = 0, mean, err, maxErr = 0;
+	CPU_INT64S t0, stepNs = 0;
+	CPU_INT08U rec[LocalTempRecSize];
+	LocalTempStats stats;
+	Reading rdg;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:l:f:")) != -1){
+		switch (opt){
+		case 's': secs = strtoul(optarg, NULL, 0); break;
+		case 'l': latency = strtoul(optarg, NULL, 0); break;
+		case 'f': fail = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (secs < 1 || secs > 30 * 24 * 3600 || latency > 255 || fail > 100) return 2;
+
+	//Every tick the sensor's register follows the temperature and a read
+	//whose -l ticks are up ends, failing -f percent of the time. Every
+	//LocalTempPeriod ticks the task wakes and steps the sampler.
+	PktGenInit(&gen, 47);
+	LocalTempInit(StationAddr);
+	for (tick = 1; tick <= secs * TicksPerSec; tick++){
+		CPU_INT32S temp = TrueTemp(tick, &gen);
+		CPU_BOOLEAN made;
+
+		I2CSimSet((CPU_INT16S)temp, (CPU_INT08U)latency, PktGenRand(&gen) % 100 >= fail);
+		I2CSimTick();
+		if (tick % LocalTempPeriod != 0)
+			continue;
+
+		windowSum += temp;
+		windowN++;
+		t0 = NowNs();
+		made = LocalTempStep(rec);
+		stepNs += NowNs() - t0;
+		if (windowN < LocalTempSamples)
+			continue;
+
+		//Reads lag a wake behind, so the average is held to the true
+		//window mean only to within the register's half degree, the
+		//rounding and a wake's drift: one degree.
+		mean = windowSum / windowN;
+		windowSum = windowN = 0;
+		if (!made)
+			continue;
+		payloads++;
+		LocalTempQueued(TRUE);
+		if (rec[0] != LocalTempRecSize - 1 + PacketHeaderDiff || rec[1] != StationAddr ||
+		    rec[2] != StationAddr || !DecodeReading((CPU_CHAR)rec[3], &rec[4], rec[0] - PayloadHeaderDiff, &rdg)){
+			badRecs++;
+			continue;
+		}
+		err = rdg.value * 256 - mean;
+		if (err < 0) err = -err;
+		if (err > maxErr) maxErr = err;
+		if (err > 256) farOff++;
+	}
+	LocalTempGetStats(&stats);
+
+	printf("%u s, a read every %u ms taking %u ms, %u%% failing, %u reads a payload\n",
+	       secs, LocalTempPeriod, latency, fail, LocalTempSamples);
+	printf("  reads %u, failed %u, late %u\n", stats.reads, stats.failed, stats.late);
+	printf("  payloads %u (%u windows without a good read), last %d C\n",
+	       payloads, secs * TicksPerSec / LocalTempPeriod / LocalTempSamples - payloads, stats.last);
+	printf("  worst error against the true window mean %.2f C, %u over 1 C\n", maxErr / 256.0, farOff);
+	printf("  %.0f ns a step; the task never waits on the bus\n", (double)stepNs / (secs * TicksPerSec / LocalTempPeriod));
+	if (badRecs)
+		printf("  %u records the payload task would not decode\n", badRecs);
+	return badRecs || farOff ? 1 : 0;
+}
+
+static CPU_BOOLEAN spanDone;    // Set by the transfer-complete interrupt
+static CPU_INT64U dmaTicks;     // Byte times so far
+static CPU_INT64U doneAt;       // Byte time of the last transfer complete
+
+/*-------------------- S p a n D o n e ( ) -------------------------------------
+	Purpose:	The driver's done function: what PutSpan()'s semaphore post is.
+*/
+static CPU_VOID SpanDone(CPU_VOID){
+	spanDone = TRUE;
+	doneAt = dmaTicks;
+}
+
+/*-------------------- T x D m a B e n c h ( ) -------------------------------------
+	Purpose:	The DMA transmit driver against the DMA and USART model.
+*/
+static int TxDmaBench(int argc, char *argv[]){
+	CPU_INT32U replies = 100000;
+	CPU_INT32U latency = 1;
+	CPU_INT32U wrapPct = 10;
+	CPU_INT32U baud = LinkBaud;
+	CPU_INT08U *line;
+	CPU_INT32U *ends;
+	CPU_INT64U lineLen = 0, sentLen = 0, idleTicks = 0, spans = 0, badBytes = 0;
+	CPU_INT32U r, i, split = 0, busyOk = 0;
+	CPU_INT64S t0, ns;
+	SerDmaTxStats stats;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:l:w:b:")) != -1){
+		switch (opt){
+		case 'p': replies = strtoul(optarg, NULL, 0); break;
+		case 'l': latency = strtoul(optarg, NULL, 0); break;
+		case 'w': wrapPct = strtoul(optarg, NULL, 0); break;
+		case 'b': baud = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (replies < 1 || replies > 10000000 || latency < 1 || latency > 1000 || wrapPct > 100 || baud < 300) return 2;
+
+	//The replies back to back, as the line should carry them
+	line = malloc((size_t)replies * SimBlockSize);
+	ends = malloc((size_t)replies * sizeof(*ends));
+	if (line == NULL || ends == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	PktGenInit(&gen, 49);
+	for (r = 0; r < replies; r++){
+		CPU_INT32U len = 10 + PktGenRand(&gen) % (SimBlockSize - 9);
+
+		for (i = 0; i < len; i++)
+			line[lineLen++] = (CPU_INT08U)(' ' + PktGenRand(&gen) % 95);
+		ends[r] = (CPU_INT32U)lineLen;
+	}
+
+	//The reply task: wake -l byte times after each interrupt, start the
+	//next span, then try once more at once, which must be refused.
+	//A wrapped reply is sent as two spans, as BfrQReadSpan() gives them.
+	//Transfer complete comes with the last byte still in DR, so a wake
+	//within a byte time keeps the line busy.
+	SerDmaTxInit(SpanDone);
+	t0 = NowNs();
+	r = 0;
+	i = 0;
+	spanDone = TRUE;
+	dmaTicks = doneAt = 0;
+	while (sentLen < lineLen){
+		CPU_INT16S c;
+
+		if (spanDone && dmaTicks >= doneAt + latency && r < replies){
+			CPU_INT32U end = ends[r];
+			CPU_INT32U start = r ? ends[r - 1] : 0;
+
+			if (i == start && PktGenRand(&gen) % 100 < wrapPct){
+				end = start + 1 + PktGenRand(&gen) % (end - start - 1);
+				split++;
+			}
+			spanDone = FALSE;
+			if (SerDmaTxStart(&line[i], (CPU_INT16U)(end - i))){
+				spans++;
+				if (!SerDmaTxStart(&line[i], 1) && SerDmaTxBusy())
+					busyOk++;
+			}
+			i = end;
+			if (i == ends[r])
+				r++;
+		}
+		if ((c = DmaSimTick()) >= 0){
+			if (c != line[sentLen++])
+				badBytes++;
+		}else
+			idleTicks++;
+		if (++dmaTicks > (lineLen + 2) * (latency + 3)){
+			printf("  line stalled after %llu of %llu bytes\n", sentLen, lineLen);
+			badBytes++;
+			break;
+		}
+	}
+	ns = NowNs() - t0;
+	SerDmaTxGetStats(&stats);
+
+	printf("%u replies, %llu bytes, %u wrapped; task wakes %u byte times after each interrupt\n",
+	       replies, lineLen, split, latency);
+	printf("  spans %u, bytes %u, interrupts %u, starts refused %u\n",
+	       stats.spans, stats.bytes, stats.irqs, stats.refused);
+	printf("  line use %.1f%% (%llu idle byte times): %.1f replies/s at %u baud\n",
+	       100.0 * sentLen / dmaTicks, idleTicks, (double)replies * baud / BitsPerByte / dmaTicks, baud);
+	printf("  interrupts a reply %.2f; a byte at a time: %.1f TXE interrupts and semaphore posts\n",
+	       (double)stats.irqs / replies, (double)lineLen / replies);
+	printf("  %.1f ns of host time a byte time\n", (double)ns / dmaTicks);
+	if (badBytes || stats.irqs != spans || stats.refused != busyOk || busyOk != spans){
+		printf("  FAILED: %llu bytes wrong, %u interrupts for %llu spans, %u of %llu busy starts refused\n",
+		       badBytes, stats.irqs, spans, busyOk, spans);
+		return 1;
+	}
+	free(line);
+	free(ends);
+	return 0;
+}
+
+static CPU_BOOLEAN rxWoken;     // Set by the Rx interrupts
+static CPU_INT64U rxWokenAt;    // Byte time of the first since the task last ran
+
+/*-------------------- R x W a k e ( ) -------------------------------------
+	Purpose:	The driver's wake function: what GetSpan()'s semaphore post is.
+*/
+static CPU_VOID RxWake(CPU_VOID){
+	if (!rxWoken)
+		rxWokenAt = dmaTicks;
+	rxWoken = TRUE;
+}
+
+/*-------------------- R x D m a B e n c h ( ) -------------------------------------
+	Purpose:	The circular DMA receive driver against the DMA and USART model.
+*/
+static int RxDmaBench(int argc, char *argv[]){
+	CPU_INT32U packets = 100000;
+	CPU_INT32U latency = 1;
+	CPU_INT32U gapPct = 50;
+	CPU_INT08U *line;
+	CPU_INT32U *arrived;
+	CPU_INT64U lineLen = 0, fed = 0, got = 0, lost = 0, badBytes = 0;
+	CPU_INT64U wakes = 0, waited = 0, maxWait = 0, gaps = 0;
+	CPU_INT32U r, i, gapLeft = 0;
+	CPU_INT32U next = 0;
+	CPU_INT64S t0, ns;
+	SerDmaRxStats stats;
+	PktGen gen;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:l:g:")) != -1){
+		switch (opt){
+		case 'p': packets = strtoul(optarg, NULL, 0); break;
+		case 'l': latency = strtoul(optarg, NULL, 0); break;
+		case 'g': gapPct = strtoul(optarg, NULL, 0); break;
+		default:  return 2;
+		}
+	}
+	if (packets < 1 || packets > 10000000 || latency > 100000 || gapPct > 100) return 2;
+
+	//The packets back to back, as the line carries them; each gap is
+	//marked by the end of its packet in arrived[], filled in as it goes
+	line = malloc((size_t)packets * SimBlockSize);
+	arrived = malloc((size_t)packets * SimBlockSize * sizeof(*arrived));
+	if (line == NULL || arrived == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	PktGenInit(&gen, 50);
+	for (r = 0; r < packets; r++){
+		CPU_INT32U len = 10 + PktGenRand(&gen) % (SimBlockSize - 9);
+
+		for (i = 0; i < len; i++)
+			line[lineLen++] = (CPU_INT08U)PktGenRand(&gen);
+	}
+
+	//Each byte time: a byte comes, or the line idles; the task runs
+	//-l byte times after the first interrupt since it last ran, and
+	//reads and releases spans, as Parser() does, until the ring is empty
+	SerDmaRxInit(RxWake);
+	t0 = NowNs();
+	rxWoken = FALSE;
+	dmaTicks = 0;
+	r = 0;
+	next = 10 + PktGenRand(&gen) % (SimBlockSize - 9);
+	while (got + lost < lineLen){
+		if (gapLeft > 0){
+			if (gapLeft-- == 1)
+				next = (CPU_INT32U)fed + 10 + PktGenRand(&gen) % (SimBlockSize - 9);
+			DmaSimRxIdle();
+		}else if (fed < lineLen){
+			arrived[fed] = (CPU_INT32U)dmaTicks;
+			DmaSimRx(line[fed++]);
+			if (fed == next || fed == lineLen){
+				if (PktGenRand(&gen) % 100 < gapPct || fed == lineLen){
+					gapLeft = 1 + PktGenRand(&gen) % 8;
+					gaps++;
+				}else
+					next = (CPU_INT32U)fed + 10 + PktGenRand(&gen) % (SimBlockSize - 9);
+			}
+		}else
+			DmaSimRxIdle();
+
+		if (rxWoken && dmaTicks >= rxWokenAt + latency){
+			const CPU_INT08U *span;
+			CPU_INT16U len;
+			CPU_INT32U overruns;
+
+			rxWoken = FALSE;
+			wakes++;
+			SerDmaRxGetStats(&stats);
+			overruns = stats.overruns;
+			for (;;){
+				len = SerDmaRxSpan(&span);
+				SerDmaRxGetStats(&stats);
+				if (stats.overruns != overruns){
+					//Moved up to the write point: the bytes before it are gone
+					overruns = stats.overruns;
+					lost = fed - got;
+				}
+				if (len == 0)
+					break;
+				for (i = 0; i < len; i++, got++){
+					CPU_INT64U wait = dmaTicks - arrived[got + lost];
+
+					if (span[i] != line[got + lost])
+						badBytes++;
+					waited += wait;
+					if (wait > maxWait)
+						maxWait = wait;
+				}
+				SerDmaRxSkip(len);
+			}
+		}
+		if (++dmaTicks > (lineLen + 2) * 10 + latency){
+			printf("  reader stalled after %llu of %llu bytes\n", got + lost, lineLen);
+			badBytes++;
+			break;
+		}
+	}
+	ns = NowNs() - t0;
+	SerDmaRxGetStats(&stats);
+
+	printf("%u packets, %llu bytes, %llu followed by an idle line; %u byte ring; task wakes %u byte times after an interrupt\n",
+	       packets, lineLen, gaps, SerDmaRxSize, latency);
+	printf("  spans %u, bytes %u, half %u, full %u, idle %u, overruns %u (%llu bytes lost)\n",
+	       stats.spans, stats.bytes, stats.halves, stats.fulls, stats.idles, stats.overruns, lost);
+	printf("  interrupts a packet %.2f, task wakes a packet %.2f; a byte at a time: %.1f RXNE interrupts and semaphore posts\n",
+	       (double)(stats.halves + stats.fulls + stats.idles) / packets, (double)wakes / packets, (double)lineLen / packets);
+	printf("  bytes wait in the ring %.1f byte times on average, %llu at most\n",
+	       got ? (double)waited / got : 0.0, maxWait);
+	printf("  %.1f ns of host time a byte time\n", (double)ns / dmaTicks);
+	if (badBytes || got != stats.bytes || (lost > 0) != (stats.overruns > 0)){
+		printf("  FAILED: %llu bytes wrong, %llu read and %u released, %llu lost in %u overruns\n",
+		       badBytes, got, stats.bytes, lost, stats.overruns);
+		return 1;
+	}
+	free(line);
+	free(arrived);
+	return 0;
+}
+
+typedef struct
+{
+	const CPU_CHAR *name;
+	int (*run)(int argc, char *argv[]);
+	const CPU_CHAR *usage;
+} BenchCmd;
+
+static const BenchCmd BenchCmds[] =
+{
+	{ "ingest", Ingest, "[-m MB] [-r runs] [-f file]" },
+	{ "aggregate", Aggregate, "[-n nodes] [-i secs] [-H hours]" },
+	{ "deadband", Deadband, "[-n nodes] [-i secs] [-H hours]" },
+	{ "replies", Replies, "[-p packets]" },
+	{ "dedup", Dedup, "[-n nodes] [-i secs] [-r relay%] [-d ms] [-H hours]" },
+	{ "crc", Crc, "[-p packets] [-m MB]" },
+	{ "multi", Multi, "[-p payloads] [-b baud]" },
+	{ "seq", Seq, "[-n nodes] [-p packets] [-l loss%] [-d dup%] [-r late%] [-w late]" },
+	{ "decode", Decode, "[-p payloads] [-r runs]" },
+	{ "flashlog", FlashLogBench, "[-f file] [-n readings] [-c cuts]" },
+	{ "history", HistoryBench, "[-n nodes] [-i secs] [-H hours] [-j ms]" },
+	{ "pool", PoolBench, "[-s secs] [-b blocks]" },
+	{ "temp", TempBench, "[-s secs] [-l ms] [-f fail%]" },
+	{ "txdma", TxDmaBench, "[-p replies] [-l bytes] [-w wrap%] [-b baud]" },
+	{ "rxdma", RxDmaBench, "[-p packets] [-l bytes] [-g gap%]" },
+};
+
+/*-------------------- M a i n ( ) ----------------------------*/
+int main(int argc, char *argv[]){
+	CPU_INT32U i;
+
+	if (argc > 1)
+		for (i = 0; i < sizeof(BenchCmds) / sizeof(BenchCmds[0]); i++)
+			if (strcmp(argv[1], BenchCmds[i].name) == 0){
+				int status = BenchCmds[i].run(argc - 1, argv + 1);
+
+				if (status == 2) fprintf(stderr, "usage: %s %s %s\n", argv[0], BenchCmds[i].name, BenchCmds[i].usage);
+				return status;
+			}
+
+	for (i = 0; i < sizeof(BenchCmds) / sizeof(BenchCmds[0]); i++)
+		fprintf(stderr, "usage: %s %s %s\n", argv[0], BenchCmds[i].name, BenchCmds[i].usage);
+	return 2;
+}
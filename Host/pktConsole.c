@@ -0,0 +1,281 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			             pktConsole.c
+-----------------------------------------------------------------------
+Host side of the station's statistics and control console (Prog 5
+Console.h). Sends one command frame down the link, then prints the
+station's answer with every value named, whether the station is
+replying in text or in binary frames. Other replies are skipped.
+
+Usage:  pktConsole [-b baud] [-w ms] device command [args]
+
+    stats                                   Every counter group
+    zero                                    Count from zero again
+    format text|binary                      Reply format
+    addr N on|off                           Take or drop packets for address N
+    deadband TYPE abs pct auxAbs silence    A reading type's deadband
+
+The answer is read until the link has been quiet for -w ms. A device
+of "-" writes the command frame to stdout and reads the answer from
+stdin, so a capture can be decoded offline:
+
+    pktConsole - stats < reply.cap > /dev/null
+
+Build:  gcc -O2 -include HostOS.h -I. -I../Prog5/App -o pktConsole pktConsole.c
+            pktGen.c replyDecode.c ../Prog5/App/ReplyFrame.c ../Prog5/App/Aggregate.c
+            ../Prog5/App/FlashLog.c ../Prog5/App/Crc32.c ../Prog5/App/Reading.c
+            ../Prog5/App/NodeCache.c ../Prog5/App/MsgDesc.c
+-----------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "CPU.h"
+#include "pktGen.h"
+#include "replyDecode.h"
+#include "Console.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define DefaultBaud 9600
+#define DefaultWaitMs 2000      // Quiet time that ends the answer
+#define MaxValues (FrameMaxData / 4)
+#define LineSize 128            // Longest text reply line kept
+
+typedef struct
+{
+	CPU_CHAR name;              // Group letter
+	const CPU_CHAR *title;
+	const CPU_CHAR *labels[MaxValues];
+	CPU_INT08U signs;           // Bit i set: value i is signed, as Console.c's table
+} GroupNames;
+
+//Console.h's group table
+static const GroupNames Groups[] =
+{
+	{ 'P', "parser",    { "payloads", "filtered", "filtered bad cs", "aggregates", "commands", "unknown type" } },
+	{ 'E', "errors",    { "P1", "P2", "P3", "CS", "size" } },
+	{ 'Q', "backlog",   { "payload 0", "1", "2+", "reply 0", "1", "2+" } },
+	{ 'H', "payload",   { "<1K cyc", "<4K", "<16K", "<64K", "<256K", "longer" } },
+	{ 'L', "sequence",  { "received", "lost", "repeated", "reordered", "too late", "restarts" } },
+	{ 'C', "caches",    { "dup lookups", "dup hits", "dup evictions", "node updates", "node full", "bad node" } },
+	{ 'K', "deadband",  { "reported", "held back" } },
+	{ 'Y', "history",   { "appended", "evicted", "no slot", "held" } },
+	{ 'G', "flash log", { "logged", "dropped", "failed", "erases", "held" } },
+	{ 'U', "cpu",       { "usage", "switches", "irq off cyc", "calibrated" } },
+	{ 'X', "console",   { "done", "dropped", "refused" } },
+	{ 'M', "bfr pool",  { "payload stalls", "ticks", "most held", "reply stalls", "ticks", "most held" } },
+	{ 'N', "payload q", { "0 bfrs ticks", "1", "2", "3", "4", "5+" } },
+	{ 'O', "reply q",   { "0 bfrs ticks", "1", "2", "3", "4", "5+" } },
+	{ 'I', "temp",      { "reads", "failed", "late", "queued", "dropped", "last" }, 0x20 },
+	{ 'B', "boot us",   { "kernel", "init", "clocks", "rx ready" } },
+	{ 'J', "boot us",   { "first pkt", "io", "calibrated" } },
+	{ 'T', "tx dma",    { "spans", "bytes", "irqs", "refused" } },
+	{ 'R', "rx dma",    { "spans", "bytes", "halves", "fulls", "idles", "overruns" } },
+};
+
+static const CPU_CHAR *TaskLabels[MaxValues] = { "prio", "stack used", "free", "cpu", "switches" };
+
+static FILE *show;              // Where the answer is printed
+static CPU_INT32U groupsShown;
+
+/*-------------------- S h o w G r o u p ( ) -------------------------------------
+	Purpose:	Print one group of values with their names.
+*/
+static CPU_VOID ShowGroup(CPU_CHAR name, const CPU_INT32U *values, CPU_INT08U count){
+	const CPU_CHAR *const *labels = NULL;
+	CPU_INT08U signs = 0;
+	CPU_INT08U i;
+
+	groupsShown++;
+	if (name == '!'){
+		fprintf(show, "%-10s %c %s\n", "command", (CPU_CHAR)values[0], count > 1 && values[1] ? "done" : "refused");
+		return;
+	}
+	if (name >= '0' && name <= '9'){
+		fprintf(show, "task %c    ", name);
+		labels = TaskLabels;
+	}else{
+		for (i = 0; i < sizeof(Groups) / sizeof(Groups[0]); i++)
+			if (Groups[i].name == name){
+				fprintf(show, "%-10s", Groups[i].title);
+				labels = Groups[i].labels;
+				signs = Groups[i].signs;
+			}
+		if (labels == NULL)
+			fprintf(show, "group %c   ", name);
+	}
+	for (i = 0; i < count; i++){
+		fprintf(show, " %s ", labels != NULL && labels[i] != NULL ? labels[i] : "?");
+		if (signs & (1 << i))
+			fprintf(show, "%ld", (long)(CPU_INT32S)values[i]);
+		else
+			fprintf(show, "%lu", (unsigned long)values[i]);
+	}
+	fprintf(show, "\n");
+}
+
+/*-------------------- T e x t G r o u p ( ) -------------------------------------
+	Purpose:	Take a text reply line of the form "#G v v ...".
+	Return:		FALSE if the line is anything else.
+*/
+static CPU_BOOLEAN TextGroup(const CPU_CHAR *line){
+	CPU_INT32U values[MaxValues];
+	CPU_INT08U count = 0;
+	const CPU_CHAR *p;
+	CPU_CHAR *end;
+
+	if (line[0] != '#' || line[1] == '\0' || line[2] != ' ')
+		return FALSE;
+	for (p = &line[2]; *p == ' ' && count < MaxValues; p = end){
+		if ((p[1] < '0' || p[1] > '9') && (p[1] != '-' || p[2] < '0' || p[2] > '9'))
+			return FALSE;
+		values[count++] = p[1] == '-' ? (CPU_INT32U)strtol(p + 1, &end, 10) : strtoul(p + 1, &end, 10);
+	}
+	if (*p != '\0')
+		return FALSE;
+	ShowGroup(line[1], values, count);
+	return TRUE;
+}
+
+/*-------------------- B u i l d C o m m a n d ( ) -------------------------------------
+	Purpose:	Turn the command words into the console's command bytes.
+	Return:		Number of bytes, 0 if the words are not a command.
+*/
+static CPU_INT08U BuildCommand(int argc, char *argv[], CPU_INT08U *cmd){
+	CPU_INT32U v;
+	CPU_INT08U i;
+
+	if (argc == 1 && strcmp(argv[0], "stats") == 0){
+		cmd[0] = 'S';
+		return 1;
+	}
+	if (argc == 1 && strcmp(argv[0], "zero") == 0){
+		cmd[0] = 'Z';
+		return 1;
+	}
+	if (argc == 2 && strcmp(argv[0], "format") == 0){
+		cmd[0] = 'F';
+		cmd[1] = strcmp(argv[1], "binary") == 0 ? 'B' : 'T';
+		return 2;
+	}
+	if (argc == 3 && strcmp(argv[0], "addr") == 0){
+		cmd[0] = 'A';
+		cmd[1] = (CPU_INT08U)strtoul(argv[1], NULL, 0);
+		cmd[2] = strcmp(argv[2], "on") == 0;
+		return 3;
+	}
+	if (argc == 6 && strcmp(argv[0], "deadband") == 0){
+		cmd[0] = 'D';
+		cmd[1] = (CPU_INT08U)argv[1][0];
+		v = (CPU_INT32U)strtol(argv[2], NULL, 0);
+		for (i = 0; i < 4; i++)
+			cmd[2 + i] = (CPU_INT08U)(v >> (8 * i));
+		cmd[6] = (CPU_INT08U)strtoul(argv[3], NULL, 0);
+		v = (CPU_INT32U)strtol(argv[4], NULL, 0);
+		cmd[7] = (CPU_INT08U)v;
+		cmd[8] = (CPU_INT08U)(v >> 8);
+		v = strtoul(argv[5], NULL, 0);
+		for (i = 0; i < 4; i++)
+			cmd[9 + i] = (CPU_INT08U)(v >> (8 * i));
+		return 13;
+	}
+	return 0;
+}
+
+/*-------------------- O p e n L i n k ( ) -------------------------------------
+	Purpose:	Open a serial device raw at the given baud rate.
+	Return:		The fd, or -1 on failure.
+*/
+static int OpenLink(const CPU_CHAR *name, CPU_INT32U baud){
+	struct termios tio;
+	int fd = open(name, O_RDWR | O_NOCTTY);
+
+	if (fd < 0) return -1;
+	if (tcgetattr(fd, &tio) == 0){
+		cfmakeraw(&tio);
+		tio.c_cflag |= CLOCAL | CREAD;
+		switch (baud){
+		case 19200:  cfsetspeed(&tio, B19200); break;
+		case 38400:  cfsetspeed(&tio, B38400); break;
+		case 57600:  cfsetspeed(&tio, B57600); break;
+		case 115200: cfsetspeed(&tio, B115200); break;
+		case 921600: cfsetspeed(&tio, B921600); break;
+		default:     cfsetspeed(&tio, B9600); break;
+		}
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+/*-------------------- M a i n ( ) ----------------------------*/
+int main(int argc, char *argv[]){
+	CPU_INT32U baud = DefaultBaud;
+	CPU_INT32U waitMs = DefaultWaitMs;
+	CPU_INT08U cmd[ConsoleMaxCmd], pkt[ConsoleMaxCmd + 8], bfr[256];
+	CPU_INT32U values[MaxValues];
+	CPU_CHAR line[LineSize];
+	CPU_INT32U lineLen = 0;
+	CPU_INT08U cmdLen, pktLen, count;
+	ReplyDecoder dec;
+	ReplyRecord rec;
+	struct pollfd pfd;
+	int opt, in, out;
+	ssize_t n, i;
+
+	while ((opt = getopt(argc, argv, "b:w:")) != -1){
+		switch (opt){
+		case 'b': baud = strtoul(optarg, NULL, 0); break;
+		case 'w': waitMs = strtoul(optarg, NULL, 0); break;
+		default:  optind = argc; break;
+		}
+	}
+	if (optind + 2 > argc || (cmdLen = BuildCommand(argc - optind - 1, argv + optind + 1, cmd)) == 0){
+		fprintf(stderr, "usage: %s [-b baud] [-w ms] device stats|zero|format text|binary|\n"
+		                "       addr N on|off|deadband TYPE abs pct auxAbs silence\n", argv[0]);
+		return 2;
+	}
+
+	if (strcmp(argv[optind], "-") == 0){
+		in = STDIN_FILENO;
+		out = STDOUT_FILENO;
+	}else if ((in = out = OpenLink(argv[optind], baud)) < 0){
+		perror(argv[optind]);
+		return 1;
+	}
+
+	pktLen = PktGenCommand(pkt, cmd, cmdLen);
+	if (write(out, pkt, pktLen) != pktLen){
+		perror("write");
+		return 1;
+	}
+	show = out == STDOUT_FILENO ? stderr : stdout;   // The frame owns stdout
+
+	//Frames and text lines can both be in the answer; look for either
+	ReplyDecoderInit(&dec);
+	pfd.fd = in;
+	pfd.events = POLLIN;
+	while (poll(&pfd, 1, (int)waitMs) > 0 && (n = read(in, bfr, sizeof(bfr))) > 0)
+		for (i = 0; i < n; i++){
+			if (ReplyDecodeByte(&dec, bfr[i], &rec) && (count = ReplyRecordStats(&rec, values)) > 0)
+				ShowGroup((CPU_CHAR)rec.node, values, count);
+			if (bfr[i] == '\n'){
+				line[lineLen] = '\0';
+				TextGroup(line);
+				lineLen = 0;
+			}else if (lineLen < LineSize - 1)
+				line[lineLen++] = (CPU_CHAR)bfr[i];
+		}
+
+	if (groupsShown == 0)
+		fprintf(stderr, "no answer from the station\n");
+	if (in != STDIN_FILENO)
+		close(in);
+	return groupsShown ? 0 : 3;
+}
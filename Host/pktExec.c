@@ -0,0 +1,431 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktExec.c
+-----------------------------------------------------------------------
+Scheduling overhead of the Prog 4 cooperative build: the same packet
+stream through Prog 4's own parser, payload and reply code, driven
+three ways:
+
+  rr      the round robin loop: Parser(), PayloadTask() and Reply()
+          called -p times per byte time whether or not they can go on
+  coro    the coroutines under the ready-bitmap executive (Exec.h,
+          CoroTasks.h): only readied tasks are resumed
+  switch  the same tasks written as blocking tasks, each on its own
+          stack, resumed by the same bitmap through a context switch;
+          a stand-in for the per-byte wake of a uC/OS-III task
+
+A simulated serial interrupt runs once per byte time: it moves the
+next packet byte into the -f byte iBfr, when there is room, and takes
+up to -o bytes out of oBfr, readying the parser and the reply task as
+ServiceRx() and ServiceTx() do. Each driver runs until every byte is
+in and every reply is out.
+
+For each the table gives host nanoseconds per input byte, task calls
+(or resumes) per byte, the calls that found nothing to do, and a
+checksum of the reply text. Parser() drops the byte it took when the
+payload queue is full; the coroutine parser waits instead, so with a
+slow -o the rr checksum can differ. swapcontext() also saves the
+signal mask with a system call, so its time is an upper bound on a
+kernel's switch; the switch count is the figure to compare.
+
+Usage:  pktExec [-n packets] [-p passes] [-f bytes] [-o bytes]
+
+-p 1 is the round robin's best case; on the station the loop spins as
+often as it can between bytes, hundreds of times at 9600 baud.
+
+Build:  gcc -O2 -include HostOS.h -I. -I../Prog4/App -I../Prog5/App -o pktExec pktExec.c
+            pktGen.c ../Prog5/App/Crc32.c ../Prog4/App/Parser.c ../Prog4/App/Payload.c
+            ../Prog4/App/Reply.c ../Prog4/App/BfrQ.c ../Prog4/App/Bfr.c
+            ../Prog4/App/Exec.c ../Prog4/App/CoroTasks.c
+-----------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "CPU.h"
+#include "pktGen.h"
+#include "Bfr.h"
+#include "BfrQ.h"
+#include "Parser.h"
+#include "../Prog4/App/Payload.h"   // Not Host/Payload.h
+#include "Reply.h"
+#include "SerIODriver.h"
+#include "Intrpt.h"
+#include "Coro.h"
+#include "Exec.h"
+#include "CoroTasks.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define StationAddr 1             // Prog 4 Payload.c's address
+#define DefaultPackets 100000
+#define MaxSerBfr 64
+#define StackSize 65536           // Host stack of each blocking task
+
+typedef enum {DrvRoundRobin, DrvCoro, DrvSwitch, NumDrivers} Driver;
+
+static const CPU_CHAR *DriverNames[NumDrivers] = { "rr", "coro", "switch" };
+static const CPU_CHAR *TaskNames[NumExecTasks] = { "parser", "payload", "reply" };
+
+typedef struct
+{
+	CPU_INT64S ns;                            // Host time for the whole stream
+	CPU_INT64U calls[NumExecTasks];           // Calls or resumes of each task
+	CPU_INT64U idle[NumExecTasks];            // ... that changed nothing
+	CPU_INT32U outBytes;                      // Reply bytes sent
+	CPU_INT32U outSum;                        // FNV-1a of them
+} ExecRun;
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_INT08U *stream;                // The packets, back to back
+static CPU_INT32U streamLen;
+static CPU_INT32U inPos;                  // Next stream byte to receive
+static CPU_INT32U passes = 1;             // Round robin passes per byte time
+static CPU_INT32U txPerTick = 4;          // Bytes sent per byte time
+
+static CircBfr iBfr, oBfr;                // SerIODriver.c's buffers
+static CPU_INT08U iBfrSpace[MaxSerBfr], oBfrSpace[MaxSerBfr];
+
+static BfrQ *payloadQ, *replyQ;
+static CPU_INT64U bytesIn, bytesOut;      // Bytes through GetByte() and PutByte()
+static CPU_BOOLEAN counting;              // Count calls and idle calls
+static ExecRun *run;                      // The run being counted
+
+static ucontext_t mainCtx;                // The executive, in the switch driver
+static ucontext_t taskCtx[NumExecTasks];
+static CPU_INT08U *taskStk[NumExecTasks];
+
+/*-------------------- I n t D i s ( ) / I n t E n ( ) -------------------------------------
+	Purpose:	Nothing runs concurrently here; the interrupt is a call.
+*/
+void IntDis(void){
+}
+
+void IntEn(void){
+}
+
+/*-------------------- G e t B y t e ( ) -------------------------------------
+	Purpose:	SerIODriver.c's GetByte() over the simulated iBfr.
+*/
+CPU_INT16S GetByte(CPU_VOID){
+	CPU_INT16S c = BfrRemByte(&iBfr);
+
+	if (c >= 0)
+		bytesIn++;
+	return c;
+}
+
+/*-------------------- P u t B y t e ( ) -------------------------------------
+	Purpose:	SerIODriver.c's PutByte() over the simulated oBfr.
+*/
+CPU_INT16S PutByte(CPU_INT16S txChar){
+	CPU_INT16S c = BfrAddByte(&oBfr, txChar);
+
+	if (c >= 0)
+		bytesOut++;
+	return c;
+}
+
+/*-------------------- N e x t B y t e ( ) ----------------------------*/
+CPU_INT16S NextByte(CPU_VOID){
+	return BfrNextByte(&iBfr);
+}
+
+/*-------------------- S e r I s r ( ) -------------------------------------
+	Purpose:	One byte time of the serial interrupt: receive the next stream
+				byte if iBfr has room, send up to txPerTick bytes from oBfr.
+*/
+static CPU_VOID SerIsr(CPU_VOID){
+	CPU_INT32U i;
+	CPU_INT16S c;
+
+	if (inPos < streamLen && !BfrFull(&iBfr)){
+		BfrAddByte(&iBfr, stream[inPos++]);
+		ExecReady(ExecParser);
+	}
+	for (i = 0; i < txPerTick && (c = BfrRemByte(&oBfr)) >= 0; i++){
+		run->outSum = (run->outSum ^ (CPU_INT08U)c) * 16777619u;
+		run->outBytes++;
+		ExecReady(ExecReply);
+	}
+}
+
+/*-------------------- D r a i n e d ( ) -------------------------------------
+	Purpose:	Test whether every byte is in and every reply is out.
+*/
+static CPU_BOOLEAN Drained(CPU_VOID){
+	return inPos == streamLen && BfrEmpty(&iBfr) && BfrEmpty(&oBfr) &&
+	       !BfrQReadClosed(payloadQ) && !BfrQReadClosed(replyQ);
+}
+
+/*-------------------- M a r k ( ) -------------------------------------
+	Purpose:	A fingerprint of everything a task can change, so a call that
+				leaves it alone can be counted as idle.
+*/
+static CPU_INT64U Mark(CPU_VOID){
+	CPU_INT64U mark = bytesIn * 1000003u + bytesOut;
+	BfrQ *qs[2];
+	CPU_INT08U q, b;
+
+	qs[0] = payloadQ;
+	qs[1] = replyQ;
+	for (q = 0; q < 2; q++){
+		mark = mark * 31 + qs[q]->readBfrNum * 7 + qs[q]->writeBfrNum;
+		for (b = 0; b < qs[q]->numBfrs; b++)
+			mark = mark * 131 + qs[q]->buffers[b].numBytes * 2 + qs[q]->buffers[b].closed;
+	}
+	return mark;
+}
+
+/*-------------------- C o u n t ( ) -------------------------------------
+	Purpose:	Call one task, counting the call and whether it did anything.
+*/
+static CPU_VOID Count(ExecTask task, ExecFnct fnct){
+	CPU_INT64U before = Mark();
+
+	fnct();
+	run->calls[task]++;
+	if (Mark() == before)
+		run->idle[task]++;
+}
+
+/*-------------------- Round robin ----------------------------*/
+static CPU_VOID ParserRR(CPU_VOID){
+	Parser(payloadQ);
+}
+
+static CPU_VOID ReplyRR(CPU_VOID){
+	Reply(replyQ);
+}
+
+static const ExecFnct RRTasks[NumExecTasks] = { ParserRR, PayloadTask, ReplyRR };
+
+static CPU_VOID RunRoundRobin(CPU_VOID){
+	CPU_INT32U p;
+	ExecTask t;
+
+	while (!Drained()){
+		SerIsr();
+		for (p = 0; p < passes; p++)
+			for (t = ExecParser; t < NumExecTasks; t++)
+				if (counting)
+					Count(t, RRTasks[t]);
+				else
+					RRTasks[t]();
+	}
+}
+
+/*-------------------- Coroutines ----------------------------*/
+static CPU_VOID ParserCount(CPU_VOID)  { Count(ExecParser, ParserCoro); }
+static CPU_VOID PayloadCount(CPU_VOID) { Count(ExecPayload, PayloadCoro); }
+static CPU_VOID ReplyCount(CPU_VOID)   { Count(ExecReply, ReplyCoro); }
+
+static CPU_VOID RunCoro(CPU_VOID){
+	CoroTasksInit(payloadQ, replyQ);
+	if (counting){
+		ExecInit(ExecParser, ParserCount);
+		ExecInit(ExecPayload, PayloadCount);
+		ExecInit(ExecReply, ReplyCount);
+	}
+	ExecReady(ExecParser);
+	ExecReady(ExecPayload);
+	ExecReady(ExecReply);
+
+	while (!Drained()){
+		SerIsr();
+		ExecRunReady();
+	}
+}
+
+/*-------------------- Blocking tasks ----------------------------*/
+//Give the CPU back to the executive until the task is readied again.
+static CPU_VOID Wait(ExecTask task){
+	swapcontext(&taskCtx[task], &mainCtx);
+}
+
+static CPU_VOID ParserTask(CPU_VOID){
+	static Payload parserPayload;
+	CPU_INT16S c;
+
+	for (;;){
+		while (BfrQWriteClosed(payloadQ))
+			Wait(ExecParser);
+		while ((c = GetByte()) < 0)
+			Wait(ExecParser);
+		if (ParseByte(&parserPayload, (CPU_INT08U)c)){
+			LoadPayloadBfrQ(payloadQ, &parserPayload);
+			ExecReady(ExecPayload);
+		}
+	}
+}
+
+static CPU_VOID PayloadBlockTask(CPU_VOID){
+	static Payload payload;
+	static CPU_CHAR message[BfrQSize];
+
+	for (;;){
+		while (!BfrQReadClosed(payloadQ))
+			Wait(ExecPayload);
+		while (BfrQWriteClosed(replyQ))
+			Wait(ExecPayload);
+		ConstructPayload(&payload);
+		ExecReady(ExecParser);
+		if (ConstructMessage(&payload, message)){
+			ReplyPutMsg(replyQ, message);
+			BfrQCloseWrite(replyQ);
+		}else
+			ReplyError(replyQ, message);
+		ExecReady(ExecReply);
+	}
+}
+
+static CPU_VOID ReplyTask(CPU_VOID){
+	CPU_INT16S c;
+
+	for (;;){
+		while (!BfrQReadClosed(replyQ))
+			Wait(ExecReply);
+		while ((c = BfrQNextByte(replyQ)) >= 0){
+			while (PutByte(c) < 0)
+				Wait(ExecReply);
+			BfrQRemByte(replyQ);
+		}
+		BfrQOpenRead(replyQ);
+		ExecReady(ExecPayload);
+	}
+}
+
+static CPU_VOID SwitchParser(CPU_VOID)  { swapcontext(&mainCtx, &taskCtx[ExecParser]); }
+static CPU_VOID SwitchPayload(CPU_VOID) { swapcontext(&mainCtx, &taskCtx[ExecPayload]); }
+static CPU_VOID SwitchReply(CPU_VOID)   { swapcontext(&mainCtx, &taskCtx[ExecReply]); }
+static CPU_VOID SwitchParserCount(CPU_VOID)  { Count(ExecParser, SwitchParser); }
+static CPU_VOID SwitchPayloadCount(CPU_VOID) { Count(ExecPayload, SwitchPayload); }
+static CPU_VOID SwitchReplyCount(CPU_VOID)   { Count(ExecReply, SwitchReply); }
+
+static CPU_VOID RunSwitch(CPU_VOID){
+	static CPU_VOID (*const bodies[NumExecTasks])(CPU_VOID) = { ParserTask, PayloadBlockTask, ReplyTask };
+	ExecTask t;
+
+	for (t = ExecParser; t < NumExecTasks; t++){
+		getcontext(&taskCtx[t]);
+		taskCtx[t].uc_stack.ss_sp = taskStk[t];
+		taskCtx[t].uc_stack.ss_size = StackSize;
+		taskCtx[t].uc_link = NULL;
+		makecontext(&taskCtx[t], bodies[t], 0);
+		ExecReady(t);
+	}
+	ExecInit(ExecParser, counting ? SwitchParserCount : SwitchParser);
+	ExecInit(ExecPayload, counting ? SwitchPayloadCount : SwitchPayload);
+	ExecInit(ExecReply, counting ? SwitchReplyCount : SwitchReply);
+
+	while (!Drained()){
+		SerIsr();
+		ExecRunReady();
+	}
+}
+
+static CPU_VOID Nothing(CPU_VOID){
+}
+
+/*-------------------- R u n ( ) -------------------------------------
+	Purpose:	Put the whole stream through one driver.
+*/
+static CPU_VOID Run(Driver drv, CPU_BOOLEAN count, CPU_INT32U bfrSize, ExecRun *result){
+	struct timespec t0, t1;
+	ExecTask t;
+
+	memset(result, 0, sizeof(*result));
+	run = result;
+	counting = count;
+	inPos = 0;
+	bytesIn = bytesOut = 0;
+	BfrInit(&iBfr, iBfrSpace, bfrSize);
+	BfrInit(&oBfr, oBfrSpace, bfrSize);
+	PayloadInit(&payloadQ, &replyQ);
+	for (t = ExecParser; t < NumExecTasks; t++)     // Take the readies left over
+		ExecInit(t, Nothing);
+	ExecRunReady();
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	switch (drv){
+	case DrvRoundRobin: RunRoundRobin(); break;
+	case DrvCoro:       RunCoro(); break;
+	default:            RunSwitch(); break;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	result->ns = (CPU_INT64S)(t1.tv_sec - t0.tv_sec) * 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+/*-------------------- M a i n ( ) ----------------------------*/
+int main(int argc, char *argv[]){
+	CPU_INT32U packets = DefaultPackets;
+	CPU_INT32U bfrSize = 4;
+	CPU_INT08U pkt[GenMaxPkt];
+	ExecRun timed, counted;
+	CPU_INT64U calls, idle;
+	PktGen gen;
+	Driver d;
+	ExecTask t;
+	CPU_INT32U i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:p:f:o:")) != -1){
+		switch (opt){
+		case 'n': packets = strtoul(optarg, NULL, 0); break;
+		case 'p': passes = strtoul(optarg, NULL, 0); break;
+		case 'f': bfrSize = strtoul(optarg, NULL, 0); break;
+		case 'o': txPerTick = strtoul(optarg, NULL, 0); break;
+		default:  optind = argc + 1; break;
+		}
+	}
+	if (optind != argc || packets < 1 || passes < 1 || bfrSize < 1 || bfrSize > MaxSerBfr || txPerTick < 1){
+		fprintf(stderr, "usage: %s [-n packets] [-p passes] [-f bytes] [-o bytes]\n", argv[0]);
+		return 2;
+	}
+
+	stream = malloc((size_t)packets * GenMaxPkt);
+	for (t = ExecParser; t < NumExecTasks; t++)
+		taskStk[t] = malloc(StackSize);
+	if (stream == NULL || taskStk[NumExecTasks - 1] == NULL){
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	PktGenInit(&gen, 48);
+	for (i = 0; i < packets; i++){
+		CPU_INT08U len = PktGenNext(&gen, pkt, StationAddr, (CPU_INT08U)(2 + PktGenRand(&gen) % 200));
+
+		memcpy(stream + streamLen, pkt, len);
+		streamLen += len;
+	}
+
+	printf("%u packets, %u bytes; %u byte serial buffers, %u bytes sent per byte time, %u rr passes\n",
+	       packets, streamLen, bfrSize, txPerTick, passes);
+	printf("  %-7s %8s %10s %10s %10s %10s %10s %9s %10s\n", "driver", "ns/byte", "calls/byte",
+	       "idle/byte", TaskNames[0], TaskNames[1], TaskNames[2], "out bytes", "out sum");
+	for (d = DrvRoundRobin; d < NumDrivers; d++){
+		Run(d, TRUE, bfrSize, &counted);
+		Run(d, FALSE, bfrSize, &timed);
+		calls = idle = 0;
+		for (t = ExecParser; t < NumExecTasks; t++){
+			calls += counted.calls[t];
+			idle += counted.idle[t];
+		}
+		printf("  %-7s %8.1f %10.2f %10.2f", DriverNames[d], (double)timed.ns / streamLen,
+		       (double)calls / streamLen, (double)idle / streamLen);
+		for (t = ExecParser; t < NumExecTasks; t++)
+			printf(" %10.2f", (double)counted.calls[t] / streamLen);
+		printf(" %9u   %08x%s\n", timed.outBytes, timed.outSum,
+		       counted.outSum != timed.outSum ? " (runs differ)" : "");
+	}
+
+	printf("task state: coroutines %u bytes (%u continuations, ready bitmap, task table);\n"
+	       "            a task per stage needs its own stack, the Prog 5 build's 3 x 128 words = %u bytes\n",
+	       (CPU_INT32U)(NumExecTasks * sizeof(CoroLc) + 1 + NumExecTasks * sizeof(CPU_INT32U)),
+	       NumExecTasks, 3 * 128 * 4);
+	return 0;
+}
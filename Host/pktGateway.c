@@ -0,0 +1,551 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktGateway.c
+-----------------------------------------------------------------------
+Single process base station gateway. Many serial or pty links are
+multiplexed with epoll; every link keeps its own ParserCtx and payload
+buffer so the Prog 5 ParseByte() state machine runs independently per
+link. Decoded payloads are formatted with the station's reply text,
+and every reading lands in the station's NodeCache, keyed by link and
+source address, so the latest value from any node can be looked up.
+
+Link mode:   pktGateway [-b baud] [-v] /dev/ttyUSB0 /dev/pts/3 ...
+             Runs until SIGINT, then prints the per-link counters.
+
+Bench mode:  pktGateway -s links [-n nodes/link] [-r pkts/s] [-d secs]
+             A generator thread drives each simulated link (a pipe)
+             with pktGen traffic. Reports CPU time per MB decoded and
+             the write-to-decode latency distribution. A reader thread
+             looks up random nodes in the cache meanwhile.
+
+Build:  gcc -O2 -pthread -include HostOS.h -I../Prog5/App -DNodeKeys=262144 -DNodeCacheNodes=65536
+            -o pktGateway pktGateway.c pktParser.c Payload.c pktGen.c
+            ../Prog5/App/Reading.c ../Prog5/App/NodeCache.c ../Prog5/App/ReplyFrame.c
+            ../Prog5/App/Crc32.c ../Prog5/App/MsgDesc.c
+-----------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "CPU.h"
+#include "pktParser.h"
+#include "Payload.h"
+#include "pktGen.h"
+#include "Reading.h"
+#include "NodeCache.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define MaxEvents 256       // Ready links handled per epoll_wait()
+#define ReadBfrSize 4096    // Bytes read from a link at a time
+#define WaitMs 100          // epoll_wait() timeout
+#define SendRingSize 64     // Outstanding send stamps per simulated link
+#define LatBuckets 100000   // Latency histogram: 1 us buckets up to 100 ms
+#define NsPerSec 1000000000LL
+#define GenBurst 64         // Packets the generator sends between clock checks
+#define NodesPerLink 256    // Cache node number = link * NodesPerLink + source address
+
+typedef struct
+{
+	CPU_INT64U bytes;            // Bytes read from the link
+	CPU_INT64U packets;          // Complete payloads
+	CPU_INT64U errors[E5 + 1];   // Error payloads by ErrorState
+	CPU_INT64U badAddr;          // Payloads for another station
+	CPU_INT64U badType;          // Payloads of an unknown type
+} LinkStats;
+
+typedef struct
+{
+	_Atomic CPU_INT32U head;         // Next stamp the generator writes
+	_Atomic CPU_INT32U tail;         // Next stamp the gateway reads
+	CPU_INT64S ns[SendRingSize];     // Time each packet was written
+} SendRing;
+
+typedef struct
+{
+	int fd;                      // Read side of the link
+	int genFd;                   // Bench mode: generator side of the link
+	CPU_INT32U id;               // Link number for reports
+	const CPU_CHAR *name;        // Device path, or NULL in bench mode
+	ParserCtx ctx;               // Per-link parser state
+	Payload payload;             // Per-link payload buffer
+	LinkStats stats;
+	SendRing ring;
+} Link;
+
+//----- g l o b a l    v a r i a b l e s -----
+static volatile sig_atomic_t stopFlag = 0;
+static atomic_int genStop;
+static CPU_INT64U latHist[LatBuckets];
+static CPU_INT64U latCount;
+static CPU_INT64S startNs;
+
+/*-------------------- N o w N s ( ) -------------------------------------
+	Purpose:	Return the monotonic clock in nanoseconds.
+*/
+static CPU_INT64S NowNs(CPU_VOID){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CPU_INT64S)ts.tv_sec * NsPerSec + ts.tv_nsec;
+}
+
+/*-------------------- C p u N s ( ) -------------------------------------
+	Purpose:	Return the user + system CPU time used by the calling thread.
+*/
+static CPU_INT64S CpuNs(CPU_VOID){
+	struct rusage ru;
+
+	getrusage(RUSAGE_THREAD, &ru);
+	return ((CPU_INT64S)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * NsPerSec +
+	       ((CPU_INT64S)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+}
+
+/*-------------------- O n S i g I n t ( ) -------------------------------------
+	Purpose:	Ask the gateway loop to stop and print its counters.
+*/
+static CPU_VOID OnSigInt(int sig){
+	(CPU_VOID)sig;
+	stopFlag = 1;
+}
+
+/*-------------------- R a i s e F d L i m i t ( ) -------------------------------------
+	Purpose:	Allow as many open files as the hard limit permits; a thousand
+				links need two thousand descriptors in bench mode.
+*/
+static CPU_VOID RaiseFdLimit(CPU_VOID){
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0){
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+}
+
+/*-------------------- O p e n L i n k ( ) -------------------------------------
+	Purpose:	Open a serial or pty device raw and non-blocking.
+	Return:		The fd, or -1 on failure.
+*/
+static int OpenLink(const CPU_CHAR *name, speed_t speed){
+	struct termios tio;
+	int fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if (fd < 0) return -1;
+	if (tcgetattr(fd, &tio) == 0){
+		cfmakeraw(&tio);
+		tio.c_cflag |= CLOCAL | CREAD;
+		if (speed != B0) cfsetspeed(&tio, speed);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+/*-------------------- R e c o r d L a t e n c y ( ) -------------------------------------
+	Purpose:	Match a decoded payload to the time its packet was written.
+*/
+static CPU_VOID RecordLatency(Link *link, CPU_INT64S now){
+	CPU_INT32U tail = atomic_load_explicit(&link->ring.tail, memory_order_relaxed);
+	CPU_INT64S us;
+
+	if (tail == atomic_load_explicit(&link->ring.head, memory_order_acquire))
+		return;
+	us = (now - link->ring.ns[tail % SendRingSize]) / 1000;
+	atomic_store_explicit(&link->ring.tail, tail + 1, memory_order_release);
+
+	latHist[us < LatBuckets ? us : LatBuckets - 1]++;
+	latCount++;
+}
+
+/*-------------------- H a n d l e P a y l o a d ( ) -------------------------------------
+	Purpose:	Count a finished payload and, if asked, print its reply text.
+*/
+static CPU_VOID HandlePayload(Link *link, CPU_BOOLEAN verbose){
+	CPU_CHAR message[80];
+	Payload *payload = &link->payload;
+	Reading rdg;
+
+	if (payload->payloadLen < 0){
+		link->stats.errors[0 - payload->payloadLen]++;
+		if (verbose){
+			ConstructError(payload, message);
+			printf("L%u *** ERR: %s\n", link->id, message + 1);
+		}
+		return;
+	}
+
+	link->stats.packets++;
+	if (payload->dstAddr == StationAddr &&
+	    DecodeReading(payload->msgType, payload->data, payload->payloadLen - PayloadHeaderDiff, &rdg))
+		NodeCacheUpdate(link->id * NodesPerLink + payload->srcAddr, payload->msgType, &rdg,
+		                (CPU_INT32U)((NowNs() - startNs) / 1000000));
+	if (ConstructMessage(payload, message)){
+		if (verbose) printf("L%u%s", link->id, message);
+	}else{
+		if (payload->dstAddr != StationAddr) link->stats.badAddr++;
+		else link->stats.badType++;
+		if (verbose) printf("L%u *** INFO: %s\n", link->id, message + 1);
+	}
+}
+
+/*-------------------- S e r v i c e L i n k ( ) -------------------------------------
+	Purpose:	Read what a ready link has and run its bytes through its parser.
+	Return:		FALSE once the link has hung up.
+*/
+static CPU_BOOLEAN ServiceLink(Link *link, CPU_BOOLEAN verbose, CPU_BOOLEAN timed){
+	CPU_INT08U bfr[ReadBfrSize];
+	ssize_t got, i;
+
+	for (;;){
+		got = read(link->fd, bfr, sizeof(bfr));
+		if (got < 0) return errno == EAGAIN || errno == EINTR;
+		if (got == 0) return FALSE;
+
+		link->stats.bytes += got;
+		for (i = 0; i < got; i++){
+			if (ParseByte(&link->ctx, &link->payload, bfr[i])){
+				if (timed && link->payload.payloadLen > 0) RecordLatency(link, NowNs());
+				do
+					HandlePayload(link, verbose);
+				while (ParseMore(&link->ctx, &link->payload));    // Rest of an aggregate frame
+			}
+		}
+		if (got < (ssize_t)sizeof(bfr)) return TRUE;
+	}
+}
+
+/*-------------------- R u n G a t e w a y ( ) -------------------------------------
+	Purpose:	Wait on every link with epoll and service the ready ones
+				until stopped or until every link has hung up.
+*/
+static CPU_VOID RunGateway(int ep, CPU_INT32U openLinks, CPU_BOOLEAN verbose, CPU_BOOLEAN timed,
+                           CPU_INT64S untilNs){
+	struct epoll_event events[MaxEvents];
+	int ready, i;
+
+	while (!stopFlag && openLinks > 0){
+		if (untilNs && NowNs() >= untilNs) break;
+
+		ready = epoll_wait(ep, events, MaxEvents, WaitMs);
+		for (i = 0; i < ready; i++){
+			Link *link = events[i].data.ptr;
+
+			if (!ServiceLink(link, verbose, timed) || (events[i].events & (EPOLLHUP | EPOLLERR))){
+				epoll_ctl(ep, EPOLL_CTL_DEL, link->fd, NULL);
+				close(link->fd);
+				openLinks--;
+			}
+		}
+	}
+}
+
+/*-------------------- G e n e r a t o r ( ) -------------------------------------
+	Purpose:	Bench mode traffic source. Round-robins packets over the links
+				at the requested total rate and stamps each successful write.
+*/
+typedef struct
+{
+	Link *links;
+	CPU_INT32U numLinks;
+	CPU_INT32U rate;             // Total packets per second, 0 = flat out
+	CPU_INT32U nodesPerLink;     // Source addresses used on each link
+	CPU_INT64U sent;             // Packets written
+	CPU_INT64U skipped;          // Packets skipped on a full pipe or ring
+} GenArgs;
+
+static CPU_VOID *Generator(CPU_VOID *arg){
+	GenArgs *g = arg;
+	PktGen gen;
+	CPU_INT08U pkt[GenMaxPkt];
+	CPU_INT64S startNs = NowNs();
+	CPU_INT64U n = 0;
+
+	PktGenInit(&gen, 12345);
+	while (!atomic_load(&genStop)){
+		Link *link = &g->links[n % g->numLinks];
+		CPU_INT32U head = atomic_load_explicit(&link->ring.head, memory_order_relaxed);
+		CPU_INT08U len = PktGenNext(&gen, pkt, StationAddr, 2 + (n / g->numLinks) % g->nodesPerLink);
+
+		if (head - atomic_load_explicit(&link->ring.tail, memory_order_acquire) < SendRingSize){
+			link->ring.ns[head % SendRingSize] = NowNs();
+			// Pipe writes up to PIPE_BUF are all or nothing.
+			if (write(link->genFd, pkt, len) == len){
+				atomic_store_explicit(&link->ring.head, head + 1, memory_order_release);
+				g->sent++;
+			}else
+				g->skipped++;
+		}else
+			g->skipped++;
+
+		if (++n % GenBurst == 0 && g->rate){
+			CPU_INT64S due = startNs + (CPU_INT64S)(n * (double)NsPerSec / g->rate);
+			struct timespec ts = { due / NsPerSec, due % NsPerSec };
+
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		}
+	}
+	return NULL;
+}
+
+/*-------------------- C a c h e R e a d e r ( ) -------------------------------------
+	Purpose:	Bench mode cache client. Looks up random nodes and reading types
+				while the gateway thread is updating the cache.
+*/
+typedef struct
+{
+	CPU_INT32U numLinks;
+	CPU_INT32U nodesPerLink;
+	CPU_INT64U lookups;          // NodeCacheRead() calls
+	CPU_INT64U hits;             // Lookups that found a reading
+} ReaderArgs;
+
+static CPU_VOID *CacheReader(CPU_VOID *arg){
+	static const CPU_CHAR Types[] = "BDHPRTW";
+	ReaderArgs *r = arg;
+	PktGen rnd;
+	Reading rdg;
+	CPU_INT32U time;
+
+	PktGenInit(&rnd, 54321);
+	while (!atomic_load_explicit(&genStop, memory_order_relaxed)){
+		CPU_INT32U x = PktGenRand(&rnd);
+		CPU_INT32U link = x % r->numLinks;
+		CPU_INT32U src = 2 + (x >> 12) % r->nodesPerLink;
+
+		if (NodeCacheRead(link * NodesPerLink + src, Types[(x >> 24) % 7], &rdg, &time))
+			r->hits++;
+		r->lookups++;
+	}
+	return NULL;
+}
+
+/*-------------------- L a t e n c y A t ( ) -------------------------------------
+	Purpose:	Return the latency (us) at a fraction of the recorded payloads.
+*/
+static CPU_INT32U LatencyAt(double fraction){
+	CPU_INT64U want = (CPU_INT64U)(fraction * latCount);
+	CPU_INT64U seen = 0;
+	CPU_INT32U us;
+
+	for (us = 0; us < LatBuckets; us++){
+		seen += latHist[us];
+		if (seen >= want && seen > 0) return us;
+	}
+	return LatBuckets - 1;
+}
+
+/*-------------------- P r i n t L i n k S t a t s ( ) -------------------------------------
+	Purpose:	Print one row of per-link counters.
+*/
+static CPU_VOID PrintLinkStats(const Link *link){
+	const LinkStats *s = &link->stats;
+
+	printf("L%-4u %-16s %10llu %8llu %6llu %6llu %6llu %6llu %6llu %6llu %6llu\n",
+	       link->id, link->name ? link->name : "-", s->bytes, s->packets,
+	       s->errors[E1], s->errors[E2], s->errors[E3], s->errors[E4], s->errors[E5],
+	       s->badAddr, s->badType);
+}
+
+/*-------------------- P r i n t H e a d e r ( ) -------------------------------------
+	Purpose:	Print the column titles for PrintLinkStats().
+*/
+static CPU_VOID PrintHeader(CPU_VOID){
+	printf("%-5s %-16s %10s %8s %6s %6s %6s %6s %6s %6s %6s\n",
+	       "link", "device", "bytes", "packets", "EP1", "EP2", "EP3", "ECS", "ESize", "BadAdr", "BadTyp");
+}
+
+/*-------------------- P r i n t N o d e C a c h e ( ) -------------------------------------
+	Purpose:	Print the latest reading of each type from every node heard.
+*/
+static CPU_VOID PrintNodeCache(CPU_INT32U numLinks){
+	CPU_INT32U link, src, type, time;
+	Reading rdg;
+
+	for (link = 0; link < numLinks; link++)
+		for (src = 0; src < NodesPerLink; src++)
+			for (type = 0; type < NumRdgTypes; type++)
+				if (NodeCacheRead(link * NodesPerLink + src, ReadingTypeChar(type), &rdg, &time))
+					printf("L%u N%u %c = %d %d  (at %u ms)\n", link, src, ReadingTypeChar(type), rdg.value, rdg.aux, time);
+}
+
+/*-------------------- B e n c h ( ) -------------------------------------
+	Purpose:	Drive simulated links from a generator thread and report the
+				gateway's CPU cost per MB and its latency distribution.
+*/
+static int Bench(CPU_INT32U numLinks, CPU_INT32U nodesPerLink, CPU_INT32U rate, CPU_INT32U secs){
+	Link *links = calloc(numLinks, sizeof(Link));
+	LinkStats total;
+	CPU_INT64U minPkts = ~0ULL, maxPkts = 0;
+	CPU_INT64S cpu0, cpu1, wall0, wall1;
+	GenArgs g;
+	ReaderArgs rd;
+	NodeCacheStats cs;
+	pthread_t genThread, readerThread;
+	int ep = epoll_create1(0);
+	CPU_INT32U i, k;
+	double mb;
+
+	for (i = 0; i < numLinks; i++){
+		int p[2];
+		struct epoll_event ev;
+
+		if (pipe2(p, O_NONBLOCK) < 0){
+			perror("pipe2");
+			return 1;
+		}
+		links[i].fd = p[0];
+		links[i].genFd = p[1];
+		links[i].id = i;
+		ParserCtxInit(&links[i].ctx);
+		ev.events = EPOLLIN;
+		ev.data.ptr = &links[i];
+		epoll_ctl(ep, EPOLL_CTL_ADD, p[0], &ev);
+	}
+
+	memset(&g, 0, sizeof(g));
+	g.links = links;
+	g.numLinks = numLinks;
+	g.rate = rate;
+	g.nodesPerLink = nodesPerLink;
+	memset(&rd, 0, sizeof(rd));
+	rd.numLinks = numLinks;
+	rd.nodesPerLink = nodesPerLink;
+	atomic_store(&genStop, 0);
+
+	cpu0 = CpuNs();
+	wall0 = NowNs();
+	pthread_create(&genThread, NULL, Generator, &g);
+	pthread_create(&readerThread, NULL, CacheReader, &rd);
+	RunGateway(ep, numLinks, FALSE, TRUE, wall0 + (CPU_INT64S)secs * NsPerSec);
+	atomic_store(&genStop, 1);
+	pthread_join(genThread, NULL);
+	pthread_join(readerThread, NULL);
+	// Decode whatever is still in flight.
+	RunGateway(ep, numLinks, FALSE, TRUE, NowNs() + NsPerSec / 10);
+	wall1 = NowNs();
+	cpu1 = CpuNs();
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < numLinks; i++){
+		total.bytes += links[i].stats.bytes;
+		total.packets += links[i].stats.packets;
+		for (k = E1; k <= E5; k++) total.errors[k] += links[i].stats.errors[k];
+		if (links[i].stats.packets < minPkts) minPkts = links[i].stats.packets;
+		if (links[i].stats.packets > maxPkts) maxPkts = links[i].stats.packets;
+		close(links[i].fd);
+		close(links[i].genFd);
+	}
+
+	mb = total.bytes / 1e6;
+	printf("links            %u\n", numLinks);
+	printf("packets          %llu written, %llu skipped (pipe or ring full)\n", g.sent, g.skipped);
+	printf("decoded          %llu packets, %.2f MB in %.2f s (%.0f pkts/s)\n",
+	       total.packets, mb, (wall1 - wall0) / 1e9, total.packets / ((wall1 - wall0) / 1e9));
+	printf("errors           EP1 %llu  EP2 %llu  EP3 %llu  ECS %llu  ESize %llu\n",
+	       total.errors[E1], total.errors[E2], total.errors[E3], total.errors[E4], total.errors[E5]);
+	printf("per link         %llu min, %llu max packets\n", minPkts, maxPkts);
+	printf("gateway cpu      %.3f s, %.2f ms per MB\n", (cpu1 - cpu0) / 1e9, mb > 0 ? (cpu1 - cpu0) / 1e6 / mb : 0.0);
+	printf("latency us       p50 %u  p90 %u  p99 %u  p99.9 %u  max %u\n",
+	       LatencyAt(0.50), LatencyAt(0.90), LatencyAt(0.99), LatencyAt(0.999), LatencyAt(1.0));
+	NodeCacheGetStats(&cs);
+	printf("node cache       %u nodes, %u updates, %u dropped (full), %u dropped (node number)\n",
+	       NodeCacheUsed(), cs.updates, cs.full, cs.badNode);
+	printf("cache reader     %llu lookups (%.1f M/s), %llu hits\n",
+	       rd.lookups, rd.lookups / 1e6 / ((wall1 - wall0) / 1e9), rd.hits);
+
+	close(ep);
+	free(links);
+	return 0;
+}
+
+/*-------------------- M a i n ( ) ----------------------------*/
+int main(int argc, char *argv[]){
+	CPU_INT32U simLinks = 0;
+	CPU_INT32U nodesPerLink = 64;
+	CPU_INT32U rate = 0;
+	CPU_INT32U secs = 5;
+	CPU_BOOLEAN verbose = FALSE;
+	speed_t speed = B0;
+	Link *links;
+	CPU_INT32U numLinks = 0;
+	int opt, ep, i;
+
+	while ((opt = getopt(argc, argv, "s:n:r:d:b:v")) != -1){
+		switch (opt){
+		case 's': simLinks = strtoul(optarg, NULL, 0); break;
+		case 'n': nodesPerLink = strtoul(optarg, NULL, 0); break;
+		case 'r': rate = strtoul(optarg, NULL, 0); break;
+		case 'd': secs = strtoul(optarg, NULL, 0); break;
+		case 'b':
+			switch (strtoul(optarg, NULL, 0)){
+			case 9600:   speed = B9600; break;
+			case 115200: speed = B115200; break;
+			case 460800: speed = B460800; break;
+			case 921600: speed = B921600; break;
+			}
+			break;
+		case 'v': verbose = TRUE; break;
+		default:
+			fprintf(stderr, "usage: %s [-b baud] [-v] device...\n"
+			                "       %s -s links [-n nodes/link] [-r pkts/s] [-d secs]\n", argv[0], argv[0]);
+			return 2;
+		}
+	}
+
+	RaiseFdLimit();
+	startNs = NowNs();
+	NodeCacheInit();
+	if (simLinks){
+		if (nodesPerLink < 1 || nodesPerLink > NodesPerLink - 2){
+			fprintf(stderr, "*** ERROR: nodes per link must be 1..%u\n", NodesPerLink - 2);
+			return 2;
+		}
+		return Bench(simLinks, nodesPerLink, rate, secs);
+	}
+
+	if (optind >= argc){
+		fprintf(stderr, "*** ERROR: no links given\n");
+		return 2;
+	}
+
+	ep = epoll_create1(0);
+	links = calloc(argc - optind, sizeof(Link));
+	for (i = optind; i < argc; i++){
+		Link *link = &links[numLinks];
+		struct epoll_event ev;
+
+		if ((link->fd = OpenLink(argv[i], speed)) < 0){
+			fprintf(stderr, "*** ERROR: cannot open %s: %s\n", argv[i], strerror(errno));
+			continue;
+		}
+		link->id = numLinks;
+		link->name = argv[i];
+		ParserCtxInit(&link->ctx);
+		ev.events = EPOLLIN;
+		ev.data.ptr = link;
+		epoll_ctl(ep, EPOLL_CTL_ADD, link->fd, &ev);
+		numLinks++;
+	}
+
+	signal(SIGINT, OnSigInt);
+	RunGateway(ep, numLinks, verbose, FALSE, 0);
+
+	PrintHeader();
+	for (i = 0; i < (int)numLinks; i++)
+		PrintLinkStats(&links[i]);
+	PrintNodeCache(numLinks);
+	close(ep);
+	free(links);
+	return 0;
+}
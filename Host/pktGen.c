@@ -0,0 +1,293 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			               pktGen.c
+-----------------------------------------------------------------------
+Sensor traffic generator for the host tools and benchmarks.
+
+Packets follow the station protocol: 3 preamble bytes, a checksum byte
+chosen so the XOR of the whole packet is zero, the packet length, the
+destination and source addresses, the message type and the data bytes.
+Multi-byte fields are little endian except the big endian date/time
+stamp; wind speed and precipitation depth are packed BCD.
+
+With PktGen.crcMode set, packets use the CRC mode framing instead:
+P3CrcChar, no checksum byte, and a CRC-32 of the length through the
+last data byte at the end (see Prog 5 Crc32.h).
+
+With PktGen.seqMode set, each node numbers its packets: SeqFlag is set
+in the message type and the node's next sequence number follows the
+data (see Prog 5 SeqTrack.h).
+
+PktGenAggregate() packs several payloads into one aggregate frame:
+P3AggChar, one checksum for the frame, and each payload as its length
+and its dst, src, type and data bytes (see Prog 5 Parser.c).
+
+PktGenCommand() frames a station console command (see Prog 5
+Console.h): P3CmdChar, the checksum, and the command with no addresses.
+-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include "pktGen.h"
+#include "Crc32.h"
+#include "SeqTrack.h"
+
+//Preamble bytes as defined in guidelines.
+#define P1Char 0x03
+#define P2Char 0xAF
+#define P3Char 0xEF
+#define P3CrcChar 0x5C
+#define P3AggChar 0xA6
+#define P3CmdChar 0xC5
+
+#define CrcLen 4             //Bytes of CRC at the end of a CRC mode packet
+
+#define PacketHeaderDiff 5   //Amount of header before the payload starts in the packet.
+#define PayloadHeaderDiff 8  //Amount of header before the data starts in the packet.
+
+/*-------------------- P k t G e n R a n d ( ) -------------------------------------
+	Purpose:	Return the next xorshift32 pseudo-random number.
+*/
+CPU_INT32U PktGenRand(PktGen *gen){
+	CPU_INT32U x = gen->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return gen->seed = x;
+}
+
+/*-------------------- W a l k ( ) -------------------------------------
+	Purpose:	Move a reading by at most step in either direction, within [lo, hi].
+*/
+static CPU_INT32S Walk(PktGen *gen, CPU_INT32S v, CPU_INT32S step, CPU_INT32S lo, CPU_INT32S hi){
+	v += (CPU_INT32S)(PktGenRand(gen) % (2 * step + 1)) - step;
+	if (v < lo) v = lo;
+	if (v > hi) v = hi;
+	return v;
+}
+
+/*-------------------- P k t G e n I n i t ( ) -------------------------------------
+	Purpose:	Seed the generator and give every node a plausible starting point.
+*/
+CPU_VOID PktGenInit(PktGen *gen, CPU_INT32U seed){
+	CPU_INT32U n;
+
+	gen->seed = seed ? seed : 0x2545F491;
+	gen->crcMode = FALSE;
+	gen->seqMode = FALSE;
+	gen->minutes = 0;
+	for (n = 0; n < GenNodes; n++){
+		GenNode *node = &gen->nodes[n];
+
+		node->temp  = 10 + PktGenRand(gen) % 20;
+		node->dewPt = node->temp - 5;
+		node->hum   = 40 + PktGenRand(gen) % 40;
+		node->pres  = 990 + PktGenRand(gen) % 40;
+		node->rad   = PktGenRand(gen) % 800;
+		node->speed = PktGenRand(gen) % 200;
+		node->dir   = PktGenRand(gen) % 360;
+		node->depth = 0;
+		node->seq = 0;
+	}
+}
+
+/*-------------------- P k t G e n B u i l d ( ) -------------------------------------
+	Purpose:	Frame a payload as a complete packet with a valid checksum.
+	Return:		Packet length in bytes.
+*/
+CPU_INT08U PktGenBuild(CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr,
+                       CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08U dataLen){
+	CPU_INT08U len = PayloadHeaderDiff + dataLen;
+	CPU_INT08U sum = 0;
+	CPU_INT08U i;
+
+	pkt[0] = P1Char;
+	pkt[1] = P2Char;
+	pkt[2] = P3Char;
+	pkt[3] = 0;
+	pkt[4] = len;
+	pkt[5] = dstAddr;
+	pkt[6] = srcAddr;
+	pkt[7] = msgType;
+	memcpy(&pkt[PayloadHeaderDiff], data, dataLen);
+
+	for (i = 0; i < len; i++)
+		sum ^= pkt[i];
+	pkt[3] = sum;
+	return len;
+}
+
+/*-------------------- P k t G e n C o m m a n d ( ) -------------------------------------
+	Purpose:	Frame a console command and its arguments with a valid checksum.
+	Return:		Frame length in bytes.
+*/
+CPU_INT08U PktGenCommand(CPU_INT08U *pkt, const CPU_INT08U *cmd, CPU_INT08U cmdLen){
+	CPU_INT08U len = PacketHeaderDiff + cmdLen;
+	CPU_INT08U sum = 0;
+	CPU_INT08U i;
+
+	pkt[0] = P1Char;
+	pkt[1] = P2Char;
+	pkt[2] = P3CmdChar;
+	pkt[3] = 0;
+	pkt[4] = len;
+	memcpy(&pkt[PacketHeaderDiff], cmd, cmdLen);
+
+	for (i = 0; i < len; i++)
+		sum ^= pkt[i];
+	pkt[3] = sum;
+	return len;
+}
+
+/*-------------------- P k t G e n B u i l d C r c ( ) -------------------------------------
+	Purpose:	Frame a payload as a complete CRC mode packet.
+	Return:		Packet length in bytes.
+*/
+CPU_INT08U PktGenBuildCrc(CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr,
+                          CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08U dataLen){
+	CPU_INT08U len = PayloadHeaderDiff - 1 + dataLen;
+	CPU_INT32U crc;
+	CPU_INT08U i;
+
+	pkt[0] = P1Char;
+	pkt[1] = P2Char;
+	pkt[2] = P3CrcChar;
+	pkt[3] = len + CrcLen;
+	pkt[4] = dstAddr;
+	pkt[5] = srcAddr;
+	pkt[6] = msgType;
+	memcpy(&pkt[PayloadHeaderDiff - 1], data, dataLen);
+
+	Crc32Init();
+	crc = Crc32Block(Crc32Seed, &pkt[3], len - 3);
+	for (i = 0; i < CrcLen; i++)
+		pkt[len + i] = (CPU_INT08U)(crc >> (8 * i));
+	return len + CrcLen;
+}
+
+/*-------------------- P k t G e n T y p e ( ) -------------------------------------
+	Purpose:	Advance one reading of a node and frame it as a packet of the given type.
+	Return:		Packet length in bytes, or 0 for an unknown type.
+*/
+CPU_INT08U PktGenType(PktGen *gen, CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr, CPU_CHAR msgType){
+	GenNode *node = &gen->nodes[srcAddr];
+	CPU_INT08U data[10];
+	CPU_INT08U len;
+	CPU_INT32U v;
+
+	switch (msgType){
+	case 'B':
+		node->pres = Walk(gen, node->pres, 1, 950, 1050);
+		data[0] = node->pres;
+		data[1] = node->pres >> 8;
+		len = 2;
+		break;
+	case 'D':
+		gen->minutes += 1 + PktGenRand(gen) % 5;
+		v = (2012u << 20) | ((1 + (gen->minutes / 40320) % 12) << 16) | ((1 + (gen->minutes / 1440) % 28) << 11) |
+		    (((gen->minutes / 60) % 24) << 6) | (gen->minutes % 60);
+		data[0] = v >> 24;
+		data[1] = v >> 16;
+		data[2] = v >> 8;
+		data[3] = v;
+		len = 4;
+		break;
+	case 'H':
+		node->hum = Walk(gen, node->hum, 1, 0, 100);
+		node->dewPt = Walk(gen, node->dewPt, 1, -40, 40);
+		data[0] = node->dewPt;
+		data[1] = node->dewPt >> 8;
+		data[2] = node->hum;
+		len = 3;
+		break;
+	case 'I':
+		len = sprintf((CPU_CHAR *)data, "NODE#%u", srcAddr);
+		break;
+	case 'P':
+		if (PktGenRand(gen) % 4 == 0) node->depth = (node->depth + 1) % 10000;
+		data[0] = ((node->depth / 1000) << 4) | (node->depth / 100 % 10);
+		data[1] = ((node->depth / 10 % 10) << 4) | (node->depth % 10);
+		len = 2;
+		break;
+	case 'R':
+		node->rad = Walk(gen, node->rad, 5, 0, 1200);
+		data[0] = node->rad;
+		data[1] = node->rad >> 8;
+		len = 2;
+		break;
+	case 'T':
+		node->temp = Walk(gen, node->temp, 1, -40, 50);
+		data[0] = node->temp;
+		data[1] = node->temp >> 8;
+		len = 2;
+		break;
+	case 'W':
+		node->speed = Walk(gen, node->speed, 3, 0, 9999);
+		node->dir = (node->dir + 360 + (PktGenRand(gen) % 21) - 10) % 360;
+		data[0] = ((node->speed / 1000) << 4) | (node->speed / 100 % 10);
+		data[1] = ((node->speed / 10 % 10) << 4) | (node->speed % 10);
+		data[2] = node->dir;
+		data[3] = node->dir >> 8;
+		len = 4;
+		break;
+	default:
+		return 0;
+	}
+	if (gen->seqMode){
+		data[len++] = node->seq++;
+		msgType |= SeqFlag;
+	}
+	if (gen->crcMode)
+		return PktGenBuildCrc(pkt, dstAddr, srcAddr, msgType, data, len);
+	return PktGenBuild(pkt, dstAddr, srcAddr, msgType, data, len);
+}
+
+/*-------------------- P k t G e n N e x t ( ) -------------------------------------
+	Purpose:	Produce the next packet from a node, choosing a message type with
+				weights that resemble a weather station report mix.
+	Return:		Packet length in bytes.
+*/
+CPU_INT08U PktGenNext(PktGen *gen, CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr){
+	static const CPU_CHAR mix[] = "TTTTTHHHBBBRRWWWWPPDI";
+
+	return PktGenType(gen, pkt, dstAddr, srcAddr, mix[PktGenRand(gen) % (sizeof(mix) - 1)]);
+}
+
+/*-------------------- P k t G e n A g g r e g a t e ( ) -------------------------------------
+	Purpose:	Produce the next packet from each of count nodes (at most GenMaxAgg)
+				and frame them as one aggregate frame.
+	Return:		Frame length in bytes.
+*/
+CPU_INT08U PktGenAggregate(PktGen *gen, CPU_INT08U *frame, CPU_INT08U dstAddr,
+                           const CPU_INT08U *srcAddrs, CPU_INT08U count){
+	CPU_BOOLEAN crcMode = gen->crcMode;
+	CPU_INT08U pkt[GenMaxPkt];
+	CPU_INT08U len = PacketHeaderDiff;
+	CPU_INT08U sum = 0;
+	CPU_INT08U n, i;
+
+	//Build each payload as a checksum mode packet and keep dst on
+	gen->crcMode = FALSE;
+	for (n = 0; n < count && n < GenMaxAgg; n++){
+		CPU_INT08U plen = PktGenNext(gen, pkt, dstAddr, srcAddrs[n]);
+
+		frame[len++] = plen - PacketHeaderDiff;
+		memcpy(&frame[len], &pkt[PacketHeaderDiff], plen - PacketHeaderDiff);
+		len += plen - PacketHeaderDiff;
+	}
+	gen->crcMode = crcMode;
+
+	frame[0] = P1Char;
+	frame[1] = P2Char;
+	frame[2] = P3AggChar;
+	frame[3] = 0;
+	frame[4] = len;
+	for (i = 0; i < len; i++)
+		sum ^= frame[i];
+	frame[3] = sum;
+	return len;
+}
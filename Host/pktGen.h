@@ -0,0 +1,57 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			               pktGen.h
+-----------------------------------------------------------------------
+Sensor traffic generator for the host tools and benchmarks. Each node
+keeps a random walk per reading so consecutive values look like real
+weather rather than noise.
+-----------------------------------------------------------------------*/
+
+#ifndef PKTGEN_H
+#define PKTGEN_H
+
+#include "CPU.h"
+
+#define GenNodes 256      // One walk state per 8 bit source address
+#define GenMaxPkt 32      // Largest packet PktGenNext() produces
+#define GenMaxAgg 6       // Most payloads PktGenAggregate() puts in a frame
+#define GenMaxAggLen 80   // Largest frame PktGenAggregate() produces
+
+typedef struct
+{
+	CPU_INT16S temp;      // Degrees
+	CPU_INT16S dewPt;     // Degrees
+	CPU_INT08U hum;       // Percent
+	CPU_INT16U pres;      // Millibars
+	CPU_INT16U rad;       // Solar intensity
+	CPU_INT16U speed;     // Wind speed in tenths
+	CPU_INT16U dir;       // Wind direction in degrees
+	CPU_INT16U depth;     // Precipitation in hundredths
+	CPU_INT08U seq;       // Next sequence number
+} GenNode;
+
+typedef struct
+{
+	CPU_INT32U seed;      // xorshift state
+	CPU_INT32U minutes;   // Date/time stamp clock
+	CPU_BOOLEAN crcMode;  // Frame packets with a CRC-32 instead of a checksum
+	CPU_BOOLEAN seqMode;  // Number each node's packets (Prog 5 SeqTrack.h)
+	GenNode nodes[GenNodes];
+} PktGen;
+
+CPU_VOID PktGenInit(PktGen *gen, CPU_INT32U seed);
+CPU_INT32U PktGenRand(PktGen *gen);
+CPU_INT08U PktGenBuild(CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr,
+                       CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08U dataLen);
+CPU_INT08U PktGenBuildCrc(CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr,
+                          CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08U dataLen);
+CPU_INT08U PktGenCommand(CPU_INT08U *pkt, const CPU_INT08U *cmd, CPU_INT08U cmdLen);
+CPU_INT08U PktGenType(PktGen *gen, CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr, CPU_CHAR msgType);
+CPU_INT08U PktGenNext(PktGen *gen, CPU_INT08U *pkt, CPU_INT08U dstAddr, CPU_INT08U srcAddr);
+CPU_INT08U PktGenAggregate(PktGen *gen, CPU_INT08U *frame, CPU_INT08U dstAddr,
+                           const CPU_INT08U *srcAddrs, CPU_INT08U count);
+
+#endif
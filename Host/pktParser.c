@@ -0,0 +1,210 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktParser.c
+-----------------------------------------------------------------------
+Re-entrant form of the Prog 5 ParseByte() state machine. The states,
+error codes and error payloads are the same as on the station.
+-----------------------------------------------------------------------*/
+#include <string.h>
+#include "pktParser.h"
+#include "Crc32.h"
+
+//Preamble bytes as defined in guidelines.
+#define P1Char 0x03
+#define P2Char 0xAF
+#define P3Char 0xEF
+#define P3CrcChar 0x5C        // Third preamble byte of a CRC mode packet
+#define P3AggChar 0xA6        // Third preamble byte of an aggregate frame
+
+#define CrcHeaderDiff 8       // Bytes other than payload in a CRC mode packet
+#define CrcLen 4              // Bytes of CRC
+
+/*-------------------- E r r o r ( ) -------------------------------------
+	Purpose:	Set parser state to ER and turn the payload into an
+				Error Message Payload (negative length, no data bytes).
+*/
+static CPU_VOID Error(PktBfr *pktBfr, ParserCtx *ctx, ErrorState errState){
+    ctx->state = ER;
+    pktBfr->payloadLen = (0 - errState); //Make the error state negative
+}
+
+/*-------------------- P a r s e r C t x I n i t ( ) -------------------------------------
+	Purpose:	Reset a parser context to wait for the first preamble byte.
+*/
+CPU_VOID ParserCtxInit(ParserCtx *ctx){
+    ctx->state = P1;
+    ctx->checkSum = 0;
+    ctx->i = 0;
+    ctx->crcMode = FALSE;
+    ctx->aggMode = FALSE;
+    ctx->aggLen = ctx->aggPos = 0;
+    Crc32Init();
+}
+
+/*-------------------- C r c B y t e ( ) -------------------------------------
+	Purpose:	Add a CRC mode byte to the context's CRC, a word at a time.
+*/
+static CPU_VOID CrcByte(ParserCtx *ctx, CPU_INT08U nextByte){
+    ctx->crcWord |= (CPU_INT32U)nextByte << (8 * ctx->crcBytes);
+    if (++ctx->crcBytes == 4){
+        ctx->crc = Crc32Word(ctx->crc, ctx->crcWord);
+        ctx->crcWord = 0;
+        ctx->crcBytes = 0;
+    }
+}
+
+/*-------------------- P a r s e M o r e ( ) -------------------------------------
+	Purpose:	Hand out the next payload of the last aggregate frame.
+	Return:		TRUE  - payloadBfr holds the payload
+				FALSE - The frame has no more payloads
+*/
+CPU_BOOLEAN ParseMore(ParserCtx *ctx, CPU_VOID *payloadBfr){
+    PktBfr *pktBfr = (PktBfr *)payloadBfr;
+    CPU_INT08U n;
+
+    if (ctx->aggPos >= ctx->aggLen)
+        return FALSE;
+    n = ctx->agg[ctx->aggPos++];
+    pktBfr->payloadLen = n + PacketHeaderDiff;
+    memcpy(pktBfr->data, &ctx->agg[ctx->aggPos], n);
+    ctx->aggPos += n;
+    return TRUE;
+}
+
+/*-------------------- P a r s e B y t e ( ) -------------------------------------
+	Purpose:	Parse a single byte and progress through the states
+	Return:		TRUE  - A payload (or an error payload) is complete
+				FALSE - The payload is not finished
+*/
+CPU_BOOLEAN ParseByte(ParserCtx *ctx, CPU_VOID *payloadBfr, CPU_INT08U nextByte){
+
+    PktBfr *pktBfr = (PktBfr *)payloadBfr;
+
+    ctx->checkSum ^= nextByte;
+
+    switch(ctx->state){
+        case P1:
+            if (nextByte == P1Char) ctx->state = P2;
+            else{
+                Error(pktBfr, ctx, E1);
+                return TRUE;
+            }
+            break;
+        case P2:
+            if (nextByte == P2Char) ctx->state = P3;
+            else{
+                Error(pktBfr, ctx, E2);
+                return TRUE;
+            }
+            break;
+        case P3:
+            ctx->crcMode = (nextByte == P3CrcChar);
+            ctx->aggMode = (nextByte == P3AggChar);
+            ctx->aggLen = ctx->aggPos = 0;
+            if (nextByte == P3Char || ctx->aggMode) ctx->state = C;
+            else if (ctx->crcMode){
+                ctx->crc = Crc32Seed;
+                ctx->crcWord = 0;
+                ctx->crcBytes = 0;
+                ctx->state = K;
+            }
+            else{
+                Error(pktBfr, ctx, E3);
+                return TRUE;
+            }
+            break;
+        case C:
+            ctx->state = K;
+            break;
+        case K:
+            if (ctx->aggMode){
+                if (nextByte - PacketHeaderDiff < 1 || nextByte - PacketHeaderDiff > AggMaxBody){
+                    Error(pktBfr, ctx, E5);
+                    return TRUE;
+                }
+                ctx->aggLeft = nextByte - PacketHeaderDiff;
+                ctx->state = AN;
+                break;
+            }
+            // Payloads keep the checksum mode length.
+            if (ctx->crcMode){
+                CrcByte(ctx, nextByte);
+                nextByte -= CrcHeaderDiff - PacketHeaderDiff;
+            }
+            // Links carry arbitrary traffic: never overrun the payload buffer.
+            if (nextByte - PacketHeaderDiff < 1 || nextByte > MaxPacketLen){
+                Error(pktBfr, ctx, E5);
+                return TRUE;
+            }
+            pktBfr->payloadLen = nextByte;
+            ctx->state = D;
+            ctx->i = 0;
+            break;
+        case D: //Go through each data part after the header
+            pktBfr->data[ctx->i++] = nextByte;
+            if (ctx->crcMode)
+                CrcByte(ctx, nextByte);
+            if (ctx->i >= pktBfr->payloadLen - PacketHeaderDiff){
+                if (ctx->crcMode){
+                    // The CRC follows; pad the last word with zeros.
+                    if (ctx->crcBytes != 0)
+                        ctx->crc = Crc32Word(ctx->crc, ctx->crcWord);
+                    ctx->state = CR;
+                    ctx->rxCrc = 0;
+                    ctx->i = 0;
+                    break;
+                }
+                ctx->state = P1;
+
+                //Checksum Error if all packets XOR'd != 0
+                if (ctx->checkSum != 0){
+                    Error(pktBfr, ctx, E4);
+                }
+                return TRUE; //Payload is finished
+            }
+            break;
+        case AN: //Aggregate record length
+            if (nextByte < 1 || nextByte >= ctx->aggLeft || nextByte > MaxPacketLen - PacketHeaderDiff){
+                ctx->aggLen = 0;
+                Error(pktBfr, ctx, E5);
+                return TRUE;
+            }
+            ctx->aggLeft -= 1 + nextByte;
+            ctx->recLeft = nextByte;
+            ctx->agg[ctx->aggLen++] = nextByte;
+            ctx->state = AR;
+            break;
+        case AR: //Aggregate record bytes
+            ctx->agg[ctx->aggLen++] = nextByte;
+            if (--ctx->recLeft > 0)
+                break;
+            if (ctx->aggLeft > 0){
+                ctx->state = AN;
+                break;
+            }
+            ctx->state = P1;
+            if (ctx->checkSum != 0){
+                ctx->aggLen = 0;
+                Error(pktBfr, ctx, E4);
+                return TRUE;
+            }
+            return ParseMore(ctx, pktBfr); //First payload of the frame
+        case CR:
+            ctx->rxCrc |= (CPU_INT32U)nextByte << (8 * ctx->i);
+            if (++ctx->i >= CrcLen){
+                ctx->state = P1;
+                if (ctx->rxCrc != ctx->crc)
+                    Error(pktBfr, ctx, E4);
+                return TRUE; //Payload is finished
+            }
+            break;
+        case ER:
+            if (nextByte == P1Char) ctx->state = P2;
+            ctx->checkSum = P1Char;
+            break;
+        }
+    return FALSE; //Payload is not finished
+}
@@ -0,0 +1,65 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktParser.h
+-----------------------------------------------------------------------
+Re-entrant form of the Prog 5 ParseByte() state machine. All parser
+state lives in a ParserCtx so one process can parse many links.
+Both the checksum and the CRC mode packets are accepted, and so are
+aggregate frames: ParseByte() returns their first payload once the
+frame checksum passes and ParseMore() hands out the rest.
+-----------------------------------------------------------------------*/
+
+#ifndef PKTPARSER_H
+#define PKTPARSER_H
+
+#include "CPU.h"
+
+//Number of bytes of header before the payload starts.
+#define PacketHeaderDiff 5
+
+//Largest packet a Payload can hold: header, 3 address/type bytes and a
+//9 character node ID that still leaves room for its terminator.
+#define MaxPacketLen (PacketHeaderDiff + 12)
+
+//Largest aggregate frame body: one station PayloadBfrQ buffer (BfrQSize).
+#define AggMaxBody 80
+
+//The Error State. Needed by both Parser and Payload.
+typedef enum {E1 = 1, E2, E3, E4, E5} ErrorState;
+
+//Set the parser states to a numerical value through enumeration.
+//AN and AR take an aggregate frame's record length and record bytes.
+typedef enum {P1, P2, P3, C, K, D, CR, AN, AR, ER } ParserState;
+
+typedef struct
+{
+    CPU_INT08S payloadLen;	  // Total number of data bytes
+    CPU_INT08U data[1];	          // Remaining data bytes
+} PktBfr;
+
+typedef struct
+{
+    ParserState state;            // Current parser state
+    CPU_INT08U  checkSum;         // Running XOR of the packet bytes
+    CPU_INT08U  i;                // Next data byte index
+    CPU_BOOLEAN crcMode;          // Packet ends with a CRC-32, not a checksum
+    CPU_INT08U  crcBytes;         // Bytes in crcWord
+    CPU_INT32U  crcWord;          // Bytes not yet added to crc
+    CPU_INT32U  crc;              // CRC so far
+    CPU_INT32U  rxCrc;            // CRC received
+    CPU_BOOLEAN aggMode;          // Aggregate frame
+    CPU_INT08U  aggLeft;          // Frame bytes after the current record
+    CPU_INT08U  recLeft;          // Record bytes still to come
+    CPU_INT08U  aggLen;           // Bytes in agg
+    CPU_INT08U  aggPos;           // Next record in agg for ParseMore()
+    CPU_INT08U  agg[AggMaxBody];  // Records of the aggregate frame, length first
+} ParserCtx;
+
+CPU_VOID ParserCtxInit(ParserCtx *ctx);
+CPU_BOOLEAN ParseByte(ParserCtx *ctx, CPU_VOID *payloadBfr, CPU_INT08U nextByte);
+CPU_BOOLEAN ParseMore(ParserCtx *ctx, CPU_VOID *payloadBfr);
+
+#endif
@@ -0,0 +1,413 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktReplay.c
+-----------------------------------------------------------------------
+Replay a packet capture into a pseudo-terminal at a simulated line rate
+so a host build of the station pipeline can be soak tested through a
+real tty. The program under test opens the slave side printed on stderr.
+
+Each byte is released on the 8N1 line clock (10 bit times per byte).
+Bytes the slave side has no room for are dropped, the same as a USART
+overrun. Replies written back by the pipeline are read from the master
+side and drained through a model of a reply link at the same baud rate.
+
+Capture formats
+  raw   - the .DAT files used since Prog 1. Packets are split at each
+          preamble and sent back to back unless -g gives a gap.
+  timed - (-t) records of { CPU_INT32U gapUs; CPU_INT16U len; bytes[len] }
+          in little endian. gapUs is the idle time before the record.
+          Gaps are divided by the -x speed factor.
+
+Build:  gcc -O2 -o pktReplay pktReplay.c
+Usage:  pktReplay [-b baud] [-x speed] [-g gapUs] [-q quantumUs]
+                  [-r repeat] [-l lingerMs] [-t] [-e] file
+-----------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "CPU.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define BitsPerByte 10          // 8N1: start + 8 data + stop
+#define NsPerSec 1000000000LL
+#define DefaultBaud 9600
+#define DefaultQuantumUs 100    // Longest sleep between line clock checks
+#define DefaultLingerMs 500     // Time to collect replies after the last byte
+#define SlaveWaitMs 30000       // Time to wait for the pipeline to open the slave
+#define SlaveSettleMs 200       // Time for the pipeline to configure the slave
+#define ReplyBfrSize 4096
+
+//Preamble bytes as defined in guidelines.
+#define P1Char 0x03
+#define P2Char 0xAF
+#define P3Char 0xEF
+
+typedef struct
+{
+	CPU_INT32U gapUs;           // Idle line time before the chunk
+	CPU_INT32U offset;          // Offset of the chunk in the capture
+	CPU_INT32U len;             // Number of bytes in the chunk
+} Chunk;
+
+typedef struct
+{
+	CPU_INT64U sent;            // Bytes accepted by the slave side
+	CPU_INT64U dropped;         // Bytes the slave side had no room for
+	CPU_INT64U chunks;          // Packets (chunks) put on the line
+	CPU_INT64U replyBytes;      // Bytes read back from the pipeline
+	CPU_INT64S replyBacklog;    // Reply bytes waiting on the modeled reply link
+	CPU_INT64S replyBacklogMax; // Worst reply backlog seen
+	CPU_INT64U lateNs;          // Worst lateness of a write against the line clock
+} ReplayStats;
+
+/*-------------------- N o w N s ( ) -------------------------------------
+	Purpose:	Return the monotonic clock in nanoseconds.
+*/
+static CPU_INT64S NowNs(CPU_VOID){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CPU_INT64S)ts.tv_sec * NsPerSec + ts.tv_nsec;
+}
+
+/*-------------------- S l e e p U n t i l ( ) -------------------------------------
+	Purpose:	Sleep until an absolute monotonic time.
+*/
+static CPU_VOID SleepUntil(CPU_INT64S ns){
+	struct timespec ts;
+
+	ts.tv_sec = ns / NsPerSec;
+	ts.tv_nsec = ns % NsPerSec;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+/*-------------------- B a u d C o n s t ( ) -------------------------------------
+	Purpose:	Map a numeric baud rate onto a termios speed constant.
+	Return:		The speed constant, or B0 if the rate has none.
+*/
+static speed_t BaudConst(CPU_INT32U baud){
+	switch (baud){
+	case 9600:   return B9600;
+	case 19200:  return B19200;
+	case 38400:  return B38400;
+	case 57600:  return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	case 460800: return B460800;
+	case 921600: return B921600;
+	default:     return B0;
+	}
+}
+
+/*-------------------- L o a d C a p t u r e ( ) -------------------------------------
+	Purpose:	Read a whole capture file into memory.
+	Return:		The capture bytes, or NULL if the file could not be read.
+*/
+static CPU_INT08U *LoadCapture(const CPU_CHAR *name, CPU_INT32U *size){
+	FILE *f = fopen(name, "rb");
+	CPU_INT08U *bytes;
+	long len;
+
+	if (f == NULL) return NULL;
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	bytes = malloc(len > 0 ? len : 1);
+	if (bytes != NULL && fread(bytes, 1, len, f) != (size_t)len){
+		free(bytes);
+		bytes = NULL;
+	}
+	fclose(f);
+	*size = (CPU_INT32U)len;
+	return bytes;
+}
+
+/*-------------------- S p l i t R a w ( ) -------------------------------------
+	Purpose:	Split a raw capture into chunks that each start at a preamble.
+				Bytes ahead of the first preamble form a chunk of their own so
+				damaged captures are replayed byte for byte.
+	Return:		Number of chunks.
+*/
+static CPU_INT32U SplitRaw(const CPU_INT08U *cap, CPU_INT32U size, CPU_INT32U gapUs, Chunk *chunks){
+	CPU_INT32U n = 0;
+	CPU_INT32U start = 0;
+	CPU_INT32U i;
+
+	for (i = 1; i + 2 < size; i++){
+		if (cap[i] == P1Char && cap[i+1] == P2Char && cap[i+2] == P3Char){
+			chunks[n].gapUs = gapUs;
+			chunks[n].offset = start;
+			chunks[n++].len = i - start;
+			start = i;
+		}
+	}
+	if (start < size){
+		chunks[n].gapUs = gapUs;
+		chunks[n].offset = start;
+		chunks[n++].len = size - start;
+	}
+	return n;
+}
+
+/*-------------------- S p l i t T i m e d ( ) -------------------------------------
+	Purpose:	Split a timed capture into its records.
+	Return:		Number of chunks, or -1 if a record runs past the end of the file.
+*/
+static CPU_INT32S SplitTimed(const CPU_INT08U *cap, CPU_INT32U size, Chunk *chunks){
+	#define TimedHdrSize 6
+	CPU_INT32U n = 0;
+	CPU_INT32U pos = 0;
+
+	while (pos + TimedHdrSize <= size){
+		chunks[n].gapUs = cap[pos] | (cap[pos+1] << 8) | (cap[pos+2] << 16) | ((CPU_INT32U)cap[pos+3] << 24);
+		chunks[n].len = cap[pos+4] | (cap[pos+5] << 8);
+		chunks[n].offset = pos + TimedHdrSize;
+		pos += TimedHdrSize + chunks[n].len;
+		if (pos > size) return -1;
+		n++;
+	}
+	return pos == size ? (CPU_INT32S)n : -1;
+}
+
+/*-------------------- O p e n P t y ( ) -------------------------------------
+	Purpose:	Open a raw, non-blocking pty master at the requested baud rate.
+	Return:		The master fd, or -1 on failure.
+*/
+static int OpenPty(CPU_INT32U baud){
+	struct termios tio;
+	int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if (fd < 0) return -1;
+	if (grantpt(fd) < 0 || unlockpt(fd) < 0){
+		close(fd);
+		return -1;
+	}
+	// The master and slave share one termios: make the line raw 8N1.
+	if (tcgetattr(fd, &tio) == 0){
+		cfmakeraw(&tio);
+		tio.c_cflag &= ~(CSTOPB | PARENB);
+		tio.c_cflag |= CS8 | CLOCAL | CREAD;
+		if (BaudConst(baud) != B0) cfsetspeed(&tio, BaudConst(baud));
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+/*-------------------- W a i t S l a v e ( ) -------------------------------------
+	Purpose:	Wait for the pipeline to open the slave side. The master reports
+				POLLHUP for as long as no process holds the slave open.
+	Return:		TRUE once the slave is open, FALSE on timeout.
+*/
+static CPU_BOOLEAN WaitSlave(int master){
+	CPU_INT32U waited;
+	struct pollfd pfd;
+
+	for (waited = 0; waited < SlaveWaitMs; waited += 10){
+		pfd.fd = master;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		poll(&pfd, 1, 0);
+		if (!(pfd.revents & POLLHUP)){
+			// Give the reader time to set raw mode; TCSAFLUSH discards input.
+			usleep(SlaveSettleMs * 1000);
+			return TRUE;
+		}
+		usleep(10000);
+	}
+	return FALSE;
+}
+
+/*-------------------- D r a i n R e p l i e s ( ) -------------------------------------
+	Purpose:	Read whatever the pipeline has written back and run the reply
+				link model: the reply UART drains one byte per line byte time.
+*/
+static CPU_VOID DrainReplies(int master, ReplayStats *stats, CPU_INT64S *drainNs,
+                             CPU_INT64S now, CPU_INT64S byteNs, CPU_BOOLEAN echo){
+	CPU_INT08U bfr[ReplyBfrSize];
+	CPU_INT64S drained;
+	ssize_t got;
+
+	while ((got = read(master, bfr, sizeof(bfr))) > 0){
+		stats->replyBytes += got;
+		stats->replyBacklog += got;
+		if (echo) fwrite(bfr, 1, got, stdout);
+	}
+
+	drained = (now - *drainNs) / byteNs;
+	*drainNs += drained * byteNs;
+	stats->replyBacklog = stats->replyBacklog > drained ? stats->replyBacklog - drained : 0;
+	if (stats->replyBacklog == 0) *drainNs = now;
+	if (stats->replyBacklog > stats->replyBacklogMax)
+		stats->replyBacklogMax = stats->replyBacklog;
+}
+
+/*-------------------- R e p l a y ( ) -------------------------------------
+	Purpose:	Put every chunk on the line. The line clock advances by one byte
+				time per byte and by the (scaled) gap before each chunk; each
+				wake-up writes all bytes whose start time has passed.
+*/
+static CPU_VOID Replay(int master, const CPU_INT08U *cap, const Chunk *chunks, CPU_INT32U numChunks,
+                       CPU_INT32U repeat, CPU_INT64S byteNs, double speed, CPU_INT64S quantumNs,
+                       CPU_BOOLEAN echo, ReplayStats *stats, CPU_INT64S *startNs, CPU_INT64S *endNs){
+	CPU_INT64S lineNs = NowNs();
+	CPU_INT64S drainNs = lineNs;
+	CPU_INT32U r, c;
+
+	*startNs = lineNs;
+	for (r = 0; r < repeat; r++){
+		for (c = 0; c < numChunks; c++){
+			const CPU_INT08U *next = cap + chunks[c].offset;
+			CPU_INT32U left = chunks[c].len;
+
+			lineNs += (CPU_INT64S)(chunks[c].gapUs * 1000.0 / speed);
+			stats->chunks++;
+
+			while (left > 0){
+				CPU_INT64S now = NowNs();
+				CPU_INT64S due;
+				ssize_t put;
+
+				if (now < lineNs){
+					SleepUntil(lineNs);
+					now = NowNs();
+				}
+				if ((CPU_INT64U)(now - lineNs) > stats->lateNs)
+					stats->lateNs = now - lineNs;
+
+				// Every byte whose start bit time has passed is due now.
+				due = (now - lineNs) / byteNs + 1;
+				if (due > left) due = left;
+
+				put = write(master, next, due);
+				if (put < 0) put = 0;
+				stats->sent += put;
+				stats->dropped += due - put;  // No room in the slave: overrun
+
+				next += due;
+				left -= due;
+				lineNs += due * byteNs;
+
+				DrainReplies(master, stats, &drainNs, now, byteNs, echo);
+
+				// Batch the next bytes unless the line clock is further out.
+				if (left > 0 && lineNs - now < quantumNs)
+					SleepUntil(now + quantumNs);
+			}
+		}
+	}
+	// Let the last byte leave the line before the clock stops.
+	SleepUntil(lineNs);
+	*endNs = NowNs();
+	DrainReplies(master, stats, &drainNs, *endNs, byteNs, echo);
+}
+
+/*-------------------- R e p o r t ( ) -------------------------------------
+	Purpose:	Print the achieved and requested rates and the loss counters.
+*/
+static CPU_VOID Report(const ReplayStats *stats, CPU_INT32U baud, CPU_INT64S elapsedNs){
+	double secs = elapsedNs / (double)NsPerSec;
+	double lineBytes = stats->sent + stats->dropped;
+
+	fprintf(stderr, "\n----- replay report -----\n");
+	fprintf(stderr, "requested rate   %u baud (%.0f bytes/s)\n", baud, baud / (double)BitsPerByte);
+	fprintf(stderr, "achieved rate    %.0f baud (%.0f bytes/s) over %.3f s\n",
+	        lineBytes * BitsPerByte / secs, lineBytes / secs, secs);
+	fprintf(stderr, "packets          %llu\n", stats->chunks);
+	fprintf(stderr, "bytes accepted   %llu\n", stats->sent);
+	fprintf(stderr, "bytes dropped    %llu (%.3f%%)\n", stats->dropped,
+	        lineBytes > 0 ? 100.0 * stats->dropped / lineBytes : 0.0);
+	fprintf(stderr, "worst lateness   %.1f us\n", stats->lateNs / 1000.0);
+	fprintf(stderr, "reply bytes      %llu (%.0f bytes/s)\n", stats->replyBytes, stats->replyBytes / secs);
+	fprintf(stderr, "reply backlog    %lld now, %lld peak\n", stats->replyBacklog, stats->replyBacklogMax);
+}
+
+/*-------------------- M a i n ( ) ----------------------------*/
+int main(int argc, char *argv[]){
+	CPU_INT32U baud = DefaultBaud;
+	CPU_INT32U gapUs = 0;
+	CPU_INT32U repeat = 1;
+	CPU_INT32U lingerMs = DefaultLingerMs;
+	CPU_INT64S quantumNs = DefaultQuantumUs * 1000LL;
+	double speed = 1.0;
+	CPU_BOOLEAN timed = FALSE;
+	CPU_BOOLEAN echo = FALSE;
+	CPU_INT08U *cap;
+	CPU_INT32U size;
+	CPU_INT32S numChunks;
+	CPU_INT64S byteNs, startNs, endNs, drainNs;
+	Chunk *chunks;
+	ReplayStats stats;
+	int opt, master;
+
+	while ((opt = getopt(argc, argv, "b:x:g:q:r:l:te")) != -1){
+		switch (opt){
+		case 'b': baud = strtoul(optarg, NULL, 0); break;
+		case 'x': speed = strtod(optarg, NULL); break;
+		case 'g': gapUs = strtoul(optarg, NULL, 0); break;
+		case 'q': quantumNs = strtoll(optarg, NULL, 0) * 1000LL; break;
+		case 'r': repeat = strtoul(optarg, NULL, 0); break;
+		case 'l': lingerMs = strtoul(optarg, NULL, 0); break;
+		case 't': timed = TRUE; break;
+		case 'e': echo = TRUE; break;
+		default:
+			fprintf(stderr, "usage: %s [-b baud] [-x speed] [-g gapUs] [-q quantumUs] "
+			                "[-r repeat] [-l lingerMs] [-t] [-e] file\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc || baud == 0 || speed <= 0.0){
+		fprintf(stderr, "*** ERROR: need a capture file, a baud rate and a positive speed\n");
+		return 2;
+	}
+
+	if ((cap = LoadCapture(argv[optind], &size)) == NULL){
+		fprintf(stderr, "*** ERROR: File not found.\n");
+		return 1;
+	}
+	chunks = malloc((size + 1) * sizeof(Chunk));
+	numChunks = timed ? SplitTimed(cap, size, chunks) : (CPU_INT32S)SplitRaw(cap, size, gapUs, chunks);
+	if (numChunks < 0){
+		fprintf(stderr, "*** ERROR: Truncated timed capture record\n");
+		return 1;
+	}
+
+	if ((master = OpenPty(baud)) < 0){
+		perror("posix_openpt");
+		return 1;
+	}
+	fprintf(stderr, "slave %s  baud %u  packets %d  bytes %u\n", ptsname(master), baud, numChunks, size);
+	if (BaudConst(baud) == B0)
+		fprintf(stderr, "note: %u is not a termios rate; timing is still simulated\n", baud);
+	if (!WaitSlave(master)){
+		fprintf(stderr, "*** ERROR: Nobody opened the slave side\n");
+		return 1;
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	byteNs = NsPerSec * BitsPerByte / baud;
+	Replay(master, cap, chunks, numChunks, repeat, byteNs, speed, quantumNs, echo, &stats, &startNs, &endNs);
+
+	// Keep collecting replies while the pipeline catches up.
+	drainNs = endNs;
+	while (lingerMs-- > 0){
+		usleep(1000);
+		DrainReplies(master, &stats, &drainNs, NowNs(), byteNs, echo);
+	}
+
+	Report(&stats, baud, endNs - startNs);
+	close(master);
+	free(chunks);
+	free(cap);
+	return stats.dropped ? 3 : 0;
+}
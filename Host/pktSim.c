@@ -0,0 +1,594 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			              pktSim.c
+-----------------------------------------------------------------------
+Capacity planner for the Prog 5 station: a discrete event simulation
+of one station in virtual time, to answer how many nodes reporting how
+often one station can take at a given baud rate.
+
+Modelled:
+  - the nodes, each reporting every -i ms give or take -j percent, into
+    a radio gateway that queues -g packets for the serial link
+  - the link, one byte every 10 bit times each way
+  - the USART2 interrupt, which costs CPU for every byte in and out,
+    and its -f byte input and output buffers (SerIODriver.h BfrSize);
+    a byte arriving at a full input buffer is lost, and its packet
+  - the parser (priority 3), payload (4) and reply (5) tasks, run by
+    priority with preemption on one CPU, each byte or payload costing
+    the -c time for its stage
+  - the payload and reply buffer queues drawing -q blocks of -s bytes
+    from one pool, through the station's own BfrPool with Payload.c's
+    minimums and caps. A reply longer than a block takes several.
+
+Usage:  pktSim [-b baud,...] [-n from:to:step] [-q bfrs,...] [-s size,...]
+               [-f size,...] [-i ms] [-j pct] [-p bytes] [-r bytes] [-g pkts]
+               [-t secs] [-c stage=us,...] [-v]
+
+Each combination of the listed -b, -q, -s and -f values gets a table
+with a row for each node count: offered and handled payloads a second,
+packets lost at the gateway (the link is full) and to input overruns
+(the station is too slow), CPU and link use, and the mean and 99th
+percentile of filled buffers waiting in each queue. -v adds the whole
+queue depth distribution. The last line of a table gives the first
+node count losing over 1 percent.
+
+The stages are isr (per byte each way), parse (per byte, the wake
+from GetByte() included), payload (per payload, the reply formatted)
+and reply (per byte, PutByte() included). The defaults are round
+figures for the 72 MHz station; take better ones from the console's
+'H' group (payload cycles) and task CPU usage, and from pktBench crc
+(parser time per byte).
+
+Build:  gcc -O2 -include HostOS.h -I. -I../Prog5/App -o pktSim pktSim.c pktGen.c
+            ../Prog5/App/BfrPool.c ../Prog5/App/Crc32.c
+-----------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "CPU.h"
+#include "pktGen.h"
+#include "BfrPool.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define NsPerSec 1000000000ULL
+#define NsPerUs 1000
+#define BitsPerByte 10            // Start, 8 data and stop bits
+#define MaxNodes 100000
+#define MaxList 8                 // Values a list option can give
+#define MaxSerBfr 64              // Largest serial buffer tried
+#define MaxBlockSize 255          // BfrPool block sizes are a byte
+#define MaxSimSecs 3600           // BfrPool times are microseconds in 32 bits
+#define LossKnee 1.0              // Percent lost that counts as saturated
+#define PayloadClient 0           // The pool's clients, in BfrQInit() order
+#define ReplyClient 1
+#define PayloadMinBfrs 2          // Payload.c's shares of the pool
+#define ReplyMinBfrs 1
+
+typedef enum {RunIsr, RunParser, RunPayload, RunReply, RunIdle, NumRuns} RunLevel;
+
+typedef struct
+{
+	CPU_INT64U isr;           // Interrupt, per byte in or out
+	CPU_INT64U parse;         // Parser, per byte
+	CPU_INT64U payload;       // Payload task, per payload
+	CPU_INT64U reply;         // Reply task, per byte
+} StageCosts;
+
+typedef struct
+{
+	CPU_INT32U baud;
+	CPU_INT32U nodes;
+	CPU_INT32U intervalMs;    // Each node's report interval
+	CPU_INT32U jitterPct;     // ... give or take this percent
+	CPU_INT32U pktLen;        // Bytes in a packet
+	CPU_INT32U replyLen;      // Bytes in the reply to a payload
+	CPU_INT32U gatewayQ;      // Packets the gateway holds for the link
+	CPU_INT32U numBfrs;       // Pool blocks (BfrQ.h NumBfrs)
+	CPU_INT32U bfrQSize;      // Block size (BfrQ.h BfrQSize)
+	CPU_INT32U bfrSize;       // Serial buffers (SerIODriver.h BfrSize)
+	CPU_INT32U secs;
+	StageCosts cost;          // Nanoseconds
+} SimCfg;
+
+typedef struct
+{
+	CPU_INT64U offered;       // Packets sent by the nodes
+	CPU_INT64U handled;       // Payloads through the payload task
+	CPU_INT64U gatewayDrops;  // Packets the gateway had no room for
+	CPU_INT64U overruns;      // Packets with a byte lost to a full input buffer
+	CPU_INT64U events;
+	CPU_INT64U runTime[NumRuns];          // CPU time at each level
+	CPU_INT64U rxTime, txTime;            // Link time busy each way
+	CPU_INT64U payDepth[PoolMaxBlocks + 1];   // Time with n filled payload buffers waiting
+	CPU_INT64U repDepth[PoolMaxBlocks + 1];   // ... reply buffers
+	PoolStats payPool, repPool;
+} SimRun;
+
+typedef struct
+{
+	CPU_INT64U time;
+	CPU_INT32U node;
+} NodeEvent;
+
+typedef struct
+{
+	CPU_INT08U *blocks[PoolMaxBlocks];
+	CPU_INT08U bytes[PoolMaxBlocks];      // Reply bytes in each block
+	CPU_INT08U in, out, n;
+} SimQ;
+
+//----- g l o b a l    v a r i a b l e s -----
+static NodeEvent heap[MaxNodes];          // Each node's next report, soonest first
+static CPU_INT32U heapN;
+static CPU_BOOLEAN verbose;
+
+/*-------------------- H e a p P u s h ( ) -------------------------------------
+	Purpose:	Add a node's next report to the heap.
+*/
+static CPU_VOID HeapPush(CPU_INT64U time, CPU_INT32U node){
+	CPU_INT32U i = heapN++;
+
+	while (i > 0 && heap[(i - 1) / 2].time > time){
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap[i].time = time;
+	heap[i].node = node;
+}
+
+/*-------------------- H e a p R e p l a c e T o p ( ) -------------------------------------
+	Purpose:	Move the soonest report to a new time and restore the heap.
+*/
+static CPU_VOID HeapReplaceTop(CPU_INT64U time){
+	NodeEvent e = heap[0];
+	CPU_INT32U i = 0, c;
+
+	e.time = time;
+	for (;;){
+		c = 2 * i + 1;
+		if (c >= heapN)
+			break;
+		if (c + 1 < heapN && heap[c + 1].time < heap[c].time)
+			c++;
+		if (heap[c].time >= time)
+			break;
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i] = e;
+}
+
+/*-------------------- S i m Q P u t ( ) -------------------------------------
+	Purpose:	Queue a filled block.
+*/
+static CPU_VOID SimQPut(SimQ *q, CPU_INT08U *block, CPU_INT08U bytes){
+	q->blocks[q->in] = block;
+	q->bytes[q->in] = bytes;
+	q->in = (CPU_INT08U)((q->in + 1) % PoolMaxBlocks);
+	q->n++;
+}
+
+/*-------------------- S i m Q G e t ( ) -------------------------------------
+	Purpose:	Take the oldest filled block.
+*/
+static CPU_INT08U *SimQGet(SimQ *q, CPU_INT08U *bytes){
+	CPU_INT08U *block = q->blocks[q->out];
+
+	*bytes = q->bytes[q->out];
+	q->out = (CPU_INT08U)((q->out + 1) % PoolMaxBlocks);
+	q->n--;
+	return block;
+}
+
+/*-------------------- N e x t R e p o r t ( ) -------------------------------------
+	Purpose:	A node's report interval, jittered.
+*/
+static CPU_INT64U NextReport(const SimCfg *cfg, PktGen *gen){
+	CPU_INT64U interval = (CPU_INT64U)cfg->intervalMs * 1000000;
+	CPU_INT64U spread = interval * cfg->jitterPct / 100;
+
+	if (spread == 0)
+		return interval;
+	return interval - spread + (CPU_INT64U)PktGenRand(gen) * (2 * spread) / 0xFFFFFFFFu;
+}
+
+/*-------------------- S i m u l a t e ( ) -------------------------------------
+	Purpose:	Run one station for cfg->secs of virtual time.
+
+	The CPU runs the highest level with work left: interrupt, parser,
+	payload, reply. Each loop either finishes that piece of work, if it
+	ends before the next link or node event, or runs it up to that
+	event and handles the event. After either, Dispatch gives each task
+	its next piece of work if it is not waiting for something.
+*/
+static CPU_VOID Simulate(const SimCfg *cfg, SimRun *run){
+	static CPU_INT08U space[PoolMaxBlocks * MaxBlockSize];
+	const CPU_INT64U byteNs = (CPU_INT64U)BitsPerByte * NsPerSec / cfg->baud;
+	const CPU_INT64U end = (CPU_INT64U)cfg->secs * NsPerSec;
+	const CPU_INT64U never = ~0ULL;
+	CPU_INT64U now = 0, next, dt;
+	CPU_INT64U work[RunIdle];                 // Work left at each level
+	CPU_INT64U rxNext = never, txDone = never;
+	CPU_INT08U iBfr[MaxSerBfr], iIn = 0, iOut = 0, iN = 0;    // 0 middle, 1 packet end, 2 damaged end
+	CPU_INT32U oN = 0;                        // Bytes in the output buffer
+	CPU_INT32U gwN = 0, rxLeft = 0;
+	CPU_BOOLEAN rxDamaged = FALSE;
+	CPU_INT08U *parserBlk = NULL, *payBlk = NULL, *repBlk = NULL;
+	CPU_INT08U parserMark = 0;
+	CPU_INT32U payState = 0;                  // 0 idle, 1 working, 2 waiting for reply blocks
+	CPU_INT32U replyLeft = 0, repBytesLeft = 0;
+	CPU_BOOLEAN repBusy = FALSE;
+	CPU_BOOLEAN changed;
+	SimQ payQ, repQ;
+	BfrPool pool;
+	PktGen gen;
+	RunLevel level;
+	CPU_INT32U i;
+
+	memset(run, 0, sizeof(*run));
+	memset(work, 0, sizeof(work));
+	memset(&payQ, 0, sizeof(payQ));
+	memset(&repQ, 0, sizeof(repQ));
+	PktGenInit(&gen, 53);
+	BfrPoolInit(&pool, space, (CPU_INT08U)cfg->numBfrs, (CPU_INT08U)cfg->bfrQSize);
+	BfrPoolAddClient(&pool, PayloadMinBfrs, (CPU_INT08U)(cfg->numBfrs - ReplyMinBfrs), &payQ);
+	BfrPoolAddClient(&pool, ReplyMinBfrs, (CPU_INT08U)(cfg->numBfrs - PayloadMinBfrs), &repQ);
+
+	//Nodes start at random points in their first interval
+	heapN = 0;
+	for (i = 0; i < cfg->nodes; i++)
+		HeapPush((CPU_INT64U)PktGenRand(&gen) * cfg->intervalMs * 1000000 / 0xFFFFFFFFu, i);
+
+	while (now < end){
+		//---- Dispatch: start whatever each task and the transmitter can start
+		do{
+			changed = FALSE;
+			//Parser: hold a write buffer, then take bytes one at a time
+			if (work[RunParser] == 0){
+				if (parserBlk == NULL)
+					parserBlk = BfrPoolTake(&pool, PayloadClient, (CPU_INT32U)(now / NsPerUs));
+				if (parserBlk != NULL && iN > 0){
+					parserMark = iBfr[iOut];
+					iOut = (CPU_INT08U)((iOut + 1) % cfg->bfrSize);
+					iN--;
+					work[RunParser] = cfg->cost.parse;
+				}
+			}
+			//Payload: take a buffer, handle it, then get the reply blocks
+			if (payState == 0 && payQ.n > 0){
+				CPU_INT08U bytes;
+
+				payBlk = SimQGet(&payQ, &bytes);
+				work[RunPayload] = cfg->cost.payload;
+				payState = 1;
+			}
+			while (payState == 2 && replyLeft > 0){
+				CPU_INT08U *b = BfrPoolTake(&pool, ReplyClient, (CPU_INT32U)(now / NsPerUs));
+				CPU_INT32U bytes = replyLeft < cfg->bfrQSize ? replyLeft : cfg->bfrQSize;
+
+				if (b == NULL)
+					break;
+				SimQPut(&repQ, b, (CPU_INT08U)bytes);
+				replyLeft -= bytes;
+			}
+			if (payState == 2 && replyLeft == 0){
+				BfrPoolGive(&pool, PayloadClient, payBlk, (CPU_INT32U)(now / NsPerUs));
+				payBlk = NULL;
+				payState = 0;
+				run->handled++;
+				changed = TRUE;
+			}
+			//Reply: put a block's bytes out, a byte at a time
+			if (!repBusy && repQ.n > 0){
+				CPU_INT08U bytes;
+
+				repBlk = SimQGet(&repQ, &bytes);
+				repBytesLeft = bytes;
+				repBusy = TRUE;
+			}
+			if (repBusy && work[RunReply] == 0){
+				if (repBytesLeft == 0){
+					BfrPoolGive(&pool, ReplyClient, repBlk, (CPU_INT32U)(now / NsPerUs));
+					repBlk = NULL;
+					repBusy = FALSE;
+					changed = TRUE;
+				}else if (oN < cfg->bfrSize)
+					work[RunReply] = cfg->cost.reply;
+			}
+			//Transmitter: the interrupt loads the next byte when it is free
+			if (txDone == never && oN > 0){
+				oN--;
+				work[RunIsr] += cfg->cost.isr;
+				txDone = now + byteNs;
+				changed = TRUE;
+			}
+		}while (changed);
+
+		//---- The next link or node event
+		next = end;
+		if (heapN > 0 && heap[0].time < next) next = heap[0].time;
+		if (rxNext < next) next = rxNext;
+		if (txDone < next) next = txDone;
+
+		//---- Run the highest level with work, up to its end or the event
+		for (level = RunIsr; level < RunIdle && work[level] == 0; level++)
+			;
+		dt = next - now;
+		if (level < RunIdle && work[level] <= dt)
+			dt = work[level];
+		run->runTime[level] += dt;
+		run->payDepth[payQ.n] += dt;
+		run->repDepth[repQ.n] += dt;
+		if (rxLeft > 0) run->rxTime += dt;
+		if (txDone != never) run->txTime += dt;
+		now += dt;
+		run->events++;
+
+		if (level < RunIdle && (work[level] -= dt) == 0){
+			//A piece of work finished
+			if (level == RunParser){
+				if (parserMark == 1){
+					SimQPut(&payQ, parserBlk, 0);
+					parserBlk = NULL;
+				}else if (parserMark == 2)
+					run->overruns++;
+			}else if (level == RunPayload){
+				payState = 2;
+				replyLeft = cfg->replyLen;
+			}else if (level == RunReply){
+				oN++;
+				repBytesLeft--;
+			}
+			continue;
+		}
+		if (now < next)
+			continue;
+
+		//An event is due
+		if (now == txDone)
+			txDone = never;
+		if (now == rxNext){
+			rxLeft--;
+			work[RunIsr] += cfg->cost.isr;
+			if (iN == cfg->bfrSize){
+				rxDamaged = TRUE;
+				if (rxLeft == 0)
+					run->overruns++;
+			}else{
+				iBfr[iIn] = (CPU_INT08U)(rxLeft > 0 ? 0 : rxDamaged ? 2 : 1);
+				iIn = (CPU_INT08U)((iIn + 1) % cfg->bfrSize);
+				iN++;
+			}
+			rxNext = rxLeft > 0 ? now + byteNs : never;
+		}
+		if (heapN > 0 && now == heap[0].time){
+			run->offered++;
+			if (gwN < cfg->gatewayQ)
+				gwN++;
+			else
+				run->gatewayDrops++;
+			HeapReplaceTop(now + NextReport(cfg, &gen));
+		}
+		//The gateway sends packets back to back
+		if (rxLeft == 0 && gwN > 0){
+			gwN--;
+			rxLeft = cfg->pktLen;
+			rxDamaged = FALSE;
+			rxNext = now + byteNs;
+		}
+	}
+	BfrPoolGetStats(&pool, PayloadClient, &run->payPool, (CPU_INT32U)(now / NsPerUs));
+	BfrPoolGetStats(&pool, ReplyClient, &run->repPool, (CPU_INT32U)(now / NsPerUs));
+}
+
+/*-------------------- D e p t h M e a n ( ) -------------------------------------
+	Purpose:	Time weighted mean of a queue depth distribution.
+*/
+static double DepthMean(const CPU_INT64U *depth, CPU_INT64U total){
+	double sum = 0;
+	CPU_INT32U i;
+
+	for (i = 0; i <= PoolMaxBlocks; i++)
+		sum += (double)i * depth[i];
+	return sum / total;
+}
+
+/*-------------------- D e p t h P 9 9 ( ) -------------------------------------
+	Purpose:	The depth a queue stayed at or under 99 percent of the time.
+*/
+static CPU_INT32U DepthP99(const CPU_INT64U *depth, CPU_INT64U total){
+	CPU_INT64U sum = 0;
+	CPU_INT32U i;
+
+	for (i = 0; i < PoolMaxBlocks; i++){
+		sum += depth[i];
+		if (sum * 100 >= total * 99)
+			break;
+	}
+	return i;
+}
+
+/*-------------------- P r i n t D e p t h s ( ) -------------------------------------
+	Purpose:	A queue's whole depth distribution, in percent of the time.
+*/
+static CPU_VOID PrintDepths(const CPU_CHAR *name, const CPU_INT64U *depth, CPU_INT64U total, CPU_INT32U bfrs){
+	CPU_INT32U i;
+
+	printf("         %s waiting:", name);
+	for (i = 0; i < bfrs; i++)
+		printf(" %u:%.1f%%", i, 100.0 * depth[i] / total);
+	printf("\n");
+}
+
+/*-------------------- P r i n t R u n ( ) -------------------------------------
+	Purpose:	One row of a table.
+	Return:		Percent of the offered packets lost.
+*/
+static double PrintRun(const SimCfg *cfg, const SimRun *run){
+	CPU_INT64U total = (CPU_INT64U)cfg->secs * NsPerSec;
+	double lost = run->offered ? 100.0 * (run->gatewayDrops + run->overruns) / run->offered : 0;
+	double busy = 100.0 * (total - run->runTime[RunIdle]) / total;
+
+	printf("  %6u %9.1f %9.1f %6.2f %6.2f %6.2f %6.1f %5.1f %5.1f %6.2f %3u %6.2f %3u\n",
+	       cfg->nodes, (double)run->offered / cfg->secs, (double)run->handled / cfg->secs, lost,
+	       run->offered ? 100.0 * run->gatewayDrops / run->offered : 0,
+	       run->offered ? 100.0 * run->overruns / run->offered : 0, busy,
+	       100.0 * run->rxTime / total, 100.0 * run->txTime / total,
+	       DepthMean(run->payDepth, total), DepthP99(run->payDepth, total),
+	       DepthMean(run->repDepth, total), DepthP99(run->repDepth, total));
+	if (verbose){
+		PrintDepths("payload", run->payDepth, total, cfg->numBfrs);
+		PrintDepths("reply  ", run->repDepth, total, cfg->numBfrs);
+		printf("         cpu: isr %.1f%% parser %.1f%% payload %.1f%% reply %.1f%%; stalls: parser %u payload %u\n",
+		       100.0 * run->runTime[RunIsr] / total, 100.0 * run->runTime[RunParser] / total,
+		       100.0 * run->runTime[RunPayload] / total, 100.0 * run->runTime[RunReply] / total,
+		       run->payPool.stalls, run->repPool.stalls);
+	}
+	return lost;
+}
+
+/*-------------------- P a r s e L i s t ( ) -------------------------------------
+	Purpose:	Read a comma separated list of numbers.
+	Return:		How many, 0 if the list is bad.
+*/
+static CPU_INT32U ParseList(const CPU_CHAR *arg, CPU_INT32U *list){
+	CPU_INT32U n = 0;
+	CPU_CHAR *end;
+
+	for (;;){
+		if (n == MaxList)
+			return 0;
+		list[n++] = strtoul(arg, &end, 0);
+		if (end == arg)
+			return 0;
+		if (*end == '\0')
+			return n;
+		if (*end != ',')
+			return 0;
+		arg = end + 1;
+	}
+}
+
+/*-------------------- P a r s e C o s t s ( ) -------------------------------------
+	Purpose:	Read -c stage=us,... into the stage costs.
+	Return:		FALSE if a stage is unknown.
+*/
+static CPU_BOOLEAN ParseCosts(CPU_CHAR *arg, StageCosts *cost){
+	CPU_CHAR *item, *save;
+
+	for (item = strtok_r(arg, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)){
+		CPU_CHAR *eq = strchr(item, '=');
+		CPU_INT64U ns;
+
+		if (eq == NULL)
+			return FALSE;
+		*eq = '\0';
+		ns = (CPU_INT64U)(strtod(eq + 1, NULL) * NsPerUs);
+		if (strcmp(item, "isr") == 0) cost->isr = ns;
+		else if (strcmp(item, "parse") == 0) cost->parse = ns;
+		else if (strcmp(item, "payload") == 0) cost->payload = ns;
+		else if (strcmp(item, "reply") == 0) cost->reply = ns;
+		else return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------- M a i n ( ) ----------------------------*/
+int main(int argc, char *argv[]){
+	CPU_INT32U bauds[MaxList] = { 9600 }, numBfrs[MaxList] = { 6 }, sizes[MaxList] = { 80 }, serBfrs[MaxList] = { 4 };
+	CPU_INT32U nBauds = 1, nBfrs = 1, nSizes = 1, nSer = 1;
+	CPU_INT32U from = 10, to = 200, step = 10;
+	CPU_INT32U b, q, s, f, n, knee;
+	CPU_INT64U packets = 0, events = 0;
+	struct timespec t0, t1;
+	double wall;
+	SimCfg cfg;
+	SimRun run;
+	int opt;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.intervalMs = 1000;
+	cfg.jitterPct = 10;
+	cfg.pktLen = 12;
+	cfg.replyLen = 40;
+	cfg.gatewayQ = 16;
+	cfg.secs = 60;
+	cfg.cost.isr = 3 * NsPerUs;
+	cfg.cost.parse = 6 * NsPerUs;
+	cfg.cost.payload = 250 * NsPerUs;
+	cfg.cost.reply = 4 * NsPerUs;
+
+	while ((opt = getopt(argc, argv, "b:n:q:s:f:i:j:p:r:g:t:c:v")) != -1){
+		switch (opt){
+		case 'b': if ((nBauds = ParseList(optarg, bauds)) == 0) optind = argc + 1; break;
+		case 'q': if ((nBfrs = ParseList(optarg, numBfrs)) == 0) optind = argc + 1; break;
+		case 's': if ((nSizes = ParseList(optarg, sizes)) == 0) optind = argc + 1; break;
+		case 'f': if ((nSer = ParseList(optarg, serBfrs)) == 0) optind = argc + 1; break;
+		case 'n': if (sscanf(optarg, "%u:%u:%u", &from, &to, &step) < 1) optind = argc + 1; break;
+		case 'i': cfg.intervalMs = strtoul(optarg, NULL, 0); break;
+		case 'j': cfg.jitterPct = strtoul(optarg, NULL, 0); break;
+		case 'p': cfg.pktLen = strtoul(optarg, NULL, 0); break;
+		case 'r': cfg.replyLen = strtoul(optarg, NULL, 0); break;
+		case 'g': cfg.gatewayQ = strtoul(optarg, NULL, 0); break;
+		case 't': cfg.secs = strtoul(optarg, NULL, 0); break;
+		case 'c': if (!ParseCosts(optarg, &cfg.cost)) optind = argc + 1; break;
+		case 'v': verbose = TRUE; break;
+		default:  optind = argc + 1; break;
+		}
+	}
+	if (to < from) to = from;
+	if (step == 0) step = 1;
+	for (b = 0; b < nBauds; b++) if (bauds[b] < 300) optind = argc + 1;
+	for (q = 0; q < nBfrs; q++) if (numBfrs[q] < PayloadMinBfrs + ReplyMinBfrs || numBfrs[q] > PoolMaxBlocks) optind = argc + 1;
+	for (s = 0; s < nSizes; s++) if (sizes[s] < 8 || sizes[s] > MaxBlockSize) optind = argc + 1;
+	for (f = 0; f < nSer; f++) if (serBfrs[f] < 1 || serBfrs[f] > MaxSerBfr) optind = argc + 1;
+	if (optind != argc || from < 1 || to > MaxNodes || cfg.intervalMs < 1 || cfg.jitterPct > 100 ||
+	    cfg.pktLen < 1 || cfg.secs < 1 || cfg.secs > MaxSimSecs){
+		fprintf(stderr, "usage: %s [-b baud,...] [-n from:to:step] [-q bfrs,...] [-s size,...]\n"
+		                "       [-f size,...] [-i ms] [-j pct] [-p bytes] [-r bytes] [-g pkts]\n"
+		                "       [-t secs] [-c isr|parse|payload|reply=us,...] [-v]\n", argv[0]);
+		return 2;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (b = 0; b < nBauds; b++)
+	for (q = 0; q < nBfrs; q++)
+	for (s = 0; s < nSizes; s++)
+	for (f = 0; f < nSer; f++){
+		cfg.baud = bauds[b];
+		cfg.numBfrs = numBfrs[q];
+		cfg.bfrQSize = sizes[s];
+		cfg.bfrSize = serBfrs[f];
+		printf("%u baud, %u blocks of %u bytes, %u byte serial buffers; %u byte packets every %u ms +-%u%%,"
+		       " %u byte replies, %u s\n", cfg.baud, cfg.numBfrs, cfg.bfrQSize, cfg.bfrSize,
+		       cfg.pktLen, cfg.intervalMs, cfg.jitterPct, cfg.replyLen, cfg.secs);
+		printf("  %6s %9s %9s %6s %6s %6s %6s %5s %5s %10s %10s\n", "nodes", "offered/s", "handled/s",
+		       "lost%", "gw%", "ovr%", "cpu%", "rx%", "tx%", "payload q", "reply q");
+		printf("  %6s %9s %9s %6s %6s %6s %6s %5s %5s %6s %3s %6s %3s\n", "", "", "", "", "", "", "",
+		       "", "", "mean", "p99", "mean", "p99");
+		knee = 0;
+		for (n = from; n <= to; n += step){
+			cfg.nodes = n;
+			Simulate(&cfg, &run);
+			packets += run.offered;
+			events += run.events;
+			if (PrintRun(&cfg, &run) > LossKnee && knee == 0)
+				knee = n;
+		}
+		if (knee)
+			printf("  saturated: over %.0f%% lost from %u nodes\n\n", LossKnee, knee);
+		else
+			printf("  not saturated up to %u nodes\n\n", to);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	fprintf(stderr, "%llu packets, %llu events in %.2f s: %.2f M packets/s, %.1f M events/s\n",
+	        packets, events, wall, packets / wall / 1e6, events / wall / 1e6);
+	return 0;
+}
@@ -0,0 +1,224 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			             replyDecode.c
+-----------------------------------------------------------------------
+Binary reply frame decoder. ReplyRecordText() turns a frame back into
+the exact text reply the station would have sent in text mode.
+-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include "replyDecode.h"
+#include "pktParser.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define MinLen 2              // Len of a frame with no data
+
+//Prefix of the station's error and info replies (Reply.c ReplyError(), ShortReplies).
+#define ErrPrefix "\n*** ERR: "
+
+//Text of the station's error replies, by ErrorState.
+static const CPU_CHAR *ErrorText[] = {"?", "P1", "P2", "P3", "CS", "Bad Size"};
+
+/*-------------------- R e p l y D e c o d e r I n i t ( ) -------------------------------------
+	Purpose:	Start looking for a sync byte and clear the counters.
+*/
+CPU_VOID ReplyDecoderInit(ReplyDecoder *dec){
+	memset(dec, 0, sizeof(*dec));
+	dec->state = DecSync;
+}
+
+/*-------------------- R e p l y D e c o d e B y t e ( ) -------------------------------------
+	Purpose:	Add one reply byte to the frame being collected.
+	Return:		TRUE when a frame with a good CRC is complete; rec holds it.
+*/
+CPU_BOOLEAN ReplyDecodeByte(ReplyDecoder *dec, CPU_INT08U byte, ReplyRecord *rec){
+	switch (dec->state){
+	case DecSync:
+		if (byte == FrameSync) dec->state = DecLen;
+		else dec->skipped++;
+		break;
+	case DecLen:
+		if (byte < MinLen || byte > FrameMaxData + MinLen){
+			// Not a frame after all; this byte may start the real one.
+			if (byte == FrameSync)
+				dec->skipped++;
+			else {
+				dec->skipped += 2;
+				dec->state = DecSync;
+			}
+			break;
+		}
+		dec->len = byte;
+		dec->body[0] = byte;
+		dec->i = 1;
+		dec->state = DecBody;
+		break;
+	case DecBody:
+		dec->body[dec->i++] = byte;
+		if (dec->i > dec->len) dec->state = DecCrc;
+		break;
+	case DecCrc:
+		dec->state = DecSync;
+		if (FrameCrc8(dec->body, dec->len + 1) != byte){
+			dec->crcErrors++;
+			break;
+		}
+		rec->type = (CPU_CHAR)dec->body[1];
+		rec->node = dec->body[2];
+		rec->dataLen = dec->len - MinLen;
+		memcpy(rec->data, &dec->body[3], rec->dataLen);
+		rec->data[rec->dataLen] = '\0';
+		dec->frames++;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*-------------------- G e t 3 2 ( ) -------------------------------------
+	Purpose:	Load a 32 bit little endian value.
+*/
+static CPU_INT32S Get32(const CPU_INT08U *data){
+	return (CPU_INT32S)((CPU_INT32U)data[0] | ((CPU_INT32U)data[1] << 8) |
+	                    ((CPU_INT32U)data[2] << 16) | ((CPU_INT32U)data[3] << 24));
+}
+
+/*-------------------- R e p l y R e c o r d R e a d i n g ( ) -------------------------------------
+	Purpose:	Recover the fixed point reading from a reading frame.
+	Return:		FALSE if the frame is not a reading.
+*/
+CPU_BOOLEAN ReplyRecordReading(const ReplyRecord *rec, Reading *rdg){
+	CPU_INT08U auxLen = FrameHasAux(rec->type) ? FrameAuxLen : 0;
+	CPU_INT08U n, i;
+
+	if (ReadingIndex(rec->type) == NumRdgTypes || rec->dataLen <= auxLen || rec->dataLen - auxLen > 4)
+		return FALSE;
+
+	n = rec->dataLen - auxLen;
+	rdg->value = (rec->data[n - 1] & 0x80) ? -1 : 0;    // Sign extend
+	for (i = n; i > 0; i--)
+		rdg->value = (CPU_INT32S)(((CPU_INT32U)rdg->value << 8) | rec->data[i - 1]);
+	rdg->aux = auxLen ? (CPU_INT16S)(rec->data[n] | (rec->data[n + 1] << 8)) : 0;
+	return TRUE;
+}
+
+/*-------------------- R e p l y R e c o r d S u m m a r y ( ) -------------------------------------
+	Purpose:	Recover a window summary from a summary frame.
+	Return:		FALSE if the frame is not a summary.
+*/
+CPU_BOOLEAN ReplyRecordSummary(const ReplyRecord *rec, AggSummary *summary){
+	if (rec->type != FrameSummary || rec->dataLen != 16 || rec->data[1] >= AggLevels)
+		return FALSE;
+
+	summary->node = rec->node;
+	summary->msgType = (CPU_CHAR)rec->data[0];
+	summary->level = rec->data[1];
+	summary->end = 0;
+	summary->count = rec->data[2] | (rec->data[3] << 8);
+	summary->min = Get32(&rec->data[4]);
+	summary->max = Get32(&rec->data[8]);
+	summary->mean = Get32(&rec->data[12]);
+	return TRUE;
+}
+
+/*-------------------- R e p l y R e c o r d L o g ( ) -------------------------------------
+	Purpose:	Recover an exported log record from a log frame.
+	Return:		FALSE if the frame is not a log record; the end of an
+			export is not one.
+*/
+CPU_BOOLEAN ReplyRecordLog(const ReplyRecord *rec, LogRecord *log){
+	if (rec->type != FrameLog || rec->dataLen != 11)
+		return FALSE;
+
+	log->node = rec->node;
+	log->msgType = (CPU_CHAR)rec->data[0];
+	log->value = Get32(&rec->data[1]);
+	log->aux = (CPU_INT16S)(rec->data[5] | (rec->data[6] << 8));
+	log->time = (CPU_INT32U)Get32(&rec->data[7]);
+	return TRUE;
+}
+
+/*-------------------- R e p l y R e c o r d S t a t s ( ) -------------------------------------
+	Purpose:	Recover a console group's values from a stats frame; the group
+			letter is the node.
+	Return:		Number of values, 0 if the frame is not a stats group.
+*/
+CPU_INT08U ReplyRecordStats(const ReplyRecord *rec, CPU_INT32U *values){
+	CPU_INT08U i;
+
+	if (rec->type != FrameStats || rec->dataLen == 0 || rec->dataLen % 4 != 0)
+		return 0;
+	for (i = 0; i < rec->dataLen / 4; i++)
+		values[i] = (CPU_INT32U)Get32(&rec->data[4 * i]);
+	return rec->dataLen / 4;
+}
+
+/*-------------------- R e p l y R e c o r d T e x t ( ) -------------------------------------
+	Purpose:	Write the text reply the station sends for the same payload.
+*/
+CPU_VOID ReplyRecordText(const ReplyRecord *rec, CPU_CHAR *text){
+	CPU_INT32U values[FrameMaxData / 4];
+	AggSummary summary;
+	LogRecord log;
+	Reading rdg;
+	CPU_INT32U v;
+	CPU_INT08U n, i;
+
+	if (ReplyRecordReading(rec, &rdg)){
+		v = (CPU_INT32U)rdg.value;
+		switch (rec->type){
+		case 'B': sprintf(text, "\nN%u P = %u\n", rec->node, v); return;
+		case 'D':
+			sprintf(text, "\nN%u TS = %u/%u/%u %u:%u\n", rec->node,
+			        (v >> 16) & 0xF, (v >> 11) & 0x1F, v >> 20, (v >> 6) & 0x1F, v & 0x3F);
+			return;
+		case 'H': sprintf(text, "\nN%u DP = %u H = %u\n", rec->node, (CPU_INT32U)rdg.aux, v); return;
+		case 'P': sprintf(text, "\nN%u = %u.%u%u\n", rec->node, v / 100, v / 10 % 10, v % 10); return;
+		case 'R': sprintf(text, "\nN%u R = %u\n", rec->node, v); return;
+		case 'T': sprintf(text, "\nN%u T = %i\n", rec->node, rdg.value); return;
+		case 'W': sprintf(text, "\nN%u SP = %u.%u  DIR = %u\n", rec->node, v / 10, v % 10, (CPU_INT16U)rdg.aux); return;
+		}
+	}
+
+	switch (rec->type){
+	case 'I':
+		sprintf(text, "\nN%u ID = %s\n", rec->node, (const CPU_CHAR *)rec->data);
+		break;
+	case FrameError:
+		sprintf(text, ErrPrefix "%s\n", rec->dataLen && rec->data[0] <= E5 ? ErrorText[rec->data[0]] : "?");
+		break;
+	case FrameInfo:
+		sprintf(text, ErrPrefix "%s\n", rec->dataLen && rec->data[0] == FrameBadAddr ? "Bad ADR" : "Bad Type");
+		break;
+	case FrameLog:
+		if (ReplyRecordLog(rec, &log) || rec->dataLen == 0){
+			FlashLogFormat(rec->dataLen ? &log : NULL, text);
+			break;
+		}
+		sprintf(text, ErrPrefix "Bad frame %c\n", rec->type);
+		break;
+	case FrameStats:
+		n = ReplyRecordStats(rec, values);
+		if (n > 0){
+			text += sprintf(text, "\n#%c", rec->node);
+			for (i = 0; i < n; i++)
+				text += sprintf(text, " %lu", (unsigned long)values[i]);
+			sprintf(text, "\n");
+			break;
+		}
+		sprintf(text, ErrPrefix "Bad frame %c\n", rec->type);
+		break;
+	case FrameSummary:
+		if (ReplyRecordSummary(rec, &summary)){
+			AggregateFormat(&summary, text);
+			break;
+		}
+		/* fall through */
+	default:
+		sprintf(text, ErrPrefix "Bad frame %c\n", rec->type);
+		break;
+	}
+}
@@ -0,0 +1,54 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                 Host Tools   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			             replyDecode.h
+-----------------------------------------------------------------------
+Decoder for the station's binary reply frames (Prog 5 ReplyFrame.h).
+Feed it the reply stream a byte at a time; it hands back each frame
+whose CRC checks and skips anything else until the next sync byte.
+
+Build with:  -include HostOS.h -I../Prog5/App replyDecode.c ../Prog5/App/Aggregate.c
+             ../Prog5/App/FlashLog.c
+-----------------------------------------------------------------------*/
+
+#ifndef REPLYDECODE_H
+#define REPLYDECODE_H
+
+#include "CPU.h"
+#include "Reading.h"
+#include "Aggregate.h"
+#include "ReplyFrame.h"
+
+typedef struct
+{
+	CPU_CHAR type;                      // Frame type: message type, FrameError, FrameInfo, FrameSummary,
+	                                    // FrameLog or FrameStats
+	CPU_INT08U node;                    // Node the frame is about
+	CPU_INT08U dataLen;                 // Bytes in data
+	CPU_INT08U data[FrameMaxData + 1];  // Data field, plus room for a terminator
+} ReplyRecord;
+
+typedef enum {DecSync, DecLen, DecBody, DecCrc} DecodeState;
+
+typedef struct
+{
+	DecodeState state;
+	CPU_INT08U len;                     // Len byte of the frame being collected
+	CPU_INT08U i;                       // Body bytes collected
+	CPU_INT08U body[FrameMaxData + 3];  // Len, Type, Node, Data
+	CPU_INT64U frames;                  // Good frames
+	CPU_INT64U crcErrors;               // Frames dropped on a bad CRC
+	CPU_INT64U skipped;                 // Bytes skipped looking for a sync byte
+} ReplyDecoder;
+
+CPU_VOID ReplyDecoderInit(ReplyDecoder *dec);
+CPU_BOOLEAN ReplyDecodeByte(ReplyDecoder *dec, CPU_INT08U byte, ReplyRecord *rec);
+CPU_BOOLEAN ReplyRecordReading(const ReplyRecord *rec, Reading *rdg);
+CPU_BOOLEAN ReplyRecordSummary(const ReplyRecord *rec, AggSummary *summary);
+CPU_BOOLEAN ReplyRecordLog(const ReplyRecord *rec, LogRecord *log);
+CPU_INT08U ReplyRecordStats(const ReplyRecord *rec, CPU_INT32U *values);
+CPU_VOID ReplyRecordText(const ReplyRecord *rec, CPU_CHAR *text);
+
+#endif
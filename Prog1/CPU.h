@@ -37,8 +37,8 @@ typedef signed char     CPU_INT08S;
 typedef unsigned char   CPU_INT08U;   
 typedef short           CPU_INT16S;           
 typedef unsigned short  CPU_INT16U;  
-typedef long            CPU_INT32S;            
-typedef unsigned long   CPU_INT32U;   
+typedef int             CPU_INT32S;            
+typedef unsigned int    CPU_INT32U;   
 typedef char            CPU_CHAR;
 typedef unsigned char   CPU_BOOLEAN;
 
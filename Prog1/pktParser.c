@@ -42,10 +42,10 @@ void Error(CPU_CHAR *message, ParserState *parseState){
 	Return:		True - A packet was obtained and its payload was extracted; pktBfr points to packet.
 				False - End of file was reached; there are no more packets.
 */
-CPU_BOOLEAN ParsePkt(FILE *pktFile, void *payloadBfr){
+CPU_BOOLEAN ParsePkt(PktReader *pktFile, void *payloadBfr){
 
 	ParserState parseState = P1;
-	CPU_INT08U  nextByte;
+	CPU_INT16S  nextByte;
 	CPU_INT08U  checkSum = 0;
 	CPU_INT08U	i = 0;
 
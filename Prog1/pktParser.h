@@ -9,9 +9,9 @@
 #ifndef PKTPARSER_H
 #define PKTPARSER_H
 
-#include "stdio.h"
 #include "CPU.h"
+#include "pktReader.h"
 
-CPU_BOOLEAN ParsePkt(FILE *pktFile, void *pktBfr);
+CPU_BOOLEAN ParsePkt(PktReader *pktFile, void *pktBfr);
 
 #endif
\ No newline at end of file
@@ -4,21 +4,392 @@
                    Prog 1   -   Jesse Whitworth
 -----------------------------------------------------------------------
 			              pktReader.c
+-----------------------------------------------------------------------
+Capture file readers. Small files are read in fread() blocks. On Linux
+large files go through io_uring: UringDepth registered buffers are kept
+in flight so the kernel fills the next blocks while the parser works
+on the current one. O_DIRECT is used when asked for and supported, and
+read() takes over when io_uring is not available.
 -----------------------------------------------------------------------*/
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
 
 #include "CPU.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "string.h"
-#include "pktParser.h"
+#include "pktReader.h"
 #include "Error.h"
 
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
 #define BUFFER_SIZE   60
+#define BlockSize     (256 * 1024)  // Bytes per read
+#define UringDepth    4             // Blocks in flight
+#define DirectAlign   4096          // O_DIRECT buffer and offset alignment
+#define InFlight      (-1 - 0x7FFF) // res[] value of a block not yet complete
+
+#ifdef __linux__
+typedef struct
+{
+	int fd;                          // Ring fd
+	CPU_INT08U *sq;                  // Submission ring mapping
+	CPU_INT08U *cq;                  // Completion ring mapping
+	size_t sqSize, cqSize;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+	unsigned *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe *cqes;
+	CPU_BOOLEAN fixed;               // Buffers are registered with the ring
+} Uring;
+
+typedef struct
+{
+	int fd;                          // Capture file
+	off_t size;                      // Capture size in bytes
+	CPU_INT08U *map;                 // ReadMmap: the whole file
+	CPU_INT08U *space;               // ReadSyscall / ReadUring buffer space
+	Uring ring;                      // ReadUring
+	struct iovec iov[UringDepth];    // One buffer per block in flight
+	CPU_INT32S res[UringDepth];      // Bytes read into each buffer, or InFlight
+	off_t block;                     // Next block number to parse
+	CPU_BOOLEAN holding;             // The previous block's buffer is still being parsed
+} LinuxIo;
+
+/*-------------------- U r i n g S e t u p ( ) -------------------------------------
+	Purpose:	Create an io_uring and map its rings.
+	Return:		TRUE on success, FALSE if io_uring is unavailable.
+*/
+static CPU_BOOLEAN UringSetup(Uring *u, unsigned entries){
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	u->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (u->fd < 0) return false;
+
+	u->sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP){
+		if (u->cqSize > u->sqSize) u->sqSize = u->cqSize;
+		u->cqSize = 0;
+	}
+
+	u->sq = mmap(NULL, u->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if (u->sq == MAP_FAILED){
+		close(u->fd);
+		return false;
+	}
+	u->cq = u->cqSize ? mmap(NULL, u->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING)
+	                  : u->sq;
+	u->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if (u->cq == MAP_FAILED || u->sqes == MAP_FAILED){
+		if (u->sqes != MAP_FAILED) munmap(u->sqes, u->sqesSize);
+		if (u->cqSize && u->cq != MAP_FAILED) munmap(u->cq, u->cqSize);
+		munmap(u->sq, u->sqSize);
+		close(u->fd);
+		return false;
+	}
+
+	u->sqTail  = (unsigned *)(u->sq + p.sq_off.tail);
+	u->sqMask  = (unsigned *)(u->sq + p.sq_off.ring_mask);
+	u->sqArray = (unsigned *)(u->sq + p.sq_off.array);
+	u->cqHead  = (unsigned *)(u->cq + p.cq_off.head);
+	u->cqTail  = (unsigned *)(u->cq + p.cq_off.tail);
+	u->cqMask  = (unsigned *)(u->cq + p.cq_off.ring_mask);
+	u->cqes    = (struct io_uring_cqe *)(u->cq + p.cq_off.cqes);
+	return true;
+}
+
+/*-------------------- U r i n g C l o s e ( ) -------------------------------------
+	Purpose:	Unmap the rings and close the ring fd.
+*/
+static void UringClose(Uring *u){
+	munmap(u->sqes, u->sqesSize);
+	if (u->cqSize) munmap(u->cq, u->cqSize);
+	munmap(u->sq, u->sqSize);
+	close(u->fd);
+}
+
+/*-------------------- S u b m i t B l o c k ( ) -------------------------------------
+	Purpose:	Queue a read of block number k into its buffer (k mod UringDepth).
+				Blocks past the end of the file are not read.
+	Return:		1 if a read was queued, 0 otherwise.
+*/
+static unsigned SubmitBlock(LinuxIo *io, off_t k){
+	Uring *u = &io->ring;
+	CPU_INT32U b = (CPU_INT32U)(k % UringDepth);
+	unsigned tail = *u->sqTail;
+	unsigned idx = tail & *u->sqMask;
+	struct io_uring_sqe *sqe = &u->sqes[idx];
+
+	if (k * BlockSize >= io->size) return 0;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->fd = io->fd;
+	sqe->off = k * BlockSize;
+	sqe->user_data = b;
+	if (u->fixed){
+		sqe->opcode = IORING_OP_READ_FIXED;
+		sqe->addr = (unsigned long)io->iov[b].iov_base;
+		sqe->len = BlockSize;
+		sqe->buf_index = b;
+	}else{
+		sqe->opcode = IORING_OP_READV;
+		sqe->addr = (unsigned long)&io->iov[b];
+		sqe->len = 1;
+	}
+	u->sqArray[idx] = idx;
+	io->res[b] = InFlight;
+	__atomic_store_n(u->sqTail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/*-------------------- U r i n g E n t e r ( ) -------------------------------------
+	Purpose:	Submit queued reads and optionally wait for one completion,
+				then record every completion that has arrived.
+	Return:		FALSE if io_uring_enter failed or took fewer reads than queued;
+				a block still InFlight may then never complete.
+*/
+static CPU_BOOLEAN UringEnter(LinuxIo *io, unsigned toSubmit, unsigned waitFor){
+	Uring *u = &io->ring;
+	CPU_BOOLEAN ok = true;
+	unsigned head;
+	long ret;
+
+	if (toSubmit || waitFor){
+		while ((ret = syscall(__NR_io_uring_enter, u->fd, toSubmit, waitFor,
+		                      waitFor ? IORING_ENTER_GETEVENTS : 0, NULL, 0)) < 0 && errno == EINTR)
+			;
+		if (ret < 0 || (unsigned long)ret < toSubmit) ok = false;
+	}
+
+	head = *u->cqHead;
+	while (head != __atomic_load_n(u->cqTail, __ATOMIC_ACQUIRE)){
+		struct io_uring_cqe *cqe = &u->cqes[head & *u->cqMask];
+
+		io->res[cqe->user_data] = cqe->res;
+		head++;
+	}
+	__atomic_store_n(u->cqHead, head, __ATOMIC_RELEASE);
+	return ok;
+}
+
+/*-------------------- F i n i s h B l o c k ( ) -------------------------------------
+	Purpose:	Read the rest of a block that came back short with pread(), so
+				the next block does not start past the missing bytes. Reads
+				start and end on DirectAlign boundaries, as O_DIRECT needs.
+	Return:		FALSE on a read error. A file that shrank ends the block early.
+*/
+static CPU_BOOLEAN FinishBlock(LinuxIo *io, CPU_INT32U b, CPU_INT32S want){
+	CPU_INT08U *buf = io->iov[b].iov_base;
+	off_t at = io->block * BlockSize;
+	CPU_INT32S to = (want + DirectAlign - 1) & ~(DirectAlign - 1);
+	ssize_t n;
+
+	while (io->res[b] < want){
+		CPU_INT32S from = io->res[b] & ~(DirectAlign - 1);
+
+		n = pread(io->fd, buf + from, (size_t)(to - from), at + from);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0){
+			ShowError(strerror(errno));
+			return false;
+		}
+		if (from + n <= io->res[b]) break;
+		io->res[b] = from + n < want ? (CPU_INT32S)(from + n) : want;
+	}
+	return true;
+}
+
+/*-------------------- R e f i l l U r i n g ( ) -------------------------------------
+	Purpose:	Hand the parser the next block in file order. The buffer the
+				parser just finished is sent back to the kernel first.
+	Return:		The first byte of the block, or EOF.
+*/
+static CPU_INT16S RefillUring(PktReader *rdr, LinuxIo *io){
+	CPU_INT32U b;
+	off_t want;
+
+	if (io->holding && !UringEnter(io, SubmitBlock(io, io->block - 1 + UringDepth), 0)){
+		ShowError("io_uring submit failed");
+		return EOF;
+	}
+	io->holding = false;
+
+	if (io->block * BlockSize >= io->size) return EOF;
+
+	b = (CPU_INT32U)(io->block % UringDepth);
+	while (io->res[b] == InFlight)
+		if (!UringEnter(io, 0, 1)){
+			ShowError("io_uring wait failed");
+			return EOF;
+		}
+	if (io->res[b] < 0){
+		ShowError(strerror(-io->res[b]));
+		return EOF;
+	}
+	want = io->size - io->block * BlockSize;
+	if (want > BlockSize) want = BlockSize;
+	if (io->res[b] < want && !FinishBlock(io, b, (CPU_INT32S)want))
+		return EOF;
+	if (io->res[b] == 0) return EOF;
+
+	rdr->cur = io->iov[b].iov_base;
+	rdr->len = io->res[b];
+	rdr->pos = 1;
+	io->block++;
+	io->holding = true;
+	return rdr->cur[0];
+}
+
+/*-------------------- S t a r t U r i n g ( ) -------------------------------------
+	Purpose:	Set up the ring, register the buffers and start the first reads.
+	Return:		TRUE on success, FALSE if io_uring is unavailable.
+*/
+static CPU_BOOLEAN StartUring(LinuxIo *io){
+	unsigned queued = 0;
+	CPU_INT32U b;
+
+	if (!UringSetup(&io->ring, UringDepth)) return false;
+	io->ring.fixed = syscall(__NR_io_uring_register, io->ring.fd, IORING_REGISTER_BUFFERS, io->iov, UringDepth) == 0;
+
+	for (b = 0; b < UringDepth; b++)
+		queued += SubmitBlock(io, b);
+	if (!UringEnter(io, queued, 0)){
+		UringClose(&io->ring);
+		return false;
+	}
+	return true;
+}
+
+/*-------------------- O p e n L i n u x ( ) -------------------------------------
+	Purpose:	Open a capture for the mmap, read() or io_uring readers.
+	Return:		The mode in use (io_uring falls back to read()), or ReadStdio
+				if the file must be read with stdio instead.
+*/
+static PktReadMode OpenLinux(PktReader *rdr, const CPU_CHAR *name, PktReadMode mode, CPU_BOOLEAN direct){
+	LinuxIo *io = calloc(1, sizeof(LinuxIo));
+	struct stat st;
+	CPU_INT32U b;
+
+	io->fd = -1;
+	if (direct && mode != ReadMmap) io->fd = open(name, O_RDONLY | O_DIRECT);
+	if (io->fd < 0) io->fd = open(name, O_RDONLY);
+	if (io->fd < 0 || fstat(io->fd, &st) < 0){
+		if (io->fd >= 0) close(io->fd);
+		free(io);
+		return ReadStdio;
+	}
+	io->size = st.st_size;
+	rdr->io = io;
+
+	if (mode == ReadAuto)
+		mode = io->size >= LargePktFile ? ReadUring : ReadSyscall;
+
+	if (mode == ReadMmap){
+		if (io->size == 0) return ReadMmap;
+		io->map = mmap(NULL, io->size, PROT_READ, MAP_PRIVATE, io->fd, 0);
+		if (io->map != MAP_FAILED){
+			madvise(io->map, io->size, MADV_SEQUENTIAL);
+			return ReadMmap;
+		}
+		io->map = NULL;
+		mode = ReadSyscall;
+	}
+
+	// Aligned buffers serve both O_DIRECT and the registered buffers.
+	if (posix_memalign((void **)&io->space, DirectAlign, (size_t)BlockSize * UringDepth) != 0){
+		close(io->fd);
+		free(io);
+		rdr->io = NULL;
+		return ReadStdio;
+	}
+	for (b = 0; b < UringDepth; b++){
+		io->iov[b].iov_base = io->space + (size_t)b * BlockSize;
+		io->iov[b].iov_len = BlockSize;
+	}
+
+	if (mode == ReadUring && StartUring(io))
+		return ReadUring;
+	posix_fadvise(io->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	return ReadSyscall;
+}
+
+/*-------------------- C l o s e L i n u x ( ) -------------------------------------
+	Purpose:	Release the mmap, read() or io_uring reader.
+*/
+static void CloseLinux(PktReader *rdr){
+	LinuxIo *io = rdr->io;
+
+	if (rdr->mode == ReadUring){
+		// Let reads still in flight finish before their buffers go away.
+		CPU_INT32U b;
+		for (b = 0; b < UringDepth; b++)
+			while (io->res[b] == InFlight && UringEnter(io, 0, 1))
+				;
+		UringClose(&io->ring);
+	}
+	if (io->map) munmap(io->map, io->size);
+	free(io->space);
+	close(io->fd);
+	free(io);
+}
+#endif
+
+/*-------------------- O p e n P k t R e a d e r ( ) -------------------------------------
+	Purpose:	Open a capture file with the requested reader. Modes the platform
+				lacks fall back to fread() blocks; io_uring falls back to read().
+	Return:		The reader, or NULL if the file could not be opened.
+*/
+PktReader* OpenPktReader(const CPU_CHAR *name, PktReadMode mode, CPU_BOOLEAN direct){
+	PktReader *rdr = calloc(1, sizeof(PktReader));
+
+#ifdef __linux__
+	if (mode != ReadFgetc && mode != ReadStdio)
+		mode = OpenLinux(rdr, name, mode, direct);
+	if (rdr->io != NULL){
+		rdr->mode = mode;
+		if (mode == ReadMmap){
+			rdr->cur = ((LinuxIo *)rdr->io)->map;
+			rdr->len = (CPU_INT32U)((LinuxIo *)rdr->io)->size;
+		}
+		return rdr;
+	}
+#else
+	(void)direct;
+	if (mode != ReadFgetc) mode = ReadStdio;
+#endif
+
+	rdr->mode = mode;
+	rdr->file = fopen(name, "rb");
+	if (rdr->file == NULL){
+		free(rdr);
+		return NULL;
+	}
+	if (mode == ReadStdio){
+		rdr->cur = malloc(BlockSize);
+		setvbuf(rdr->file, NULL, _IONBF, 0);  // fread() straight into our block
+	}
+	return rdr;
+}
 
 /*-------------------- O p e n P k t F i l e ( ) -------------------------------------
 	Purpose:	Promt the user for a file, and then open the file for reading.
-	Return:		FILE - Returns the file that was opened.
+	Return:		PktReader - Returns the reader for the file that was opened.
 				NULL  - Returns NULL if the file could not be opened.*/
-FILE* OpenPktFile(){
+PktReader* OpenPktFile(){
 
 	CPU_CHAR buffer[BUFFER_SIZE];
 	printf("Packet File Name? ");
@@ -28,7 +399,7 @@ FILE* OpenPktFile(){
 	else{
 		if(buffer[0] == '\n') return NULL;
 		else{
-			FILE *pktFile = fopen(buffer, "rb");
+			PktReader *pktFile = OpenPktReader(buffer, ReadAuto, false);
 			if (pktFile == NULL){
 				ShowError("File not found.");
 			}
@@ -39,11 +410,51 @@ FILE* OpenPktFile(){
 	return NULL;
 }
 
-/*-------------------- G e t B y t e ( ) -------------------------------------
-	Purpose:	Read the next byte from the file.
-	Return:		False - The user did not enter a file.*/
-CPU_INT08U	GetByte(FILE *pktFile){
-	
-	return fgetc(pktFile);
+/*-------------------- R e f i l l P k t F i l e ( ) -------------------------------------
+	Purpose:	Read the next block of the file. Called by GetByte() when the
+				current block is used up.
+	Return:		The next byte, or EOF at the end of the file.*/
+CPU_INT16S RefillPktFile(PktReader *rdr){
+	size_t got;
 
-}
\ No newline at end of file
+	switch (rdr->mode){
+	case ReadFgetc:
+		return fgetc(rdr->file);
+	case ReadStdio:
+		got = fread(rdr->cur, 1, BlockSize, rdr->file);
+		if (got == 0) return EOF;
+		rdr->len = (CPU_INT32U)got;
+		rdr->pos = 1;
+		return rdr->cur[0];
+#ifdef __linux__
+	case ReadSyscall:
+	{
+		LinuxIo *io = rdr->io;
+		ssize_t n;
+
+		while ((n = read(io->fd, io->space, BlockSize)) < 0 && errno == EINTR)
+			;
+		if (n <= 0) return EOF;
+		rdr->cur = io->space;
+		rdr->len = (CPU_INT32U)n;
+		rdr->pos = 1;
+		return rdr->cur[0];
+	}
+	case ReadUring:
+		return RefillUring(rdr, rdr->io);
+#endif
+	default:
+		return EOF;  // ReadMmap: the whole file was the first block
+	}
+}
+
+/*-------------------- C l o s e P k t F i l e ( ) -------------------------------------
+	Purpose:	Close the capture file and release the reader.*/
+void ClosePktFile(PktReader *rdr){
+#ifdef __linux__
+	if (rdr->io != NULL) CloseLinux(rdr);
+#endif
+	if (rdr->file != NULL) fclose(rdr->file);
+	if (rdr->mode == ReadStdio) free(rdr->cur);
+	free(rdr);
+}
@@ -4,13 +4,46 @@
                    Prog 1   -   Jesse Whitworth
 -----------------------------------------------------------------------
 			              pktReader.h
+-----------------------------------------------------------------------
+The packet reader hands the parser one byte at a time from a block of
+the capture file. GetByte() is a macro so the common case (the next
+byte is already in memory) costs a compare and a load; RefillPktFile()
+fetches the next block.
 -----------------------------------------------------------------------*/
 #ifndef PKTREADER_H
-#define PKETREADER_H
+#define PKTREADER_H
 
+#include "stdio.h"
 #include "CPU.h"
 
-FILE* OpenPktFile();
-CPU_INT08U	GetByte(FILE *pktFile);
+//Captures at least this big are read with io_uring (or read()) on Linux.
+#define LargePktFile (1024L * 1024L)
+
+typedef enum
+{
+	ReadAuto,       // Linux: read() blocks for small files, io_uring for large ones; stdio blocks elsewhere
+	ReadFgetc,      // One fgetc() per byte (the original reader)
+	ReadStdio,      // fread() blocks
+	ReadMmap,       // Map the whole file (Linux)
+	ReadSyscall,    // read() blocks (Linux, io_uring fallback)
+	ReadUring       // io_uring, registered buffers, several reads in flight (Linux)
+} PktReadMode;
+
+typedef struct
+{
+	CPU_INT08U *cur;        // Block being parsed
+	CPU_INT32U pos;         // Next byte in the block
+	CPU_INT32U len;         // Number of bytes in the block
+	PktReadMode mode;       // Mode actually in use after any fallback
+	FILE *file;             // ReadFgetc and ReadStdio
+	void *io;               // Platform specific state for the other modes
+} PktReader;
+
+#define GetByte(rdr) ((rdr)->pos < (rdr)->len ? (CPU_INT16S)(rdr)->cur[(rdr)->pos++] : RefillPktFile(rdr))
+
+PktReader* OpenPktFile();
+PktReader* OpenPktReader(const CPU_CHAR *name, PktReadMode mode, CPU_BOOLEAN direct);
+CPU_INT16S RefillPktFile(PktReader *rdr);
+void ClosePktFile(PktReader *rdr);
 
-#endif
\ No newline at end of file
+#endif
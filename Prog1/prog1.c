@@ -154,7 +154,7 @@ void DisplayPacket(Payload *payload){
 
 /*-------------------- M a i n ( ) ----------------------------*/
 int main (){
-	FILE *packetFile;
+	PktReader *packetFile;
 	Payload payload;
 
 	for(;;){
@@ -167,7 +167,7 @@ int main (){
 			}
 			DisplayPacket(&payload);
 		}
-		fclose(packetFile);
+		ClosePktFile(packetFile);
 	}
 			
 	return 0;
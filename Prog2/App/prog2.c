@@ -168,6 +168,7 @@ int main()
     BSP_IntDisAll();            // Disable all interrupts.
     BSP_Init();                 // Initialize BSP functions
     BSP_Ser_Init(BaudRate);     // Initialize the RS232 interface.
+    CPU_IntEn();                // Let the USART2 interrupt drain the output ring.
 
     AppMain();  //  Run the application.
     
@@ -21,6 +21,7 @@
 * Version       : V1.00
 * Programmer(s) : EHS
                   02-02-2011 gpc - Change to simple polled I/O, not requiring the OS.
+                  JW - Output through a TX ring drained by the USART2 interrupt.
 *********************************************************************************************************
 */
 
@@ -42,6 +43,14 @@
 */
 #define USART_RXNE  0x20  // Rx not Empty Status Bit
 #define USART_TXE   0x80  // Tx Empty Status Bit
+#define USART_TXEIE 0x80  // Tx Empty Interrupt Enable Bit (CR1)
+
+#ifndef  BSP_SER_TX_BUF_SIZE
+#define  BSP_SER_TX_BUF_SIZE                  256               /* Bytes in the TX ring                                 */
+#endif
+
+#define  BSP_SER_BITS_PER_BYTE                 10               /* Start, 8 data and stop bits                          */
+#define  BSP_SER_PRINTF_SIZE                   80               /* Longest BSP_Ser_Printf() output                      */
 
 /*
 *********************************************************************************************************
@@ -70,12 +79,41 @@
 *********************************************************************************************************
 */
 
+static  CPU_INT08U           BSP_SerTxBuf[BSP_SER_TX_BUF_SIZE];
+static  volatile  CPU_INT16U BSP_SerTxIn;                       /* Next byte queued goes here                           */
+static  volatile  CPU_INT16U BSP_SerTxOut;                      /* Next byte sent comes from here                       */
+static  volatile  CPU_INT16U BSP_SerTxWant;                     /* Room a writer waits for, 0 if none waits             */
+static  volatile  CPU_INT32U BSP_SerTxSent;                     /* Bytes sent, the clock for waits without the OS       */
+static  CPU_INT32U           BSP_SerTxDropped;                  /* Writes given up on a timeout                         */
+static  CPU_INT32U           BSP_SerBaud;
+
+static  CPU_BOOLEAN          BSP_SerOS_Ready;                   /* The mutex and semaphore below exist                  */
+static  OS_MUTEX             BSP_SerTxMutex;                    /* One writer at a time, whole strings                  */
+static  OS_SEM               BSP_SerTxSem;                      /* Posted by the ISR when BSP_SerTxWant bytes are free  */
+
 /*
 *********************************************************************************************************
 *                                      LOCAL FUNCTION PROTOTYPES
 *********************************************************************************************************
 */
 
+static  void         BSP_Ser_ISR_Handler (void);
+static  CPU_INT16U   BSP_Ser_TxFree      (void);
+static  void         BSP_Ser_TxSend      (void);
+static  CPU_BOOLEAN  BSP_Ser_TxWait      (CPU_INT16U   need,
+                                          CPU_INT32U   start,
+                                          CPU_INT32U   timeout_ms);
+static  CPU_BOOLEAN  BSP_Ser_TxPut       (CPU_INT08U   c,
+                                          CPU_INT32U   start,
+                                          CPU_INT32U   timeout_ms);
+static  CPU_BOOLEAN  BSP_Ser_TxStr       (CPU_CHAR    *p_str,
+                                          CPU_INT32U   timeout_ms);
+static  CPU_BOOLEAN  BSP_Ser_VPrintfTmo  (CPU_INT32U   timeout_ms,
+                                          CPU_CHAR    *format,
+                                          va_list      vArgs);
+static  CPU_BOOLEAN  BSP_Ser_Lock        (CPU_INT32U   timeout_ms);
+static  void         BSP_Ser_Unlock      (void);
+
 
 /*
 *********************************************************************************************************
@@ -148,6 +186,348 @@ void  BSP_Ser_Init (CPU_INT32U  baud_rate)
     USART_Init(USART2, &usart_init);
     USART_ClockInit(USART2, &usart_clk_init);
     USART_Cmd(USART2, ENABLE);
+
+                                                                /* ------------------- SETUP TX RING ------------------ */
+    BSP_SerTxIn   = 0;
+    BSP_SerTxOut  = 0;
+    BSP_SerTxWant = 0;
+    BSP_SerBaud   = baud_rate;
+    BSP_IntVectSet(BSP_INT_ID_USART2, BSP_Ser_ISR_Handler);
+    BSP_IntEn(BSP_INT_ID_USART2);                               /* TXEIE stays off until a byte is queued.              */
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_ISR_Handler()
+*
+* Description : USART2 interrupt: move the next queued byte to the transmitter.
+*
+* Argument(s) : none.
+*
+* Return(s)   : none.
+*
+* Caller(s)   : BSP_IntHandlerUSART2(), through the vector table set in BSP_Ser_Init().
+*
+* Note(s)     : (1) Only TXE is enabled; the receive side stays polled.
+*
+*               (2) A waiting writer is posted once the room it asked for is free, not every byte.
+*********************************************************************************************************
+*/
+
+static  void  BSP_Ser_ISR_Handler (void)
+{
+    OS_ERR  err;
+
+
+    BSP_Ser_TxSend();
+
+    if ((BSP_SerTxWant != 0) && (BSP_Ser_TxFree() >= BSP_SerTxWant)) {
+        BSP_SerTxWant = 0;
+        if (BSP_SerOS_Ready == DEF_TRUE) {
+            OSSemPost(&BSP_SerTxSem, OS_OPT_POST_1, &err);
+        }
+    }
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_TxFree()
+*
+* Description : Bytes the TX ring has room for. One slot is kept empty to tell full from empty.
+*********************************************************************************************************
+*/
+
+static  CPU_INT16U  BSP_Ser_TxFree (void)
+{
+    return ((CPU_INT16U)((BSP_SerTxOut + BSP_SER_TX_BUF_SIZE - BSP_SerTxIn - 1) % BSP_SER_TX_BUF_SIZE));
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_TxSend()
+*
+* Description : Hand the next queued byte to the transmitter if it is empty; turn the TXE interrupt off
+*               once the ring is empty.
+*
+* Caller(s)   : BSP_Ser_ISR_Handler(), BSP_Ser_TxWait().
+*
+* Note(s)     : (1) Runs with interrupts disabled, so the ISR and a polling writer never send one byte twice.
+*********************************************************************************************************
+*/
+
+static  void  BSP_Ser_TxSend (void)
+{
+    CPU_SR_ALLOC();
+
+
+    CPU_CRITICAL_ENTER();
+    if (BSP_SerTxOut == BSP_SerTxIn) {
+        USART2->CR1 &= ~USART_TXEIE;
+    } else if (USART2->SR & USART_TXE) {
+        USART2->DR   = BSP_SerTxBuf[BSP_SerTxOut];
+        BSP_SerTxOut = (BSP_SerTxOut + 1) % BSP_SER_TX_BUF_SIZE;
+        BSP_SerTxSent++;
+    }
+    CPU_CRITICAL_EXIT();
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_TxWait()
+*
+* Description : Wait until the TX ring has room for a number of bytes.
+*
+* Argument(s) : need          Bytes of room wanted.
+*
+*               start         OSTimeGet() or BSP_SerTxSent when the write began.
+*
+*               timeout_ms    Longest wait from start; BSP_SER_NO_WAIT or BSP_SER_WAIT_FOREVER.
+*
+* Return(s)   : DEF_OK if the room is there, DEF_FAIL on timeout.
+*
+* Note(s)     : (1) With the OS running, the writer pends on BSP_SerTxSem and other tasks run meanwhile.
+*
+*               (2) Without it, the writer sends bytes itself while it waits, in case interrupts are off,
+*                   and measures the timeout in bytes sent: one takes BSP_SER_BITS_PER_BYTE bit times.
+*********************************************************************************************************
+*/
+
+static  CPU_BOOLEAN  BSP_Ser_TxWait (CPU_INT16U  need,
+                                     CPU_INT32U  start,
+                                     CPU_INT32U  timeout_ms)
+{
+    CPU_INT32U  limit;
+    OS_TICK     elapsed;
+    OS_TICK     ticks;
+    OS_ERR      err;
+    CPU_SR_ALLOC();
+
+
+    if (BSP_Ser_TxFree() >= need) {
+        return (DEF_OK);
+    }
+    if (timeout_ms == BSP_SER_NO_WAIT) {
+        return (DEF_FAIL);
+    }
+
+    if (BSP_SerOS_Ready != DEF_TRUE) {
+        limit = (CPU_INT32U)(((CPU_INT64U)timeout_ms * BSP_SerBaud) / (1000u * BSP_SER_BITS_PER_BYTE));
+        while (BSP_Ser_TxFree() < need) {
+            if ((timeout_ms != BSP_SER_WAIT_FOREVER) && (BSP_SerTxSent - start >= limit)) {
+                return (DEF_FAIL);
+            }
+            BSP_Ser_TxSend();
+        }
+        return (DEF_OK);
+    }
+
+    ticks = (timeout_ms == BSP_SER_WAIT_FOREVER) ? 0
+          : (OS_TICK)(((CPU_INT64U)timeout_ms * OSCfg_TickRate_Hz + 999u) / 1000u);
+    for (;;) {
+        CPU_CRITICAL_ENTER();                                   /* Ask the ISR for a post, unless the room came already */
+        if (BSP_Ser_TxFree() >= need) {
+            BSP_SerTxWant = 0;
+            CPU_CRITICAL_EXIT();
+            return (DEF_OK);
+        }
+        BSP_SerTxWant = need;
+        CPU_CRITICAL_EXIT();
+
+        if (ticks != 0) {
+            elapsed = OSTimeGet(&err) - (OS_TICK)start;
+            if (elapsed >= ticks) {
+                BSP_SerTxWant = 0;
+                return (DEF_FAIL);
+            }
+            OSSemPend(&BSP_SerTxSem, ticks - elapsed, OS_OPT_PEND_BLOCKING, (CPU_TS *)0, &err);
+        } else {
+            OSSemPend(&BSP_SerTxSem, 0, OS_OPT_PEND_BLOCKING, (CPU_TS *)0, &err);
+        }
+    }
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_TxPut()
+*
+* Description : Queue one byte, waiting for room, and make sure the TXE interrupt will send it.
+*
+* Argument(s) : c             The byte.
+*
+*               start         As BSP_Ser_TxWait().
+*
+*               timeout_ms    As BSP_Ser_TxWait().
+*
+* Return(s)   : DEF_OK, or DEF_FAIL if there was no room in time.
+*********************************************************************************************************
+*/
+
+static  CPU_BOOLEAN  BSP_Ser_TxPut (CPU_INT08U  c,
+                                    CPU_INT32U  start,
+                                    CPU_INT32U  timeout_ms)
+{
+    CPU_SR_ALLOC();
+
+
+    if (BSP_Ser_TxWait(1, start, timeout_ms) != DEF_OK) {
+        return (DEF_FAIL);
+    }
+    BSP_SerTxBuf[BSP_SerTxIn] = c;
+
+    CPU_CRITICAL_ENTER();
+    BSP_SerTxIn  = (BSP_SerTxIn + 1) % BSP_SER_TX_BUF_SIZE;
+    USART2->CR1 |= USART_TXEIE;
+    CPU_CRITICAL_EXIT();
+    return (DEF_OK);
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_TxStr()
+*
+* Description : Queue a string, each '\n' as "\r\n". The caller holds the lock.
+*
+* Argument(s) : p_str         The string.
+*
+*               timeout_ms    Longest wait for room; BSP_SER_NO_WAIT or BSP_SER_WAIT_FOREVER.
+*
+* Return(s)   : DEF_OK, or DEF_FAIL if it did not go in time.
+*
+* Note(s)     : (1) A string that fits the ring goes whole or not at all. A longer one goes in pieces as
+*                   room comes, and a timeout can cut it short.
+*********************************************************************************************************
+*/
+
+static  CPU_BOOLEAN  BSP_Ser_TxStr (CPU_CHAR    *p_str,
+                                    CPU_INT32U   timeout_ms)
+{
+    CPU_CHAR     *p;
+    CPU_INT32U    len;
+    CPU_INT32U    start;
+    CPU_BOOLEAN   ok;
+    OS_ERR        err;
+
+
+    start = (BSP_SerOS_Ready == DEF_TRUE) ? (CPU_INT32U)OSTimeGet(&err) : BSP_SerTxSent;
+
+    len = 0;
+    for (p = p_str; *p != (CPU_CHAR)0; p++) {
+        len += (*p == ASCII_CHAR_LINE_FEED) ? 2 : 1;
+    }
+    ok = DEF_OK;
+    if (len < BSP_SER_TX_BUF_SIZE) {
+        ok = BSP_Ser_TxWait((CPU_INT16U)len, start, timeout_ms);
+    }
+
+    for (p = p_str; (ok == DEF_OK) && (*p != (CPU_CHAR)0); p++) {
+        if (*p == ASCII_CHAR_LINE_FEED) {
+            ok = BSP_Ser_TxPut(ASCII_CHAR_CARRIAGE_RETURN, start, timeout_ms);
+            if (ok == DEF_OK) {
+                ok = BSP_Ser_TxPut(ASCII_CHAR_LINE_FEED, start, timeout_ms);
+            }
+        } else {
+            ok = BSP_Ser_TxPut(*p, start, timeout_ms);
+        }
+    }
+    if (ok != DEF_OK) {
+        BSP_SerTxDropped++;
+    }
+    return (ok);
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_VPrintfTmo()
+*
+* Description : Format into the shared buffer and queue the result, holding the lock throughout.
+*********************************************************************************************************
+*/
+
+static  CPU_BOOLEAN  BSP_Ser_VPrintfTmo (CPU_INT32U   timeout_ms,
+                                         CPU_CHAR    *format,
+                                         va_list      vArgs)
+{
+    static  CPU_CHAR     buffer[BSP_SER_PRINTF_SIZE + 1];
+            CPU_BOOLEAN  ok;
+
+
+    if (BSP_Ser_Lock(timeout_ms) != DEF_OK) {
+        BSP_SerTxDropped++;
+        return (DEF_FAIL);
+    }
+    vsnprintf((char *)buffer, sizeof(buffer), (char const *)format, vArgs);
+    ok = BSP_Ser_TxStr(buffer, timeout_ms);
+    BSP_Ser_Unlock();
+    return (ok);
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_Lock()
+*
+* Description : Keep other tasks' output out until BSP_Ser_Unlock(). Does nothing before the OS runs.
+*
+* Argument(s) : timeout_ms    Longest wait for the lock; BSP_SER_NO_WAIT or BSP_SER_WAIT_FOREVER.
+*
+* Return(s)   : DEF_OK, or DEF_FAIL if another task held the lock too long.
+*
+* Note(s)     : (1) The mutex and semaphore are created on first use by a task, so BSP_Ser_Init() may be
+*                   called before OSInit(), or by an application that never starts the OS.
+*********************************************************************************************************
+*/
+
+static  CPU_BOOLEAN  BSP_Ser_Lock (CPU_INT32U  timeout_ms)
+{
+    OS_OPT  opt;
+    OS_TICK ticks;
+    OS_ERR  err;
+
+
+    if (OSRunning != OS_STATE_OS_RUNNING) {
+        return (DEF_OK);
+    }
+    if (BSP_SerOS_Ready != DEF_TRUE) {
+        OSSchedLock(&err);
+        if (BSP_SerOS_Ready != DEF_TRUE) {
+            OSMutexCreate(&BSP_SerTxMutex, "BSP Ser Tx Mutex", &err);
+            OSSemCreate(&BSP_SerTxSem, "BSP Ser Tx Room", 0, &err);
+            BSP_SerOS_Ready = DEF_TRUE;
+        }
+        OSSchedUnlock(&err);
+    }
+
+    opt   = (timeout_ms == BSP_SER_NO_WAIT) ? OS_OPT_PEND_NON_BLOCKING : OS_OPT_PEND_BLOCKING;
+    ticks = (timeout_ms == BSP_SER_WAIT_FOREVER || timeout_ms == BSP_SER_NO_WAIT) ? 0
+          : (OS_TICK)(((CPU_INT64U)timeout_ms * OSCfg_TickRate_Hz + 999u) / 1000u);
+    OSMutexPend(&BSP_SerTxMutex, ticks, opt, (CPU_TS *)0, &err);
+    return ((err == OS_ERR_NONE) ? DEF_OK : DEF_FAIL);
+}
+
+
+/*
+*********************************************************************************************************
+*                                          BSP_Ser_Unlock()
+*
+* Description : Let the next task's output in.
+*********************************************************************************************************
+*/
+
+static  void  BSP_Ser_Unlock (void)
+{
+    OS_ERR  err;
+
+
+    if (BSP_SerOS_Ready == DEF_TRUE && OSRunning == OS_STATE_OS_RUNNING) {
+        OSMutexPost(&BSP_SerTxMutex, OS_OPT_POST_NONE, &err);
+    }
 }
 
 
@@ -156,9 +536,8 @@ void  BSP_Ser_Init (CPU_INT32U  baud_rate)
 *                                                BSP_Ser_Printf()
 *
 * Description : Formatted outout to the serial port.
-*               This funcion reads a string from a serial port. This call blocks until a
-*               character appears at the port and the last character is a Carriage
-*               Return (0x0D).
+*               The output is queued for the USART2 interrupt to send; this call only waits
+*               while the TX ring has no room for it.
 *
 * Argument(s) : Format string follwing the C format convention.
 *
@@ -166,21 +545,50 @@ void  BSP_Ser_Init (CPU_INT32U  baud_rate)
 *
 * Caller(s)   : Application
 *
-* Note(s)     : none.
+* Note(s)     : (1) Output past BSP_SER_PRINTF_SIZE characters is cut off.
 *********************************************************************************************************
 */
 
 void  BSP_Ser_Printf (CPU_CHAR *format, ...)
 {
-    static  CPU_CHAR  buffer[80 + 1];
-            va_list   vArgs;
+    va_list   vArgs;
 
 
     va_start(vArgs, format);
-    vsprintf((char *)buffer, (char const *)format, vArgs);
+    BSP_Ser_VPrintfTmo(BSP_SER_WAIT_FOREVER, format, vArgs);
     va_end(vArgs);
+}
+
+
+/*
+*********************************************************************************************************
+*                                                BSP_Ser_PrintfTmo()
+*
+* Description : Formatted output to the serial port, waiting no longer than a timeout for room.
+*
+* Argument(s) : timeout_ms    Longest wait, for the lock and then for room: BSP_SER_NO_WAIT to drop
+*                             the output at once if it does not fit, BSP_SER_WAIT_FOREVER to block.
+*
+*               format        Format string follwing the C format convention.
+*
+* Return(s)   : DEF_OK if the output was queued, DEF_FAIL if it was dropped.
+*
+* Caller(s)   : Application
+*
+* Note(s)     : none.
+*********************************************************************************************************
+*/
+
+CPU_BOOLEAN  BSP_Ser_PrintfTmo (CPU_INT32U  timeout_ms, CPU_CHAR *format, ...)
+{
+    CPU_BOOLEAN  ok;
+    va_list      vArgs;
 
-    BSP_Ser_WrStr((CPU_CHAR*) buffer);
+
+    va_start(vArgs, format);
+    ok = BSP_Ser_VPrintfTmo(timeout_ms, format, vArgs);
+    va_end(vArgs);
+    return (ok);
 }
 
 
@@ -293,18 +701,20 @@ void  BSP_Ser_RdStr (CPU_CHAR    *p_str,
 *
 * Caller(s)   : Application.
 *
-* Note(s)     : none.
+* Note(s)     : (1) Queued behind any earlier output; blocks only while the TX ring is full.
 *********************************************************************************************************
 */
 
 void  BSP_Ser_WrByte(CPU_INT08U  c)
 {
-    CPU_REG32  status;
+    OS_ERR      err;
+    CPU_INT32U  start;
 
-    while (!(USART2->SR &  USART_TXE))
-      ;
 
-    USART2->DR = c;
+    BSP_Ser_Lock(BSP_SER_WAIT_FOREVER);
+    start = (BSP_SerOS_Ready == DEF_TRUE) ? (CPU_INT32U)OSTimeGet(&err) : BSP_SerTxSent;
+    BSP_Ser_TxPut(c, start, BSP_SER_WAIT_FOREVER);
+    BSP_Ser_Unlock();
 }
 
 /*
@@ -319,22 +729,61 @@ void  BSP_Ser_WrByte(CPU_INT08U  c)
 *
 * Return(s)   : none.
 *
-* Note(s)     : none.
+* Note(s)     : (1) Queued whole for the USART2 interrupt; blocks only while the TX ring has no room.
 *********************************************************************************************************
 */
 
 void  BSP_Ser_WrStr (CPU_CHAR  *p_str)
 {
-    while ((*p_str) != (CPU_CHAR )0) {
+    BSP_Ser_WrStrTmo(p_str, BSP_SER_WAIT_FOREVER);
+}
+
+/*
+*********************************************************************************************************
+*                                                BSP_Ser_WrStrTmo()
+*
+* Description : Transmits a string, waiting no longer than a timeout for room.
+*
+* Argument(s) : p_str         Pointer to the string that will be transmitted
+*
+*               timeout_ms    As BSP_Ser_PrintfTmo().
+*
+* Caller(s)   : Application
+*
+* Return(s)   : DEF_OK if the string was queued, DEF_FAIL if it was dropped.
+*
+* Note(s)     : (1) A string longer than the TX ring may be cut short instead.
+*********************************************************************************************************
+*/
+
+CPU_BOOLEAN  BSP_Ser_WrStrTmo (CPU_CHAR  *p_str, CPU_INT32U  timeout_ms)
+{
+    CPU_BOOLEAN  ok;
 
-        if (*p_str == ASCII_CHAR_LINE_FEED) {
-            BSP_Ser_WrByte(ASCII_CHAR_CARRIAGE_RETURN);
-            BSP_Ser_WrByte(ASCII_CHAR_LINE_FEED);
-            p_str++;
-        } else {
-            BSP_Ser_WrByte(*p_str++);
-        }
+
+    if (BSP_Ser_Lock(timeout_ms) != DEF_OK) {
+        BSP_SerTxDropped++;
+        return (DEF_FAIL);
     }
+    ok = BSP_Ser_TxStr(p_str, timeout_ms);
+    BSP_Ser_Unlock();
+    return (ok);
+}
+
+/*
+*********************************************************************************************************
+*                                                BSP_Ser_TxDroppedCtr()
+*
+* Description : Number of writes dropped or cut short on a timeout since BSP_Ser_Init().
+*
+* Argument(s) : none.
+*
+* Return(s)   : The count.
+*********************************************************************************************************
+*/
 
+CPU_INT32U  BSP_Ser_TxDroppedCtr (void)
+{
+    return (BSP_SerTxDropped);
 }
 
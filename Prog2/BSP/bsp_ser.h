@@ -65,6 +65,9 @@
 #define  BSP_SER_COMM_UART_NONE                0xFF
 #define  BSP_SER_COMM_UART_02                     2
 
+#define  BSP_SER_NO_WAIT                          0u            /* Timeouts: drop output that does not fit now          */
+#define  BSP_SER_WAIT_FOREVER            0xFFFFFFFFu            /*           block until it fits                        */
+
 
 /*
 *********************************************************************************************************
@@ -124,9 +127,16 @@ void         BSP_Ser_RdStr  (CPU_CHAR    *p_str,
 
 void         BSP_Ser_WrByte (CPU_INT08U   c);
 void         BSP_Ser_WrStr  (CPU_CHAR     *p_str);
+CPU_BOOLEAN  BSP_Ser_WrStrTmo(CPU_CHAR    *p_str,
+                             CPU_INT32U   timeout_ms);
 
 void         BSP_Ser_Printf (CPU_CHAR     *format,
                              ...);
+CPU_BOOLEAN  BSP_Ser_PrintfTmo(CPU_INT32U  timeout_ms,
+                             CPU_CHAR     *format,
+                             ...);
+
+CPU_INT32U   BSP_Ser_TxDroppedCtr(void);
 
 
 
@@ -0,0 +1,59 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 4   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			         Coro.h
+-----------------------------------------------------------------------
+Stackless coroutines (protothreads). A coroutine is an ordinary
+function that keeps where it is waiting in a CoroLc, its local
+continuation, and returns to the executive instead of blocking:
+
+    static CoroLc lc;
+
+    CPU_VOID Task(CPU_VOID){
+        CoroBegin(&lc);
+        for(;;){
+            CoroAwait(&lc, (c = GetByte()) >= 0);
+            ...
+        }
+        CoroEnd(&lc);
+    }
+
+The next call jumps straight back to the CoroAwait() it returned from
+and tests its condition again. The whole state of a waiting coroutine
+is its CoroLc (2 bytes) and its statics: locals do NOT survive an
+await, so anything used across one must be static. An await cannot be
+inside a switch of the coroutine's own, and only one can be on a line.
+*/
+
+#ifndef CORO_H
+#define CORO_H
+
+#include "includes.h"
+
+typedef CPU_INT16U CoroLc;      // Line of the await a coroutine is in, 0 at the top
+
+//An await falls into its own case label on purpose; say so to gcc's
+//-Wimplicit-fallthrough. IAR takes the empty statement.
+#if defined(__GNUC__) && __GNUC__ >= 7
+#define CoroFallThrough __attribute__((fallthrough))
+#else
+#define CoroFallThrough
+#endif
+
+//Start of a coroutine's body: resume where it left off.
+#define CoroBegin(lc) switch(*(lc)){ case 0:
+
+//Return until cond is true, then go on from here.
+#define CoroAwait(lc, cond) \
+    *(lc) = __LINE__; CoroFallThrough; case __LINE__: \
+    if(!(cond)) return
+
+//End of a coroutine's body. Falling off it starts again at the top.
+#define CoroEnd(lc) } *(lc) = 0
+
+//Start a coroutine again from the top.
+#define CoroReset(lc) (*(lc) = 0)
+
+#endif
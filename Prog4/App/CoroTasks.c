@@ -0,0 +1,113 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 4   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			       CoroTasks.c
+-----------------------------------------------------------------------
+The coroutine tasks. What each waits for, and who readies it:
+
+    Parser    an open payload write buffer   payload task, on taking one
+              a byte in iBfr                 Rx interrupt
+    Payload   a closed payload read buffer   parser, on closing one
+              an open reply write buffer     reply task, on emptying one
+    Reply     a closed reply read buffer     payload task, on closing one
+              room in oBfr                   Tx interrupt
+
+Everything a coroutine keeps across an await is static (Coro.h).
+*/
+
+#include "CoroTasks.h"
+#include "Coro.h"
+#include "Exec.h"
+#include "Parser.h"
+#include "Payload.h"
+#include "Reply.h"
+#include "SerIODriver.h"
+
+//----- g l o b a l    v a r i a b l e s -----
+static BfrQ *payloadQ;          // Payload buffer queue
+static BfrQ *replyQ;            // Reply buffer queue
+static CoroLc parserLc;         // Where each coroutine is waiting
+static CoroLc payloadLc;
+static CoroLc replyLc;
+
+/*-------------------- C o r o T a s k s I n i t ( ) -------------------------------------
+	Purpose:	Hand the coroutines to the executive, each at its top.
+        Parameters:     the payload and reply buffer queues, from PayloadInit()
+*/
+CPU_VOID CoroTasksInit(BfrQ *payloadBfrQ, BfrQ *replyBfrQ){
+    payloadQ = payloadBfrQ;
+    replyQ = replyBfrQ;
+    CoroReset(&parserLc);
+    CoroReset(&payloadLc);
+    CoroReset(&replyLc);
+    ExecInit(ExecParser, ParserCoro);
+    ExecInit(ExecPayload, PayloadCoro);
+    ExecInit(ExecReply, ReplyCoro);
+}
+
+/*-------------------- P a r s e r C o r o ( ) -------------------------------------
+	Purpose:	Parse bytes from iBfr into the payload buffer queue.
+*/
+CPU_VOID ParserCoro(CPU_VOID){
+    static Payload parserPayload;
+    static CPU_INT16S nextByte;
+
+    CoroBegin(&parserLc);
+    for(;;){
+        CoroAwait(&parserLc, !BfrQWriteClosed(payloadQ));
+        CoroAwait(&parserLc, (nextByte = GetByte()) >= 0);
+        if(ParseByte(&parserPayload, (CPU_INT08U)nextByte)){
+            LoadPayloadBfrQ(payloadQ, &parserPayload);
+            ExecReady(ExecPayload);
+        }
+    }
+    CoroEnd(&parserLc);
+}
+
+/*-------------------- P a y l o a d C o r o ( ) -------------------------------------
+	Purpose:	Turn each payload into a reply message in the reply buffer queue.
+*/
+CPU_VOID PayloadCoro(CPU_VOID){
+    static Payload payload;
+    static CPU_CHAR message[BfrQSize];
+
+    CoroBegin(&payloadLc);
+    for(;;){
+        CoroAwait(&payloadLc, BfrQReadClosed(payloadQ));
+        CoroAwait(&payloadLc, !BfrQWriteClosed(replyQ));
+
+        ConstructPayload(&payload);
+        ExecReady(ExecParser);          // Its payload buffer is open again
+
+        if(ConstructMessage(&payload, message)){
+            ReplyPutMsg(replyQ, message);
+            BfrQCloseWrite(replyQ);
+        }else
+            ReplyError(replyQ, message);
+        ExecReady(ExecReply);
+    }
+    CoroEnd(&payloadLc);
+}
+
+/*-------------------- R e p l y C o r o ( ) -------------------------------------
+	Purpose:	Send each reply message out through oBfr.
+*/
+CPU_VOID ReplyCoro(CPU_VOID){
+    static CPU_INT16S c;
+
+    CoroBegin(&replyLc);
+    for(;;){
+        CoroAwait(&replyLc, BfrQReadClosed(replyQ));
+
+        //Take a byte off the message only once oBfr has taken it
+        while((c = BfrQNextByte(replyQ)) >= 0){
+            CoroAwait(&replyLc, PutByte(c) >= 0);
+            BfrQRemByte(replyQ);
+        }
+        BfrQOpenRead(replyQ);
+        ExecReady(ExecPayload);         // Its reply buffer is open again
+    }
+    CoroEnd(&replyLc);
+}
@@ -0,0 +1,28 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 4   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			       CoroTasks.h
+-----------------------------------------------------------------------
+The parser, payload and reply tasks as coroutines (Coro.h) for the
+ready-bitmap executive (Exec.h). Each does the same work as Parser(),
+PayloadTask() and Reply(), but waits at an explicit await until its
+byte, buffer or space is there, and readies the task it has given work
+or room to. Unlike Parser(), the parser coroutine waits for an open
+payload buffer before it takes the next byte, so no byte is dropped.
+*/
+
+#ifndef COROTASKS_H
+#define COROTASKS_H
+
+#include "includes.h"
+#include "BfrQ.h"
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID CoroTasksInit(BfrQ *payloadBfrQ, BfrQ *replyBfrQ);
+CPU_VOID ParserCoro(CPU_VOID);
+CPU_VOID PayloadCoro(CPU_VOID);
+CPU_VOID ReplyCoro(CPU_VOID);
+
+#endif
@@ -0,0 +1,92 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 4   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			         Exec.c
+-----------------------------------------------------------------------
+The ready-bitmap executive. Bit n of ready is set when task n should be
+resumed; the serial interrupt sets bits too, so the bitmap is only
+changed with interrupts off. A task's bit is cleared before the task is
+resumed, so an ExecReady() while it runs brings it back again.
+*/
+
+#include "Exec.h"
+#include "Intrpt.h"
+
+//----- g l o b a l    v a r i a b l e s -----
+static volatile CPU_INT08U ready;       // Bit n set: task n is ready
+static ExecFnct tasks[NumExecTasks];    // Each task's coroutine
+static CPU_INT32U resumes;              // Coroutine calls
+
+/*-------------------- E x e c I n i t ( ) -------------------------------------
+	Purpose:	Give a task its coroutine. The task is not ready until
+                        ExecReady() says so.
+*/
+CPU_VOID ExecInit(ExecTask task, ExecFnct fnct){
+    tasks[task] = fnct;
+}
+
+/*-------------------- E x e c R e a d y ( ) -------------------------------------
+	Purpose:	Mark a task ready to be resumed. Safe from the interrupt.
+*/
+CPU_VOID ExecReady(ExecTask task){
+    IntDis();
+    ready |= (CPU_INT08U)(1 << task);
+    IntEn();
+}
+
+/*-------------------- E x e c R u n R e a d y ( ) -------------------------------------
+	Purpose:	Resume the ready tasks, highest priority first, until none is
+                        ready. A task readied while another runs is taken in turn.
+        Return:         TRUE if any task was resumed
+*/
+CPU_BOOLEAN ExecRunReady(CPU_VOID){
+    CPU_BOOLEAN ran = FALSE;
+    CPU_INT08U task;
+
+    for(;;){
+        IntDis();
+        if(ready == 0){
+            IntEn();
+            return ran;
+        }
+        for(task = 0; !(ready & (1 << task)); task++)
+            ;
+        ready &= (CPU_INT08U)~(1 << task);
+        IntEn();
+
+        resumes++;
+        ran = TRUE;
+        tasks[task]();
+    }
+}
+
+/*-------------------- E x e c R e s u m e s ( ) -------------------------------------
+	Purpose:	Return how many times a coroutine has been resumed.
+*/
+CPU_INT32U ExecResumes(CPU_VOID){
+    return resumes;
+}
+
+#ifndef ExecSimulated
+
+/*-------------------- E x e c R u n ( ) -------------------------------------
+	Purpose:	The executive loop: run the ready tasks, then sleep until an
+                        interrupt. The test and the wfi are made with interrupts
+                        off, so an interrupt that readies a task between them
+                        still wakes the CPU (wfi wakes on a pending interrupt
+                        even when masked) and is taken once they are back on.
+*/
+CPU_VOID ExecRun(CPU_VOID){
+    for(;;){
+        ExecRunReady();
+
+        IntDis();
+        if(ready == 0)
+            asm(" wfi");
+        IntEn();
+    }
+}
+
+#endif
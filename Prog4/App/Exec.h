@@ -0,0 +1,44 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 4   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			         Exec.h
+-----------------------------------------------------------------------
+A ready-bitmap executive for the coroutine tasks (Coro.h). Instead of
+calling every task every pass, as the round robin loop does, it
+resumes only the tasks marked ready, highest priority first. A task is
+made ready by whatever can end its wait: the serial interrupt readies
+the parser when a byte arrives and the reply task when there is room
+to send, and the tasks ready each other as buffers change hands.
+
+A task resumed without being able to go on just awaits again, so a
+spare ExecReady() costs one call, but a missing one leaves the task
+asleep: every event that can end a wait must ready its waiter. With
+nothing ready the CPU sleeps (wfi) until an interrupt.
+
+Define ExecSimulated (the host tools' HostOS.h does) to leave out
+ExecRun(); the host drives ExecRunReady() itself.
+*/
+
+#ifndef EXEC_H
+#define EXEC_H
+
+#include "includes.h"
+
+//The tasks, highest priority first
+typedef enum {ExecParser, ExecPayload, ExecReply, NumExecTasks} ExecTask;
+
+typedef CPU_VOID (*ExecFnct)(CPU_VOID);
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID ExecInit(ExecTask task, ExecFnct fnct);
+CPU_VOID ExecReady(ExecTask task);
+CPU_BOOLEAN ExecRunReady(CPU_VOID);
+CPU_INT32U ExecResumes(CPU_VOID);
+
+#ifndef ExecSimulated
+CPU_VOID ExecRun(CPU_VOID);
+#endif
+
+#endif
@@ -26,10 +26,13 @@ CHANGES
 #include "Parser.h"
 #include "SerIODriver.h"
 #include "Intrpt.h"
+#include "Exec.h"
+#include "CoroTasks.h"
 
 //#define TXTEST
 //#define RXTEST
 #define NOTEST
+//#define COROEXEC
 
 /*----- c o n s t a n t    d e f i n i t i o n s -----*/
 
@@ -156,3 +159,33 @@ CPU_VOID AppMain(CPU_VOID)
     }
 }
 #endif
+
+#ifdef COROEXEC
+CPU_VOID AppMain(CPU_VOID)
+{
+    // Payload and Reply buffer queue pointers
+    BfrQ *payloadBfrQ;
+    BfrQ *replyBfrQ;
+    
+    // Initialize the circular buffers iBfr and oBfr. Also unmask the Rx and Tx
+    // interrupts and enable IRQ38.
+    InitSerIO();
+    
+    // Turn on global interrupt enable.
+    IntEn();
+    
+    // Initialize the Payload and Reply buffer queues and return their addresses.
+    PayloadInit(&payloadBfrQ, &replyBfrQ);
+    
+    // Hand the parser, payload and reply coroutines to the executive and let
+    // each run once to reach its first await.
+    CoroTasksInit(payloadBfrQ, replyBfrQ);
+    ExecReady(ExecParser);
+    ExecReady(ExecPayload);
+    ExecReady(ExecReply);
+    
+    // Coroutine Executive Loop: Only the tasks readied by an interrupt or by
+    // another task are resumed, highest priority first; otherwise the CPU sleeps.
+    ExecRun();
+}
+#endif
@@ -8,6 +8,7 @@
 
 #include "SerIODriver.h"
 #include "Bfr.h"
+#include "Exec.h"
 
 // If not already defined, use the default buffer size of 4.
 #ifndef BfrSize
@@ -32,7 +33,7 @@ static CPU_INT08U oBfrSpace[BfrSize];
 #define MASK_TX() (USART2->CR1 &= ~USART_TXEIE)
 #define UNMASK_TX() (USART2->CR1 |= USART_TXEIE)
 #define MASK_RX() (USART2->CR1 &= ~USART_RXNEIE)
-#define UNMASK_RX() (USART2->CR1 |= USART_TXEIE)
+#define UNMASK_RX() (USART2->CR1 |= USART_RXNEIE)
 
 /*-------------------- I n i t S e r I O ( ) -------------------------------------
 	Purpose:	Initialize the RS232 I/O driver by initializing both iBfr and oBfr.
@@ -110,14 +111,16 @@ CPU_INT16S GetByte(CPU_VOID){
 	Purpose:	If TXE = 1 and oBfr is not empty, then output one byte to the UART
                         Tx and return. If TXE = 0, just return.
                         [If the get buffer (iBfr) is empty, mask the Tx and return]
+                        Sending a byte makes room in oBfr, so the reply task is readied.
         Parameters:     None
         Return Value:   None
 */
 CPU_VOID ServiceTx(CPU_VOID){
     if (USART2->SR & USART_TXE)
-        if (!BfrEmpty(&oBfr))
+        if (!BfrEmpty(&oBfr)){
             USART2->DR = (CPU_INT08U)BfrRemByte(&oBfr);
-        else
+            ExecReady(ExecReply);
+        }else
             MASK_TX();
   return;
 } 
@@ -126,14 +129,16 @@ CPU_VOID ServiceTx(CPU_VOID){
 	Purpose:	if RXNE = 1 and the iBfr is not full, then read a byte from the UART Rx
                         and add it to the iBfr. If RXNE = 0, return.
                         [If oBfr is full, mask the Rx interrupt and return.]
+                        A byte received readies the parser task.
         Parameters:     None
         Return Value:   None
 */
 CPU_VOID ServiceRx(CPU_VOID){
   if (USART2->SR & USART_RXNE)
-        if (!BfrFull(&iBfr))
+        if (!BfrFull(&iBfr)){
             BfrAddByte(&iBfr, (CPU_INT16S)USART2->DR);
-        else
+            ExecReady(ExecParser);
+        }else
             MASK_RX();
   return;
 }
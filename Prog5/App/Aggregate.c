@@ -0,0 +1,168 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Aggregate.c
+-----------------------------------------------------------------------
+Windowed aggregation. Every node slot (see NodeCache) has one
+accumulator per reading type per window length. A reading only touches
+its one minute accumulator, so an update costs the same however many
+nodes there are. When a one minute window closes its accumulators are
+folded into the ten minute ones, and those into the hour ones when the
+ten minutes are up. Date/time stamps are not summarized.
+
+With the defaults (16 nodes) the accumulators take about 5 KB of RAM.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "Aggregate.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define MaxCatchUp 60         // Windows closed one at a time after a long gap
+
+//Length of each level's window, in shortest windows.
+static const CPU_INT32U LevelSpan[AggLevels] = {1, 10, 60};
+
+//Report names of the levels, for the default AggWindowTicks.
+static const CPU_CHAR *LevelName[AggLevels] = {"1m", "10m", "1h"};
+
+//----- g l o b a l    v a r i a b l e s -----
+static AggAcc accs[NodeCacheNodes][NumRdgTypes][AggLevels];
+static CPU_INT32U windowNum;  // Number of the shortest window now open
+
+/*-------------------- A c c R e s e t ( ) -------------------------------------
+	Purpose:	Empty an accumulator.
+*/
+static CPU_VOID AccReset(AggAcc *acc){
+    acc->count = 0;
+    acc->sum = 0;
+}
+
+/*-------------------- A g g r e g a t e I n i t ( ) -------------------------------------
+	Purpose:	Empty every accumulator and start the first window.
+        Parameters:     current time in ticks
+*/
+CPU_VOID AggregateInit(CPU_INT32U now){
+    memset(accs, 0, sizeof(accs));
+    windowNum = now / AggWindowTicks;
+}
+
+/*-------------------- A g g r e g a t e U p d a t e ( ) -------------------------------------
+	Purpose:	Add a reading to its node's one minute accumulator. The node must
+                        already have a NodeCache slot; readings from other nodes are ignored.
+        Parameters:     node number, message type, fixed point reading
+        Return:         TRUE if the reading was added
+*/
+CPU_BOOLEAN AggregateUpdate(CPU_INT32U node, CPU_CHAR msgType, CPU_INT32S value){
+    ReadingType type = ReadingIndex(msgType);
+    NodeSlot slot = NodeCacheSlot(node);
+    AggAcc *acc;
+
+    if(slot == 0 || type == NumRdgTypes || type == RdgD)
+        return FALSE;
+
+    acc = &accs[slot - 1][type][0];
+    if(acc->count == 0){
+        acc->min = value;
+        acc->max = value;
+    }else{
+        if(value < acc->min) acc->min = value;
+        if(value > acc->max) acc->max = value;
+    }
+    acc->sum += value;
+    acc->count++;
+    return TRUE;
+}
+
+/*-------------------- C l o s e L e v e l ( ) -------------------------------------
+	Purpose:	Report every non-empty accumulator of one window length, fold it
+                        into the next longer window and empty it.
+        Parameters:     level closing, time it closed, report function
+*/
+static CPU_VOID CloseLevel(CPU_INT08U level, CPU_INT32U end, AggEmit emit){
+    CPU_INT32U slot, type;
+    AggSummary summary;
+
+#if AggReportFrom > 0
+    if(level < AggReportFrom)
+        emit = NULL;          //Only folded into the longer windows
+#endif
+    summary.level = level;
+    summary.end = end;
+    for(slot = 0; slot < NodeCacheUsed(); slot++){
+        for(type = 0; type < NumRdgTypes; type++){
+            AggAcc *acc = &accs[slot][type][level];
+
+            if(acc->count == 0)
+                continue;
+
+            if(level + 1 < AggLevels){
+                AggAcc *up = &accs[slot][type][level + 1];
+
+                if(up->count == 0){
+                    up->min = acc->min;
+                    up->max = acc->max;
+                }else{
+                    if(acc->min < up->min) up->min = acc->min;
+                    if(acc->max > up->max) up->max = acc->max;
+                }
+                up->sum += acc->sum;
+                up->count += acc->count;
+            }
+
+            if(emit != NULL){
+                summary.node = NodeCacheNode((NodeSlot)(slot + 1));
+                summary.msgType = ReadingTypeChar((ReadingType)type);
+                summary.min = acc->min;
+                summary.max = acc->max;
+                summary.count = acc->count;
+                //Round half away from zero
+                summary.mean = (acc->sum + (acc->sum < 0 ? -(CPU_INT32S)acc->count : (CPU_INT32S)acc->count) / 2)
+                               / (CPU_INT32S)acc->count;
+                emit(&summary);
+            }
+            AccReset(acc);
+        }
+    }
+}
+
+/*-------------------- A g g r e g a t e T i c k ( ) -------------------------------------
+	Purpose:	Close every window that has ended by now. Call this often enough
+                        that windows close on time, whether or not readings arrive.
+        Parameters:     current time in ticks, report function (NULL to discard)
+*/
+CPU_VOID AggregateTick(CPU_INT32U now, AggEmit emit){
+    CPU_INT32U current = now / AggWindowTicks;
+    CPU_INT32U closes = current - windowNum;
+    CPU_INT08U level;
+
+    //After a long gap (or the tick counter wrapping) everything still
+    //open is reported once and the windows restart from now.
+    if(current < windowNum || closes > MaxCatchUp){
+        for(level = 0; level < AggLevels; level++)
+            CloseLevel(level, now, emit);
+        windowNum = current;
+        return;
+    }
+
+    while(windowNum != current){
+        CPU_INT32U ended = windowNum++;
+
+        for(level = 0; level < AggLevels; level++){
+            if((ended + 1) % LevelSpan[level] != 0)
+                break;
+            CloseLevel(level, (ended + 1) * AggWindowTicks, emit);
+        }
+    }
+}
+
+/*-------------------- A g g r e g a t e F o r m a t ( ) -------------------------------------
+	Purpose:	Format a summary record in the style of the reading replies.
+*/
+CPU_VOID AggregateFormat(const AggSummary *summary, CPU_CHAR *message){
+    sprintf(message, "\nN%u %c %s n=%u lo=%d hi=%d av=%d\n",
+            (unsigned)summary->node, summary->msgType, LevelName[summary->level],
+            (unsigned)summary->count, (int)summary->min, (int)summary->max, (int)summary->mean);
+}
@@ -0,0 +1,69 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Aggregate.h
+-----------------------------------------------------------------------
+Windowed summaries of the readings from each node: count, minimum,
+maximum and mean over one minute, ten minute and one hour windows.
+A summary record is handed to the caller as each window closes.
+
+By default only the summaries of the ten minute and one hour windows
+are sent, not every reading: define AggregateOnly 0 to send every
+reading as well, and AggReportFrom 0 to send the one minute summaries
+too. Readings that go into no summary (nodes without a NodeCache
+slot, dates) are always sent as they arrive.
+*/
+
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "includes.h"
+#include "Reading.h"
+#include "NodeCache.h"
+
+#ifndef AggWindowTicks
+#define AggWindowTicks 60000  // Shortest window: one minute of 1 ms ticks
+#endif
+
+#define AggLevels 3           // 1 minute, 10 minute and 1 hour windows
+
+#ifndef AggReportFrom
+#define AggReportFrom 1       // Shortest window reported: 0, 1 or 2
+#endif
+
+#ifndef AggregateOnly
+#define AggregateOnly 1       // 1 = summarized readings are not sent raw
+#endif
+
+typedef struct
+{
+	CPU_INT32S min;           // Smallest reading
+	CPU_INT32S max;           // Largest reading
+	CPU_INT32S sum;           // Sum of the readings
+	CPU_INT32U count;         // Number of readings, 0 if the window is empty
+} AggAcc;
+
+typedef struct
+{
+	CPU_INT32U node;          // Node number
+	CPU_CHAR msgType;         // Reading type
+	CPU_INT08U level;         // 0 = 1 minute, 1 = 10 minutes, 2 = 1 hour
+	CPU_INT32U end;           // Time the window closed
+	CPU_INT32S min;           // Same fixed point units as Reading.value
+	CPU_INT32S max;
+	CPU_INT32S mean;          // Rounded to the nearest unit
+	CPU_INT32U count;
+} AggSummary;
+
+//Called once for each non-empty window as it closes.
+typedef CPU_VOID (*AggEmit)(const AggSummary *summary);
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID AggregateInit(CPU_INT32U now);
+CPU_VOID AggregateTick(CPU_INT32U now, AggEmit emit);
+CPU_BOOLEAN AggregateUpdate(CPU_INT32U node, CPU_CHAR msgType, CPU_INT32S value);
+CPU_VOID AggregateFormat(const AggSummary *summary, CPU_CHAR *message);
+
+#endif
@@ -111,6 +111,40 @@ CPU_INT16S BfrNextByte(CircBfr *bfr){
     return *(bfr->bfr+(bfr->out));
 }
 
+/*-------------------- B f r S p a n ( ) -------------------------------------
+	Purpose:	Find the bytes from position 'out' that lie in one piece: up to
+                        the last byte or the end of the buffer space, whichever is first.
+        Parameters:     buffer address, where to return the address of the first byte
+        Return Value:   Number of bytes in the span, 0 if the buffer is empty
+*/
+CPU_INT16U BfrSpan(CircBfr *bfr, CPU_INT08U **span){
+    CPU_INT16U len = bfr->size - bfr->out;
+    
+    *span = bfr->bfr+bfr->out;
+    if (len > bfr->numBytes)
+        len = bfr->numBytes;
+    return len;
+}
+
+/*-------------------- B f r S k i p ( ) -------------------------------------
+	Purpose:	Remove count bytes from position 'out', as that many BfrRemByte()
+                        calls would, without reading them.
+        Parameters:     buffer address, number of bytes to remove
+        Return Value:   None
+*/
+CPU_VOID BfrSkip(CircBfr *bfr, CPU_INT16U count){
+    CPU_SR_ALLOC();   //CPU_INT32U sr = 0; Necessary to disable/enable interrupts in uC/OSIII
+    
+    if (count > bfr->numBytes)
+        count = bfr->numBytes;
+    bfr->out = (bfr->out + count) % bfr->size;
+    
+    //Disable interrupts to avoid data hazards
+    OS_CRITICAL_ENTER();
+    bfr->numBytes -= count;
+    OS_CRITICAL_EXIT();
+}
+
 /*-------------------- B f r W r i t e ( ) -------------------------------------
 	Purpose:	Write a block of bytes to the buffer
         Parameters:     buffer address, address of block to be written, number of bytes to write
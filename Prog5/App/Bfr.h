@@ -32,6 +32,8 @@ CPU_BOOLEAN BfrEmpty(CircBfr *bfr);
 CPU_INT16S BfrAddByte(CircBfr * bfr, CPU_INT16S theByte);
 CPU_INT16S BfrRemByte(CircBfr *bfr);
 CPU_INT16S BfrNextByte(CircBfr *bfr);
+CPU_INT16U BfrSpan(CircBfr *bfr, CPU_INT08U **span);
+CPU_VOID BfrSkip(CircBfr *bfr, CPU_INT16U count);
 CPU_VOID BfrWrite(CircBfr *bfr, CPU_VOID *rec, CPU_INT08U size);
 CPU_VOID BfrRead(CircBfr *bfr, CPU_VOID *rec, CPU_INT08U size);
 
@@ -0,0 +1,152 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        BfrPool.c
+-----------------------------------------------------------------------
+The shared block pool. Free blocks are a stack of pointers, so a take
+or a give is O(1); only the check of what the other clients are owed
+walks the (two) clients.
+*/
+
+#include <string.h>
+#include "BfrPool.h"
+
+/*-------------------- B f r P o o l I n i t ( ) -------------------------------------
+	Purpose:	Cut a block of memory into pool blocks, all free, with no clients.
+        Parameters:     pool, memory of numBlocks * blockSize bytes, number of blocks,
+                        block size
+*/
+CPU_VOID BfrPoolInit(BfrPool *pool, CPU_INT08U *space, CPU_INT08U numBlocks, CPU_INT08U blockSize){
+    CPU_INT08U i;
+
+    if(numBlocks > PoolMaxBlocks)
+        numBlocks = PoolMaxBlocks;
+    pool->blockSize = blockSize;
+    pool->numBlocks = numBlocks;
+    pool->numClients = 0;
+    for(i = 0; i < numBlocks; i++)
+        pool->freeList[i] = space + i * blockSize;
+    pool->numFree = numBlocks;
+}
+
+/*-------------------- B f r P o o l A d d C l i e n t ( ) -------------------------------------
+	Purpose:	Give a queue a share of the pool.
+        Parameters:     pool, blocks kept back for it, most it may hold, the queue
+        Return:         Client number, PoolMaxClients if the pool has no room for its
+                        minimum, its cap is out of range or the pool has all its clients
+*/
+CPU_INT08U BfrPoolAddClient(BfrPool *pool, CPU_INT08U min, CPU_INT08U max, CPU_VOID *owner){
+    PoolClient *c = &pool->clients[pool->numClients];
+    CPU_INT08U i, reserved = min;
+
+    for(i = 0; i < pool->numClients; i++)
+        reserved += pool->clients[i].min;
+    if(pool->numClients == PoolMaxClients || min > max || max > pool->numBlocks || reserved > pool->numBlocks)
+        return PoolMaxClients;
+
+    memset(c, 0, sizeof(*c));
+    c->min = min;
+    c->max = max;
+    c->owner = owner;
+    return pool->numClients++;
+}
+
+/*-------------------- B f r P o o l C a n T a k e ( ) -------------------------------------
+	Purpose:	Tell whether a client may have a block now without eating into
+                        another client's minimum. Unlike BfrPoolTake(), a refusal
+                        here counts no stall.
+*/
+CPU_BOOLEAN BfrPoolCanTake(BfrPool *pool, CPU_INT08U client){
+    PoolClient *c = &pool->clients[client];
+    CPU_INT08U i, owed = 0;
+
+    if(c->stats.held >= c->max || pool->numFree == 0)
+        return FALSE;
+    if(c->stats.held < c->min)
+        return TRUE;
+    for(i = 0; i < pool->numClients; i++)
+        if(i != client && pool->clients[i].stats.held < pool->clients[i].min)
+            owed += pool->clients[i].min - pool->clients[i].stats.held;
+    return pool->numFree > owed;
+}
+
+/*-------------------- C h a r g e T i m e ( ) -------------------------------------
+	Purpose:	Add the time since the last change to the client's current level.
+*/
+static CPU_VOID ChargeTime(PoolClient *c, CPU_INT32U now){
+    CPU_INT08U level = c->stats.held < PoolLevelBins ? c->stats.held : PoolLevelBins - 1;
+
+    c->stats.levelTime[level] += now - c->since;
+    c->since = now;
+}
+
+/*-------------------- B f r P o o l T a k e ( ) -------------------------------------
+	Purpose:	Take a block for a client. A refusal marks the client waiting,
+                        for BfrPoolWake(), and counts a stall the first time.
+        Parameters:     pool, client, time now
+        Return:         The block, NULL if refused
+*/
+CPU_INT08U *BfrPoolTake(BfrPool *pool, CPU_INT08U client, CPU_INT32U now){
+    PoolClient *c = &pool->clients[client];
+
+    c->woken = FALSE;
+    if(!BfrPoolCanTake(pool, client)){
+        if(!c->waiting){
+            c->waiting = TRUE;
+            c->stallStart = now;
+            c->stats.stalls++;
+        }
+        return NULL;
+    }
+    if(c->waiting){
+        c->waiting = FALSE;
+        c->stats.stallTime += now - c->stallStart;
+    }
+    ChargeTime(c, now);
+    if(++c->stats.held > c->stats.peak)
+        c->stats.peak = c->stats.held;
+    c->stats.taken++;
+    return pool->freeList[--pool->numFree];
+}
+
+/*-------------------- B f r P o o l G i v e ( ) -------------------------------------
+	Purpose:	Hand a client's block back to the pool.
+        Parameters:     pool, client, the block, time now
+*/
+CPU_VOID BfrPoolGive(BfrPool *pool, CPU_INT08U client, CPU_INT08U *block, CPU_INT32U now){
+    PoolClient *c = &pool->clients[client];
+
+    ChargeTime(c, now);
+    c->stats.held--;
+    pool->freeList[pool->numFree++] = block;
+}
+
+/*-------------------- B f r P o o l W a k e ( ) -------------------------------------
+	Purpose:	Find a waiting client that a block is free for now. Each client is
+                        handed out once per refusal, so call until NULL after a give.
+        Return:         The client's owner, NULL if there is none
+*/
+CPU_VOID *BfrPoolWake(BfrPool *pool){
+    CPU_INT08U i;
+
+    for(i = 0; i < pool->numClients; i++)
+        if(pool->clients[i].waiting && !pool->clients[i].woken && BfrPoolCanTake(pool, i)){
+            pool->clients[i].woken = TRUE;
+            return pool->clients[i].owner;
+        }
+    return NULL;
+}
+
+/*-------------------- B f r P o o l G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out a client's counters, its times brought up to now.
+*/
+CPU_VOID BfrPoolGetStats(BfrPool *pool, CPU_INT08U client, PoolStats *stats, CPU_INT32U now){
+    PoolClient *c = &pool->clients[client];
+
+    ChargeTime(c, now);
+    *stats = c->stats;
+    if(c->waiting)
+        stats->stallTime += now - c->stallStart;
+}
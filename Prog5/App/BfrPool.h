@@ -0,0 +1,73 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        BfrPool.h
+-----------------------------------------------------------------------
+A pool of fixed size blocks that several buffer queues draw their
+buffers from. Each queue is a client with a minimum, the blocks kept
+back for it however busy the others are, and a cap, the most it may
+hold at once. A client may take a free block while it holds fewer than
+its minimum, or while the free blocks outnumber what the other clients
+are still owed; so the RAM goes to whichever stage is backed up.
+
+The pool itself does no locking and never blocks: BfrQ.c takes and
+gives blocks with the scheduler locked and pends when refused. Times
+are whatever clock the caller passes, OS ticks on the station.
+*/
+
+#ifndef BFRPOOL_H
+#define BFRPOOL_H
+
+#include "includes.h"
+
+#ifndef PoolMaxBlocks
+#define PoolMaxBlocks 16      // Most blocks a pool can have
+#endif
+
+#define PoolMaxClients 2      // Most queues sharing a pool
+#define PoolLevelBins 6       // Time held at 0, 1, 2, 3, 4, 5 or more blocks
+
+typedef struct
+{
+	CPU_INT08U held;          // Blocks held now
+	CPU_INT08U peak;          // Most ever held at once
+	CPU_INT32U taken;         // Blocks taken
+	CPU_INT32U stalls;        // Takes refused and waited out
+	CPU_INT32U stallTime;     // Time spent refused
+	CPU_INT32U levelTime[PoolLevelBins];  // Time spent holding each number of blocks
+} PoolStats;
+
+typedef struct
+{
+	CPU_INT08U min;           // Blocks kept back for this client
+	CPU_INT08U max;           // Most blocks it may hold
+	CPU_BOOLEAN waiting;      // Refused and not yet served
+	CPU_BOOLEAN woken;        // Told a block is free since its last try
+	CPU_INT32U since;         // Time held last changed
+	CPU_INT32U stallStart;    // Time it was first refused
+	CPU_VOID *owner;          // The queue, handed back by BfrPoolWake()
+	PoolStats stats;
+} PoolClient;
+
+typedef struct
+{
+	CPU_INT08U blockSize;     // Bytes in a block
+	CPU_INT08U numBlocks;     // Blocks in the pool
+	CPU_INT08U numFree;       // Blocks on the free list
+	CPU_INT08U numClients;
+	CPU_INT08U *freeList[PoolMaxBlocks];
+	PoolClient clients[PoolMaxClients];
+} BfrPool;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID BfrPoolInit(BfrPool *pool, CPU_INT08U *space, CPU_INT08U numBlocks, CPU_INT08U blockSize);
+CPU_INT08U BfrPoolAddClient(BfrPool *pool, CPU_INT08U min, CPU_INT08U max, CPU_VOID *owner);
+CPU_BOOLEAN BfrPoolCanTake(BfrPool *pool, CPU_INT08U client);
+CPU_INT08U *BfrPoolTake(BfrPool *pool, CPU_INT08U client, CPU_INT32U now);
+CPU_VOID BfrPoolGive(BfrPool *pool, CPU_INT08U client, CPU_INT08U *block, CPU_INT32U now);
+CPU_VOID *BfrPoolWake(BfrPool *pool);
+CPU_VOID BfrPoolGetStats(BfrPool *pool, CPU_INT08U client, PoolStats *stats, CPU_INT32U now);
+
+#endif
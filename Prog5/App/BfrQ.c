@@ -17,28 +17,34 @@ supply any needed functionality.
 #define SuspendTimeout 100	    // Timeout for semaphore wait
 
 /*-------------------- B f r Q I n i t ( ) -------------------------------------
-	Purpose:	Initialize a buffer queue. Initialize the numBfrs and bfrSize members. Set
-                        readBfrNum and writeBfrNum to zero. Finally, perform BfrInit() on all of the buffers in the queue.
-        Parameters:     buffer queue address, number of buffers, size of each buffer (bytes), address of a block of memory large enough
+	Purpose:	Initialize a buffer queue drawing its buffers from a pool. Initialize the numBfrs
+                        and bfrSize members. Set readBfrNum and writeBfrNum to zero. The buffers get
+                        their space as the queue takes pool blocks.
+        Parameters:     buffer queue address, pool, buffers kept back for the queue, most it may hold
         Return Value:   None
 */
-CPU_VOID BfrQInit( BfrQ *bfrQ, CPU_INT08U numBfrs, CPU_INT08U bfrSize, CPU_INT08U *bfrSpace){
+CPU_VOID BfrQInit( BfrQ *bfrQ, BfrPool *pool, CPU_INT08U minBfrs, CPU_INT08U maxBfrs){
   CPU_INT08S i;
   
   /* O/S error code */
   OS_ERR  osErr;
   
-  bfrQ->numBfrs = numBfrs;
-  bfrQ->bfrSize = bfrSize;
+  assert(maxBfrs <= NumBfrs);
+  bfrQ->pool = pool;
+  bfrQ->client = BfrPoolAddClient(pool, minBfrs, maxBfrs, bfrQ);
+  assert(bfrQ->client < PoolMaxClients);
+  bfrQ->numBfrs = maxBfrs;
+  bfrQ->bfrSize = pool->blockSize;
   bfrQ->readBfrNum = 0;
   bfrQ->writeBfrNum = 0;
+  bfrQ->writing = FALSE;
   
-  for (i = 0; i < numBfrs; i++){
-    BfrInit(&bfrQ->buffers[i], bfrSpace+(i*bfrSize)/*+1*/, bfrSize); 
+  for (i = 0; i < maxBfrs; i++){
+    BfrInit(&bfrQ->buffers[i], NULL, bfrQ->bfrSize); 
   }
   
-  /* Create and initialize semaphores. */
-  OSSemCreate(&bfrQ->writeBfrs, "Write Bfrs Avail", NumBfrs, &osErr);
+  /* Create and initialize semaphores. No producer has been refused yet. */
+  OSSemCreate(&bfrQ->writeBfrs, "Write Bfrs Avail", 0, &osErr);
   assert(osErr == OS_ERR_NONE);
   
   OSSemCreate(&bfrQ->readBfrs, "Read Bfrs Avail", 0, &osErr);
@@ -58,31 +64,88 @@ CPU_VOID BfrQPendRead(BfrQ *bfrQ){
     assert(osErr == OS_ERR_NONE);
 }
 
+/*-------------------- B f r Q P e n d R e a d T i m e d ( ) -------------------------------------
+	Purpose:	Block until the buffer queue read buffer is ready or the timeout expires.
+        Parameters:     buffer queue address, timeout in ticks
+        Return Value:   TRUE -  A read buffer is ready
+                        FALSE - The timeout expired first
+*/
+CPU_BOOLEAN BfrQPendReadTimed(BfrQ *bfrQ, OS_TICK timeout){
+    OS_ERR osErr;  
+  
+    OSSemPend(&bfrQ->readBfrs, timeout, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+    if(osErr == OS_ERR_TIMEOUT)
+        return FALSE;
+    assert(osErr == OS_ERR_NONE);
+    return TRUE;
+}
+
 /*-------------------- B f r Q P e n d W r i t e ( ) -------------------------------------
-	Purpose:	Block if the buffer queue write buffer is not ready.
+	Purpose:	Take a pool block for the write buffer, blocking while the pool
+                        refuses this queue one.
         Parameters:     buffer queue address
         Return Value:   None
 */
 CPU_VOID BfrQPendWrite(BfrQ *bfrQ){
+    CPU_INT08U *block;
     OS_ERR osErr;  
   
-    OSSemPend(&bfrQ->writeBfrs, SuspendTimeout, OS_OPT_PEND_BLOCKING, NULL, &osErr);
-    assert(osErr == OS_ERR_NONE);
+    for(;;){
+        OSSchedLock(&osErr);
+        block = BfrPoolTake(bfrQ->pool, bfrQ->client, OSTimeGet(&osErr));
+        OSSchedUnlock(&osErr);
+        if(block != NULL)
+            break;
+        
+        //BfrQPostWrite() on either queue posts here once a block is free for this one
+        OSSemPend(&bfrQ->writeBfrs, SuspendTimeout, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+        assert(osErr == OS_ERR_NONE);
+    }
+    BfrInit(BfrQWriteBfrAddr(bfrQ), block, bfrQ->bfrSize);
+    bfrQ->writing = TRUE;
 }
 /*-------------------- B f r Q P o s t W r i t e( ) -------------------------------------
-	Purpose:	Post that there is another write buffer available.
-                        Finally, increment the current write buffer number.
+	Purpose:	Hand the read buffer's block back to the pool and wake any
+                        producer it lets in. Finally, increment the current read buffer number.
         Parameters:     buffer queue address
         Return Value:   None
 */
 CPU_VOID BfrQPostWrite(BfrQ *bfrQ){
   OS_ERR osErr;  //Semaphore Error Code.
-  
-  OSSemPost(&bfrQ->writeBfrs, OS_OPT_POST_1, &osErr);
-  assert(osErr == OS_ERR_NONE);
+  BfrQ *waiter;
   
   BfrQReadReset(bfrQ);
+  OSSchedLock(&osErr);
+  BfrPoolGive(bfrQ->pool, bfrQ->client, ((CircBfr *)BfrQReadBfrAddr(bfrQ))->bfr, OSTimeGet(&osErr));
+  while((waiter = BfrPoolWake(bfrQ->pool)) != NULL){
+    OSSemPost(&waiter->writeBfrs, OS_OPT_POST_1, &osErr);
+    assert(osErr == OS_ERR_NONE);
+  }
   bfrQ->readBfrNum = (bfrQ->readBfrNum + 1) % bfrQ->numBfrs;
+  OSSchedUnlock(&osErr);
+}
+
+/*-------------------- B f r Q R e a d s W a i t i n g( ) -------------------------------------
+	Purpose:	Count the read buffers posted and not yet taken. Called by the
+                        consumer just after it takes one, this is the queue's backlog.
+        Parameters:     buffer queue address
+        Return Value:   Read buffers waiting
+*/
+CPU_INT08U BfrQReadsWaiting(BfrQ *bfrQ){
+  return (CPU_INT08U)bfrQ->readBfrs.Ctr;
+}
+
+/*-------------------- B f r Q G e t S t a t s( ) -------------------------------------
+	Purpose:	Copy out the queue's pool counters.
+        Parameters:     buffer queue address, where to put them
+        Return Value:   None
+*/
+CPU_VOID BfrQGetStats(BfrQ *bfrQ, PoolStats *stats){
+  OS_ERR osErr;
+  
+  OSSchedLock(&osErr);
+  BfrPoolGetStats(bfrQ->pool, bfrQ->client, stats, OSTimeGet(&osErr));
+  OSSchedUnlock(&osErr);
 }
 
 /*-------------------- B f r Q P o s t R e a d( ) -------------------------------------
@@ -94,12 +157,44 @@ CPU_VOID BfrQPostWrite(BfrQ *bfrQ){
 CPU_VOID BfrQPostRead(BfrQ *bfrQ){
   OS_ERR osErr;  //Semaphore Error Code.
   
+  bfrQ->writing = FALSE;
   OSSemPost(&bfrQ->readBfrs, OS_OPT_POST_1, &osErr);
   assert(osErr == OS_ERR_NONE);
   
   bfrQ->writeBfrNum = (bfrQ->writeBfrNum + 1) % bfrQ->numBfrs;
 }
 
+/*-------------------- B f r Q I n j e c t( ) -------------------------------------
+	Purpose:	Post a record from a task other than the producer. The record goes
+                        into the producer's write buffer, which is posted at once, and the
+                        producer goes on in a new one. This is only done while the producer
+                        holds an empty write buffer (it is between records) and the pool
+                        has a block for the new one, so it never waits.
+                        The caller must run below the producer, so the producer is
+                        blocked, not part way through a write, whenever it is called.
+        Parameters:     buffer queue address, record, its size
+        Return Value:   TRUE -  The record was posted
+                        FALSE - Not now; nothing was written
+*/
+CPU_BOOLEAN BfrQInject(BfrQ *bfrQ, CPU_VOID *rec, CPU_INT08U size){
+  CPU_INT08U *block;
+  CPU_BOOLEAN posted = FALSE;
+  OS_ERR osErr;
+  
+  OSSchedLock(&osErr);
+  if(bfrQ->writing && size <= bfrQ->bfrSize && BfrEmpty(BfrQWriteBfrAddr(bfrQ)) &&
+     BfrPoolCanTake(bfrQ->pool, bfrQ->client)){
+    block = BfrPoolTake(bfrQ->pool, bfrQ->client, OSTimeGet(&osErr));
+    BfrQWrite(bfrQ, rec, size);
+    BfrQPostRead(bfrQ);
+    BfrInit(BfrQWriteBfrAddr(bfrQ), block, bfrQ->bfrSize);
+    bfrQ->writing = TRUE;
+    posted = TRUE;
+  }
+  OSSchedUnlock(&osErr);
+  return posted;
+}
+
 /*-------------------- B f r Q N e x t B y t e( ) -------------------------------------
 	Purpose:	Obtain but do not remove the next byte from the current read buffer, or -1
                         if the buffer is empty.
@@ -110,6 +205,25 @@ CPU_VOID BfrQPostRead(BfrQ *bfrQ){
 CPU_INT16S BfrQNextByte(BfrQ *bfrQ){
   return BfrNextByte(BfrQReadBfrAddr(bfrQ));
 }
+
+/*-------------------- B f r Q R e a d S p a n( ) -------------------------------------
+	Purpose:	Find the next bytes of the current read buffer that lie in one
+                        piece, without removing them (BfrSpan()).
+        Parameters:     buffer queue address, where to return the span's address
+        Return Value:   Number of bytes in the span, 0 if the buffer is empty
+*/
+CPU_INT16U BfrQReadSpan(BfrQ *bfrQ, CPU_INT08U **span){
+  return BfrSpan(BfrQReadBfrAddr(bfrQ), span);
+}
+
+/*-------------------- B f r Q S k i p( ) -------------------------------------
+	Purpose:	Remove count bytes from the current read buffer.
+        Parameters:     buffer queue address, number of bytes
+        Return Value:   None
+*/
+CPU_VOID BfrQSkip(BfrQ *bfrQ, CPU_INT16U count){
+  BfrSkip(BfrQReadBfrAddr(bfrQ), count);
+}
 /*-------------------- B f r Q R e a d R e s e t( ) -------------------------------------
 	Purpose:	Reset the current read buffer
         Parameters:     buffer queue address
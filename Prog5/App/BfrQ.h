@@ -8,6 +8,14 @@
 From Program 3, modified as needed. The two semaphores readBfrs and writeBfrs
 are defined in this module as members of type BfrQ. You may add new functions to
 supply any needed functionality.
+
+The queues no longer own their buffer space. Each is a client of a
+BfrPool and takes a block for its write buffer in BfrQPendWrite(),
+handing it back in BfrQPostWrite(), so writeBfrs now only wakes a
+producer that was refused a block.
+
+BfrQInject() lets a second, lower priority task slip a record in
+between the producer's own.
 */
 
 #ifndef BFRQ_H
@@ -15,13 +23,14 @@ supply any needed functionality.
 
 #include "includes.h"
 #include "Bfr.h"
+#include "BfrPool.h"
 
 #ifndef BfrQSize
 #define BfrQSize 80  //Size of the buffers in the BufferQ
 #endif
 
 #ifndef NumBfrs
-#define NumBfrs 3
+#define NumBfrs 6    //Buffers in the pool the queues share
 #endif
 
 #pragma pack() //Ensure this is not packed.
@@ -35,15 +44,19 @@ typedef struct
                         that it is finished with a read buffer and a new write buffer is available.
                         A producer task pends on this semaphore, awaiting an available write buffer.
                       */
-    CPU_INT08U numBfrs; /* -- Number of buffers in the queue */
+    BfrPool *pool;      /* -- Where the buffers come from */
+    CPU_INT08U client;  /* -- This queue's client number in the pool */
+    CPU_INT08U numBfrs; /* -- Most buffers the queue may hold */
     CPU_INT08U bfrSize; /* -- Buffer capacity in bytes */
     CPU_INT08U readBfrNum; /* -- The index of the read buffer */
     CPU_INT08U writeBfrNum; /* -- The index of the write buffer */
+    CPU_BOOLEAN writing; /* -- The producer holds the write buffer's block */
     CircBfr buffers[NumBfrs]; /* -- The buffers */ //These should not be treated as CircBfrs
 } BfrQ;
 
-CPU_VOID BfrQInit( BfrQ *bfrQ, CPU_INT08U numBfrs, CPU_INT08U bfrSize, CPU_INT08U *bfrSpace);
+CPU_VOID BfrQInit( BfrQ *bfrQ, BfrPool *pool, CPU_INT08U minBfrs, CPU_INT08U maxBfrs);
 CPU_VOID BfrQReadReset(BfrQ *bfrQ);
+CPU_VOID BfrQWriteReset(BfrQ *bfrQ);
 CPU_VOID *BfrQWriteBfrAddr(BfrQ *bfrQ);
 CPU_VOID *BfrQReadBfrAddr(BfrQ *bfrQ);
 CPU_INT16S BfrQAddByte(BfrQ *bfrQ, CPU_INT16S theByte);
@@ -51,10 +64,16 @@ CPU_INT16S BfrQRemByte(BfrQ *bfrQ);
 CPU_VOID BfrQWrite( BfrQ *bfrQ, CPU_VOID *rec, CPU_INT08U size);
 CPU_VOID BfrQRead( BfrQ *bfrQ, CPU_VOID *rec, CPU_INT08U size);
 CPU_INT16S BfrQNextByte(BfrQ *bfrQ);
+CPU_INT16U BfrQReadSpan(BfrQ *bfrQ, CPU_INT08U **span);
+CPU_VOID BfrQSkip(BfrQ *bfrQ, CPU_INT16U count);
 
 CPU_VOID BfrQPendRead(BfrQ *bfrQ);
+CPU_BOOLEAN BfrQPendReadTimed(BfrQ *bfrQ, OS_TICK timeout);
 CPU_VOID BfrQPendWrite(BfrQ *bfrQ);
 CPU_VOID BfrQPostRead(BfrQ *bfrQ);
 CPU_VOID BfrQPostWrite(BfrQ *bfrQ);
+CPU_BOOLEAN BfrQInject(BfrQ *bfrQ, CPU_VOID *rec, CPU_INT08U size);
+CPU_INT08U BfrQReadsWaiting(BfrQ *bfrQ);
+CPU_VOID BfrQGetStats(BfrQ *bfrQ, PoolStats *stats);
 
 #endif
\ No newline at end of file
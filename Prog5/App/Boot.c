@@ -0,0 +1,85 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Boot.c
+-----------------------------------------------------------------------
+Boot phase time stamps. Only the first stamp of each phase is kept,
+so BootStamp() can sit on a path that runs for every packet.
+*/
+
+#include "Boot.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define ResetMHz 8            // HSI: the core clock out of reset
+#define LongGapTicks 1000     // Gaps this long are timed by the OS tick
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_INT32U stamps[NumBootPhases];  // Microseconds from main(), 0 if not reached
+static CPU_INT32U nowUs;                  // Time of the last stamp
+static CPU_INT32U lastCyc;                // Cycle count at it, less any part microsecond
+static OS_TICK lastTick;                  // OS tick at it
+static CPU_INT32U cycPerUs = ResetMHz;
+
+/*-------------------- B o o t S t a r t ( ) -------------------------------------
+	Purpose:	Start the cycle counter. Call first thing in main().
+*/
+CPU_VOID BootStart(CPU_VOID){
+    CPU_TS_TmrInit();
+    lastCyc = OS_TS_GET();
+}
+
+/*-------------------- B o o t S t a m p ( ) -------------------------------------
+	Purpose:	Note the end of a boot phase, unless it was noted before.
+        Parameters:     the phase
+*/
+CPU_VOID BootStamp(BootPhase phase){
+    CPU_INT32U cyc, ticks;
+    OS_TICK tick;
+    OS_ERR osErr;
+    CPU_SR_ALLOC();
+
+    if(stamps[phase] != 0)
+        return;
+
+    CPU_CRITICAL_ENTER();
+    cyc = OS_TS_GET() - lastCyc;
+    tick = OSTimeGet(&osErr);
+    ticks = tick - lastTick;
+    if(ticks >= LongGapTicks){
+        nowUs += ticks * (1000000 / OSCfg_TickRate_Hz);
+        lastCyc += cyc;
+    }else{
+        nowUs += cyc / cycPerUs;
+        lastCyc += cyc - cyc % cycPerUs;
+    }
+    lastTick = tick;
+    stamps[phase] = nowUs;
+    CPU_CRITICAL_EXIT();
+
+    //From here on the counter runs at the core clock
+    if(phase == BootClocks)
+        cycPerUs = BSP_CPU_ClkFreq() / 1000000;
+}
+
+/*-------------------- B o o t G e t T i m e s ( ) -------------------------------------
+	Purpose:	Copy out the stamps.
+        Parameters:     space for NumBootPhases times in microseconds from main(),
+                        0 for a phase not reached yet
+*/
+CPU_VOID BootGetTimes(CPU_INT32U *us){
+    CPU_INT08U i;
+
+    for(i = 0; i < NumBootPhases; i++)
+        us[i] = stamps[i];
+}
+
+/*-------------------- B o o t C a l i b r a t e d ( ) -------------------------------------
+	Purpose:	Tell whether the CPU usage figures can be trusted.
+        Return:         TRUE if the statistics task's idle calibration is done and
+                        no payload had arrived before it ended
+*/
+CPU_BOOLEAN BootCalibrated(CPU_VOID){
+    return stamps[BootDone] != 0 && (stamps[BootFirstPkt] == 0 || stamps[BootFirstPkt] > stamps[BootDone]);
+}
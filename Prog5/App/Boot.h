@@ -0,0 +1,51 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Boot.h
+-----------------------------------------------------------------------
+The boot timeline. main() starts the DWT cycle counter first thing and
+each boot phase is stamped as it ends, in microseconds from main(); the
+C start up code before main() is not counted. The console reports the
+stamps as its 'B' and 'J' groups.
+
+The Init task brings up the clocks, the tasks the packets go through
+and the USART2 receive path first, then drops below them to finish
+the rest: the LEDs and status input, the STLM75 and the statistics
+task's idle calibration, which sits idle for a tenth of a second.
+Packets that arrive during the calibration take idle time from it, and
+every CPU usage figure after reads low. BootCalibrated() tells whether
+the calibration ended before the first payload; the console reports
+it in its 'U' group.
+
+Cycles are counted at the 8 MHz reset clock until the clocks are up
+and at the core clock after. A gap of a second or more between stamps
+is taken from the OS tick instead, as the counter wraps in under a
+minute.
+*/
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "includes.h"
+
+typedef enum
+{
+	BootOSInit,               // Kernel initialized
+	BootTask,                 // Init task first run
+	BootClocks,               // PLLs locked, core at full speed
+	BootRxReady,              // Packet tasks created, USART2 receiving
+	BootFirstPkt,             // First payload handed to the payload task
+	BootIO,                   // LEDs, status input and STLM75 set up
+	BootDone,                 // Statistics task calibrated
+	NumBootPhases
+} BootPhase;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID BootStart(CPU_VOID);
+CPU_VOID BootStamp(BootPhase phase);
+CPU_VOID BootGetTimes(CPU_INT32U *us);
+CPU_BOOLEAN BootCalibrated(CPU_VOID);
+
+#endif
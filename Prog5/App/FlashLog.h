@@ -0,0 +1,88 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        FlashLog.h
+-----------------------------------------------------------------------
+Ring log of decoded readings in the STM32F107's internal flash, so the
+readings survive while the PC is disconnected and can be exported in
+bulk later.
+
+The payload task only copies a reading into a RAM queue. The log task,
+below every other task, programs the queued readings into flash a page
+at a time, or whatever is queued after LogFlushTicks. The log fills
+the LogPages pages in turn and erases the oldest page to go on, so
+every page wears at the same rate.
+
+Define FlashSimulated (the host tools' HostOS.h does) to keep the log
+in a file instead; the FlashSim functions then open the file and
+inject power failures.
+*/
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include "includes.h"
+#include "Reading.h"
+
+#define FlashPageSize 2048    // Erase unit of the STM32F107's flash
+
+#ifndef LogBase
+#define LogBase 0x08030000    // First log page; STM32_FLASH.icf ends the code below it
+#endif
+
+#ifndef LogPages
+#define LogPages 32           // Pages in the ring: 64 KB, about 5400 readings
+#endif
+
+#ifndef LogBfrRecs
+#define LogBfrRecs 256        // Readings the RAM queue holds; a power of 2
+#endif
+
+#ifndef LogFlushTicks
+#define LogFlushTicks 10000   // Longest a reading waits in RAM, in ticks
+#endif
+
+//One reading as it is stored. msgType is programmed last, so a record
+//cut short by a power failure still reads as empty.
+typedef struct
+{
+	CPU_INT32U time;          // Arrival time in ticks
+	CPU_INT32S value;         // Reading value and aux, as Reading.h
+	CPU_INT16S aux;
+	CPU_INT08U node;          // Source address
+	CPU_CHAR msgType;         // 0xFF in an empty slot
+} LogRecord;
+
+typedef struct
+{
+	CPU_INT32U logged;        // Readings programmed into flash
+	CPU_INT32U dropped;       // Readings lost because the RAM queue was full
+	CPU_INT32U failed;        // Readings lost because programming failed
+	CPU_INT32U erases;        // Pages erased
+	CPU_INT32U records;       // Readings in the log now
+} LogStats;
+
+//Called with each record of an export, oldest first, then with NULL.
+typedef CPU_VOID (*LogEmit)(const LogRecord *rec);
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID FlashLogInit(CPU_VOID);
+CPU_VOID FlashLogPut(CPU_INT08U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U time);
+CPU_INT32U FlashLogFlush(CPU_VOID);
+CPU_INT32U FlashLogRead(LogEmit emit);
+CPU_VOID FlashLogGetStats(LogStats *stats);
+CPU_VOID FlashLogFormat(const LogRecord *rec, CPU_CHAR *message);
+
+#ifdef FlashSimulated
+CPU_BOOLEAN FlashSimOpen(const CPU_CHAR *path);
+CPU_VOID FlashSimClose(CPU_VOID);
+CPU_VOID FlashSimCutAfter(CPU_INT32S halfWords);
+CPU_VOID FlashSimGetWear(CPU_INT32U *erases);
+#else
+CPU_VOID CreateFlashLogTask(CPU_VOID);
+CPU_VOID FlashLogExport(LogEmit emit);
+#endif
+
+#endif
@@ -0,0 +1,322 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        History.c
+-----------------------------------------------------------------------
+The reading history. Every NodeCache slot has one series per reading
+type. A block holds its first sample whole in the header, so any block
+decodes on its own, and the samples after it coded in the data bytes:
+
+    time step change    zigzag varint
+    value               zigzag varint difference, or varint XOR for D
+    aux                 zigzag varint difference, H and W only
+
+A varint is 7 bits per byte, low bits first, with the top bit set on
+every byte but the last. Zigzag maps 0, -1, 1, -2 ... to 0, 1, 2, 3 ...
+so small differences of either sign take one byte.
+
+Blocks are handed out in turn round the pool. The block handed out
+next is therefore the oldest in use, the first block of its series, and
+taking it only moves that series' start on: an append is O(1) however
+full the pool is. The series table takes 16 bytes per slot and type.
+
+Only the payload task appends; read from the same task.
+*/
+
+#include <string.h>
+#include "History.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define NoBlock 0xFFFF        // End of a chain
+#define NoSeries 0xFFFF       // Owner of a free block
+#define HeaderBytes 16
+#define DataBytes (HistBlockSize - HeaderBytes)
+#define MaxSampleBytes 13     // Time change (5), value (5), aux (3)
+#define NumSeries (NodeCacheNodes * NumRdgTypes)
+
+//How each reading type's samples are coded
+#define HasAux 0x01           // Code the aux too
+#define XorValue 0x02         // XOR the value with the last: packed fields, not a number
+
+//Registered types (RdgSpare on) code the aux in case they have one.
+#define Coding(type) ((type) < RdgSpare ? TypeCoding[type] : HasAux)
+
+static const CPU_INT08U TypeCoding[RdgSpare] =
+{
+    0,          // B
+    XorValue,   // D
+    HasAux,     // H
+    0,          // P
+    0,          // R
+    0,          // T
+    HasAux      // W
+};
+
+typedef struct
+{
+	CPU_INT16U next;          // Next newer block of the series, NoBlock for the last
+	CPU_INT16U series;        // Owning series, NoSeries if free
+	CPU_INT08U used;          // Data bytes used
+	CPU_INT08U count;         // Samples, the one in the header included
+	CPU_INT16S aux;           // First sample
+	CPU_INT32U time;          // In HistTimeUnit steps
+	CPU_INT32S value;
+	CPU_INT08U data[DataBytes];
+} HistBlock;
+
+typedef struct
+{
+	CPU_INT16U head;          // Oldest block, NoBlock if the series is empty
+	CPU_INT16U tail;          // Newest block
+	CPU_INT32U time;          // Last sample appended
+	CPU_INT32S step;          // Its time step
+	CPU_INT32S value;
+	CPU_INT16S aux;
+} Series;
+
+//----- g l o b a l    v a r i a b l e s -----
+static HistBlock pool[HistBlocks];
+static Series series[NumSeries];
+static CPU_INT16U nextBlock;  // Block handed out next
+static HistStats histStats;
+
+/*-------------------- Z i g z a g ( ) -------------------------------------
+	Purpose:	Map a signed number to an unsigned one, small magnitudes to small values.
+*/
+static CPU_INT32U Zigzag(CPU_INT32S n){
+    return ((CPU_INT32U)n << 1) ^ (CPU_INT32U)(n >> 31);
+}
+
+/*-------------------- U n z i g z a g ( ) -------------------------------------
+	Purpose:	Undo Zigzag().
+*/
+static CPU_INT32S Unzigzag(CPU_INT32U n){
+    return (CPU_INT32S)(n >> 1) ^ -(CPU_INT32S)(n & 1);
+}
+
+/*-------------------- P u t V a r i n t ( ) -------------------------------------
+	Purpose:	Store a varint.
+        Return:         Bytes stored, 1 to 5
+*/
+static CPU_INT08U PutVarint(CPU_INT08U *bytes, CPU_INT32U n){
+    CPU_INT08U len = 0;
+
+    while(n >= 0x80){
+        bytes[len++] = (CPU_INT08U)(n | 0x80);
+        n >>= 7;
+    }
+    bytes[len++] = (CPU_INT08U)n;
+    return len;
+}
+
+/*-------------------- G e t V a r i n t ( ) -------------------------------------
+	Purpose:	Load a varint and step past it.
+*/
+static CPU_INT32U GetVarint(const CPU_INT08U **bytes){
+    const CPU_INT08U *p = *bytes;
+    CPU_INT32U n = 0;
+    CPU_INT08U shift = 0;
+
+    do{
+        n |= (CPU_INT32U)(*p & 0x7F) << shift;
+        shift += 7;
+    }while(*p++ & 0x80);
+    *bytes = p;
+    return n;
+}
+
+/*-------------------- H i s t o r y I n i t ( ) -------------------------------------
+	Purpose:	Empty every series and free every block.
+*/
+CPU_VOID HistoryInit(CPU_VOID){
+    CPU_INT32U i;
+
+    for(i = 0; i < NumSeries; i++){
+        series[i].head = NoBlock;
+        series[i].tail = NoBlock;
+    }
+    for(i = 0; i < HistBlocks; i++)
+        pool[i].series = NoSeries;
+    nextBlock = 0;
+    memset(&histStats, 0, sizeof(histStats));
+}
+
+/*-------------------- N e w B l o c k ( ) -------------------------------------
+	Purpose:	Hand out the next block in turn, taking it from the series that
+                        has it if it is in use.
+        Return:         Block number
+*/
+static CPU_INT16U NewBlock(CPU_VOID){
+    CPU_INT16U b = nextBlock;
+    HistBlock *blk = &pool[b];
+
+    nextBlock = (CPU_INT16U)((b + 1) % HistBlocks);
+    if(blk->series == NoSeries){
+        histStats.blocksUsed++;
+        return b;
+    }
+
+    //The oldest block in use: its series starts at the next one
+    series[blk->series].head = blk->next;
+    if(blk->next == NoBlock)
+        series[blk->series].tail = NoBlock;
+    histStats.samples -= blk->count;
+    histStats.evicted += blk->count;
+    return b;
+}
+
+/*-------------------- H i s t o r y A p p e n d ( ) -------------------------------------
+	Purpose:	Add a reading to its node's series. The node must already have a
+                        NodeCache slot; readings from other nodes are counted and dropped.
+        Parameters:     node number, message type, fixed point reading, time in ticks
+*/
+CPU_VOID HistoryAppend(CPU_INT32U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U time){
+    ReadingType type = ReadingIndex(msgType);
+    NodeSlot slot = NodeCacheSlot(node);
+    CPU_INT08U code[MaxSampleBytes];
+    CPU_INT32U t = time / HistTimeUnit;
+    CPU_INT16U index, b;
+    CPU_INT08U coding, n;
+    CPU_INT32S step;
+    HistBlock *blk;
+    Series *s;
+
+    if(type == NumRdgTypes)
+        return;
+    if(slot == 0){
+        histStats.noSlot++;
+        return;
+    }
+    index = (CPU_INT16U)((slot - 1) * NumRdgTypes + type);
+    s = &series[index];
+    coding = Coding(type);
+
+    //Code the sample against the last one and add it to the newest block if it fits
+    if(s->tail != NoBlock){
+        blk = &pool[s->tail];
+        step = (CPU_INT32S)(t - s->time);
+        n = PutVarint(code, Zigzag(step - s->step));
+        if(coding & XorValue)
+            n += PutVarint(&code[n], (CPU_INT32U)(rdg->value ^ s->value));
+        else
+            n += PutVarint(&code[n], Zigzag(rdg->value - s->value));
+        if(coding & HasAux)
+            n += PutVarint(&code[n], Zigzag(rdg->aux - s->aux));
+        if(blk->used + n <= DataBytes){
+            memcpy(&blk->data[blk->used], code, n);
+            blk->used += n;
+            blk->count++;
+            s->step = step;
+            s->time = t;
+            s->value = rdg->value;
+            s->aux = rdg->aux;
+            histStats.samples++;
+            histStats.appended++;
+            return;
+        }
+    }
+
+    //Start a block with the sample whole. Taking the block may empty this
+    //very series, so link it in afterwards.
+    b = NewBlock();
+    blk = &pool[b];
+    blk->next = NoBlock;
+    blk->series = index;
+    blk->used = 0;
+    blk->count = 1;
+    blk->time = t;
+    blk->value = rdg->value;
+    blk->aux = rdg->aux;
+    if(s->tail != NoBlock)
+        pool[s->tail].next = b;
+    else
+        s->head = b;
+    s->tail = b;
+    s->step = 0;
+    s->time = t;
+    s->value = rdg->value;
+    s->aux = rdg->aux;
+    histStats.samples++;
+    histStats.appended++;
+}
+
+/*-------------------- R e a d S e r i e s ( ) -------------------------------------
+	Purpose:	Decode one series, oldest sample first.
+        Parameters:     series number, function given each sample
+        Return:         Samples read
+*/
+static CPU_INT32U ReadSeries(CPU_INT16U index, HistEmit emit){
+    ReadingType type = (ReadingType)(index % NumRdgTypes);
+    CPU_INT08U coding = Coding(type);
+    const CPU_INT08U *p, *end;
+    const HistBlock *blk;
+    HistSample smp;
+    CPU_INT32U t, n = 0;
+    CPU_INT32S step;
+    CPU_INT16U b;
+
+    smp.node = NodeCacheNode((NodeSlot)(index / NumRdgTypes + 1));
+    smp.msgType = ReadingTypeChar(type);
+    for(b = series[index].head; b != NoBlock; b = blk->next){
+        blk = &pool[b];
+        t = blk->time;
+        step = 0;
+        smp.time = t * HistTimeUnit;
+        smp.value = blk->value;
+        smp.aux = blk->aux;
+        emit(&smp);
+        n++;
+
+        p = blk->data;
+        end = p + blk->used;
+        while(p < end){
+            step += Unzigzag(GetVarint(&p));
+            t += step;
+            smp.time = t * HistTimeUnit;
+            if(coding & XorValue)
+                smp.value ^= (CPU_INT32S)GetVarint(&p);
+            else
+                smp.value += Unzigzag(GetVarint(&p));
+            if(coding & HasAux)
+                smp.aux = (CPU_INT16S)(smp.aux + Unzigzag(GetVarint(&p)));
+            emit(&smp);
+            n++;
+        }
+    }
+    return n;
+}
+
+/*-------------------- H i s t o r y R e a d ( ) -------------------------------------
+	Purpose:	Decode one node's history of one reading type, oldest first.
+        Parameters:     node number, message type, function given each sample
+        Return:         Samples read
+*/
+CPU_INT32U HistoryRead(CPU_INT32U node, CPU_CHAR msgType, HistEmit emit){
+    ReadingType type = ReadingIndex(msgType);
+    NodeSlot slot = NodeCacheSlot(node);
+
+    if(slot == 0 || type == NumRdgTypes)
+        return 0;
+    return ReadSeries((CPU_INT16U)((slot - 1) * NumRdgTypes + type), emit);
+}
+
+/*-------------------- H i s t o r y R e a d A l l ( ) -------------------------------------
+	Purpose:	Decode every series in turn, node by node.
+        Return:         Samples read
+*/
+CPU_INT32U HistoryReadAll(HistEmit emit){
+    CPU_INT32U index, n = 0;
+
+    for(index = 0; index < NodeCacheUsed() * NumRdgTypes; index++)
+        n += ReadSeries((CPU_INT16U)index, emit);
+    return n;
+}
+
+/*-------------------- H i s t o r y G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out the history counters.
+*/
+CPU_VOID HistoryGetStats(HistStats *stats){
+    *stats = histStats;
+}
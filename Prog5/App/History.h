@@ -0,0 +1,75 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        History.h
+-----------------------------------------------------------------------
+Compressed history of the readings from each node, one series per node
+and reading type, kept in RAM for export.
+
+A sample's time is stored as the change in its time step (delta of
+delta), so readings that come at a steady rate cost one byte of time.
+Its value is stored as the zigzag varint difference from the last one,
+or for date/time stamps the varint XOR with it, so a slowly changing
+reading costs a byte or two more. Series are chains of fixed size
+blocks from one pool; when the pool is used up the oldest block of all
+is taken, so the history covers as far back as the pool allows.
+
+Only nodes with a NodeCache slot have a history, so the station keeps
+at most NodeCacheNodes (16) of them. The 16 KB pool holds about 4700
+samples: with every reading type from all 16 nodes, that is 30 to 50
+minutes at one packet of each a minute, and 2 to 4 hours at one every
+5 minutes (pktBench history). The STM32F107 has 64 KB of SRAM in all,
+so hours of history for dozens of nodes is beyond the station; the
+host tools raise NodeCacheNodes and HistBlocks together.
+*/
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "includes.h"
+#include "Reading.h"
+#include "NodeCache.h"
+
+#ifndef HistBlockSize
+#define HistBlockSize 64      // Bytes in a pool block: a 16 byte header and samples
+#endif
+
+#ifndef HistBlocks
+#define HistBlocks 256        // Blocks in the pool: 16 KB with the default size, a quarter of SRAM
+#endif
+
+#ifndef HistTimeUnit
+#define HistTimeUnit 1000     // Ticks per stored time step: times are kept in seconds
+#endif
+
+typedef struct
+{
+	CPU_INT32U node;          // Node number
+	CPU_CHAR msgType;         // Reading type
+	CPU_INT32U time;          // Arrival in ticks, rounded down to HistTimeUnit
+	CPU_INT32S value;         // As Reading.h
+	CPU_INT16S aux;
+} HistSample;
+
+typedef struct
+{
+	CPU_INT32U samples;       // Samples held now
+	CPU_INT32U appended;      // Samples ever appended
+	CPU_INT32U evicted;       // Samples dropped with their block to make room
+	CPU_INT32U noSlot;        // Readings from nodes NodeCache has no slot for
+	CPU_INT32U blocksUsed;    // Pool blocks holding samples
+} HistStats;
+
+//Called with each sample of a read, oldest first.
+typedef CPU_VOID (*HistEmit)(const HistSample *sample);
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID HistoryInit(CPU_VOID);
+CPU_VOID HistoryAppend(CPU_INT32U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U time);
+CPU_INT32U HistoryRead(CPU_INT32U node, CPU_CHAR msgType, HistEmit emit);
+CPU_INT32U HistoryReadAll(HistEmit emit);
+CPU_VOID HistoryGetStats(HistStats *stats);
+
+#endif
@@ -0,0 +1,257 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        LocalTemp.c
+-----------------------------------------------------------------------
+The local temperature sampler. A read is started by LocalTempStep() and
+finished by the I2C interrupt, which only sets readDone; the next step
+takes the value. The register holds 1/256 degrees in 0.5 degree steps,
+so a sum of LocalTempSamples registers fits easily in 32 bits.
+
+The task is the only caller of LocalTempStep(), so apart from the two
+flags the interrupt sets the state needs no lock.
+*/
+
+#include <string.h>
+#include "Assert.h"
+#include "LocalTemp.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define TempMsgType 'T'
+#define RecPayloadLen (LocalTempRecSize - 1 + 5)  // Length byte: 5 more than the bytes after it, as Parser.c
+#define RegPerDegree 256      // STLM75 temperature register units
+
+#define LOCALTEMP_STK_SIZE 128  // Sampling task stack size
+#define LocalTempPrio 6         // Sampling task priority: below the reply task
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_INT08U stationAddr;          // Source and destination of the payloads
+static CPU_INT32S regSum;               // Registers read in this window
+static CPU_INT08U regCount;             // Number of them
+static CPU_INT08U wakes;                // Wakes in this window
+static CPU_BOOLEAN reading;             // A read was started and not yet taken
+static volatile CPU_BOOLEAN readDone;   // Set by the interrupt when the read ends
+static volatile CPU_BOOLEAN readOk;     // ... and whether it worked
+static LocalTempStats tempStats;
+
+/*-------------------- R e a d D o n e ( ) -------------------------------------
+	Purpose:	Note the end of a read. Called from the I2C interrupt.
+*/
+static CPU_VOID ReadDone(CPU_BOOLEAN ok){
+    readOk = ok;
+    readDone = TRUE;
+}
+
+#ifdef I2CSimulated
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_INT16S simReg;               // Temperature register
+static CPU_INT08U simLatency;           // I2CSimTick() calls a read takes
+static CPU_BOOLEAN simAnswer = TRUE;    // The sensor acknowledges
+static CPU_INT08U simLeft;              // Ticks before the read in progress ends
+static CPU_BOOLEAN simBusy;             // A read is in progress
+static CPU_INT16S simLatched;           // Register as the read in progress saw it
+static CPU_VOID (*simDone)(CPU_BOOLEAN ok);     // What the interrupt would call
+
+/*-------------------- I 2 C S i m S e t ( ) -------------------------------------
+	Purpose:	Set what the simulated sensor does from the next read on.
+        Parameters:     temperature register (1/256 degrees C), I2CSimTick() calls
+                        a read takes, FALSE if it should not acknowledge
+*/
+CPU_VOID I2CSimSet(CPU_INT16S tempReg, CPU_INT08U latency, CPU_BOOLEAN answer){
+    simReg = (CPU_INT16S)(tempReg & ~0x7F);     // 9 bit register: 0.5 degree steps
+    simLatency = latency;
+    simAnswer = answer;
+}
+
+/*-------------------- I 2 C S i m T i c k ( ) -------------------------------------
+	Purpose:	Let time pass: a read whose time is up ends, as the interrupt
+                        would end it.
+*/
+CPU_VOID I2CSimTick(CPU_VOID){
+    if(!simBusy || simLeft-- > 0)
+        return;
+    simBusy = FALSE;
+    simDone(simAnswer);
+}
+
+/*-------------------- T e m p R d S t a r t ( ) -------------------------------------
+	Purpose:	Start a simulated read.
+*/
+static CPU_BOOLEAN TempRdStart(CPU_VOID (*done)(CPU_BOOLEAN ok)){
+    if(simBusy)
+        return FALSE;
+    simBusy = TRUE;
+    simDone = done;
+    simLeft = simLatency;
+    simLatched = simReg;
+    return TRUE;
+}
+
+#define TempRdEnd() simLatched
+
+#else
+
+#include "BfrQ.h"
+#include "Parser.h"
+
+#define TempRdStart(done) BSP_STLM75_TempRdStart(done)
+#define TempRdEnd() BSP_STLM75_TempRdEnd()
+
+#endif
+
+/*-------------------- L o c a l T e m p I n i t ( ) -------------------------------------
+	Purpose:	Start a new window with no read in progress.
+        Parameters:     the station's address, which the payloads come from and go to
+*/
+CPU_VOID LocalTempInit(CPU_INT08U addr){
+    stationAddr = addr;
+    regSum = 0;
+    regCount = 0;
+    wakes = 0;
+    reading = FALSE;
+    readDone = FALSE;
+    memset(&tempStats, 0, sizeof(tempStats));
+}
+
+/*-------------------- A v e r a g e ( ) -------------------------------------
+	Purpose:	Average the window's registers to the nearest whole degree.
+*/
+static CPU_INT16S Average(CPU_VOID){
+    CPU_INT32S div = (CPU_INT32S)regCount * RegPerDegree;
+
+    if(regSum < 0)
+        return (CPU_INT16S)((regSum - div / 2) / div);
+    return (CPU_INT16S)((regSum + div / 2) / div);
+}
+
+/*-------------------- L o c a l T e m p S t e p ( ) -------------------------------------
+	Purpose:	One wake of the sampling task: take the last read's result, start
+                        the next read and, at the end of a window, build its payload.
+        Parameters:     space for a LocalTempRecSize byte queue record
+        Return:         TRUE if rec holds a payload to queue; none is made for a
+                        window in which no read worked
+*/
+CPU_BOOLEAN LocalTempStep(CPU_INT08U *rec){
+    CPU_INT16S value;
+
+    if(reading && !readDone){
+        tempStats.late++;     // Still going: take it next time
+    }else{
+        if(reading){
+            reading = FALSE;
+            if(readOk){
+                regSum += TempRdEnd();
+                regCount++;
+                tempStats.reads++;
+            }else
+                tempStats.failed++;
+        }
+        readDone = FALSE;
+        if(TempRdStart(ReadDone))
+            reading = TRUE;
+        else
+            tempStats.failed++;
+    }
+
+    if(++wakes < LocalTempSamples)
+        return FALSE;
+    wakes = 0;
+    if(regCount == 0)
+        return FALSE;
+
+    value = Average();
+    regSum = 0;
+    regCount = 0;
+    tempStats.last = value;
+
+    //The record LoadPayloadBfrQ() would write for the packet
+    rec[0] = RecPayloadLen;
+    rec[1] = stationAddr;     // dst
+    rec[2] = stationAddr;     // src
+    rec[3] = TempMsgType;
+    rec[4] = (CPU_INT08U)value;
+    rec[5] = (CPU_INT08U)((CPU_INT16U)value >> 8);
+    return TRUE;
+}
+
+/*-------------------- L o c a l T e m p Q u e u e d ( ) -------------------------------------
+	Purpose:	Count a payload as queued or dropped.
+*/
+CPU_VOID LocalTempQueued(CPU_BOOLEAN queued){
+    if(queued)
+        tempStats.queued++;
+    else
+        tempStats.dropped++;
+}
+
+/*-------------------- L o c a l T e m p G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out the sampler's counters.
+*/
+CPU_VOID LocalTempGetStats(LocalTempStats *stats){
+    *stats = tempStats;
+}
+
+#ifndef I2CSimulated
+
+//----- g l o b a l    v a r i a b l e s -----
+static  OS_TCB   localTempTCB;                       // Sampling task TCB
+static  CPU_STK  localTempStk[LOCALTEMP_STK_SIZE];   // Space for sampling task stack
+
+/*-------------------- L o c a l T e m p T a s k ( ) -------------------------------------
+	Purpose:	Read the sensor every LocalTempPeriod ticks and inject each
+                        window's average into the payload buffer queue.
+        Parameters:     the payload buffer queue
+*/
+static CPU_VOID LocalTempTask(CPU_VOID *data){
+    BfrQ *payloadBfrQ = (BfrQ *)data;
+    CPU_INT08U rec[LocalTempRecSize];
+    OS_ERR osErr;
+
+    for(;;){
+        OSTimeDly(LocalTempPeriod, OS_OPT_TIME_PERIODIC, &osErr);
+        assert(osErr == OS_ERR_NONE);
+
+        if(LocalTempStep(rec))
+            LocalTempQueued(BfrQInject(payloadBfrQ, rec, LocalTempRecSize));
+    }
+}
+
+/*--------------- C r e a t e L o c a l T e m p T a s k( ) ---------------
+PURPOSE
+Set up the sensor's I2C bus and create the sampling task.
+
+INPUT PARAMETERS
+payloadBfrQ - The address of the payload buffer queue.
+*/
+CPU_VOID CreateLocalTempTask(CPU_VOID *payloadBfrQ){
+    /* O/S error code */
+    OS_ERR  osErr;
+
+    //No bus, no local readings. A missing sensor only fails each read.
+    if(BSP_STLM75_Init() != DEF_OK)
+        return;
+    LocalTempInit(StationAddr);
+
+    /* Create the sampling Task. */
+    OSTaskCreate(  &localTempTCB,       // Task Control Block
+                 "Local Temp Task",     // Task name
+                 LocalTempTask,         // Task entry point
+                 payloadBfrQ,           // Address of payload buffer queue
+                 LocalTempPrio,         // Task priority
+                 &localTempStk[0],      // Base address of task stack space
+                 LOCALTEMP_STK_SIZE / 10,  // Stack water mark limit
+                 LOCALTEMP_STK_SIZE,    // Task stack size
+                 0,                   // This task has no task queue
+                 0,                   // Number of clock ticks (defaults to 10)
+                 (CPU_VOID      *)0,  // Pointer to TCB extension
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),  // Task options
+                 &osErr);             // Address to return O/S error code
+
+    /* Verify successful task creation. */
+    assert(osErr == OS_ERR_NONE);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        LocalTemp.h
+-----------------------------------------------------------------------
+Samples the board's own STLM75 temperature sensor and queues the
+averages as 'T' payloads from the station's own address, as if a node
+had sent them, so the payload task handles them like any other reading.
+
+The sampling task wakes every LocalTempPeriod ticks. It takes the
+result of the I2C read it started last time, which the I2C interrupt
+has long since finished, and starts the next one, so it never waits on
+the bus. Every LocalTempSamples wakes it averages the reads that worked
+into whole degrees and slips the payload into the PayloadBfrQ between
+the parser's own (BfrQInject()). It runs below the parser, payload and
+reply tasks, and drops the payload rather than wait for room, so the
+radio packets are never held up by it.
+
+Define I2CSimulated (the host tools' HostOS.h does) to read a simulated
+sensor instead; I2CSimSet() gives its temperature, how many wakes a
+read takes and whether it answers, and I2CSimTick() stands in for the
+interrupt.
+*/
+
+#ifndef LOCALTEMP_H
+#define LOCALTEMP_H
+
+#include "includes.h"
+
+#ifndef LocalTempPeriod
+#define LocalTempPeriod 250   // Ticks between reads; the STLM75 converts every 150 ms
+#endif
+
+#ifndef LocalTempSamples
+#define LocalTempSamples 8    // Reads averaged into one payload
+#endif
+
+#define LocalTempRecSize 6    // Queue record: length, dst, src, 'T', value (2)
+
+typedef struct
+{
+	CPU_INT32U reads;         // Reads that worked
+	CPU_INT32U failed;        // Reads that did not start or were not answered
+	CPU_INT32U late;          // Wakes that found the last read still going
+	CPU_INT32U queued;        // Payloads put in the PayloadBfrQ
+	CPU_INT32U dropped;       // Payloads the queue had no room for
+	CPU_INT32S last;          // Last average, whole degrees C
+} LocalTempStats;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID LocalTempInit(CPU_INT08U addr);
+CPU_BOOLEAN LocalTempStep(CPU_INT08U *rec);
+CPU_VOID LocalTempQueued(CPU_BOOLEAN queued);
+CPU_VOID LocalTempGetStats(LocalTempStats *stats);
+
+#ifdef I2CSimulated
+CPU_VOID I2CSimSet(CPU_INT16S tempReg, CPU_INT08U latency, CPU_BOOLEAN answer);
+CPU_VOID I2CSimTick(CPU_VOID);
+#else
+CPU_VOID CreateLocalTempTask(CPU_VOID *payloadBfrQ);
+#endif
+
+#endif
@@ -0,0 +1,297 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        MsgDesc.c
+-----------------------------------------------------------------------
+The message type table, the handler table and the generic field
+decoder. Fields are read a byte at a time from the data bytes, so
+nothing depends on structure packing or the byte order of the machine,
+and the reply text is built without sprintf().
+
+The handler table holds a pointer for every type byte, never NULL:
+unknown types point at unknownHandler, so a lookup needs no search and
+a caller no NULL test. The table takes 1 KB of RAM on the STM32.
+*/
+
+#include "MsgDesc.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define NumTypes 256          // One index entry per message type byte
+#define MaxDigits 10          // Digits in a 32 bit number
+
+//Field shorthands: offset, width, shift, bits, flags, scale
+#define Word16(at, flags)          {at, 2, 0, 0, flags, 1}
+#define Byte(at, flags)            {at, 1, 0, 0, flags, 1}
+#define Bits32BE(shift, bits)      {0, 4, shift, bits, FieldBE, 1}
+
+static const MsgDesc MsgDescs[] =
+{
+    { 'B', 2, "\nN%u P = %u\n",                1, { Word16(0, FieldValue) } },
+    //Date/time: year 12 bits, month 4, day 5, hour 5, minute 6, big endian
+    { 'D', 4, "\nN%u TS = %u/%u/%u %u:%u\n",   6, { {0, 4, 0, 0, FieldBE | FieldValue | FieldHidden, 1},
+                                                   Bits32BE(16, 4), Bits32BE(11, 5), Bits32BE(20, 12),
+                                                   Bits32BE(6, 5), Bits32BE(0, 6) } },
+    { 'H', 3, "\nN%u DP = %u H = %u\n",        2, { Word16(0, FieldSigned | FieldAux), Byte(2, FieldValue) } },
+    { 'I', 0, "\nN%u ID = %s\n",               1, { {0, 0, 0, 0, FieldString, 1} } },
+    //Precipitation: BCD tens, units . tenths, hundredths
+    { 'P', 2, "\nN%u = %u\n",                  1, { {0, 2, 0, 0, FieldBE | FieldBcd | FieldValue, 100} } },
+    { 'R', 2, "\nN%u R = %u\n",                1, { Word16(0, FieldValue) } },
+    { 'T', 2, "\nN%u T = %i\n",                1, { Word16(0, FieldSigned | FieldValue) } },
+    //Wind: BCD hundreds, tens, units . tenths, then direction in degrees
+    { 'W', 4, "\nN%u SP = %u  DIR = %u\n",     2, { {0, 2, 0, 0, FieldBE | FieldBcd | FieldValue, 10},
+                                                   Word16(2, FieldAux) } },
+};
+
+#define NumDescs (sizeof(MsgDescs) / sizeof(MsgDescs[0]))
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+static CPU_BOOLEAN UnknownDecode(const MsgDesc *desc, const CPU_INT08U *data,
+                                 CPU_INT08S dataLen, Reading *reading);
+static CPU_BOOLEAN UnknownFormat(const MsgDesc *desc, CPU_INT08U node, const CPU_INT08U *data,
+                                 CPU_INT08S dataLen, CPU_CHAR *message);
+static CPU_BOOLEAN NoAggregate(CPU_INT32U node, CPU_CHAR msgType, CPU_INT32S value);
+
+//----- g l o b a l    v a r i a b l e s -----
+static const MsgHandler unknownHandler = {NULL, UnknownDecode, UnknownFormat, NoAggregate};
+static MsgHandler descHandlers[NumDescs];         // The MsgDescs types' handlers
+static const MsgHandler *handlers[NumTypes];      // Handler by message type
+static CPU_BOOLEAN handlersReady = FALSE;
+static CPU_INT32U unknownCount;                   // Decodes of types with no handler
+
+/*-------------------- U n k n o w n D e c o d e ( ) -------------------------------------
+	Purpose:	Decode for every type with no handler: count it. Each payload is
+                        decoded once, so this counts payloads of unknown types.
+        Return:         FALSE - No reading
+*/
+static CPU_BOOLEAN UnknownDecode(const MsgDesc *desc, const CPU_INT08U *data,
+                                 CPU_INT08S dataLen, Reading *reading){
+    unknownCount++;
+    return FALSE;
+}
+
+/*-------------------- U n k n o w n F o r m a t ( ) -------------------------------------
+	Purpose:	Format for every type with no handler.
+        Return:         FALSE - The caller reports a bad type
+*/
+static CPU_BOOLEAN UnknownFormat(const MsgDesc *desc, CPU_INT08U node, const CPU_INT08U *data,
+                                 CPU_INT08S dataLen, CPU_CHAR *message){
+    return FALSE;
+}
+
+/*-------------------- N o A g g r e g a t e ( ) -------------------------------------
+	Purpose:	Aggregate for types whose readings are not summarized.
+        Return:         FALSE: the reading is sent as it is
+*/
+static CPU_BOOLEAN NoAggregate(CPU_INT32U node, CPU_CHAR msgType, CPU_INT32S value){
+    return FALSE;
+}
+
+/*-------------------- M s g H a n d l e r s I n i t ( ) -------------------------------------
+	Purpose:	Install the MsgDescs types' handlers, point every other type at the
+                        unknown handler and clear its count. Handlers registered
+                        earlier are dropped.
+        Parameters:     function given the descriptor types' readings, or NULL
+*/
+CPU_VOID MsgHandlersInit(MsgAggregateFn aggregate){
+    CPU_INT16U i;
+
+    for(i = 0; i < NumTypes; i++)
+        handlers[i] = &unknownHandler;
+    for(i = 0; i < NumDescs; i++){
+        descHandlers[i].desc = &MsgDescs[i];
+        descHandlers[i].decode = MsgReading;
+        descHandlers[i].format = MsgFormat;
+        descHandlers[i].aggregate = aggregate != NULL ? aggregate : NoAggregate;
+        handlers[(CPU_INT08U)MsgDescs[i].msgType] = &descHandlers[i];
+    }
+    unknownCount = 0;
+    handlersReady = TRUE;
+}
+
+/*-------------------- M s g R e g i s t e r ( ) -------------------------------------
+	Purpose:	Install a message type's handler, replacing any it had. The handler
+                        is kept by address, so it must not go away; every function
+                        must be set. Register after MsgHandlersInit(). A new type
+                        takes a spare reading slot, which it keeps if unregistered.
+        Parameters:     message type, handler or NULL to make the type unknown again
+        Return:         FALSE if the type needed a reading slot and none was left;
+                        the handler is not installed
+*/
+CPU_BOOLEAN MsgRegister(CPU_CHAR msgType, const MsgHandler *handler){
+    if(!handlersReady)
+        MsgHandlersInit(NULL);
+    if(handler != NULL && ReadingTypeAdd(msgType) == NumRdgTypes)
+        return FALSE;
+    handlers[(CPU_INT08U)msgType] = handler != NULL ? handler : &unknownHandler;
+    return TRUE;
+}
+
+/*-------------------- M s g H a n d l e r F i n d ( ) -------------------------------------
+	Purpose:	Look up a message type's handler.
+        Return:         The handler; the unknown handler if the type has none.
+*/
+const MsgHandler *MsgHandlerFind(CPU_CHAR msgType){
+    //Tools that never call MsgHandlersInit() get the descriptor types
+    if(!handlersReady)
+        MsgHandlersInit(NULL);
+    return handlers[(CPU_INT08U)msgType];
+}
+
+/*-------------------- M s g U n k n o w n C o u n t ( ) -------------------------------------
+	Purpose:	Read the unknown handler's count.
+        Return:         Payloads of types with no handler since MsgHandlersInit()
+*/
+CPU_INT32U MsgUnknownCount(CPU_VOID){
+    return unknownCount;
+}
+
+/*-------------------- M s g D e s c F i n d ( ) -------------------------------------
+	Purpose:	Look up a message type's descriptor.
+        Return:         The descriptor, or NULL for an unknown type or one
+                        whose handler has none.
+*/
+const MsgDesc *MsgDescFind(CPU_CHAR msgType){
+    return MsgHandlerFind(msgType)->desc;
+}
+
+/*-------------------- M s g F i e l d ( ) -------------------------------------
+	Purpose:	Read a numeric field from the data bytes.
+*/
+CPU_INT32S MsgField(const FieldDesc *field, const CPU_INT08U *data){
+    const CPU_INT08U *bytes = data + field->offset;
+    CPU_INT32U word = 0;
+    CPU_INT32U value = 0;
+    CPU_INT08U bits = field->bits ? field->bits : 8 * field->width;
+    CPU_INT08U i;
+
+    if(field->flags & FieldBE)
+        for(i = 0; i < field->width; i++)
+            word = (word << 8) | bytes[i];
+    else
+        for(i = field->width; i > 0; i--)
+            word = (word << 8) | bytes[i - 1];
+    word >>= field->shift;
+    if(bits < 32)
+        word &= ((CPU_INT32U)1 << bits) - 1;
+
+    if(field->flags & FieldBcd){
+        //Most significant digit first
+        for(i = bits; i >= 4; i -= 4)
+            value = value * 10 + ((word >> (i - 4)) & 0x0F);
+        return (CPU_INT32S)value;
+    }
+    if((field->flags & FieldSigned) && bits < 32 && (word & ((CPU_INT32U)1 << (bits - 1))))
+        word |= ~(((CPU_INT32U)1 << bits) - 1);
+    return (CPU_INT32S)word;
+}
+
+/*-------------------- P u t U n s ( ) -------------------------------------
+	Purpose:	Write an unsigned number in decimal with at least minDigits digits.
+        Return:         Where the next character goes
+*/
+static CPU_CHAR *PutUns(CPU_CHAR *out, CPU_INT32U value, CPU_INT08U minDigits){
+    CPU_CHAR digits[MaxDigits];
+    CPU_INT08U n = 0;
+
+    do{
+        digits[n++] = (CPU_CHAR)('0' + value % 10);
+        value /= 10;
+    }while(value != 0 || n < minDigits);
+    while(n > 0)
+        *out++ = digits[--n];
+    return out;
+}
+
+/*-------------------- P u t F i e l d ( ) -------------------------------------
+	Purpose:	Write one field for a %u, %i or %s conversion.
+        Return:         Where the next character goes
+*/
+static CPU_CHAR *PutField(CPU_CHAR *out, CPU_CHAR conv, const FieldDesc *field,
+                          const CPU_INT08U *data, CPU_INT08S dataLen){
+    CPU_INT32S value;
+    CPU_INT08S i;
+
+    if(field->flags & FieldString){
+        //Stop at the end of the data or at a terminator, as %s would
+        for(i = field->offset; i < dataLen && data[i] != '\0'; i++)
+            *out++ = (CPU_CHAR)data[i];
+        return out;
+    }
+
+    value = MsgField(field, data);
+    if(conv == 'i' && value < 0){
+        *out++ = '-';
+        return PutUns(out, (CPU_INT32U)0 - (CPU_INT32U)value, 1);
+    }
+    if(field->scale > 1){
+        out = PutUns(out, (CPU_INT32U)value / field->scale, 1);
+        *out++ = '.';
+        return PutUns(out, (CPU_INT32U)value % field->scale, field->scale == 100 ? 2 : 1);
+    }
+    return PutUns(out, (CPU_INT32U)value, 1);
+}
+
+/*-------------------- M s g F o r m a t ( ) -------------------------------------
+	Purpose:	Write the reply text for a payload's data bytes.
+        Parameters:     descriptor, node address, data bytes, number of data bytes,
+                        message space
+        Return:         FALSE if there are too few data bytes for the fields
+*/
+CPU_BOOLEAN MsgFormat(const MsgDesc *desc, CPU_INT08U node, const CPU_INT08U *data,
+                      CPU_INT08S dataLen, CPU_CHAR *message){
+    const CPU_CHAR *format = desc->format;
+    const FieldDesc *field = desc->fields;
+    const FieldDesc *end = field + desc->numFields;
+    CPU_BOOLEAN nodeDone = FALSE;
+    CPU_CHAR conv;
+
+    if(dataLen < desc->minLen)
+        return FALSE;
+
+    while(*format != '\0'){
+        if(*format != '%'){
+            *message++ = *format++;
+            continue;
+        }
+        conv = format[1];
+        format += 2;
+        if(!nodeDone){
+            message = PutUns(message, node, 1);
+            nodeDone = TRUE;
+            continue;
+        }
+        while(field < end && (field->flags & FieldHidden))
+            field++;
+        if(field == end)
+            break;
+        message = PutField(message, conv, field++, data, dataLen);
+    }
+    *message = '\0';
+    return TRUE;
+}
+
+/*-------------------- M s g R e a d i n g ( ) -------------------------------------
+	Purpose:	Decode the fixed point reading from a payload's data bytes.
+        Return:         FALSE if the type has no value field or there are too few bytes
+*/
+CPU_BOOLEAN MsgReading(const MsgDesc *desc, const CPU_INT08U *data, CPU_INT08S dataLen, Reading *reading){
+    CPU_BOOLEAN found = FALSE;
+    CPU_INT08U i;
+
+    if(dataLen < desc->minLen)
+        return FALSE;
+
+    reading->aux = 0;
+    for(i = 0; i < desc->numFields; i++){
+        const FieldDesc *field = &desc->fields[i];
+
+        if(field->flags & FieldValue){
+            reading->value = MsgField(field, data);
+            found = TRUE;
+        }else if(field->flags & FieldAux)
+            reading->aux = (CPU_INT16S)MsgField(field, data);
+    }
+    return found;
+}
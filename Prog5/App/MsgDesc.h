@@ -0,0 +1,97 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        MsgDesc.h
+-----------------------------------------------------------------------
+Message type descriptors. Each message type is a constant table entry
+that says where its fields sit in the data bytes and how they are
+encoded; one decoder reads any type's fields straight from the bytes.
+A new sensor type is a new entry in MsgDescs[] (MsgDesc.c), or a
+handler registered at run time.
+
+Every message type byte has a slot in a 256 entry handler table, so
+finding a type's decode, format and aggregate functions is one index.
+The descriptor types are installed with the generic functions below;
+MsgRegister() installs (or replaces) any type's handler. Types with no
+handler share one that fails the decode and format and counts them.
+A registered type also gets a reading slot (Reading.h), so its readings
+are cached, deadbanded, kept in the history and aggregated like the
+descriptor types'.
+
+A field is a bit range of a 1 to 4 byte word that starts at a data
+byte offset. The word is little endian unless FieldBE is set. The bits
+may be a signed number or packed BCD digits, and a scale of 10 or 100
+prints the value with that many tenths or hundredths.
+
+The reply text format is plain text with conversions: the first %u is
+the node address, then each field not marked FieldHidden takes the next
+conversion in field order. %u prints a field unsigned, %i signed and %s
+prints a FieldString field.
+*/
+
+#ifndef MSGDESC_H
+#define MSGDESC_H
+
+#include "includes.h"
+#include "Reading.h"
+
+#define MsgMaxFields 6        // Fields a message type can have
+
+//FieldDesc flags
+#define FieldBE 0x01          // The word is big endian
+#define FieldSigned 0x02      // Sign extend the field
+#define FieldBcd 0x04         // The field is packed BCD digits
+#define FieldString 0x08      // The field is characters to the end of the data
+#define FieldValue 0x10       // The field is the reading's value
+#define FieldAux 0x20         // The field is the reading's aux
+#define FieldHidden 0x40      // The field is not printed
+
+typedef struct
+{
+	CPU_INT08U offset;        // First data byte of the word holding the field
+	CPU_INT08U width;         // Bytes in the word, 1 to 4
+	CPU_INT08U shift;         // Lowest bit of the field in the word
+	CPU_INT08U bits;          // Bits in the field; 0 for the whole word
+	CPU_INT08U flags;         // Field... flags
+	CPU_INT08U scale;         // 1, or 10 or 100 to print tenths or hundredths
+} FieldDesc;
+
+typedef struct
+{
+	CPU_CHAR msgType;         // Message type byte
+	CPU_INT08U minLen;        // Data bytes the fields need
+	const CPU_CHAR *format;   // Reply text
+	CPU_INT08U numFields;
+	FieldDesc fields[MsgMaxFields];
+} MsgDesc;
+
+//Handler functions. The handler's desc is passed back to decode and format.
+typedef CPU_BOOLEAN (*MsgDecodeFn)(const MsgDesc *desc, const CPU_INT08U *data,
+                                   CPU_INT08S dataLen, Reading *reading);
+typedef CPU_BOOLEAN (*MsgFormatFn)(const MsgDesc *desc, CPU_INT08U node, const CPU_INT08U *data,
+                                   CPU_INT08S dataLen, CPU_CHAR *message);
+//Returns TRUE if the reading went into a summary.
+typedef CPU_BOOLEAN (*MsgAggregateFn)(CPU_INT32U node, CPU_CHAR msgType, CPU_INT32S value);
+
+typedef struct
+{
+	const MsgDesc *desc;      // Layout for decode and format; may be NULL
+	MsgDecodeFn decode;       // Data bytes to a reading; FALSE if none
+	MsgFormatFn format;       // Data bytes to reply text; FALSE if it can't
+	MsgAggregateFn aggregate; // Given each reading the payload task decodes
+} MsgHandler;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID MsgHandlersInit(MsgAggregateFn aggregate);
+CPU_BOOLEAN MsgRegister(CPU_CHAR msgType, const MsgHandler *handler);
+const MsgHandler *MsgHandlerFind(CPU_CHAR msgType);
+CPU_INT32U MsgUnknownCount(CPU_VOID);
+const MsgDesc *MsgDescFind(CPU_CHAR msgType);
+CPU_INT32S MsgField(const FieldDesc *field, const CPU_INT08U *data);
+CPU_BOOLEAN MsgFormat(const MsgDesc *desc, CPU_INT08U node, const CPU_INT08U *data,
+                      CPU_INT08S dataLen, CPU_CHAR *message);
+CPU_BOOLEAN MsgReading(const MsgDesc *desc, const CPU_INT08U *data, CPU_INT08S dataLen, Reading *reading);
+
+#endif
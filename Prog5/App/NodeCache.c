@@ -0,0 +1,149 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        NodeCache.c
+-----------------------------------------------------------------------
+Latest reading cache. A node number maps to a slot through slotOf[],
+and a slot holds one NodeEntry per reading type, so both update and
+lookup are two array indexes. Slots are handed out first come, first
+served and are never reused until NodeCacheInit().
+
+Only one task may call NodeCacheUpdate(). It makes an entry's sequence
+count odd, writes the entry and makes the count even again. Readers
+copy the entry and retry if the count was odd or changed meanwhile.
+With the defaults the cache takes about 2 KB of RAM.
+*/
+
+#include <string.h>
+#include "NodeCache.h"
+
+//Keep the compiler (and on a multicore host, the CPU) from moving
+//entry accesses across the sequence count updates.
+#if defined(__GNUC__)
+#define SeqBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define SeqBarrier() __DMB()
+#endif
+
+//----- g l o b a l    v a r i a b l e s -----
+static volatile NodeSlot slotOf[NodeKeys];               // Slot number + 1, or 0 if none
+static NodeEntry entries[NodeCacheNodes][NumRdgTypes];
+static CPU_INT32U nodeOf[NodeCacheNodes];                // Node number in each slot
+static CPU_INT32U usedSlots;
+static NodeCacheStats cacheStats;
+
+/*-------------------- N o d e C a c h e I n i t ( ) -------------------------------------
+	Purpose:	Empty the cache. Not safe while other tasks are reading it.
+*/
+CPU_VOID NodeCacheInit(CPU_VOID){
+    memset((CPU_VOID *)slotOf, 0, sizeof(slotOf));
+    memset(entries, 0, sizeof(entries));
+    memset(&cacheStats, 0, sizeof(cacheStats));
+    usedSlots = 0;
+}
+
+/*-------------------- N o d e C a c h e U p d a t e ( ) -------------------------------------
+	Purpose:	Store a node's latest reading of one type.
+        Parameters:     node number, message type, reading, arrival time
+        Return:         TRUE -  The reading was stored
+                        FALSE - Not a reading type, or no room for the node
+*/
+CPU_BOOLEAN NodeCacheUpdate(CPU_INT32U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U time){
+    ReadingType type = ReadingIndex(msgType);
+    NodeEntry *entry;
+    CPU_INT32U seq;
+    NodeSlot slot;
+
+    if(type == NumRdgTypes)
+        return FALSE;
+    if(node >= NodeKeys){
+        cacheStats.badNode++;
+        return FALSE;
+    }
+
+    slot = slotOf[node];
+    if(slot == 0){
+        if(usedSlots >= NodeCacheNodes){
+            cacheStats.full++;
+            return FALSE;
+        }
+        nodeOf[usedSlots] = node;
+        slot = (NodeSlot)++usedSlots;
+        slotOf[node] = slot;    // The slot's entries are still all zero
+    }
+
+    entry = &entries[slot - 1][type];
+    seq = entry->seq;
+    entry->seq = seq + 1;
+    SeqBarrier();
+    entry->rdg = *rdg;
+    entry->time = time;
+    SeqBarrier();
+    entry->seq = seq + 2;
+
+    cacheStats.updates++;
+    return TRUE;
+}
+
+/*-------------------- N o d e C a c h e R e a d ( ) -------------------------------------
+	Purpose:	Fetch a node's latest reading of one type. Safe from any task
+                        or thread; never blocks the updating task.
+        Parameters:     node number, message type, reading and arrival time returned
+        Return:         TRUE -  A reading was returned
+                        FALSE - No reading of that type from that node yet
+*/
+CPU_BOOLEAN NodeCacheRead(CPU_INT32U node, CPU_CHAR msgType, Reading *rdg, CPU_INT32U *time){
+    ReadingType type = ReadingIndex(msgType);
+    NodeEntry *entry;
+    CPU_INT32U seq;
+    NodeSlot slot;
+
+    if(type == NumRdgTypes || node >= NodeKeys)
+        return FALSE;
+    slot = slotOf[node];
+    if(slot == 0)
+        return FALSE;
+
+    entry = &entries[slot - 1][type];
+    do{
+        seq = entry->seq;
+        SeqBarrier();
+        *rdg = entry->rdg;
+        *time = entry->time;
+        SeqBarrier();
+    }while((seq & 1) || seq != entry->seq);
+
+    return seq != 0;
+}
+
+/*-------------------- N o d e C a c h e U s e d ( ) -------------------------------------
+	Purpose:	Return the number of nodes that have a slot.
+*/
+CPU_INT32U NodeCacheUsed(CPU_VOID){
+    return usedSlots;
+}
+
+/*-------------------- N o d e C a c h e S l o t ( ) -------------------------------------
+	Purpose:	Return the slot a node's readings are kept in, so other modules
+                        can keep per-node data in arrays of NodeCacheNodes.
+        Return:         1..NodeCacheNodes, or 0 if the node has no slot
+*/
+NodeSlot NodeCacheSlot(CPU_INT32U node){
+    return node < NodeKeys ? slotOf[node] : 0;
+}
+
+/*-------------------- N o d e C a c h e N o d e ( ) -------------------------------------
+	Purpose:	Return the node number held in a slot from NodeCacheSlot().
+*/
+CPU_INT32U NodeCacheNode(NodeSlot slot){
+    return nodeOf[slot - 1];
+}
+
+/*-------------------- N o d e C a c h e G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy the cache counters.
+*/
+CPU_VOID NodeCacheGetStats(NodeCacheStats *stats){
+    *stats = cacheStats;
+}
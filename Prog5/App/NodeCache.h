@@ -0,0 +1,58 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        NodeCache.h
+-----------------------------------------------------------------------
+Latest reading of every message type from every node, with the time it
+arrived. One task updates the cache; any task may read it. Each entry
+is guarded by a sequence count, so neither side ever blocks.
+*/
+
+#ifndef NODECACHE_H
+#define NODECACHE_H
+
+#include "includes.h"
+#include "Reading.h"
+
+#ifndef NodeKeys
+#define NodeKeys 256          // Node numbers accepted: one per 8 bit source address
+#endif
+
+#ifndef NodeCacheNodes
+#define NodeCacheNodes 16     // Nodes that can be cached at once
+#endif
+
+#if NodeCacheNodes < 255
+typedef CPU_INT08U NodeSlot;
+#elif NodeCacheNodes < 65535
+typedef CPU_INT16U NodeSlot;
+#else
+typedef CPU_INT32U NodeSlot;
+#endif
+
+typedef struct
+{
+	volatile CPU_INT32U seq;    // Odd while being updated, 0 if never written
+	Reading rdg;                // Latest reading
+	CPU_INT32U time;            // When it arrived (OS ticks on the station)
+} NodeEntry;
+
+typedef struct
+{
+	CPU_INT32U updates;         // Readings stored
+	CPU_INT32U full;            // Readings dropped: every slot already taken
+	CPU_INT32U badNode;         // Readings dropped: node number >= NodeKeys
+} NodeCacheStats;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID NodeCacheInit(CPU_VOID);
+CPU_BOOLEAN NodeCacheUpdate(CPU_INT32U node, CPU_CHAR msgType, const Reading *rdg, CPU_INT32U time);
+CPU_BOOLEAN NodeCacheRead(CPU_INT32U node, CPU_CHAR msgType, Reading *rdg, CPU_INT32U *time);
+CPU_INT32U NodeCacheUsed(CPU_VOID);
+NodeSlot NodeCacheSlot(CPU_INT32U node);
+CPU_INT32U NodeCacheNode(NodeSlot slot);
+CPU_VOID NodeCacheGetStats(NodeCacheStats *stats);
+
+#endif
@@ -7,6 +7,47 @@
 -----------------------------------------------------------------------
 The packet parser task module  same as Program 3
 The packet parser task module. Parser() must be a uC/OS-III style task.
+
+Packets are filtered on their destination address as soon as it arrives.
+A packet for an address outside the station's address set is never
+stored or queued; the parser only follows its checksum to the end.
+Relayed copies of a packet seen in the last DupTtl ticks are dropped
+after their checksum passes, before they reach the PayloadBfrQ.
+
+CRC mode packets start with P3CrcChar in place of P3Char, have no
+checksum byte, and end with a CRC-32 (see Crc32.h) of K through the
+last data byte, little endian:
+
+    03 AF 5C | K | dst src type data ... | CRC (4)
+
+K counts every byte. The CRC unit takes the bytes a word at a time as
+they arrive, so checking the packet costs nothing once it has ended.
+
+Aggregate frames carry several payloads behind one preamble and one
+checksum. Each record is its length (dst through data) and the payload:
+
+    03 AF A6 | C | K | n dst src type data ... | n dst src type data ... 
+
+Each record is collected in the parser's payload buffer and checked
+against the duplicate cache like a single payload. A new one goes into
+the PayloadBfrQ write buffer as the length and bytes LoadPayloadBfrQ()
+would have written, so the payload task reads it like a single payload.
+The buffer is posted only when the checksum passes. If it does not, the
+buffer is emptied and the records are taken back out of the cache, so
+a relayed copy of the frame still gets through. A frame must fit in
+one buffer.
+
+Console command frames (see Console.h) have their own third preamble
+byte and no addresses; the data is the command and its arguments:
+
+    03 AF C5 | C | K | command args ...
+
+They are never queued. The parser hands them straight to the console task.
+
+With SerRxDma (SerIODriver.h) the parser reads the receive DMA ring a
+span at a time, parsing each byte in place, and releases only the bytes
+it has parsed: a span that runs past the end of a payload is picked up
+again, at the next byte, once a new write buffer is open.
 */
 #include "Assert.h"
 #include "Parser.h"
@@ -14,9 +55,16 @@ The packet parser task module. Parser() must be a uC/OS-III style task.
 #include "SerIODriver.h"
 #include "Bfr.h"
 #include "Payload.h"
+#include "DupCache.h"
+#include "Crc32.h"
+#include "Console.h"
+#include "Boot.h"
 
 //Set the parser states to a numerical value through enumeration.
-typedef enum {P1, P2, P3, C, K, D, ER } ParserState;
+//SK skips the data of a packet for another station. CR collects the CRC
+//of a CRC mode packet. AN and AR take an aggregate frame's record length
+//and record bytes.
+typedef enum {P1, P2, P3, C, K, D, SK, CR, AN, AR, ER } ParserState;
 
 //----- c o n s t a n t    d e f i n i t  i o n s -----
 #define SuspendTimeout 100   // Timeout for semaphore wait
@@ -27,13 +75,29 @@ typedef enum {P1, P2, P3, C, K, D, ER } ParserState;
 #define P1Char 0x03
 #define P2Char 0xAF
 #define P3Char 0xEF
+#define P3CrcChar 0x5C        // Third preamble byte of a CRC mode packet
+#define P3AggChar 0xA6        // Third preamble byte of an aggregate frame
+#define P3CmdChar 0xC5        // Third preamble byte of a console command frame
 
 //Number of bytes of header before the payload starts.
 #define PacketHeaderDiff 5  
+#define CrcHeaderDiff 8      // Bytes other than payload in a CRC mode packet
+#define CrcLen 4             // Bytes of CRC
+
+//Destination address set, one bit per address
+#define AddrWords (256 / 32)
+#define AddrWord(addr) ((addr) >> 5)
+#define AddrBit(addr) (1UL << ((addr) & 0x1F))
 
 //----- g l o b a l    v a r i a b l e s -----
 static  OS_TCB   parserTCB;                  // Reply Task TCB
 static  CPU_STK  parserStk[PARSER_STK_SIZE];  // Space for Reply Task stack
+static  CPU_INT32U acceptAddr[AddrWords];     // Addresses this station takes packets for
+static  ParserStats parserStats;              // Payload, filter and error counters
+static  CPU_INT32U crcWord;                   // CRC mode bytes not yet given to the CRC unit
+static  CPU_INT08U crcBytes;                  // Number of them
+static  BfrQ *parserBfrQ;                     // Where aggregate frame payloads go
+static  CPU_INT32U aggTags[BfrQSize / 2];     // Hashes of the aggregate frame records queued
 
 /*-------------------- Local Function Prototypes -----------------------------*/
 CPU_VOID Error(PktBfr *pktBfr, ParserState *parserState, ErrorState errState);
@@ -48,6 +112,12 @@ payloadBfrQ - The address of the reply buffer queue.
 CPU_VOID CreateParserTask(CPU_VOID *payloadBfrQ){
     OS_ERR  osErr;     /* O/S error code */                       
     
+    /* Take packets for this station and broadcasts. */
+    ParserAcceptAddr(StationAddr, TRUE);
+    ParserAcceptAddr(BroadcastAddr, TRUE);
+    DupCacheInit();
+    Crc32Init();
+    
     /* Create the Reply Task. */
     OSTaskCreate(  &parserTCB,         // Task Control Block
                  "Parser Task",        // Task name
@@ -60,7 +130,7 @@ CPU_VOID CreateParserTask(CPU_VOID *payloadBfrQ){
                  0,                   // This task has no task queue
                  0,                   // Number of clock ticks (defaults to 10)
                  (CPU_VOID      *)0,  // Pointer to TCB extension
-                 OS_OPT_TASK_NONE,    // Task options
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),  // Task options
                  &osErr);             // Address to return O/S error code
     
     /* Verify successful task creation. */
@@ -78,6 +148,107 @@ length and no data bytes. The new packet structure is shown below
 CPU_VOID Error(PktBfr *pktBfr, ParserState *parserState, ErrorState errState){
     *parserState = ER;
     pktBfr->payloadLen = (0 - errState); //Make the error state negative
+    parserStats.errors[errState]++;
+}
+
+/*-------------------- P a r s e r A c c e p t A d d r ( ) -------------------------------------
+	Purpose:	Add an address to the station's address set, or remove it.
+        Parameters:     address, TRUE to take its packets, FALSE to drop them
+*/
+CPU_VOID ParserAcceptAddr(CPU_INT08U addr, CPU_BOOLEAN accept){
+    CPU_SR_ALLOC();
+    
+    //The parser reads the set at any time, so update it in one piece
+    OS_CRITICAL_ENTER();
+    if(accept)
+        acceptAddr[AddrWord(addr)] |= AddrBit(addr);
+    else
+        acceptAddr[AddrWord(addr)] &= ~AddrBit(addr);
+    OS_CRITICAL_EXIT();
+}
+
+/*-------------------- P a r s e r A d d r A c c e p t e d ( ) -------------------------------------
+	Purpose:	Tell whether an address is in the station's address set.
+*/
+CPU_BOOLEAN ParserAddrAccepted(CPU_INT08U addr){
+    return (acceptAddr[AddrWord(addr)] & AddrBit(addr)) != 0;
+}
+
+/*-------------------- P a r s e r G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy the payload, filter and error counters.
+*/
+CPU_VOID ParserGetStats(ParserStats *stats){
+    *stats = parserStats;
+}
+
+/*-------------------- C r c B y t e ( ) -------------------------------------
+	Purpose:	Add a CRC mode byte to the CRC, a word at a time.
+*/
+static CPU_VOID CrcByte(CPU_INT08U nextByte){
+    crcWord |= (CPU_INT32U)nextByte << (8 * crcBytes);
+    if (++crcBytes == 4){
+        CrcUnitWord(crcWord);
+        crcWord = 0;
+        crcBytes = 0;
+    }
+}
+
+/*-------------------- E n d P a c k e t ( ) -------------------------------------
+	Purpose:	Finish a packet once its last byte has been parsed.
+        Parameters:     payload buffer, parser state, packet was for another station,
+                        checksum or CRC matched, packet is a console command frame
+        Return:         ParsePayload - A payload or error payload is ready
+                        ParseCommand - A console command is ready
+                        ParseMore -    The packet was for another station
+*/
+static ParseResult EndPacket(PktBfr *pktBfr, ParserState *parserState, CPU_BOOLEAN filtered,
+                             CPU_BOOLEAN intact, CPU_BOOLEAN command){
+    *parserState = P1;
+    
+    //Checksum Error if all packets XOR'd != 0, or the CRC is wrong. The damage
+    //may be in the destination address itself, so a filtered packet still reports it.
+    if (!intact){
+        if (filtered)
+            parserStats.filteredBadCs++;
+        Error(pktBfr, parserState, E4);
+        return ParsePayload;
+    }
+    if (filtered){
+        parserStats.filtered++;
+        return ParseMore;
+    }
+    if (command){
+        parserStats.commands++;
+        return ParseCommand;
+    }
+    parserStats.payloads++;
+    return ParsePayload;
+}
+
+/*-------------------- E n d A g g r e g a t e ( ) -------------------------------------
+	Purpose:	Finish an aggregate frame once its last byte has been parsed.
+        Parameters:     payload buffer, parser state, checksum matched,
+                        records queued, records for other stations
+        Return:         ParseQueued -  Payloads are in the queue write buffer
+                        ParsePayload - A checksum error payload is ready
+                        ParseMore -    Every record was for another station
+*/
+static ParseResult EndAggregate(PktBfr *pktBfr, ParserState *parserState, CPU_BOOLEAN intact,
+                                CPU_INT08U kept, CPU_INT08U filtered){
+    *parserState = P1;
+    
+    //Throw the records away: any of them may be damaged
+    if (!intact){
+        while (kept > 0)
+            DupCacheForget(aggTags[--kept]);
+        BfrQWriteReset(parserBfrQ);
+        Error(pktBfr, parserState, E4);
+        return ParsePayload;
+    }
+    parserStats.aggregates++;
+    parserStats.payloads += kept;
+    parserStats.filtered += filtered;
+    return kept != 0 ? ParseQueued : ParseMore;
 }
 
 
@@ -94,6 +265,45 @@ CPU_VOID LoadPayloadBfrQ(BfrQ *payloadBfrQ, void *payloadBfr){
  
 }
 
+/*-------------------- I s D u p l i c a t e ( ) -------------------------------------
+	Purpose:	Tell whether a finished payload is a relayed copy of a recent one.
+                        Source, type and data bytes are compared; error payloads never are.
+*/
+static CPU_BOOLEAN IsDuplicate(PktBfr *pktBfr){
+    OS_ERR osErr;
+    
+    if(pktBfr->payloadLen <= 0)
+        return FALSE;
+    return DupCacheSeen(&pktBfr->data[1], pktBfr->payloadLen - PacketHeaderDiff - 1, OSTimeGet(&osErr));
+}
+
+/*-------------------- P a r s e N e x t ( ) -------------------------------------
+    Purpose:        Parse one received byte and act on what it finishes: hand a
+                    command to the console, or queue a payload unless it is a copy.
+    Return:         TRUE if the PayloadBfrQ write buffer was posted
+*/
+static CPU_BOOLEAN ParseNext(BfrQ *payloadBfrQ, Payload *parserPayload, CPU_INT08U nextByte){
+    ParseResult result = ParseByte(parserPayload, nextByte);
+    
+    //A command goes to the console, keeping the write buffer
+    if(result == ParseCommand){
+        ConsolePost(((PktBfr *)parserPayload)->data,
+                    ((PktBfr *)parserPayload)->payloadLen - PacketHeaderDiff);
+        return FALSE;
+    }
+    if(result == ParsePayload){
+        //Drop a copy, keeping the write buffer for the next payload
+        if(IsDuplicate((PktBfr *)parserPayload))
+            return FALSE;
+        LoadPayloadBfrQ(payloadBfrQ, parserPayload);
+    }
+    if(result == ParseMore)
+        return FALSE;
+    BfrQPostRead(payloadBfrQ); // Post to Read buffer - Done producing
+    BootStamp(BootFirstPkt);
+    return TRUE;
+}
+
 /*-------------------- P a r s e r T a s k ( ) -------------------------------------
     Packet Parser Task: Read a packet from iBfr and extract a payload to the
                         payload buffer queue write buffer.
@@ -106,33 +316,54 @@ CPU_VOID ParserTask(CPU_VOID *data){
     BfrQ *payloadBfrQ = (BfrQ *) data;
     static Payload parserPayload;
     
+    parserBfrQ = payloadBfrQ;
     for(;;){
       
         BfrQPendWrite(payloadBfrQ); //Pend on Write buffer - Start Producing
         
         for (;;){    
+#ifdef SerRxDma
+            const CPU_INT08U *span;
+            CPU_INT16U len = GetSpan(&span);  //Pend on spanAvail
+            CPU_INT16U used = 0;
+            CPU_BOOLEAN posted = FALSE;
+            
+            while(used < len && !posted)
+                posted = ParseNext(payloadBfrQ, &parserPayload, span[used++]);
+            ReleaseSpan(used);
+            if(posted)
+                break;
+#else
             CPU_INT16S nextByte = GetByte();  //Pend on bytesAvail 
             
-            if((nextByte >= 0)){
-                if(ParseByte(&parserPayload, nextByte)){
-                    LoadPayloadBfrQ(payloadBfrQ, &parserPayload);
-                    BfrQPostRead(payloadBfrQ); // Post to Read buffer - Done producing
-                    break;
-                }
-            }
+            if((nextByte >= 0) && ParseNext(payloadBfrQ, &parserPayload, (CPU_INT08U)nextByte))
+                break;
+#endif
         }
     }
 }
 
 /*-------------------- P a r s e B y t e ( ) -------------------------------------
     Packet Parser Task: Parse a single byte and progress through the states
+    Return:         See ParseResult
 */
-CPU_BOOLEAN ParseByte(CPU_VOID *payloadBfr, CPU_INT08U nextByte){
+ParseResult ParseByte(CPU_VOID *payloadBfr, CPU_INT08U nextByte){
     
     static ParserState parseState = P1;
     static CPU_INT08U checkSum = 0;
     static CPU_INT08U  i = 0;
+    static CPU_BOOLEAN crcMode = FALSE;   // Packet has a CRC, not a checksum
+    static CPU_BOOLEAN filtered;          // Packet is for another station
+    static CPU_INT32U rxCrc;              // CRC received
+    static CPU_BOOLEAN aggMode = FALSE;   // Aggregate frame
+    static CPU_BOOLEAN cmdMode = FALSE;   // Console command frame
+    static CPU_INT08U aggLeft;            // Aggregate frame bytes after the current record
+    static CPU_INT08U recLen;             // Current record's length
+    static CPU_INT08U recLeft;            // Bytes of it still to come
+    static CPU_INT08U kept;               // Records queued from this frame
+    static CPU_INT08U dropped;            // Records for other stations
     
+    OS_ERR osErr;
     PktBfr *pktBfr = (PktBfr *)payloadBfr;
 
     checkSum ^= nextByte;
@@ -142,51 +373,133 @@ CPU_BOOLEAN ParseByte(CPU_VOID *payloadBfr, CPU_INT08U nextByte){
             if (nextByte == P1Char) parseState = P2;
             else{
                 Error(pktBfr, &parseState, E1);
-                return TRUE;
+                return ParsePayload;
             }
             break;
         case P2:
             if (nextByte == P2Char) parseState = P3;
             else{
                 Error(pktBfr, &parseState, E2);
-                return TRUE;
+                return ParsePayload;
             }
             break;
         case P3:
-            if (nextByte == P3Char) parseState = C;
+            crcMode = (nextByte == P3CrcChar);
+            aggMode = (nextByte == P3AggChar);
+            cmdMode = (nextByte == P3CmdChar);
+            if (nextByte == P3Char || aggMode || cmdMode) parseState = C;
+            else if (crcMode){
+                CrcUnitReset();
+                crcWord = 0;
+                crcBytes = 0;
+                parseState = K;
+            }
             else{
                 Error(pktBfr, &parseState, E3);
-                return TRUE;
+                return ParsePayload;
             }
             break;
         case C:
             parseState = K;
             break;
         case K:
-            if (nextByte - PacketHeaderDiff < 1){
+            if (nextByte - (crcMode ? CrcHeaderDiff : PacketHeaderDiff) < 1){
+                Error(pktBfr, &parseState, E5);
+                return ParsePayload;
+            }
+            //Payloads and commands must fit in the payload buffer after its length
+            if (!aggMode &&
+                nextByte - (crcMode ? CrcHeaderDiff : PacketHeaderDiff) > (CPU_INT16S)(sizeof(Payload) - 1)){
                 Error(pktBfr, &parseState, E5);
-                return TRUE;
+                return ParsePayload;
+            }
+            if (aggMode){
+                //The whole frame goes into one queue buffer
+                if (nextByte - PacketHeaderDiff > parserBfrQ->bfrSize){
+                    Error(pktBfr, &parseState, E5);
+                    return ParsePayload;
+                }
+                aggLeft = nextByte - PacketHeaderDiff;
+                kept = dropped = 0;
+                parseState = AN;
+                break;
             }
+            //Payloads keep the checksum mode length
             pktBfr->payloadLen = nextByte;
+            if (crcMode){
+                CrcByte(nextByte);
+                pktBfr->payloadLen -= CrcHeaderDiff - PacketHeaderDiff;
+            }
             parseState = D;
             i = 0;
             break;
         case D: //Go through each data part after the header
-            pktBfr->data[i++] = nextByte;
-            if (i >= pktBfr->payloadLen - PacketHeaderDiff){
-                parseState = P1;
+            //The first data byte is the destination address; commands have none
+            if (i == 0 && !cmdMode && !ParserAddrAccepted(nextByte))
+                parseState = SK;
+            else
+                pktBfr->data[i] = nextByte;
+            /* fall through */
+        case SK: //Another station's packet: count it out, keep nothing
+            if (crcMode)
+                CrcByte(nextByte);
+            if (++i < pktBfr->payloadLen - PacketHeaderDiff)
+                break;
+            filtered = (parseState == SK);
+            if (!crcMode)
+                return EndPacket(pktBfr, &parseState, filtered, checkSum == 0, cmdMode);
+            
+            //The CRC follows; pad the last word with zeros
+            if (crcBytes != 0)
+                CrcUnitWord(crcWord);
+            parseState = CR;
+            rxCrc = 0;
+            i = 0;
+            break;
+        case AN: //Aggregate record length
+            if (nextByte < 1 || nextByte >= aggLeft || nextByte > sizeof(Payload) - 1){
+                BfrQWriteReset(parserBfrQ);
+                Error(pktBfr, &parseState, E5);
+                return ParsePayload;
+            }
+            aggLeft -= 1 + nextByte;
+            recLen = recLeft = nextByte;
+            parseState = AR;
+            break;
+        case AR: //Aggregate record bytes, dst first
+            if (recLeft == recLen && !ParserAddrAccepted(nextByte))
+                recLen = 0;   //Skip the record
+            if (recLen != 0)
+                pktBfr->data[recLen - recLeft] = nextByte;
+            if (--recLeft > 0)
+                break;
+            if (recLen == 0)
+                dropped++;
+            else{
+                //Source, type and data are compared, as IsDuplicate() does
+                CPU_INT32U tag = DupCacheHash(&pktBfr->data[1], recLen - 1);
                 
-                //Checksum Error if all packets XOR'd != 0
-                if (checkSum != 0){ 
-                    Error(pktBfr, &parseState, E4);
+                if (!DupCacheSeenHash(tag, OSTimeGet(&osErr))){
+                    assert(kept < sizeof(aggTags) / sizeof(aggTags[0]));
+                    aggTags[kept++] = tag;
+                    BfrQAddByte(parserBfrQ, recLen + PacketHeaderDiff);
+                    BfrQWrite(parserBfrQ, pktBfr->data, recLen);
                 }
-                return TRUE; //Payload is finished
             }
+            if (aggLeft > 0){
+                parseState = AN;
+                break;
+            }
+            return EndAggregate(pktBfr, &parseState, checkSum == 0, kept, dropped);
+        case CR:
+            rxCrc |= (CPU_INT32U)nextByte << (8 * i);
+            if (++i >= CrcLen)
+                return EndPacket(pktBfr, &parseState, filtered, rxCrc == CrcUnitResult(), FALSE);
             break;
         case ER:
             if (nextByte == P1Char) parseState = P2;
                 checkSum = P1Char;
             break;
         }
-    return FALSE; //Payload is not finished
+    return ParseMore; //Payload is not finished
 }
@@ -18,6 +18,28 @@ The packet parser task module. Parser() must be a uC/OS-III style task.
 //The Error State. Needed by both Parser and Payload.
 typedef enum {E1 = 1, E2, E3, E4, E5} ErrorState;
 
+#define StationAddr 1         // This station's address
+#define BroadcastAddr 0xFF    // Address every station listens to
+
+typedef struct
+{
+    CPU_INT32U payloads;          // Payloads queued for this station
+    CPU_INT32U filtered;          // Packets dropped: destination not in the address set
+    CPU_INT32U filteredBadCs;     // Packets for other stations that failed the checksum (queued as E4)
+    CPU_INT32U aggregates;        // Aggregate frames that passed the checksum
+    CPU_INT32U commands;          // Console command frames that passed the checksum
+    CPU_INT32U errors[E5 + 1];    // Error payloads queued, by ErrorState
+} ParserStats;
+
+//What ParseByte() has finished
+typedef enum
+{
+    ParseMore,                    // Nothing yet
+    ParsePayload,                 // A payload or error payload is in the payload buffer
+    ParseQueued,                  // An aggregate frame's payloads are in the queue write buffer
+    ParseCommand                  // A console command frame is in the payload buffer
+} ParseResult;
+
 typedef struct
 {
     CPU_INT08S payloadLen;	  // Total number of data bytes
@@ -26,7 +48,10 @@ typedef struct
 
 CPU_VOID CreateParserTask(CPU_VOID *payloadBfrQ);
 CPU_VOID ParserTask(CPU_VOID *data);
-CPU_BOOLEAN ParseByte(CPU_VOID *payloadBfr, CPU_INT08U nextByte);
+ParseResult ParseByte(CPU_VOID *payloadBfr, CPU_INT08U nextByte);
 CPU_VOID LoadPayloadBfrQ(BfrQ *payloadBfrQ, CPU_VOID *payloadBfr);
+CPU_VOID ParserAcceptAddr(CPU_INT08U addr, CPU_BOOLEAN accept);
+CPU_BOOLEAN ParserAddrAccepted(CPU_INT08U addr);
+CPU_VOID ParserGetStats(ParserStats *stats);
 
 #endif
@@ -16,37 +16,57 @@ The payload task module 
 #include "Reply.h"
 #include "Parser.h"
 #include "Bfr.h"
+#include "Reading.h"
+#include "NodeCache.h"
+#include "Aggregate.h"
+#include "Deadband.h"
+#include "ReplyFrame.h"
+#include "SeqTrack.h"
+#include "MsgDesc.h"
+#include "FlashLog.h"
+#include "History.h"
+#include "Console.h"
 
 //----- c o n s t a n t    d e f i n i t  i o n s -----
 #define SuspendTimeout 100    // Timeout for semaphore wait
 #define PAYLOAD_STK_SIZE 128  // Payload Task stack size
 #define PayloadPrio 4         // Payload Task Priority
+#define AggTimeout 1000       // Longest wait for a payload before checking for closed windows
+
+//The queues' shares of the buffer pool. The parser fills one payload
+//buffer while the payload task empties another; one reply buffer keeps
+//replies moving. The rest goes to whichever queue is backed up.
+#define PayloadMinBfrs 2
+#define ReplyMinBfrs 1
+#define PayloadMaxBfrs (NumBfrs - ReplyMinBfrs)
+#define ReplyMaxBfrs (NumBfrs - PayloadMinBfrs)
 
 #define PayloadHeaderDiff 8  //Amount of header before the data starts in the payload.
 #define PacketHeaderDiff 5   //Amount of header before the payload starts in the packet.
 
-//Define the message types with real names
-#define BarPacket 'B'
+//Define the message types with real names. The sensor types' layouts
+//are in MsgDesc.c.
 #define DatePacket 'D'
-#define HumPacket 'H'
 #define NodePacket 'I'
-#define PrecPacket 'P'
-#define SolarPacket 'R'
-#define TempPacket 'T'
-#define WindPacket 'W'
-#define StationAddr 1
+#define FormatPacket 'F'     //To the station: data 'B' for binary replies, anything else for text
+#define LogPacket 'G'        //To the station: send the flash log
 
 //----- g l o b a l    v a r i a b l e s -----
 static  OS_TCB   payloadTCB;                  // Reply Task TCB
 static  CPU_STK  payloadStk[PAYLOAD_STK_SIZE];  // Space for Reply Task stack
 
+//Allocate the buffer pool both queues draw from
+static BfrPool SharedPool;
+static CPU_INT08U SharedBfrSpace[NumBfrs * BfrQSize];
+
 //Allocate the payloadBfrQ
 static BfrQ PayloadBfrQ;
-static CPU_INT08U PayloadBfrSpace[NumBfrs * BfrQSize];
 
 //Allocate the ReplyBfrQ
 static BfrQ ReplyBfrQ;
-static CPU_INT08U ReplyBfrSpace[NumBfrs * BfrQSize];
+
+//The payload task, the log task's exports and the console all produce replies
+static OS_MUTEX replyMutex;
 
 /*--------------- C r e a t e P a y l o a d T a s k( ) ---------------
 PURPOSE
@@ -71,65 +91,13 @@ CPU_VOID CreatePayloadTask(CPU_VOID){
                  0,                   // This task has no task queue
                  0,                   // Number of clock ticks (defaults to 10)
                  (CPU_VOID      *)0,  // Pointer to TCB extension
-                 OS_OPT_TASK_NONE,    // Task options
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),  // Task options
                  &osErr);             // Address to return O/S error code
     
     /* Verify successful task creation. */
     assert(osErr == OS_ERR_NONE);
 }
 
-/*-------------------- P a r s e W i n d ( ) -------------------------------------
-	Purpose:	Parses the Packed Wind packet into it's component parts using bitwise arithmetic.
-*/
-CPU_VOID ParseWind(CPU_CHAR *message, CPU_INT08U *speed, CPU_INT16U *dir, CPU_INT08U srcAddr){
-    #define Mask 0xF0
-    #define Shift 4
-    #define NumBase 10
-    
-    sprintf(message, "\nN%u SP = %u.%u  DIR = %u\n", 
-                   srcAddr, \
-                   (((speed[0] & Mask) >> Shift)*NumBase*NumBase) + ((speed[0] & ~Mask)* NumBase) + ((speed[1] & Mask) >> Shift), (speed[1] & ~Mask), \
-                   *dir);
-}
-
-/*-------------------- P a r s e P r e c i p ( ) -------------------------------------
-	Purpose:	Parses the Packed Precipitation packet into it's component parts using bitwise arithmetic.
-*/
-CPU_VOID ParsePrecip(CPU_CHAR *message, CPU_INT08U *depth, CPU_INT08U srcAddr){
-    #define Mask 0xF0
-    #define Shift 4
-    #define NumBase 10
-    
-    sprintf(message, "\nN%u = %u.%u%u\n",
-                   srcAddr, \
-                   (((depth[0] & Mask) >> Shift)*NumBase) + (depth[0] & ~Mask), \
-                     (depth[1] & Mask) >> Shift, (depth[1] & ~Mask));
-}
-
-/*-------------------- P a r s e D a t e ( ) -------------------------------------
-	Purpose:	Parses the Packed Date/Time packet into it's component parts using bitwise arithmetic.
-	Issue:		The date/time packet is packed in big endian.
-			The bytes must be reversed before bitwise manipulation.
-*/
-CPU_VOID ParseDate(CPU_CHAR *message, CPU_INT32U *ts, CPU_INT08U srcAddr){
-    CPU_INT32U rBytes = ReverseBytes32(ts);
-    
-    //Masks for the different packed components
-    #define MYear 0xFFF00000
-    #define MMonth 0x000F0000
-    #define MDay 0xF800
-    #define MHour 0x07C0
-    #define MMinute 0x003F
-    #define MonthOffset 16
-    #define DayOffset 11
-    #define YearOffset 20
-    #define HourOffset 6
-    
-    sprintf(message, "\nN%u TS = %u/%u/%u %u:%u\n", srcAddr, \
-                   (rBytes & MMonth) >> MonthOffset, (rBytes & MDay) >> DayOffset, (rBytes & MYear) >> YearOffset, \
-                     (rBytes & MHour) >> HourOffset, (rBytes & MMinute));
-}
-
 /*-------------------- C o n s t r u c t M e s s a g e ( ) -------------------------------------
 	Purpose:	Create a message that will be sent to the replyQ
         Parameters:     address of payload, character string
@@ -137,6 +105,7 @@ CPU_VOID ParseDate(CPU_CHAR *message, CPU_INT32U *ts, CPU_INT08U srcAddr){
                         FALSE - A error message was created
 */
 CPU_BOOLEAN ConstructMessage(Payload *payload, CPU_CHAR *message){
+    const MsgHandler *handler;
     
     //Error Payload
     if(payload->payloadLen < 0){
@@ -144,56 +113,79 @@ CPU_BOOLEAN ConstructMessage(Payload *payload, CPU_CHAR *message){
         return FALSE;
     }
     
-    //Info Message - Wrong Address
-    if(payload->dstAddr != StationAddr){
+    //Info Message - Wrong Address. The parser drops these unless the
+    //address set changed while the payload was queued.
+    if(!ParserAddrAccepted(payload->dstAddr)){
         sprintf(message, "IBad ADR");
         return FALSE;
     }
    
-    switch(payload->msgType){
-        case BarPacket:
-                sprintf(message, "\nN%u P = %u\n", payload->srcAddr, payload->dataPart.pres);
-                break;
-        case DatePacket:
-                ParseDate(message, &payload->dataPart.dateTime, payload->srcAddr);
-                break;
-        case HumPacket:
-                sprintf(message, "\nN%u DP = %u H = %u\n", 
-                        payload->srcAddr, payload->dataPart.hum.dewPt, payload->dataPart.hum.hum);
-                break;
-        case NodePacket:
-                payload->dataPart.id[(payload->payloadLen-PayloadHeaderDiff)] = '\0'; //Terminate the info string
-                sprintf(message, "\nN%u ID = %s\n", payload->srcAddr, payload->dataPart.id);
-                break;
-        case PrecPacket:
-                ParsePrecip(message, payload->dataPart.depth, payload->srcAddr);
-                break;
-        case SolarPacket:
-                sprintf(message, "\nN%u R = %u\n", payload->srcAddr, payload->dataPart.rad);
-                break;
-        case TempPacket:
-                sprintf(message, "\nN%u T = %i\n", payload->srcAddr, payload->dataPart.temp);
-                break;
-        case WindPacket:
-                ParseWind(message, payload->dataPart.wind.speed, &payload->dataPart.wind.dir, payload->srcAddr);
-                break;
-        default:
-                sprintf(message, "IBad Type"); //Info Message - Bad Type
-                return FALSE;
+    //Info Message - Bad Type. A reading too short for its fields is
+    //reported the same way, as binary replies do.
+    handler = MsgHandlerFind(payload->msgType);
+    if(!handler->format(handler->desc, payload->srcAddr, payload->data,
+                        payload->payloadLen - PayloadHeaderDiff, message)){
+        sprintf(message, "IBad Type");
+        return FALSE;
     }
     return TRUE;
 }
 
+/*-------------------- C o n s t r u c t F r a m e ( ) -------------------------------------
+	Purpose:	Create the binary reply frame for a payload (see ReplyFrame.h)
+        Parameters:     address of payload, its decoded reading or NULL if it has none,
+                        frame space of FrameMaxLen bytes
+        Return:         Frame length in bytes
+*/
+CPU_INT08U ConstructFrame(Payload *payload, const Reading *rdg, CPU_INT08U *frame){
+    CPU_INT08U info[2];
+    CPU_INT08S dataLen = payload->payloadLen - PayloadHeaderDiff;
+    
+    //Error Payload
+    if(payload->payloadLen < 0){
+        info[0] = (CPU_INT08U)(0 - payload->payloadLen);
+        return FrameBuild(frame, FrameError, 0, info, 1);
+    }
+    
+    //Info Frame - Wrong Address
+    if(!ParserAddrAccepted(payload->dstAddr)){
+        info[0] = FrameBadAddr;
+        return FrameBuild(frame, FrameInfo, payload->srcAddr, info, 1);
+    }
+    
+    if(payload->msgType == NodePacket)
+        return FrameBuild(frame, NodePacket, payload->srcAddr, payload->data, dataLen);
+    if(rdg != NULL)
+        return FrameReading(frame, payload->msgType, payload->srcAddr, rdg);
+    
+    //Info Frame - Bad Type
+    info[0] = FrameBadType;
+    info[1] = payload->msgType;
+    return FrameBuild(frame, FrameInfo, payload->srcAddr, info, 2);
+}
+
 /*-------------------- P a y l o a d I n i t( ) -------------------------------------
 	Purpose:	Initialize the Payload buffer
         Parameters:     buffer queue address
         Return Value:   None
 */
 CPU_VOID PayloadInit(BfrQ **payloadBfrQ, BfrQ **replyBfrQ){
-    BfrQInit(&PayloadBfrQ, NumBfrs, BfrQSize, PayloadBfrSpace);
-    BfrQInit(&ReplyBfrQ, NumBfrs, BfrQSize, ReplyBfrSpace);
+    OS_ERR osErr;
+    
+    OSMutexCreate(&replyMutex, "Reply Mutex", &osErr);
+    assert(osErr == OS_ERR_NONE);
+    BfrPoolInit(&SharedPool, SharedBfrSpace, NumBfrs, BfrQSize);
+    BfrQInit(&PayloadBfrQ, &SharedPool, PayloadMinBfrs, PayloadMaxBfrs);
+    BfrQInit(&ReplyBfrQ, &SharedPool, ReplyMinBfrs, ReplyMaxBfrs);
     *payloadBfrQ = &PayloadBfrQ;
     *replyBfrQ = &ReplyBfrQ;
+    MsgHandlersInit(AggregateUpdate);
+    NodeCacheInit();
+    AggregateInit(0);
+    DeadbandInit();
+    SeqTrackInit();
+    FlashLogInit();
+    HistoryInit();
 }
 
 /*-------------------- S e n d E r r o r P a y l o a d( ) -----------------------------
@@ -245,9 +237,193 @@ CPU_VOID ConstructPayload(CPU_VOID *payload){
 }
 
 
+/*-------------------- R e c o r d R e a d i n g( ) -----------------------------
+	Purpose:	Record a good reading addressed to this station in the node cache,
+                        the history and the flash log, and hand it to its type's
+                        aggregate handler. This is the one
+                        decode of each payload.
+        Parameters:     payload address, decoded reading returned, current time in ticks,
+                        returned TRUE if the reading went into a summary
+        Return Value:   TRUE if the payload was a reading
+*/
+static CPU_BOOLEAN RecordReading(Payload *payload, Reading *rdg, OS_TICK now, CPU_BOOLEAN *summarized){
+    const MsgHandler *handler;
+
+    *summarized = FALSE;
+    if(payload->payloadLen <= 0 || !ParserAddrAccepted(payload->dstAddr))
+        return FALSE;
+    handler = MsgHandlerFind(payload->msgType);
+    if(!handler->decode(handler->desc, payload->data, payload->payloadLen - PayloadHeaderDiff, rdg))
+        return FALSE;
+
+    NodeCacheUpdate(payload->srcAddr, payload->msgType, rdg, now);
+    HistoryAppend(payload->srcAddr, payload->msgType, rdg, now);
+    *summarized = handler->aggregate(payload->srcAddr, payload->msgType, rdg->value);
+    FlashLogPut(payload->srcAddr, payload->msgType, rdg, now);
+    return TRUE;
+}
+
+/*-------------------- R e p l y B e g i n( ) -----------------------------
+	Purpose:	Take the reply buffer queue's write buffer for one reply
+        Parameters:     None
+        Return Value:   None
+*/
+static CPU_VOID ReplyBegin(CPU_VOID){
+    OS_ERR osErr;
+    
+    OSMutexPend(&replyMutex, 0, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+    assert(osErr == OS_ERR_NONE);
+    BfrQPendWrite(&ReplyBfrQ);  //Pend on available writebfrs in ReplyQ
+}
+
+/*-------------------- R e p l y E n d( ) -----------------------------
+	Purpose:	Hand the reply to the reply task and let the other producer in
+        Parameters:     None
+        Return Value:   None
+*/
+static CPU_VOID ReplyEnd(CPU_VOID){
+    OS_ERR osErr;
+    
+    BfrQPostRead(&ReplyBfrQ); //Done Producing
+    OSMutexPost(&replyMutex, OS_OPT_POST_NONE, &osErr);
+    assert(osErr == OS_ERR_NONE);
+}
+
+/*-------------------- S e n d S u m m a r y( ) -----------------------------
+	Purpose:	Put a closed window's summary record in the reply buffer queue
+        Parameters:     summary record
+        Return Value:   None
+*/
+static CPU_VOID SendSummary(const AggSummary *summary){
+    static CPU_CHAR message[BfrQSize];
+    static CPU_INT08U frame[FrameMaxLen];
+
+    ReplyBegin();
+    if(ReplyGetFormat() == ReplyBinary){
+        ReplyPutFrame(&ReplyBfrQ, frame, FrameAggSummary(frame, summary));
+    }else{
+        AggregateFormat(summary, message);
+        ReplyPutMsg(&ReplyBfrQ, message);
+    }
+    ReplyEnd();
+}
+
+/*-------------------- S e n d L o g R e c o r d( ) -----------------------------
+	Purpose:	Put an exported log record in the reply buffer queue. Runs in
+                        the log task.
+        Parameters:     log record, or NULL after the last one
+        Return Value:   None
+*/
+static CPU_VOID SendLogRecord(const LogRecord *rec){
+    static CPU_CHAR message[BfrQSize];
+    static CPU_INT08U frame[FrameMaxLen];
+
+    ReplyBegin();
+    if(ReplyGetFormat() == ReplyBinary){
+        ReplyPutFrame(&ReplyBfrQ, frame, FrameLogRecord(frame, rec));
+    }else{
+        FlashLogFormat(rec, message);
+        ReplyPutMsg(&ReplyBfrQ, message);
+    }
+    ReplyEnd();
+}
+
+/*-------------------- P a y l o a d S e n d M s g( ) -----------------------------
+	Purpose:	Put a text reply from another task in the reply buffer queue
+        Parameters:     message
+        Return Value:   None
+*/
+CPU_VOID PayloadSendMsg(const CPU_CHAR *message){
+    ReplyBegin();
+    ReplyPutMsg(&ReplyBfrQ, message);
+    ReplyEnd();
+}
+
+/*-------------------- P a y l o a d S e n d F r a m e( ) -----------------------------
+	Purpose:	Put a binary reply frame from another task in the reply buffer queue
+        Parameters:     frame, its length
+        Return Value:   None
+*/
+CPU_VOID PayloadSendFrame(const CPU_INT08U *frame, CPU_INT08U len){
+    ReplyBegin();
+    ReplyPutFrame(&ReplyBfrQ, frame, len);
+    ReplyEnd();
+}
+
+/*-------------------- P a y l o a d G e t P o o l S t a t s( ) -----------------------------
+	Purpose:	Copy out each queue's share of the buffer pool
+        Parameters:     where to put the payload queue's, the reply queue's
+        Return Value:   None
+*/
+CPU_VOID PayloadGetPoolStats(PoolStats *payloadQ, PoolStats *replyQ){
+    BfrQGetStats(&PayloadBfrQ, payloadQ);
+    BfrQGetStats(&ReplyBfrQ, replyQ);
+}
+
+/*-------------------- H a n d l e P a y l o a d( ) -----------------------------
+	Purpose:	Record a payload and put its reply in the reply buffer queue
+        Parameters:     payload address
+        Return Value:   None
+*/
+static CPU_VOID HandlePayload(Payload *payload){
+    static CPU_CHAR message[BfrQSize];
+    static CPU_INT08U frame[FrameMaxLen];
+    OS_ERR osErr;
+    OS_TICK now;
+    Reading rdg;
+    CPU_BOOLEAN isReading;
+    CPU_BOOLEAN summarized;
+    
+    //A numbered packet: count it and drop the number, which ends the data
+    if(payload->payloadLen > PayloadHeaderDiff && (payload->msgType & SeqFlag)){
+        payload->payloadLen--;
+        payload->msgType &= ~SeqFlag;
+        SeqTrack(payload->srcAddr, (payload->data)[payload->payloadLen - PayloadHeaderDiff]);
+    }
+    
+    //Reply format switch for this station
+    if(payload->payloadLen > PayloadHeaderDiff && payload->dstAddr == StationAddr &&
+       payload->msgType == FormatPacket){
+        ReplySetFormat(payload->data[0] == 'B' ? ReplyBinary : ReplyText);
+        return;
+    }
+    
+    //Log export for this station; the log task sends it
+    if(payload->payloadLen >= PayloadHeaderDiff && payload->dstAddr == StationAddr &&
+       payload->msgType == LogPacket){
+        FlashLogExport(SendLogRecord);
+        return;
+    }
+    
+    now = OSTimeGet(&osErr);
+    AggregateTick(now, SendSummary);
+    isReading = RecordReading(payload, &rdg, now, &summarized);
+    if(isReading){
+#if AggregateOnly
+        if(summarized)
+            return; //The reading leaves the station in its summaries
+#endif
+        if(!DeadbandPass(payload->srcAddr, payload->msgType, &rdg, now))
+            return; //Nothing new since the node's last report
+    }
+    
+    //Producer
+    ReplyBegin();
+    if(ReplyGetFormat() == ReplyBinary){ //Produce Buffer
+        ReplyPutFrame(&ReplyBfrQ, frame, ConstructFrame(payload, isReading ? &rdg : NULL, frame));
+    }else if(ConstructMessage(payload, message)){
+        ReplyPutMsg(&ReplyBfrQ, message); 
+    }else{
+        ReplyError(&ReplyBfrQ, message);
+    }
+    ReplyEnd();
+}
+
 /*-------------------- P a y l o a d T a s k( ) -------------------------------------
-	Purpose:	Process a payload from the payload buffer queue read buffer and
-                        put the reply message in the reply buffer queue write buffer.
+	Purpose:	Process the payloads in the payload buffer queue read buffer and
+                        put the reply messages in the reply buffer queue write buffer.
+                        A buffer holds one payload, or every payload an aggregate
+                        frame carried for this station.
         Parameters:     buffer queue address
         Return Value:   None
 
@@ -260,30 +436,24 @@ CPU_VOID ConstructPayload(CPU_VOID *payload){
 CPU_VOID PayloadTask(CPU_VOID *data){
  
     static Payload payload;
-    static CPU_CHAR message[BfrQSize];
+    OS_ERR osErr;
+    CPU_TS start;
     
     for(;;){
-        BfrQPendRead(&PayloadBfrQ); //Pend on available readbfrs in PayloadQ
+        //Pend on available readbfrs in PayloadQ, waking now and then to close windows
+        if(!BfrQPendReadTimed(&PayloadBfrQ, AggTimeout)){
+            AggregateTick(OSTimeGet(&osErr), SendSummary);
+            continue;
+        }
+        ConsoleQueueDepth(ConPayloadQ, BfrQReadsWaiting(&PayloadBfrQ));
         
         //Consumer
-        ConstructPayload(&payload); //Consume Buffer
+        do{
+            start = OS_TS_GET();
+            ConstructPayload(&payload); //Consume one payload
+            HandlePayload(&payload);
+            ConsolePayloadTime(OS_TS_GET() - start);
+        }while(BfrQNextByte(&PayloadBfrQ) >= 0);
         BfrQPostWrite(&PayloadBfrQ); //Done Consuming
-        
-        //Producer
-        BfrQPendWrite(&ReplyBfrQ);  //Pend on available writebfrs in ReplyQ
-        if(ConstructMessage(&payload, message)){ //Produce Buffer
-            ReplyPutMsg(&ReplyBfrQ, message); 
-        }else{
-            ReplyError(&ReplyBfrQ, message);
-        }
-        BfrQPostRead(&ReplyBfrQ); //Done Producing
     }
-}
-
-/*-------------------- R e v e r s e B y t e s 3 2 ( ) -------------------------------------
-	Purpose:	Reverses the bytes in a 32bit unsigned integer.
-*/
-CPU_INT32U ReverseBytes32(CPU_INT32U *original){
-    return ((*original >> 24)&0x000000FF) | ((*original << 8) &0x00FF0000) | 
-      ((*original >> 8) &0x0000FF00) | ((*original << 24)&0xFF000000);
 }
\ No newline at end of file
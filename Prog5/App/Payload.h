@@ -15,43 +15,30 @@ The payload task module 
 
 #include "includes.h"
 #include "BfrQ.h"
+#include "Reading.h"
 
+#define PayloadMaxData 10     // Longest data field: a node ID
+
+//The data bytes stay as they arrived; MsgDesc.h says where each
+//message type's fields are.
 typedef struct
 {
 	CPU_INT08S payloadLen; // Number of data bytes
 	CPU_INT08U dstAddr; // Destination address
 	CPU_INT08U srcAddr; // Address of sending node
 	CPU_CHAR msgType; // ASCII Message Type
-	union
-	{
-		CPU_INT16U pres; // B Packet
-		CPU_INT32U dateTime; // D Packet
-		struct // H Packet
-		{
-			CPU_INT16S	dewPt;
-			CPU_INT08U	hum;
-		} hum;
-		CPU_INT08U id[10];// I Packet //See Note Below
-		CPU_INT08U depth[2]; // P Packet //See Note Below
-		CPU_INT16U rad; // R Packet
-		CPU_INT16S temp; // T Packet
-		struct // W Packet
-		{
-			CPU_INT08U	speed[2]; //See Note Below
-			CPU_INT16U	dir;
-		} wind;
-	} dataPart;
+	CPU_INT08U data[PayloadMaxData]; // Data bytes
 } Payload;
 
 /*----- f u n c t i o n    p r o t o t y p e s -----*/
-CPU_VOID ParseWind(CPU_CHAR *messageStr, CPU_INT08U *speed, CPU_INT16U *dir, CPU_INT08U srcAddr);
-CPU_VOID ParsePrecip(CPU_CHAR *messageStr, CPU_INT08U *depth, CPU_INT08U srcAddr);
-CPU_VOID ParseDate(CPU_CHAR *messageStr, CPU_INT32U *ts, CPU_INT08U srcAddr);
-CPU_INT32U ReverseBytes32(CPU_INT32U *original);
 CPU_BOOLEAN ConstructMessage(Payload *payload, CPU_CHAR *messageStr);
+CPU_INT08U ConstructFrame(Payload *payload, const Reading *rdg, CPU_INT08U *frame);
 CPU_VOID ConstructError(Payload *payload, CPU_CHAR *message);
 CPU_VOID ConstructPayload(CPU_VOID *payload);
 CPU_VOID PayloadInit(BfrQ **payloadBfrQ, BfrQ **replyBfrQ);
+CPU_VOID PayloadSendMsg(const CPU_CHAR *message);
+CPU_VOID PayloadSendFrame(const CPU_INT08U *frame, CPU_INT08U len);
+CPU_VOID PayloadGetPoolStats(PoolStats *payloadQ, PoolStats *replyQ);
 
 CPU_VOID CreatePayloadTask(CPU_VOID);
 CPU_VOID PayloadTask(CPU_VOID *data);
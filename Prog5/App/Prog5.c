@@ -36,11 +36,16 @@ The payload task module 
 #include "Payload.h"
 #include "Parser.h"
 #include "SerIODriver.h"
+#include "FlashLog.h"
+#include "Console.h"
+#include "LocalTemp.h"
+#include "Boot.h"
 
 /*----- c o n s t a n t    d e f i n i t i o n s -----*/
 
 #define Init_STK_SIZE 128      // Init task Priority
 #define Init_PRIO 2             // Init task Priority
+#define Init_LATE_PRIO (OS_CFG_PRIO_MAX - 2u)  // Init task Priority once packets flow
 
 // Define RS232 baud rate.
 #define BaudRate 9600
@@ -56,6 +61,10 @@ static  CPU_VOID  Init  (CPU_VOID *p_arg);
 /*--------------- I n i t( ) ---------------
 PURPOSE
 This will initialize tasks and board support functions.
+
+Only what a packet needs comes before USART2 is receiving: the clocks,
+the tick and the tasks a packet passes through, or may post to. The
+rest is done after Init drops below every other task (see Boot.h).
 */
 static CPU_VOID Init(CPU_VOID *p_arg)
 {
@@ -64,18 +73,14 @@ static CPU_VOID Init(CPU_VOID *p_arg)
     CPU_INT32U  cnts;                                             /* CPU clock interval */
     OS_ERR      err;                                              /* OS Error code */
     
-    BSP_Init();                                                   /* Initialize BSP functions  */
+    BootStamp(BootTask);
+    BSP_ClkInit();                                                /* Run the core at full speed */
+    BootStamp(BootClocks);
     CPU_Init();                                                   /* Initialize the uC/CPU services */
 
     cpu_clk_freq = BSP_CPU_ClkFreq();                             /* Determine SysTick reference freq. */                                                                        
     cnts         = cpu_clk_freq / (CPU_INT32U)OSCfg_TickRate_Hz;  /* Determine nbr SysTick increments */
     OS_CPU_SysTickInit(cnts);                                     /* Init uC/OS periodic time src (SysTick). */
-
-#if OS_CFG_STAT_TASK_EN > 0u
-    OSStatTaskCPUUsageInit(&err);                                 /* Compute CPU capacity with no task running */
-#endif
-
-    CPU_IntDisMeasMaxCurReset();
     
     //First Task should enable interrupts according to the uC/OS III book
     //CPU_IntEn();
@@ -88,16 +93,35 @@ static CPU_VOID Init(CPU_VOID *p_arg)
     // Initialize the payload
     PayloadInit(&payloadBfrQ, &replyBfrQ);
     
-    // Create Tasks.
+    // Create Tasks. The log and console are posted to by the payload
+    // and parser tasks, so they must exist before the first packet.
     CreateParserTask(payloadBfrQ);
     CreatePayloadTask();
     CreateReplyTask(replyBfrQ);
+    CreateFlashLogTask();
+    CreateConsoleTask();
     
     // Initialize USART2.
     BSP_Ser_Init(BaudRate);
 
     // Initialize the USART2 I/O driver. 
     InitIODriver();
+    BootStamp(BootRxReady);
+    
+    //--------------------- Deferred: runs only when every other task waits
+    OSTaskChangePrio(&initTCB, Init_LATE_PRIO, &err);
+    assert(err == OS_ERR_NONE);
+    
+    BSP_IO_Init();                                                /* LEDs and status input */
+    CreateLocalTempTask(payloadBfrQ);
+    BootStamp(BootIO);
+
+#if OS_CFG_STAT_TASK_EN > 0u
+    OSStatTaskCPUUsageInit(&err);                                 /* Compute CPU capacity with no task running */
+#endif
+
+    CPU_IntDisMeasMaxCurReset();
+    BootStamp(BootDone);
     
     // Delete the Init task.
     OSTaskDel(&initTCB, &err);
@@ -110,12 +134,16 @@ CPU_INT32S main()
     // OS Error Code
     OS_ERR  err;  
     
+    // Time the boot from here
+    BootStart();
+    
     // Disable all interrupts... When are these re-enabled?
     BSP_IntDisAll();
     
     // Init uC/OS-III.
     OSInit(&err);                         
     assert(err == OS_ERR_NONE);
+    BootStamp(BootOSInit);
     
     // Create the init task.
     OSTaskCreate(&initTCB,            // Task Control Block                
@@ -135,9 +163,6 @@ CPU_INT32S main()
     /* Verify successful task creation. */
     assert(err == OS_ERR_NONE);
     
-    /* Initialize the RS232 interface. */
-    BSP_Ser_Init(BaudRate);
-    
     // Start multitasking.
     OSStart(&err);                        
     assert(err == OS_ERR_NONE);
@@ -0,0 +1,80 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Reading.c
+-----------------------------------------------------------------------
+Decode payload data bytes into fixed point readings with each message
+type's handler (MsgDesc.h). For the descriptor types the fields are the
+ones MsgDesc.c marks as the value and aux.
+
+A type registered with MsgRegister() takes the next spare reading slot
+the first time, and keeps it for good, so the NodeCache, deadband,
+history and aggregate state kept under the slot is never handed to
+another type.
+*/
+
+#include "Reading.h"
+#include "MsgDesc.h"
+
+//Message type of each reading type, in ReadingType order; 0 for a free slot.
+static CPU_CHAR RdgChars[NumRdgTypes] = {'B', 'D', 'H', 'P', 'R', 'T', 'W'};
+
+/*-------------------- R e a d i n g I n d e x ( ) -------------------------------------
+	Purpose:	Map a message type to its reading type.
+	Return:		The ReadingType, or NumRdgTypes if the message is not a reading.
+*/
+ReadingType ReadingIndex(CPU_CHAR msgType){
+    CPU_INT08U type;
+
+    switch(msgType){
+        case 'B': return RdgB;
+        case 'D': return RdgD;
+        case 'H': return RdgH;
+        case 'P': return RdgP;
+        case 'R': return RdgR;
+        case 'T': return RdgT;
+        case 'W': return RdgW;
+    }
+    for(type = RdgSpare; type < NumRdgTypes && RdgChars[type] != 0; type++)
+        if(RdgChars[type] == msgType)
+            return (ReadingType)type;
+    return NumRdgTypes;
+}
+
+/*-------------------- R e a d i n g T y p e A d d ( ) -------------------------------------
+	Purpose:	Give a message type a reading slot, if it has none yet.
+	Return:		Its ReadingType, or NumRdgTypes if the spare slots are all taken.
+*/
+ReadingType ReadingTypeAdd(CPU_CHAR msgType){
+    CPU_INT08U type = ReadingIndex(msgType);
+
+    if(type != NumRdgTypes || msgType == 0)
+        return (ReadingType)type;
+    for(type = RdgSpare; type < NumRdgTypes; type++)
+        if(RdgChars[type] == 0){
+            RdgChars[type] = msgType;
+            return (ReadingType)type;
+        }
+    return NumRdgTypes;
+}
+
+/*-------------------- R e a d i n g T y p e C h a r ( ) -------------------------------------
+	Purpose:	Map a reading type back to its message type.
+*/
+CPU_CHAR ReadingTypeChar(ReadingType type){
+    return type < NumRdgTypes && RdgChars[type] != 0 ? RdgChars[type] : '?';
+}
+
+/*-------------------- D e c o d e R e a d i n g ( ) -------------------------------------
+	Purpose:	Decode a payload's data bytes into a fixed point reading.
+        Parameters:     message type, data bytes, number of data bytes, result
+        Return:         TRUE -  The reading was decoded
+                        FALSE - Not a reading type, or too few data bytes
+*/
+CPU_BOOLEAN DecodeReading(CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08S dataLen, Reading *reading){
+    const MsgHandler *handler = MsgHandlerFind(msgType);
+
+    return handler->decode(handler->desc, data, dataLen, reading);
+}
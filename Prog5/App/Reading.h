@@ -0,0 +1,43 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        Reading.h
+-----------------------------------------------------------------------
+A sensor reading decoded from a payload's data bytes into fixed point
+integers, for the modules that keep or summarize readings rather than
+print them.
+*/
+
+#ifndef READING_H
+#define READING_H
+
+#include "includes.h"
+
+//Slots for reading types registered at run time (MsgRegister()). Each
+//costs a NodeCache entry, deadband, history series and aggregate per node.
+#ifndef RdgSpareTypes
+#define RdgSpareTypes 2
+#endif
+
+//Reading types: the descriptor types in table order, then the spare
+//slots from RdgSpare, which is also the number of descriptor types.
+//NumRdgTypes means "not a reading".
+typedef enum {RdgB, RdgD, RdgH, RdgP, RdgR, RdgT, RdgW, RdgSpare,
+              NumRdgTypes = RdgSpare + RdgSpareTypes} ReadingType;
+
+typedef struct
+{
+	CPU_INT32S value;   // B millibars, D packed date/time, H percent, P hundredths,
+	                    // R solar intensity, T degrees, W speed in tenths
+	CPU_INT16S aux;     // H dew point, W direction in degrees, otherwise 0
+} Reading;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+ReadingType ReadingIndex(CPU_CHAR msgType);
+ReadingType ReadingTypeAdd(CPU_CHAR msgType);
+CPU_CHAR ReadingTypeChar(ReadingType type);
+CPU_BOOLEAN DecodeReading(CPU_CHAR msgType, const CPU_INT08U *data, CPU_INT08S dataLen, Reading *reading);
+
+#endif
@@ -16,6 +16,8 @@ CHANGES
   ---------------------------------------------
   Modified by: Jesse Whitworth
   04/18/2012 - Changed function names
+  Replies go out by DMA, a span of the read buffer at a time, when
+  SerIODriver.h defines SerTxDma.
 */ 
 
 
@@ -25,6 +27,7 @@ CHANGES
 #include "Reply.h"
 #include "BfrQ.h"
 #include "SerIODriver.h"
+#include "Console.h"
 
 //----- c o n s t a n t    d e f i n i t  i o n s -----
 #define SuspendTimeout 100   // Timeout for semaphore wait
@@ -35,6 +38,7 @@ CHANGES
 
 static  OS_TCB   replyTCB;                  // Reply Task TCB
 static  CPU_STK  replyStk[REPLY_STK_SIZE];  // Space for Reply Task stack
+static  ReplyFormat replyFormat = ReplyText;  // Encoding of the replies
 
 /*----- f u n c t i o n    p r o t o t y p e s -----*/
 
@@ -65,7 +69,7 @@ CPU_VOID CreateReplyTask(CPU_VOID *replyBfrQ)
                  0,                   // This task has no task queue
                  0,                   // Number of clock ticks (defaults to 10)
                  (CPU_VOID      *)0,  // Pointer to TCB extension
-                 OS_OPT_TASK_NONE,    // Task options
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),  // Task options
                  &osErr);             // Address to return O/S error code
     
   /* Verify successful task creation. */
@@ -92,7 +96,23 @@ CPU_VOID Reply(CPU_VOID *data)
     {
     // Block if the reply buffer queue read buffer is not ready.
     BfrQPendRead(replyBfrQ);
+    ConsoleQueueDepth(ConReplyQ, BfrQReadsWaiting(replyBfrQ));
   
+#ifdef SerTxDma
+    // Hand each contiguous span of the read buffer to DMA; block until it is sent.
+    for (;;)
+      {
+      CPU_INT08U *span;
+      CPU_INT16U len = BfrQReadSpan(replyBfrQ, &span);
+      
+      // If no span, this reply is complete.
+      if (len == 0)
+        break;
+      
+      PutSpan(span, len);
+      BfrQSkip(replyBfrQ, len);
+      }
+#else
     // Repeatedly get the next byte from the reply buffer queue read buffer
     // and output it to oBfr.
     for (;;)
@@ -110,6 +130,7 @@ CPU_VOID Reply(CPU_VOID *data)
       // Now remove the byte.
       BfrQRemByte(replyBfrQ);
       }
+#endif
     
     // Post to the Write buffer to signal - done consuming
     BfrQPostWrite(replyBfrQ);
@@ -132,6 +153,46 @@ CPU_VOID ReplyPutMsg(BfrQ *replyBfrQ, const CPU_CHAR *msg)
     BfrQAddByte(replyBfrQ, *msg++);
 }
 
+/*--------------- R e p l y P u t F r a m e ( ) ---------------
+
+PURPOSE
+Copy a binary reply frame to the reply buffer queue write buffer.
+
+INPUT PARAMETERS
+replyBfrQ - The address of the reply buffer queue.
+frame         - The frame to copy
+len           - The frame length in bytes
+*/
+CPU_VOID ReplyPutFrame(BfrQ *replyBfrQ, const CPU_INT08U *frame, CPU_INT08U len)
+{
+  // Frames may hold zero bytes, so copy by length.
+  while (len-- > 0)
+    BfrQAddByte(replyBfrQ, *frame++);
+}
+
+/*--------------- R e p l y S e t F o r m a t ( ) ---------------
+
+PURPOSE
+Choose text or binary replies. Takes effect with the next reply.
+
+INPUT PARAMETERS
+format - ReplyText or ReplyBinary
+*/
+CPU_VOID ReplySetFormat(ReplyFormat format)
+{
+  replyFormat = format;
+}
+
+/*--------------- R e p l y G e t F o r m a t ( ) ---------------
+
+PURPOSE
+Return the current reply encoding.
+*/
+ReplyFormat ReplyGetFormat(CPU_VOID)
+{
+  return replyFormat;
+}
+
 /*--------------- R e p l y E r r o r ( ) ---------------
 
 PURPOSE
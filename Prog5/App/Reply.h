@@ -25,11 +25,17 @@
   
   #define ShortReplies
   
+  //Reply encodings. See ReplyFrame.h for the binary frames.
+  typedef enum {ReplyText, ReplyBinary} ReplyFormat;
+  
   /*----- f u n c t i o n    p r o t o t y p e s -----*/
   
   CPU_VOID CreateReplyTask(CPU_VOID *replyBfrQ); //Create semaphores
   CPU_VOID Reply(CPU_VOID *data);
   CPU_VOID ReplyPutMsg(BfrQ *replyBfrQ, const CPU_CHAR *msg);
+  CPU_VOID ReplyPutFrame(BfrQ *replyBfrQ, const CPU_INT08U *frame, CPU_INT08U len);
+  CPU_VOID ReplySetFormat(ReplyFormat format);
+  ReplyFormat ReplyGetFormat(CPU_VOID);
   CPU_VOID ReplyError(BfrQ *replyBfrQ, const CPU_CHAR *msg);
   CPU_VOID BfrQPendRead(BfrQ *bfrQ);
   #endif
\ No newline at end of file
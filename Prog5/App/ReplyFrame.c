@@ -0,0 +1,150 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        ReplyFrame.c
+-----------------------------------------------------------------------
+Build binary reply frames. A reading takes 5 to 10 bytes on the wire,
+where its text reply takes 11 to 30.
+*/
+
+#include <string.h>
+#include "ReplyFrame.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define CrcPoly 0x07          // x^8 + x^2 + x + 1
+#define MaxCount 0xFFFF       // Summary counts saturate at 16 bits
+
+/*-------------------- F r a m e C r c 8 ( ) -------------------------------------
+	Purpose:	CRC-8 of a block of bytes, computed a bit at a time.
+*/
+CPU_INT08U FrameCrc8(const CPU_INT08U *bytes, CPU_INT08U len){
+    CPU_INT08U crc = 0;
+    CPU_INT08U bit;
+
+    while(len-- > 0){
+        crc ^= *bytes++;
+        for(bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (CPU_INT08U)((crc << 1) ^ CrcPoly) : (CPU_INT08U)(crc << 1);
+    }
+    return crc;
+}
+
+/*-------------------- F r a m e B u i l d ( ) -------------------------------------
+	Purpose:	Frame a data field.
+        Parameters:     frame space (FrameMaxLen bytes), type, node, data, data length
+        Return:         Frame length in bytes
+*/
+CPU_INT08U FrameBuild(CPU_INT08U *frame, CPU_CHAR type, CPU_INT08U node, const CPU_INT08U *data, CPU_INT08U dataLen){
+    if(dataLen > FrameMaxData)
+        dataLen = FrameMaxData;
+
+    frame[0] = FrameSync;
+    frame[1] = dataLen + 2;
+    frame[2] = (CPU_INT08U)type;
+    frame[3] = node;
+    memcpy(&frame[4], data, dataLen);
+    frame[4 + dataLen] = FrameCrc8(&frame[1], dataLen + 3);
+    return dataLen + 5;
+}
+
+/*-------------------- P u t S i g n e d ( ) -------------------------------------
+	Purpose:	Store a value in as few little endian bytes as hold it signed.
+        Return:         Number of bytes stored
+*/
+static CPU_INT08U PutSigned(CPU_INT08U *data, CPU_INT32S value){
+    CPU_INT08U n = 1;
+    CPU_INT08U i;
+
+    //Widen until the value fits in n bytes, two's complement
+    while(n < 4 && (value < -((CPU_INT32S)1 << (8 * n - 1)) || value >= ((CPU_INT32S)1 << (8 * n - 1))))
+        n++;
+    for(i = 0; i < n; i++)
+        data[i] = (CPU_INT08U)(value >> (8 * i));
+    return n;
+}
+
+/*-------------------- P u t 3 2 ( ) -------------------------------------
+	Purpose:	Store a 32 bit value little endian.
+*/
+static CPU_VOID Put32(CPU_INT08U *data, CPU_INT32S value){
+    data[0] = (CPU_INT08U)value;
+    data[1] = (CPU_INT08U)(value >> 8);
+    data[2] = (CPU_INT08U)(value >> 16);
+    data[3] = (CPU_INT08U)(value >> 24);
+}
+
+/*-------------------- F r a m e H a s A u x ( ) -------------------------------------
+	Purpose:	Tell whether frames of a type end with an aux field.
+*/
+CPU_BOOLEAN FrameHasAux(CPU_CHAR type){
+    return type == 'H' || type == 'W';
+}
+
+/*-------------------- F r a m e R e a d i n g ( ) -------------------------------------
+	Purpose:	Frame a decoded reading.
+        Return:         Frame length in bytes
+*/
+CPU_INT08U FrameReading(CPU_INT08U *frame, CPU_CHAR msgType, CPU_INT08U node, const Reading *rdg){
+    CPU_INT08U data[6];
+    CPU_INT08U n = PutSigned(data, rdg->value);
+
+    if(FrameHasAux(msgType)){
+        data[n++] = (CPU_INT08U)rdg->aux;
+        data[n++] = (CPU_INT08U)(rdg->aux >> 8);
+    }
+    return FrameBuild(frame, msgType, node, data, n);
+}
+
+/*-------------------- F r a m e A g g S u m m a r y ( ) -------------------------------------
+	Purpose:	Frame a window summary from Aggregate.
+        Return:         Frame length in bytes
+*/
+CPU_INT08U FrameAggSummary(CPU_INT08U *frame, const AggSummary *summary){
+    CPU_INT08U data[16];
+    CPU_INT32U count = summary->count > MaxCount ? MaxCount : summary->count;
+
+    data[0] = (CPU_INT08U)summary->msgType;
+    data[1] = summary->level;
+    data[2] = (CPU_INT08U)count;
+    data[3] = (CPU_INT08U)(count >> 8);
+    Put32(&data[4], summary->min);
+    Put32(&data[8], summary->max);
+    Put32(&data[12], summary->mean);
+    return FrameBuild(frame, FrameSummary, (CPU_INT08U)summary->node, data, sizeof(data));
+}
+
+/*-------------------- F r a m e L o g R e c o r d ( ) -------------------------------------
+	Purpose:	Frame a record exported from FlashLog.
+        Parameters:     frame space, record or NULL for the end of the export
+        Return:         Frame length in bytes
+*/
+CPU_INT08U FrameLogRecord(CPU_INT08U *frame, const LogRecord *rec){
+    CPU_INT08U data[11] = {0};
+
+    if(rec == NULL)
+        return FrameBuild(frame, FrameLog, 0, data, 0);
+    data[0] = (CPU_INT08U)rec->msgType;
+    Put32(&data[1], rec->value);
+    data[5] = (CPU_INT08U)rec->aux;
+    data[6] = (CPU_INT08U)(rec->aux >> 8);
+    Put32(&data[7], (CPU_INT32S)rec->time);
+    return FrameBuild(frame, FrameLog, rec->node, data, sizeof(data));
+}
+
+/*-------------------- F r a m e S t a t G r o u p ( ) -------------------------------------
+	Purpose:	Frame a group of console counters (see Console.h).
+        Parameters:     frame space, group letter, counters, number of them
+        Return:         Frame length in bytes
+*/
+CPU_INT08U FrameStatGroup(CPU_INT08U *frame, CPU_CHAR group, const CPU_INT32U *values, CPU_INT08U count){
+    CPU_INT08U data[FrameMaxData];
+    CPU_INT08U i;
+
+    if(count > FrameMaxData / 4)
+        count = FrameMaxData / 4;
+    for(i = 0; i < count; i++)
+        Put32(&data[4 * i], (CPU_INT32S)values[i]);
+    return FrameBuild(frame, FrameStats, (CPU_INT08U)group, data, 4 * count);
+}
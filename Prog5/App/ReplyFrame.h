@@ -0,0 +1,60 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        ReplyFrame.h
+-----------------------------------------------------------------------
+Binary reply frames, the compact alternative to the text replies.
+
+    Sync | Len | Type | Node | Data ... | CRC
+
+Len counts Type, Node and Data. CRC is a CRC-8 (polynomial 0x07)
+of Len through the last Data byte. Multi-byte fields are little endian.
+
+    Type            Node        Data
+    B D P R T       source      value, 1 to 4 bytes signed
+    H W             source      value, 1 to 4 bytes signed; aux, 2 bytes
+    I               source      node ID characters
+    FrameError      0           ErrorState
+    FrameInfo       source      FrameBadAddr, or FrameBadType and the type
+    FrameSummary    node        type, level, count (2), min, max, mean (4 each)
+    FrameLog        source      type, value (4), aux (2), time (4)
+    FrameLog        0           none: the end of a log export
+    FrameStats      group       counters of a console group, 4 bytes each
+*/
+
+#ifndef REPLYFRAME_H
+#define REPLYFRAME_H
+
+#include "includes.h"
+#include "Reading.h"
+#include "Aggregate.h"
+#include "FlashLog.h"
+
+#define FrameSync 0xA5        // First byte of every frame
+#define FrameMaxData 24       // Largest Data field
+#define FrameMaxLen (FrameMaxData + 5)
+#define FrameAuxLen 2         // Bytes of aux field in H and W frames
+
+//Frame types that are not message types
+#define FrameError 'E'
+#define FrameInfo '?'
+#define FrameSummary 'S'
+#define FrameLog 'G'
+#define FrameStats '#'
+
+//FrameInfo reasons
+#define FrameBadAddr 1
+#define FrameBadType 2
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_INT08U FrameCrc8(const CPU_INT08U *bytes, CPU_INT08U len);
+CPU_INT08U FrameBuild(CPU_INT08U *frame, CPU_CHAR type, CPU_INT08U node, const CPU_INT08U *data, CPU_INT08U dataLen);
+CPU_INT08U FrameReading(CPU_INT08U *frame, CPU_CHAR msgType, CPU_INT08U node, const Reading *rdg);
+CPU_INT08U FrameAggSummary(CPU_INT08U *frame, const AggSummary *summary);
+CPU_INT08U FrameLogRecord(CPU_INT08U *frame, const LogRecord *rec);
+CPU_INT08U FrameStatGroup(CPU_INT08U *frame, CPU_CHAR group, const CPU_INT32U *values, CPU_INT08U count);
+CPU_BOOLEAN FrameHasAux(CPU_CHAR type);
+
+#endif
@@ -0,0 +1,137 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        SeqTrack.c
+-----------------------------------------------------------------------
+Sequence tracker. The source address indexes a table of SeqNodes
+entries, so a packet costs one lookup and a few compares whatever the
+number of nodes. Each entry holds the next number expected and a
+SeqWindow bit map of the numbers before it that have arrived: a late
+number whose bit is clear fills a gap (reordered, no longer lost), one
+whose bit is set is a repeat. A number further back than the window
+is only counted, unless the next one follows it: then the node has
+restarted and is followed from there. With the defaults the table takes
+4.5 KB of RAM.
+*/
+
+#include <string.h>
+#include "SeqTrack.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+#define AllSeen 0xFFFF        // Window of a node just (re)started: nothing older is owed
+
+typedef enum {SeqIdle, SeqActive, SeqResync} SeqState;
+
+typedef struct
+{
+	CPU_INT08U next;          // Number expected next
+	CPU_INT08U state;         // SeqState
+	CPU_INT16U window;        // Bit k set: number next-1-k has arrived
+	CPU_INT08U resync;        // SeqResync: the number that would confirm a restart
+	SeqNodeStats stats;
+} SeqEntry;
+
+//----- g l o b a l    v a r i a b l e s -----
+static SeqEntry seqEntries[SeqNodes];
+static SeqStats seqStats;
+
+/*-------------------- S e q T r a c k I n i t ( ) -------------------------------------
+	Purpose:	Forget every node and clear the counters.
+*/
+CPU_VOID SeqTrackInit(CPU_VOID){
+    memset(seqEntries, 0, sizeof(seqEntries));
+    memset(&seqStats, 0, sizeof(seqStats));
+}
+
+/*-------------------- R e s t a r t ( ) -------------------------------------
+	Purpose:	Start following a node from the number just received.
+*/
+static CPU_VOID Restart(SeqEntry *entry, CPU_INT08U seq){
+    entry->state = SeqActive;
+    entry->next = seq + 1;
+    entry->window = AllSeen;
+}
+
+/*-------------------- S e q T r a c k ( ) -------------------------------------
+	Purpose:	Account for a numbered packet from a node.
+        Parameters:     source address, the packet's sequence number
+*/
+CPU_VOID SeqTrack(CPU_INT08U srcAddr, CPU_INT08U seq){
+    SeqEntry *entry;
+    CPU_INT08S ahead;
+    CPU_INT16U bit;
+
+#if SeqNodes < 256
+    if(srcAddr >= SeqNodes)
+        return;
+#endif
+    entry = &seqEntries[srcAddr];
+    entry->stats.received++;
+    seqStats.received++;
+
+    if(entry->state == SeqIdle){
+        Restart(entry, seq);
+        return;
+    }
+
+    //Half the number space ahead counts as ahead, the other half as behind
+    ahead = (CPU_INT08S)(CPU_INT08U)(seq - entry->next);
+    if(ahead >= 0){
+        //Numbers skipped are lost until they turn up
+        entry->state = SeqActive;
+        entry->stats.lost += ahead;
+        seqStats.lost += ahead;
+        entry->window = ahead + 1 >= SeqWindow ? 1 : (CPU_INT16U)((entry->window << (ahead + 1)) | 1);
+        entry->next = seq + 1;
+        return;
+    }
+
+    if(-ahead > SeqWindow){
+        if(entry->state == SeqResync && seq == entry->resync){
+            entry->stats.restarts++;
+            seqStats.restarts++;
+            Restart(entry, seq);
+            return;
+        }
+        entry->state = SeqResync;
+        entry->resync = seq + 1;
+        entry->stats.tooLate++;
+        seqStats.tooLate++;
+        return;
+    }
+    bit = (CPU_INT16U)(1 << (-ahead - 1));
+    if(entry->window & bit){
+        entry->stats.duplicates++;
+        seqStats.duplicates++;
+    }else{
+        entry->window |= bit;
+        entry->stats.reordered++;
+        entry->stats.lost--;
+        seqStats.reordered++;
+        seqStats.lost--;
+    }
+}
+
+/*-------------------- S e q T r a c k G e t ( ) -------------------------------------
+	Purpose:	Copy out one node's counters.
+        Return:         FALSE if no numbered packet has come from the node.
+*/
+CPU_BOOLEAN SeqTrackGet(CPU_INT08U srcAddr, SeqNodeStats *stats){
+#if SeqNodes < 256
+    if(srcAddr >= SeqNodes)
+        return FALSE;
+#endif
+    if(seqEntries[srcAddr].state == SeqIdle)
+        return FALSE;
+    *stats = seqEntries[srcAddr].stats;
+    return TRUE;
+}
+
+/*-------------------- S e q T r a c k G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out the counters summed over every node.
+*/
+CPU_VOID SeqTrackGetStats(SeqStats *stats){
+    *stats = seqStats;
+}
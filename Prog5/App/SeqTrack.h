@@ -0,0 +1,57 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        SeqTrack.h
+-----------------------------------------------------------------------
+Per node packet sequence tracking. A node may number its packets: it
+sets SeqFlag in the message type and appends an 8 bit sequence number,
+one more than the last, after the data bytes. The tracker follows each
+source address and counts packets lost, repeated and arriving out of
+order, so silent gaps on a link can be told apart from the framing
+errors the parser reports.
+*/
+
+#ifndef SEQTRACK_H
+#define SEQTRACK_H
+
+#include "includes.h"
+
+#define SeqFlag 0x80          // Message type bit: a sequence number ends the data
+
+#ifndef SeqNodes
+#define SeqNodes 256          // Source addresses tracked: 0 to SeqNodes-1
+#endif
+
+#define SeqWindow 16          // Numbers behind the newest that can still be told apart
+
+//Counters wrap at 16 bits; read them often enough to take differences.
+typedef struct
+{
+	CPU_INT16U received;      // Numbered packets
+	CPU_INT16U lost;          // Numbers skipped and never filled in
+	CPU_INT16U duplicates;    // Numbers seen twice
+	CPU_INT16U reordered;     // Numbers that arrived after a later one
+	CPU_INT16U tooLate;       // Numbers more than SeqWindow behind; still counted lost
+	CPU_INT16U restarts;      // Two numbers in a row far behind: the node restarted
+} SeqNodeStats;
+
+//The same counts summed over every node
+typedef struct
+{
+	CPU_INT32U received;
+	CPU_INT32U lost;
+	CPU_INT32U duplicates;
+	CPU_INT32U reordered;
+	CPU_INT32U tooLate;
+	CPU_INT32U restarts;
+} SeqStats;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID SeqTrackInit(CPU_VOID);
+CPU_VOID SeqTrack(CPU_INT08U srcAddr, CPU_INT08U seq);
+CPU_BOOLEAN SeqTrackGet(CPU_INT08U srcAddr, SeqNodeStats *stats);
+CPU_VOID SeqTrackGetStats(SeqStats *stats);
+
+#endif
@@ -0,0 +1,513 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        SerDma.c
+-----------------------------------------------------------------------
+The USART2 transmit DMA driver. Its state is one flag, txBusy: set by
+SerDmaTxStart(), cleared by the transfer-complete interrupt, which is
+the only interrupt the channel raises. The channel's CMAR and CNDTR
+are written only while it is off, as the reference manual asks.
+
+Transfer complete means the last byte is in DR, not yet on the line;
+a span started at once queues behind it, as the channel waits for TXE.
+
+The receive side keeps two byte counts that only grow: rxMarked, the
+bytes written up to the last half or end of the ring the interrupt
+has seen, and rxTaken, the bytes the reader has skipped. The write
+point is wherever CNDTR says the channel is, so the bytes written are
+rxMarked plus the distance from its place in the ring to there, and
+the reader owns everything between rxTaken and that. The channel is
+never stopped to read it.
+*/
+
+#include <string.h>
+#include "SerDma.h"
+
+//----- c o n s t a n t    d e f i n i t  i o n s -----
+//DMA channel configuration (CCR) bits; sizes are left at bytes
+#define DMA_EN 0x0001           // Channel enable
+#define DMA_TCIE 0x0002         // Transfer-complete interrupt enable
+#define DMA_HTIE 0x0004         // Half-transfer interrupt enable
+#define DMA_DIR 0x0010          // Read from memory, write to the peripheral
+#define DMA_CIRC 0x0020         // Circular: CNDTR reloads at the end
+#define DMA_MINC 0x0080         // Memory address increments
+//DMA status (ISR) and clear (IFCR) bits of channels 6 and 7
+#define DMA_GIF6 0x00100000     // Any flag; writing it to IFCR clears them all
+#define DMA_TCIF6 0x00200000    // Transfer complete
+#define DMA_HTIF6 0x00400000    // Half transfer
+#define DMA_GIF7 0x01000000
+#define DMA_TCIF7 0x02000000
+//USART bits
+#define USART_IDLE 0x10         // Idle line detected (SR)
+#define USART_RXNE 0x20         // Rx Not Empty (SR)
+#define USART_TC 0x40           // Tx complete (SR)
+#define USART_TXE 0x80          // Tx Empty Bit (SR)
+#define USART_IDLEIE 0x10       // Idle line interrupt enable (CR1)
+#define USART_DMAR 0x40         // DMA receive enable (CR3)
+#define USART_DMAT 0x80         // DMA transmit enable (CR3)
+
+#define RxHalf (SerDmaRxSize / 2)
+
+#ifdef DmaSimulated
+
+//The model's registers, with the reference manual's names
+typedef struct
+{
+	volatile CPU_INT32U CCR;
+	volatile CPU_INT32U CNDTR;
+	CPU_VOID *CPAR;
+	CPU_VOID *CMAR;
+} SimDmaChannel;
+
+typedef struct
+{
+	volatile CPU_INT32U ISR;
+	volatile CPU_INT32U IFCR;
+} SimDmaCtl;
+
+typedef struct
+{
+	volatile CPU_INT16U SR;
+	volatile CPU_INT16U DR;         // Written: the Tx side
+	volatile CPU_INT16U CR1;
+	volatile CPU_INT16U CR3;
+} SimUsart;
+
+//----- g l o b a l    v a r i a b l e s -----
+static SimDmaChannel simTxCh;
+static SimDmaChannel simRxCh;
+static SimDmaCtl simDma;
+static SimUsart simUsart;
+static const CPU_INT08U *simTxNext;     // Channel's memory address counter
+static CPU_BOOLEAN simTxLatched;        // ... loaded from CMAR for this transfer
+static CPU_INT16S simShift = -1;        // Byte in the shift register, -1 if none
+static CPU_INT08U simRxDr;              // DR as read: the Rx side
+static CPU_INT08U *simRxBase;           // Rx channel's CMAR ...
+static CPU_INT16U simRxReload;          // ... and CNDTR, as enabled
+static CPU_BOOLEAN simRxLatched;        // ... loaded for this transfer
+static CPU_BOOLEAN simRxHeard;          // A byte came since the line was last idle
+
+#define TxCh (&simTxCh)
+#define RxCh (&simRxCh)
+#define Dma (&simDma)
+#define Usart (&simUsart)
+#define DmaAddr(p) ((CPU_VOID *)(p))
+#define ClearIdle() (simUsart.SR &= ~USART_IDLE)
+
+#else
+
+#define TxCh DMA1_Channel7      // The USART2_TX request's channel
+#define RxCh DMA1_Channel6      // The USART2_RX request's channel
+#define Dma DMA1
+#define Usart USART2
+#define DmaAddr(p) ((CPU_INT32U)(p))
+#define ClearIdle() ((CPU_VOID)Usart->DR)   // SR read first, then DR
+
+#endif
+
+//----- g l o b a l    v a r i a b l e s -----
+static CPU_VOID (*txDone)(CPU_VOID);    // Called when a span is sent
+static volatile CPU_BOOLEAN txBusy;     // A span is going
+static SerDmaTxStats txStats;
+static CPU_INT08U rxRing[SerDmaRxSize]; // The Rx channel writes here, round and round
+static CPU_VOID (*rxWake)(CPU_VOID);    // Called when there are bytes to read
+static volatile CPU_INT32U rxMarked;    // Bytes written to the last half or end seen
+static CPU_INT32U rxTaken;              // Bytes the reader has skipped
+static SerDmaRxStats rxStats;
+
+/*-------------------- T x D m a I r q ( ) -------------------------------------
+	Purpose:	End the span on transfer complete: turn the channel off and
+                        tell the sender. The body of the channel's interrupt.
+*/
+static CPU_VOID TxDmaIrq(CPU_VOID){
+    if(!(Dma->ISR & DMA_TCIF7))
+        return;
+    Dma->IFCR = DMA_GIF7;
+    TxCh->CCR &= ~DMA_EN;
+    txStats.irqs++;
+    txBusy = FALSE;
+    if(txDone != NULL)
+        txDone();
+}
+
+/*-------------------- R x D m a I r q ( ) -------------------------------------
+	Purpose:	Count the half of the ring the channel has just filled and wake
+                        the reader. The body of the Rx channel's interrupt.
+*/
+static CPU_VOID RxDmaIrq(CPU_VOID){
+    CPU_INT32U flags = Dma->ISR & (DMA_HTIF6 | DMA_TCIF6);
+
+    if(!flags)
+        return;
+    Dma->IFCR = DMA_GIF6;
+    if(flags & DMA_HTIF6){
+        rxStats.halves++;
+        rxMarked += RxHalf;
+    }
+    if(flags & DMA_TCIF6){
+        rxStats.fulls++;
+        rxMarked += RxHalf;
+    }
+    if(rxWake != NULL)
+        rxWake();
+}
+
+#ifdef DmaSimulated
+
+/*-------------------- S i m I f c r ( ) -------------------------------------
+	Purpose:	Clear the status flags written to IFCR, as the controller does
+                        at once. A channel's global bit (the low bit of its four)
+                        clears all four.
+*/
+static CPU_VOID SimIfcr(CPU_VOID){
+    CPU_INT32U clear = simDma.IFCR;
+    CPU_INT08U ch;
+
+    for(ch = 0; ch < 32; ch += 4)
+        if(clear & (1UL << ch))
+            clear |= 0xFUL << ch;
+    simDma.ISR &= ~clear;
+    simDma.IFCR = 0;
+}
+
+/*-------------------- D m a S i m T i c k ( ) -------------------------------------
+	Purpose:	One byte time of the model. The shift register sends its byte
+                        and takes DR's; then, if the USART asks (DMAT and TXE) and
+                        the channel is on with bytes left, the channel writes the
+                        next byte to DR, raising transfer complete on the last.
+                        IFCR writes take effect at once.
+        Return:         The byte sent on the line this byte time, -1 if none
+*/
+CPU_INT16S DmaSimTick(CPU_VOID){
+    CPU_INT16S sent = simShift;
+
+    SimIfcr();
+    if(!(simTxCh.CCR & DMA_EN))
+        simTxLatched = FALSE;
+
+    simShift = -1;
+    if(!(simUsart.SR & USART_TXE)){
+        simShift = simUsart.DR;
+        simUsart.SR |= USART_TXE;
+    }else if(sent >= 0)
+        simUsart.SR |= USART_TC;
+
+    if((simUsart.CR3 & USART_DMAT) && (simUsart.SR & USART_TXE) &&
+       (simTxCh.CCR & DMA_EN) && simTxCh.CNDTR > 0){
+        if(!simTxLatched){
+            simTxNext = simTxCh.CMAR;
+            simTxLatched = TRUE;
+        }
+        simUsart.DR = *simTxNext++;
+        simUsart.SR &= ~(USART_TXE | USART_TC);
+        if(--simTxCh.CNDTR == 0){
+            simTxLatched = FALSE;
+            simDma.ISR |= DMA_GIF7 | DMA_TCIF7;
+            if(simTxCh.CCR & DMA_TCIE){
+                TxDmaIrq();
+                SimIfcr();
+            }
+        }
+    }
+    return sent;
+}
+
+/*-------------------- D m a S i m R x ( ) -------------------------------------
+	Purpose:	One byte comes in on the line. If the USART asks (DMAR) and the
+                        channel is on with bytes left, the channel moves it from DR to
+                        the next place in memory, raising half transfer and transfer
+                        complete as it passes the middle and the end; in circular
+                        mode CNDTR then starts again. Otherwise it waits in DR,
+                        where the next byte overwrites it.
+        Parameters:     the byte
+*/
+CPU_VOID DmaSimRx(CPU_INT08U byte){
+    CPU_INT32U raised = 0;
+
+    SimIfcr();
+    if(!(simRxCh.CCR & DMA_EN))
+        simRxLatched = FALSE;
+    simRxDr = byte;
+    simUsart.SR |= USART_RXNE;
+    simRxHeard = TRUE;
+
+    if(!(simUsart.CR3 & USART_DMAR) || !(simRxCh.CCR & DMA_EN) || simRxCh.CNDTR == 0)
+        return;
+    if(!simRxLatched){
+        simRxBase = (CPU_INT08U *)simRxCh.CMAR;
+        simRxReload = (CPU_INT16U)simRxCh.CNDTR;
+        simRxLatched = TRUE;
+    }
+    simRxBase[simRxReload - simRxCh.CNDTR] = simRxDr;
+    simUsart.SR &= ~USART_RXNE;
+    if(--simRxCh.CNDTR == simRxReload / 2){
+        simDma.ISR |= DMA_GIF6 | DMA_HTIF6;
+        if(simRxCh.CCR & DMA_HTIE)
+            raised = DMA_HTIF6;
+    }else if(simRxCh.CNDTR == 0){
+        simDma.ISR |= DMA_GIF6 | DMA_TCIF6;
+        if(simRxCh.CCR & DMA_TCIE)
+            raised = DMA_TCIF6;
+        if(simRxCh.CCR & DMA_CIRC)
+            simRxCh.CNDTR = simRxReload;
+    }
+    if(raised){
+        RxDmaIrq();
+        SimIfcr();
+    }
+}
+
+/*-------------------- D m a S i m R x I d l e ( ) -------------------------------------
+	Purpose:	The Rx line stays idle for a frame. If a byte has come since it
+                        was last idle, the USART sets IDLE and, with IDLEIE, takes the
+                        interrupt Ser_ISR() passes on to SerDmaRxIdle().
+*/
+CPU_VOID DmaSimRxIdle(CPU_VOID){
+    if(!simRxHeard)
+        return;
+    simRxHeard = FALSE;
+    simUsart.SR |= USART_IDLE;
+    if(simUsart.CR1 & USART_IDLEIE)
+        SerDmaRxIdle();
+}
+
+/*-------------------- D m a S i m T x R e s e t ( ) -------------------------------------
+	Purpose:	Put the model's Tx side in its reset state: channel off, line idle.
+*/
+static CPU_VOID DmaSimTxReset(CPU_VOID){
+    memset(&simTxCh, 0, sizeof(simTxCh));
+    simDma.ISR &= ~(DMA_GIF7 | DMA_TCIF7);
+    simUsart.SR |= USART_TXE | USART_TC;
+    simUsart.CR3 &= ~USART_DMAT;
+    simTxLatched = FALSE;
+    simShift = -1;
+}
+
+/*-------------------- D m a S i m R x R e s e t ( ) -------------------------------------
+	Purpose:	Put the model's Rx side in its reset state: channel off, nothing heard.
+*/
+static CPU_VOID DmaSimRxReset(CPU_VOID){
+    memset(&simRxCh, 0, sizeof(simRxCh));
+    simDma.ISR &= ~(DMA_GIF6 | DMA_TCIF6 | DMA_HTIF6);
+    simUsart.SR &= ~(USART_RXNE | USART_IDLE);
+    simUsart.CR1 &= ~USART_IDLEIE;
+    simUsart.CR3 &= ~USART_DMAR;
+    simRxLatched = FALSE;
+    simRxHeard = FALSE;
+}
+
+#else
+
+#define DmaSimTxReset()
+#define DmaSimRxReset()
+
+/*-------------------- S e r D m a T x _ I S R ( ) -------------------------------------
+	Purpose:	DMA1 channel 7 interrupt, with the uC/OS-III prologue and
+                        epilogue, since the done function may post a semaphore.
+*/
+CPU_VOID SerDmaTx_ISR(CPU_VOID){
+    /*---------------------- Prologue ----------------*/
+    CPU_SR_ALLOC();
+    OS_CRITICAL_ENTER();
+    OSIntEnter();
+    OS_CRITICAL_EXIT();
+    /*----------------------  ISR  -------------------*/
+
+    TxDmaIrq();
+
+    /*---------------------- Epilogue ----------------*/
+    OSIntExit();
+}
+
+/*-------------------- S e r D m a R x _ I S R ( ) -------------------------------------
+	Purpose:	DMA1 channel 6 interrupt, with the uC/OS-III prologue and
+                        epilogue, since the wake function may post a semaphore.
+*/
+CPU_VOID SerDmaRx_ISR(CPU_VOID){
+    /*---------------------- Prologue ----------------*/
+    CPU_SR_ALLOC();
+    OS_CRITICAL_ENTER();
+    OSIntEnter();
+    OS_CRITICAL_EXIT();
+    /*----------------------  ISR  -------------------*/
+
+    RxDmaIrq();
+
+    /*---------------------- Epilogue ----------------*/
+    OSIntExit();
+}
+
+#endif
+
+/*-------------------- S e r D m a T x I n i t ( ) -------------------------------------
+	Purpose:	Set DMA1 channel 7 up to feed USART2's DR from memory, a byte
+                        at a time, and let the USART ask it for bytes. The USART
+                        itself must be set up already, with TXEIE off.
+        Parameters:     function to call, from the interrupt, as each span ends
+*/
+CPU_VOID SerDmaTxInit(CPU_VOID (*done)(CPU_VOID)){
+    txDone = done;
+    txBusy = FALSE;
+    memset(&txStats, 0, sizeof(txStats));
+    DmaSimTxReset();
+
+#ifndef DmaSimulated
+    BSP_PeriphEn(BSP_PERIPH_ID_DMA1);
+#endif
+    TxCh->CCR = 0;
+    TxCh->CPAR = DmaAddr(&Usart->DR);
+    TxCh->CCR = DMA_MINC | DMA_DIR | DMA_TCIE;
+    Dma->IFCR = DMA_GIF7;
+    Usart->CR3 |= USART_DMAT;
+#ifndef DmaSimulated
+    BSP_IntVectSet(BSP_INT_ID_DMA1_CH7, SerDmaTx_ISR);
+    BSP_IntEn(BSP_INT_ID_DMA1_CH7);
+#endif
+}
+
+/*-------------------- S e r D m a T x S t a r t ( ) -------------------------------------
+	Purpose:	Start sending a span. It must stay put until the done function
+                        is called.
+        Parameters:     the span and its length in bytes
+        Return:         FALSE if a span is still going or len is 0
+*/
+CPU_BOOLEAN SerDmaTxStart(const CPU_INT08U *span, CPU_INT16U len){
+    if(txBusy){
+        txStats.refused++;
+        return FALSE;
+    }
+    if(len == 0)
+        return FALSE;
+
+    txBusy = TRUE;
+    TxCh->CCR &= ~DMA_EN;
+    TxCh->CMAR = DmaAddr(span);
+    TxCh->CNDTR = len;
+    txStats.spans++;
+    txStats.bytes += len;
+    TxCh->CCR |= DMA_EN;
+    return TRUE;
+}
+
+/*-------------------- S e r D m a T x B u s y ( ) -------------------------------------
+	Purpose:	Test whether a span is still going.
+*/
+CPU_BOOLEAN SerDmaTxBusy(CPU_VOID){
+    return txBusy;
+}
+
+/*-------------------- S e r D m a T x G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out the transmit counters.
+*/
+CPU_VOID SerDmaTxGetStats(SerDmaTxStats *stats){
+    *stats = txStats;
+}
+
+/*-------------------- S e r D m a R x I n i t ( ) -------------------------------------
+	Purpose:	Set DMA1 channel 6 up to copy USART2's DR into the ring as each
+                        byte arrives, round and round, interrupting at the half and the
+                        end, and let the USART hand it bytes and interrupt on an idle
+                        line. The USART itself must be set up already, with RXNEIE off.
+        Parameters:     function to call, from an interrupt, when there are bytes to read
+*/
+CPU_VOID SerDmaRxInit(CPU_VOID (*wake)(CPU_VOID)){
+    rxWake = wake;
+    rxMarked = 0;
+    rxTaken = 0;
+    memset(&rxStats, 0, sizeof(rxStats));
+    DmaSimRxReset();
+
+#ifndef DmaSimulated
+    BSP_PeriphEn(BSP_PERIPH_ID_DMA1);
+#endif
+    RxCh->CCR = 0;
+    RxCh->CPAR = DmaAddr(&Usart->DR);
+    RxCh->CMAR = DmaAddr(rxRing);
+    RxCh->CNDTR = SerDmaRxSize;
+    RxCh->CCR = DMA_MINC | DMA_CIRC | DMA_HTIE | DMA_TCIE;
+    Dma->IFCR = DMA_GIF6;
+    Usart->CR3 |= USART_DMAR;
+    Usart->CR1 |= USART_IDLEIE;
+#ifndef DmaSimulated
+    BSP_IntVectSet(BSP_INT_ID_DMA1_CH6, SerDmaRx_ISR);
+    BSP_IntEn(BSP_INT_ID_DMA1_CH6);
+#endif
+    RxCh->CCR |= DMA_EN;
+}
+
+/*-------------------- R x W r i t t e n ( ) -------------------------------------
+	Purpose:	Find the bytes the channel has written so far. rxMarked is read
+                        again after CNDTR, so an interrupt between them is seen.
+        Return:         Bytes written since SerDmaRxInit(), modulo 2^32
+*/
+static CPU_INT32U RxWritten(CPU_VOID){
+    CPU_INT32U marked;
+    CPU_INT16U at;
+
+    do{
+        marked = rxMarked;
+        at = (CPU_INT16U)(SerDmaRxSize - RxCh->CNDTR);
+    }while(marked != rxMarked);
+    return marked + ((at - marked) & (SerDmaRxSize - 1));
+}
+
+/*-------------------- S e r D m a R x S p a n ( ) -------------------------------------
+	Purpose:	Find the received bytes the reader has not skipped yet that lie
+                        together in the ring: up to the write point, or to the end of
+                        the ring if the bytes wrap. The rest follow from the start of the
+                        ring once these are skipped. A reader more than a lap behind is
+                        moved up to the write point first, losing the bytes between.
+        Parameters:     where to put the span's start
+        Return:         Its length in bytes, 0 if nothing has come
+*/
+CPU_INT16U SerDmaRxSpan(const CPU_INT08U **span){
+    CPU_INT32U written = RxWritten();
+    CPU_INT16U at;
+    CPU_INT32U len;
+
+    if(written - rxTaken > SerDmaRxSize){
+        rxStats.overruns++;
+        rxTaken = written;
+    }
+    at = (CPU_INT16U)(rxTaken & (SerDmaRxSize - 1));
+    len = written - rxTaken;
+    if(len > (CPU_INT32U)(SerDmaRxSize - at))
+        len = SerDmaRxSize - at;
+
+    *span = &rxRing[at];
+    if(len > 0)
+        rxStats.spans++;
+    return (CPU_INT16U)len;
+}
+
+/*-------------------- S e r D m a R x S k i p ( ) -------------------------------------
+	Purpose:	Give bytes the reader is done with back to the channel.
+        Parameters:     how many, at most the length of the last span
+*/
+CPU_VOID SerDmaRxSkip(CPU_INT16U count){
+    rxTaken += count;
+    rxStats.bytes += count;
+}
+
+/*-------------------- S e r D m a R x I d l e ( ) -------------------------------------
+	Purpose:	Wake the reader if the line has gone idle after a burst, so the
+                        end of a short packet is read without waiting for the channel
+                        to reach a half. Called from the USART interrupt.
+*/
+CPU_VOID SerDmaRxIdle(CPU_VOID){
+    if(!(Usart->SR & USART_IDLE))
+        return;
+    ClearIdle();
+    rxStats.idles++;
+    if(rxWake != NULL)
+        rxWake();
+}
+
+/*-------------------- S e r D m a R x G e t S t a t s ( ) -------------------------------------
+	Purpose:	Copy out the receive counters.
+*/
+CPU_VOID SerDmaRxGetStats(SerDmaRxStats *stats){
+    *stats = rxStats;
+}
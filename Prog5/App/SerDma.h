@@ -0,0 +1,90 @@
+/*
+-----------------------------------------------------------------------
+	                    Embedded Systems
+                   Prog 5   -   Jesse Whitworth
+-----------------------------------------------------------------------
+			        SerDma.h
+-----------------------------------------------------------------------
+DMA transmit on USART2. SerDmaTxStart() hands a contiguous span of
+bytes to DMA1 channel 7 (the USART2_TX request), which feeds the USART
+a byte each time TXE sets, with no interrupt. One transfer-complete
+interrupt ends the span and calls the done function given to
+SerDmaTxInit(), from the interrupt. A span is at most 65535 bytes
+(CNDTR), and one span is sent at a time.
+
+The reply task sends each reply buffer as one span (PutSpan(),
+SerIODriver.h), so a reply costs one interrupt and one task wake
+instead of a TXE interrupt and a semaphore post for every byte.
+
+Define DmaSimulated (the host tools' HostOS.h does) to drive a
+register level model of the channel and the USART instead. Each
+DmaSimTick() is one byte time on the line: the shift register sends
+its byte, takes the next from DR, and the channel refills DR while it
+has bytes left, raising the transfer-complete interrupt on the last.
+
+DMA receive, also on USART2. DMA1 channel 6 (USART2_RX) runs in
+circular mode, copying each byte from DR into a ring of SerDmaRxSize
+bytes as it arrives, with no interrupt. The channel interrupts at the
+half-transfer and transfer-complete points of the ring, and the USART
+interrupts when the line goes idle after a burst (SerDmaRxIdle(), from
+Ser_ISR()); each calls the wake function given to SerDmaRxInit(), so
+the reader hears of a short packet as soon as it ends and of a long
+stream at least twice a lap. SerDmaRxSpan() gives the reader the
+contiguous bytes up to the channel's write point or the end of the
+ring, and SerDmaRxSkip() hands what it has used back to the channel.
+A reader more than a lap behind has lost bytes: it is counted as an
+overrun and moved up to the write point.
+
+DmaSimRx() puts a byte on the model's Rx line and DmaSimRxIdle() lets
+the line go idle.
+*/
+
+#ifndef SERDMA_H
+#define SERDMA_H
+
+#include "includes.h"
+
+//Ring size in bytes, a power of two so the byte counts wrap with it
+#ifndef SerDmaRxSize
+#define SerDmaRxSize 64
+#endif
+
+typedef struct
+{
+	CPU_INT32U spans;         // Spans started
+	CPU_INT32U bytes;         // Bytes in them
+	CPU_INT32U irqs;          // Transfer-complete interrupts taken
+	CPU_INT32U refused;       // Starts refused: a span was still going
+} SerDmaTxStats;
+
+typedef struct
+{
+	CPU_INT32U spans;         // Spans given to the reader
+	CPU_INT32U bytes;         // Bytes it has skipped past
+	CPU_INT32U halves;        // Half-transfer interrupts taken
+	CPU_INT32U fulls;         // Transfer-complete interrupts taken
+	CPU_INT32U idles;         // Idle line interrupts taken
+	CPU_INT32U overruns;      // Times the reader was lapped
+} SerDmaRxStats;
+
+/*----- f u n c t i o n    p r o t o t y p e s -----*/
+CPU_VOID SerDmaTxInit(CPU_VOID (*done)(CPU_VOID));
+CPU_BOOLEAN SerDmaTxStart(const CPU_INT08U *span, CPU_INT16U len);
+CPU_BOOLEAN SerDmaTxBusy(CPU_VOID);
+CPU_VOID SerDmaTxGetStats(SerDmaTxStats *stats);
+CPU_VOID SerDmaRxInit(CPU_VOID (*wake)(CPU_VOID));
+CPU_INT16U SerDmaRxSpan(const CPU_INT08U **span);
+CPU_VOID SerDmaRxSkip(CPU_INT16U count);
+CPU_VOID SerDmaRxIdle(CPU_VOID);
+CPU_VOID SerDmaRxGetStats(SerDmaRxStats *stats);
+
+#ifdef DmaSimulated
+CPU_INT16S DmaSimTick(CPU_VOID);
+CPU_VOID DmaSimRx(CPU_INT08U byte);
+CPU_VOID DmaSimRxIdle(CPU_VOID);
+#else
+CPU_VOID SerDmaTx_ISR(CPU_VOID);
+CPU_VOID SerDmaRx_ISR(CPU_VOID);
+#endif
+
+#endif
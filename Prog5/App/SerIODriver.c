@@ -13,6 +13,7 @@ two semaphores 
 #include "Assert.h"
 #include "SerIODriver.h"
 #include "Bfr.h"
+#include "SerDma.h"
 
 //----- c o n s t a n t    d e f i n i t  i o n s -----
 //USART Bit Masks
@@ -28,7 +29,7 @@ two semaphores 
 #define MASK_TX() (USART2->CR1 &= ~USART_TXEIE)
 #define UNMASK_TX() (USART2->CR1 |= USART_TXEIE)
 #define MASK_RX() (USART2->CR1 &= ~USART_RXNEIE)
-#define UNMASK_RX() (USART2->CR1 |= USART_TXEIE)
+#define UNMASK_RX() (USART2->CR1 |= USART_RXNEIE)
 
 
 
@@ -39,6 +40,16 @@ OS_SEM	spacesAvail;	  /* Upon removing a byte from oBfr, ServiceTx() posts to th
                                      semaphore to signal PutByte() that a new data byte is available.*/
 OS_SEM	bytesAvail;	  /* Upon adding a byte to iBfr, ServiceRx() posts to this semaphore to
                                      signal GetByte() that a space has been made available.*/
+#ifdef SerTxDma
+static OS_SEM spanSent;   /* The DMA transfer-complete interrupt posts to this semaphore to
+                                     signal PutSpan() that its span is sent.*/
+static CPU_VOID SpanSent(CPU_VOID);
+#endif
+#ifdef SerRxDma
+static OS_SEM spanAvail;  /* The Rx DMA interrupts and the idle line interrupt post to this
+                                     semaphore to signal GetSpan() that bytes may have come.*/
+static CPU_VOID SpanArrived(CPU_VOID);
+#endif
 
 // Allocate the input buffer.
 static CircBfr iBfr;
@@ -74,9 +85,28 @@ CPU_VOID InitIODriver(CPU_VOID){
     AFIO->MAPR |= AFIO_MAPR_USART2_REMAP;
     USART2->SR  = 0x00C0;
     USART2->BRR = 0x0EA6;
+#if defined(SerTxDma) && defined(SerRxDma)
+    USART2->CR1 = 0x201C; // Unmask UE, IDLEIE, TE, RE; DMA feeds Tx and drains Rx
+#elif defined(SerTxDma)
+    USART2->CR1 = 0x202C; // Unmask UE, RXNEIE, TE, RE; DMA feeds Tx
+#elif defined(SerRxDma)
+    USART2->CR1 = 0x209C; // Unmask UE, TXEIE, IDLEIE, TE, RE; DMA drains Rx
+#else
     USART2->CR1 = 0x20AC; // Unmask UE, TXEIE, RXNEIE, TE, RE
+#endif
     USART2->CR2 = 0x0000;
     USART2->CR3 = 0x0000;
+    
+#ifdef SerTxDma
+    OSSemCreate(&spanSent, "Span Sent", 0, &osErr);
+    assert(osErr == OS_ERR_NONE);
+    SerDmaTxInit(SpanSent);
+#endif
+#ifdef SerRxDma
+    OSSemCreate(&spanAvail, "Span Avail", 0, &osErr);
+    assert(osErr == OS_ERR_NONE);
+    SerDmaRxInit(SpanArrived);
+#endif
       
     // Enable IRQ38 - Set NVIC Register SETENA1[6]
     BSP_IntVectSet(38, Ser_ISR); // Setup Ser_ISR as the interrupt handler for USART2 at irq 38
@@ -110,6 +140,37 @@ CPU_INT16S PutByte(CPU_INT16S txChar){
     return txChar; 
 }
 
+#ifdef SerTxDma
+
+/*-------------------- S p a n S e n t ( ) -------------------------------------
+	Purpose:	Wake PutSpan(). Called from the DMA transfer-complete interrupt.
+*/
+static CPU_VOID SpanSent(CPU_VOID){
+    OS_ERR osErr; /* -- Semaphore error code */
+    
+    OSSemPost(&spanSent, OS_OPT_POST_1, &osErr);
+    assert(osErr==OS_ERR_NONE);
+}
+
+/*-------------------- P u t S p a n ( ) -------------------------------------
+	Purpose:	[Hand a contiguous span to the Tx DMA channel and pend on the
+                        semaphore "spanSent" until its transfer-complete interrupt.]
+                        The span must not change until then; the caller may release
+                        it as soon as PutSpan() returns.
+        Parameters:     The span and its length in bytes
+        Return Value:   None
+*/
+CPU_VOID PutSpan(const CPU_INT08U *span, CPU_INT16U len){
+    OS_ERR osErr; /* -- Semaphore error code */
+    
+    if(!SerDmaTxStart(span, len))
+        return;
+    OSSemPend(&spanSent, 0, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+    assert(osErr == OS_ERR_NONE);
+}
+
+#endif
+
 /*-------------------- G e t B y t e ( ) -------------------------------------
 	Purpose:	[Pend on the semaphore "bytesAvail" and then remove one byte from
                         iBfr, unmask Rx interrup, and return result of BfrRemByte.]
@@ -118,15 +179,66 @@ CPU_INT16S PutByte(CPU_INT16S txChar){
                         Failure - If iBfr is empty, return -1
 */
 CPU_INT16S GetByte(CPU_VOID){
+#ifdef SerRxDma
+    const CPU_INT08U *span;
+    
+    GetSpan(&span);
+    CPU_INT16S byte = span[0];
+    ReleaseSpan(1);
+#else
     OS_ERR osErr; /* -- Semaphore error code */
     
     OSSemPend(&bytesAvail, 0, OS_OPT_PEND_BLOCKING, NULL, &osErr); 
     CPU_INT16S byte = BfrRemByte(&iBfr);
     UNMASK_RX();
+#endif
     
     return byte;
 }
 
+#ifdef SerRxDma
+
+/*-------------------- S p a n A r r i v e d ( ) -------------------------------------
+	Purpose:	Wake GetSpan(). Called from the Rx DMA and idle line interrupts.
+*/
+static CPU_VOID SpanArrived(CPU_VOID){
+    OS_ERR osErr; /* -- Semaphore error code */
+    
+    OSSemPost(&spanAvail, OS_OPT_POST_1, &osErr);
+    assert(osErr==OS_ERR_NONE);
+}
+
+/*-------------------- G e t S p a n ( ) -------------------------------------
+	Purpose:	[Pend on the semaphore "spanAvail" until the Rx DMA ring holds
+                        bytes not yet released, and point to the first of them.]
+                        A post can come with nothing new, or several for one span;
+                        the ring is looked at each time, not the count.
+        Parameters:     Where to put the span's start
+        Return Value:   The span's length in bytes, at least 1. More may follow it
+                        from the start of the ring once it is released.
+*/
+CPU_INT16U GetSpan(const CPU_INT08U **span){
+    OS_ERR osErr; /* -- Semaphore error code */
+    CPU_INT16U len;
+    
+    while((len = SerDmaRxSpan(span)) == 0){
+        OSSemPend(&spanAvail, 0, OS_OPT_PEND_BLOCKING, NULL, &osErr);
+        assert(osErr == OS_ERR_NONE);
+    }
+    return len;
+}
+
+/*-------------------- R e l e a s e S p a n ( ) -------------------------------------
+	Purpose:	Give bytes from the front of the last span back to the ring.
+        Parameters:     How many, at most the span's length
+        Return Value:   None
+*/
+CPU_VOID ReleaseSpan(CPU_INT16U count){
+    SerDmaRxSkip(count);
+}
+
+#endif
+
 /*-------------------- S e r v i c e T x ( ) -------------------------------------
 	Purpose:	[If TXE = 0, just return.
                         Otherwise, if oBfr is empty, mask the Tx interrupt and return.
@@ -192,8 +304,16 @@ CPU_VOID Ser_ISR(CPU_VOID){
     OS_CRITICAL_EXIT();
     /*----------------------  ISR  -------------------*/
     
+#ifdef SerRxDma
+    SerDmaRxIdle();
+#else
     ServiceRx();
+#endif
+#ifndef SerTxDma
     ServiceTx();
+#else
+    MASK_TX();  // DMA feeds Tx: TXE must never interrupt, or it would never stop
+#endif
     
     /*---------------------- Epilogue ----------------*/
     /*Give the O/S a chance to swap tasks. */
@@ -20,9 +20,22 @@ two semaphores 
 #define BfrSize 4
 #endif
 
+//Send replies by DMA, a span at a time (PutSpan(), SerDma.h). Comment
+//out to send them a byte per TXE interrupt through oBfr (PutByte()).
+#define SerTxDma
+
+//Take received bytes a span at a time from the circular Rx DMA ring
+//(GetSpan(), SerDma.h), woken at each half of the ring and when the line
+//goes idle. Comment out to take them a byte per RXNE interrupt through
+//iBfr (GetByte()).
+#define SerRxDma
+
 CPU_VOID InitIODriver(CPU_VOID);
 CPU_INT16S PutByte(CPU_INT16S txChar);
+CPU_VOID PutSpan(const CPU_INT08U *span, CPU_INT16U len);
 CPU_INT16S GetByte(CPU_VOID);
+CPU_INT16U GetSpan(const CPU_INT08U **span);
+CPU_VOID ReleaseSpan(CPU_INT16U count);
 CPU_VOID ServiceTx(CPU_VOID);
 CPU_VOID ServiceRx(CPU_VOID);
 CPU_VOID Ser_ISR(CPU_VOID);
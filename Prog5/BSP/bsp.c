@@ -25,6 +25,8 @@
 * Filename      : bsp.c
 * Version       : V1.00
 * Programmer(s) : EHS
+*                 JW - BSP_Init() split into BSP_ClkInit() and BSP_IO_Init() so the clocks can come up
+*                      alone at boot. CPU_TS_TmrInit() keeps a running cycle counter.
 *********************************************************************************************************
 */
 
@@ -164,6 +166,31 @@ void  BSP_Init (void)
 {
 //gpc 2-2-2011    BSP_IntInit();
 
+    BSP_ClkInit();
+    BSP_IO_Init();
+}
+
+
+/*
+*********************************************************************************************************
+*                                             BSP_ClkInit()
+*
+* Description : Start the external crystal and the PLLs and run the core at 72MHz.
+*
+* Argument(s) : none.
+*
+* Return(s)   : none.
+*
+* Caller(s)   : BSP_Init(),
+*               Application.
+*
+* Note(s)     : (1) The USART baud rate dividers assume these clocks, so this MUST be called before
+*                   the USARTs are set up.
+*********************************************************************************************************
+*/
+
+void  BSP_ClkInit (void)
+{
     RCC_DeInit();
     RCC_HSEConfig(RCC_HSE_ON);                                  /* HSE = 25MHz ext. crystal.                            */
     RCC_WaitForHSEStartUp();
@@ -211,7 +238,30 @@ void  BSP_Init (void)
 
     BSP_CPU_ClkFreq_MHz = BSP_CPU_ClkFreq_MHz;                  /* Surpress compiler warning BSP_CPU_ClkFreq_MHz    ... */
                                                                 /* ... set and not used.                                */
+}
+
 
+/*
+*********************************************************************************************************
+*                                             BSP_IO_Init()
+*
+* Description : Initialize the LEDs, the status input and the trace pins.
+*
+* Argument(s) : none.
+*
+* Return(s)   : none.
+*
+* Caller(s)   : BSP_Init(),
+*               Application.
+*
+* Note(s)     : (1) BSP_ClkInit() MUST have been called.
+*
+*               (2) See BSP_Init() Note #2 for the trace pins.
+*********************************************************************************************************
+*/
+
+void  BSP_IO_Init (void)
+{
     BSP_LED_Init();                                             /* Initialize the I/Os for the LED      controls.       */
 
     BSP_StatusInit();                                           /* Initialize the status input(s)                       */
@@ -562,10 +612,12 @@ CPU_INT32U  OSProbe_TmrRd (void)
 *
 * Return(s)   : none.
 *
-* Caller(s)   : CPU_TS_Init().
+* Caller(s)   : CPU_TS_Init(),
+*               BootStart().
 *
 *               This function is an INTERNAL CPU module function & MUST be implemented by application/
-*               BSP function(s) [see Note #1] but MUST NOT be called by application function(s).
+*               BSP function(s) [see Note #1] but MUST NOT be called by application function(s) other
+*               than BootStart() (see Note #3).
 *
 * Note(s)     : (1) CPU_TS_TmrInit() is an application/BSP function that MUST be defined by the developer
 *                   if either of the following CPU features is enabled :
@@ -601,12 +653,18 @@ CPU_INT32U  OSProbe_TmrRd (void)
 *                       inadequate to measure desired times.
 *
 *                   See also 'CPU_TS_TmrRd()  Note #2'.
+*
+*               (3) BootStart() starts the counter before the kernel is initialized to time the boot;
+*                   the call from CPU_Init() then leaves it running rather than clear it.
 *********************************************************************************************************
 */
 
 #if (CPU_CFG_TS_TMR_EN == DEF_ENABLED)
 void  CPU_TS_TmrInit (void)
 {
+    if ((DWT_CR & DWT_CR_CYCCNTENA) != 0u) {                   /* Already counting from boot (see Note #3).            */
+        return;
+    }
     DEM_CR     |= (CPU_INT32U)DEM_CR_TRCENA;                    /* Enable Cortex-M3's DWT CYCCNT reg.                   */
     DWT_CYCCNT  = (CPU_INT32U)0u;
     DWT_CR     |= (CPU_INT32U)DWT_CR_CYCCNTENA;
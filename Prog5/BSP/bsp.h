@@ -333,6 +333,10 @@
 
 void         BSP_Init                    (void);
 
+void         BSP_ClkInit                 (void);
+
+void         BSP_IO_Init                 (void);
+
 void         BSP_IntDisAll               (void);
 
 CPU_INT32U   BSP_CPU_ClkFreq             (void);
@@ -21,6 +21,8 @@
 * Filename      : bsp_i2c.c
 * Version       : V1.00
 * Programmer(s) : FT
+*                 JW - BSP_I2C_WrRdStart(): transfers completed by the ISR without a waiting caller.
+*                      Fast mode sets CCR[FS] and TRISE.
 *********************************************************************************************************
 * Note(s)       :
 *********************************************************************************************************
@@ -160,6 +162,7 @@ typedef  struct bsp_i2c_dev_status {
     CPU_INT16U   BufLen;                                        /* Trnasfer length                                      */
     BSP_OS_SEM   SemLock;                                       /* I2C Exclusive access sempahore                       */
     BSP_OS_SEM   SemWait;                                       /* Transfer Complete signal                             */
+    BSP_I2C_DONE_FNCT  DoneFnct;                                /* Called at the end instead, if no caller waits        */
 } BSP_I2C_DEV_STATUS;
 
 
@@ -205,11 +208,14 @@ static  void        BSP_I2C1_ErrISR_Handler    (void);
 static  void        BSP_I2C2_ErrISR_Handler    (void);
 static  void        BSP_I2Cx_ErrISR_Handler    (CPU_INT08U  i2c_nbr);
 
-static CPU_BOOLEAN  BSP_I2C_StartXfer          (CPU_INT08U   i2c_nbr,
-                                                CPU_INT08U   i2c_addr,
-                                                CPU_INT08U   i2c_access_type,
-                                                CPU_INT08U  *p_buf,
-                                                CPU_INT08U   nbr_bytes);
+static CPU_BOOLEAN  BSP_I2C_StartXfer          (CPU_INT08U          i2c_nbr,
+                                                CPU_INT08U          i2c_addr,
+                                                CPU_INT08U          i2c_access_type,
+                                                CPU_INT08U         *p_buf,
+                                                CPU_INT08U          nbr_bytes,
+                                                BSP_I2C_DONE_FNCT   done_fnct);
+
+static  void        BSP_I2C_XferEnd            (BSP_I2C_DEV_STATUS  *p_i2c_dev_status);
 /*
 *********************************************************************************************************
 *                                     LOCAL CONFIGURATION ERRORS
@@ -345,9 +351,9 @@ CPU_BOOLEAN  BSP_I2C_Init (CPU_INT08U  i2c_id,
              if (clk_freq > BSP_I2C_MODE_FAST_MAX_FREQ_HZ) {
                  return (DEF_FAIL);
              }  
-             DEF_BIT_SET(reg_val, BSP_I2C_REG_CCR_FS);
              reg_val = (((2 * pclk_freq  + clk_freq)/ (2 * clk_freq))  / 3)
                      & BSP_I2C_REG_CCR_MASK;
+             DEF_BIT_SET(reg_val, BSP_I2C_REG_CCR_FS);
              break;
         
         
@@ -362,6 +368,12 @@ CPU_BOOLEAN  BSP_I2C_Init (CPU_INT08U  i2c_id,
     }    
     
     p_i2c_reg->I2C_CCR = reg_val;
+                                                               /* Longest rise time: 1000 ns standard, 300 ns fast    */
+    if (i2c_mode == BSP_I2C_MODE_STANDARD) {
+        p_i2c_reg->I2C_TRISE = (pclk_freq / DEF_TIME_NBR_uS_PER_SEC) + 1;
+    } else {
+        p_i2c_reg->I2C_TRISE = ((pclk_freq / DEF_TIME_NBR_uS_PER_SEC) * 300 / 1000) + 1;
+    }
     
                                                                 /* Enable interrupts in the interrupt controller      */
     switch (i2c_id) {
@@ -392,6 +404,7 @@ CPU_BOOLEAN  BSP_I2C_Init (CPU_INT08U  i2c_id,
     p_i2c_dev_status->State      = BSP_I2C_STATE_IDLE;
     p_i2c_dev_status->BufPtr     = (CPU_INT08U *)0;
     p_i2c_dev_status->BufLen     = 0;   
+    p_i2c_dev_status->DoneFnct   = (BSP_I2C_DONE_FNCT)0;
 
     p_i2c_reg->I2C_CR1           = BSP_I2C_REG_CR1_PE;            /* Enable the I2C peripheral                        */
     
@@ -421,22 +434,27 @@ CPU_BOOLEAN  BSP_I2C_Init (CPU_INT08U  i2c_id,
 *
 *               nbr_bytes          Number of bytes to read.
 *
+*               done_fnct          Function the ISR calls when the transfer ends, or 0 to wait for it here.
+*
 * Return(s)   : DEF_OK            If the transfer could be initialized and started 
 *               DEF_FAIL          If the transfer could no bet initialized and started
 *
 * Caller(s)   : BSP_I2C_Rd()
 *               BSP_I2C_Wr()
 *               BSP_I2C_WrRd()
+*               BSP_I2C_WrRdStart()
 *
-* Note(s)     : none.
+* Note(s)     : (1) With a done_fnct the peripheral stays locked until the transfer ends, and the
+*                   ISR releases it (see BSP_I2C_XferEnd()).
 *********************************************************************************************************
 */
 
-static  CPU_BOOLEAN  BSP_I2C_StartXfer (CPU_INT08U   i2c_id,
-                                        CPU_INT08U   i2c_addr,
-                                        CPU_INT08U   i2c_access_type,
-                                        CPU_INT08U  *p_buf,                    
-                                        CPU_INT08U   nbr_bytes)
+static  CPU_BOOLEAN  BSP_I2C_StartXfer (CPU_INT08U          i2c_id,
+                                        CPU_INT08U          i2c_addr,
+                                        CPU_INT08U          i2c_access_type,
+                                        CPU_INT08U         *p_buf,                    
+                                        CPU_INT08U          nbr_bytes,
+                                        BSP_I2C_DONE_FNCT   done_fnct)
 {   
     CPU_BOOLEAN          err;
     BSP_I2C_DEV_STATUS  *p_i2c_dev_status;
@@ -473,12 +491,17 @@ static  CPU_BOOLEAN  BSP_I2C_StartXfer (CPU_INT08U   i2c_id,
     p_i2c_dev_status->State      = BSP_I2C_STATE_START;         /* Set the START state                                  */
     p_i2c_dev_status->BufPtr     = p_buf;                       /* Set the buffer information                           */
     p_i2c_dev_status->BufLen     = nbr_bytes;  
+    p_i2c_dev_status->DoneFnct   = done_fnct;
     
     DEF_BIT_SET(p_i2c_reg->I2C_CR1, BSP_I2C_REG_CR1_START);     /* Generate the start condition                         */
 
     DEF_BIT_SET(p_i2c_reg->I2C_CR2, BSP_I2C_REG_CR2_ITEVTEN |   /* Enable Bus Errors and bus Events interrupts          */
                                     BSP_I2C_REG_CR2_ITERREN);
     
+    if (done_fnct != (BSP_I2C_DONE_FNCT)0) {                    /* The ISR finishes it (see Note #1)                    */
+        return (DEF_OK);
+    }
+
                                                                 /* Wait until the transfer completes                    */
     err = BSP_OS_SemWait(&(p_i2c_dev_status->SemWait),
                          500);  
@@ -539,7 +562,8 @@ CPU_BOOLEAN  BSP_I2C_Rd (CPU_INT08U   i2c_id,
                             i2c_addr,
                             BSP_I2C_ACCESS_TYPE_RD,
                             p_buf,
-                            nbr_bytes);
+                            nbr_bytes,
+                            (BSP_I2C_DONE_FNCT)0);
     
     return (err);
 }
@@ -592,7 +616,8 @@ CPU_BOOLEAN  BSP_I2C_Wr (CPU_INT08U   i2c_id,
                             i2c_addr,
                             BSP_I2C_ACCESS_TYPE_WR,
                             p_buf,
-                            nbr_bytes);
+                            nbr_bytes,
+                            (BSP_I2C_DONE_FNCT)0);
     
     return (err);               
 }
@@ -644,12 +669,101 @@ CPU_BOOLEAN  BSP_I2C_WrRd (CPU_INT08U   i2c_id,
                             i2c_addr,
                             BSP_I2C_ACCESS_TYPE_WR_RD,
                             p_buf,
-                            nbr_bytes);
+                            nbr_bytes,
+                            (BSP_I2C_DONE_FNCT)0);
     
     return (err);               
 }
 
 
+/*
+*********************************************************************************************************
+*                                        BSP_I2C_WrRdStart()
+*
+* Description : Start a write followed by a read, as BSP_I2C_WrRd(), and return without waiting for it.
+*
+* Argument(s) : i2c_nbr      I2C peripheral number
+*                                BSP_I2C_ID_I2C1
+*                                BSP_I2C_ID_I2C2
+*
+*               i2c_addr     The I2C device address
+*
+*               p_buf        Pointer to the buffer where the bytes will be transfered/received. It must
+*                            stay valid until done_fnct is called.
+*
+*               nbr_bytes    Number of bytes to be read.
+*
+*               done_fnct    Function called from the I2C ISR when the transfer ends, with DEF_OK if
+*                            every byte was transfered.
+*
+* Return(s)   : DEF_OK       If the transfer was started.
+*               DEF_FAIL     If the transfer could not be started; done_fnct will not be called.
+*
+* Caller(s)   : Application
+*
+* Note(s)     : (1) The peripheral stays locked until done_fnct is called, so the next transfer on it
+*                   should not be started before then.
+*********************************************************************************************************
+*/
+
+CPU_BOOLEAN  BSP_I2C_WrRdStart (CPU_INT08U          i2c_id,
+                                CPU_INT08U          i2c_addr,
+                                CPU_INT08U         *p_buf,
+                                CPU_INT08U          nbr_bytes,
+                                BSP_I2C_DONE_FNCT   done_fnct)
+{
+    if ((p_buf == (CPU_INT08U *)0) || (done_fnct == (BSP_I2C_DONE_FNCT)0)) {
+        return (DEF_FAIL);
+    }
+    
+    if (nbr_bytes < 2) {
+        return (DEF_FAIL);
+    }
+    
+    return (BSP_I2C_StartXfer(i2c_id,
+                              i2c_addr,
+                              BSP_I2C_ACCESS_TYPE_WR_RD,
+                              p_buf,
+                              nbr_bytes,
+                              done_fnct));
+}
+
+
+/*
+*********************************************************************************************************
+*                                        BSP_I2C_XferEnd()
+*
+* Description : Signal the end of a transfer: wake the waiting caller, or release the peripheral and
+*               call the transfer's done function.
+*
+* Argument(s) : p_i2c_dev_status  The peripheral's status.
+*
+* Return(s)   : none.
+*
+* Caller(s)   : BSP_I2Cx_EventISR_Handler()
+*               BSP_I2Cx_ErrISR_Handler()
+*
+* Note(s)     : none.
+*********************************************************************************************************
+*/
+
+static  void  BSP_I2C_XferEnd (BSP_I2C_DEV_STATUS  *p_i2c_dev_status)
+{
+    BSP_I2C_DONE_FNCT  done_fnct;
+
+
+    done_fnct = p_i2c_dev_status->DoneFnct;
+    if (done_fnct == (BSP_I2C_DONE_FNCT)0) {
+        BSP_OS_SemPost(&(p_i2c_dev_status->SemWait));
+        return;
+    }
+
+    p_i2c_dev_status->DoneFnct = (BSP_I2C_DONE_FNCT)0;
+    BSP_OS_SemPost(&(p_i2c_dev_status->SemLock));               /* Release the I2C Peripheral                           */
+    done_fnct((p_i2c_dev_status->BufLen == 0) ? DEF_OK : DEF_FAIL);
+}
+
+
 /*
 *********************************************************************************************************
 *                                        BSP_I2C1_EventISR_Handle()
@@ -783,7 +897,7 @@ void  BSP_I2Cx_EventISR_Handler (CPU_INT08U  i2c_nbr)
                                                  BSP_I2C_REG_CR2_ITERREN);
                  DEF_BIT_SET(p_i2c_reg->I2C_CR1, BSP_I2C_REG_CR1_STOP);                              
 
-                 BSP_OS_SemPost(&(p_i2c_dev_status->SemWait));
+                 BSP_I2C_XferEnd(p_i2c_dev_status);
              }
              break;
                  
@@ -850,7 +964,7 @@ void  BSP_I2Cx_EventISR_Handler (CPU_INT08U  i2c_nbr)
                  DEF_BIT_CLR(p_i2c_reg->I2C_CR2, BSP_I2C_REG_CR2_ITEVTEN |
                                                  BSP_I2C_REG_CR2_ITERREN);
                  
-                 BSP_OS_SemPost(&(p_i2c_dev_status->SemWait));
+                 BSP_I2C_XferEnd(p_i2c_dev_status);
              }
              break;
 
@@ -946,6 +1060,6 @@ static  void  BSP_I2Cx_ErrISR_Handler (CPU_INT08U  i2c_nbr)
         DEF_BIT_CLR(p_i2c_reg->I2C_CR2, (BSP_I2C_REG_CR2_ITEVTEN |
                                          BSP_I2C_REG_CR2_ITERREN));
                  
-        BSP_OS_SemPost(&(p_i2c_dev_status->SemWait));
+        BSP_I2C_XferEnd(p_i2c_dev_status);
     }
 }
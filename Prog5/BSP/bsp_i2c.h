@@ -91,6 +91,8 @@
 *********************************************************************************************************
 */
 
+typedef  void  (*BSP_I2C_DONE_FNCT)(CPU_BOOLEAN  xfer_ok);      /* Called from the I2C ISR when a transfer ends        */
+
 
 /*
 *********************************************************************************************************
@@ -117,6 +119,12 @@ CPU_BOOLEAN  BSP_I2C_WrRd  (CPU_INT08U   i2c_nbr,
                             CPU_INT08U  *p_buf,
                             CPU_INT08U   nbr_bytes);
 
+CPU_BOOLEAN  BSP_I2C_WrRdStart (CPU_INT08U          i2c_nbr,
+                                CPU_INT08U          i2c_addr,
+                                CPU_INT08U         *p_buf,
+                                CPU_INT08U          nbr_bytes,
+                                BSP_I2C_DONE_FNCT   done_fnct);
+
 
 /*
 *********************************************************************************************************
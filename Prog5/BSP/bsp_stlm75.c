@@ -21,6 +21,7 @@
 * Filename      : bsp_stlm75.c
 * Version       : V1.00
 * Programmer(s) : FT
+*                 JW - Fast mode I2C; BSP_STLM75_TempRdStart() reads without waiting.
 *********************************************************************************************************
 * Note(s)       :
 *********************************************************************************************************
@@ -95,6 +96,8 @@
 *********************************************************************************************************
 */
 
+static  CPU_INT08U  BSP_STLM75_RdBuf[3];                        /* Register pointer, then the temperature read into it */
+
 
 /*
 *********************************************************************************************************
@@ -141,7 +144,7 @@ static  CPU_BOOLEAN  BSP_STLM75_RdReg_16  (CPU_INT08U  reg,
 *
 * Caller(s)   : Application
 *
-* Note(s)     : none.
+* Note(s)     : (1) The bus runs at BSP_STLM75_I2C_FREQ, in fast mode above 100 kHz.
 *********************************************************************************************************
 */
 
@@ -150,9 +153,15 @@ CPU_BOOLEAN  BSP_STLM75_Init (void)
     CPU_BOOLEAN  err;
     
     
+#if (BSP_STLM75_I2C_FREQ > BSP_I2C_MODE_STANDARD_MAX_FREQ_HZ)
+    err = BSP_I2C_Init(BSP_I2C_ID_I2C1, 
+                       BSP_I2C_MODE_FAST_1_2, 
+                       BSP_STLM75_I2C_FREQ);
+#else
     err = BSP_I2C_Init(BSP_I2C_ID_I2C1, 
                        BSP_I2C_MODE_STANDARD, 
-                       BSP_I2C_MODE_STANDARD_MAX_FREQ_HZ);
+                       BSP_STLM75_I2C_FREQ);
+#endif
     
     return (err);
     
@@ -437,4 +446,60 @@ CPU_BOOLEAN  BSP_STLM75_TempGet  (CPU_INT08U   temp_unit,
     }
        
    return (DEF_OK);
-}
\ No newline at end of file
+}
+
+
+/*
+*********************************************************************************************************
+*                                        BSP_STLM75_TempRdStart()
+*
+* Description : Start reading the temperature register and return without waiting for the read.
+*
+* Argument(s) : done_fnct       Function the I2C ISR calls when the read ends, with DEF_OK if it worked.
+*
+* Return(s)   : DEF_OK     If the read was started.
+*               DEF_FAIL   If the read could not be started; done_fnct will not be called.
+*
+* Caller(s)   : Application
+*
+* Note(s)     : (1) Only one read may be in progress; start the next after done_fnct is called.
+*********************************************************************************************************
+*/
+
+CPU_BOOLEAN  BSP_STLM75_TempRdStart (BSP_I2C_DONE_FNCT  done_fnct)
+{
+    CPU_BOOLEAN  err;
+    
+    
+    BSP_STLM75_RdBuf[0] = BSP_STLM75_REG_TEMP;
+
+    err = BSP_I2C_WrRdStart( BSP_I2C_ID_I2C1, 
+                             BSP_STLM75_I2C_ADDR, 
+                            &BSP_STLM75_RdBuf[0], 
+                             3,
+                             done_fnct);
+    
+    return (err);
+}
+
+
+/*
+*********************************************************************************************************
+*                                        BSP_STLM75_TempRdEnd()
+*
+* Description : The temperature register a finished BSP_STLM75_TempRdStart() read.
+*
+* Argument(s) : none.
+*
+* Return(s)   : The register, in 1/256 degrees Celsius (0.5 degree steps).
+*
+* Caller(s)   : Application, after the read's done_fnct reports DEF_OK.
+*
+* Note(s)     : none.
+*********************************************************************************************************
+*/
+
+CPU_INT16S  BSP_STLM75_TempRdEnd (void)
+{
+    return ((CPU_INT16S)((BSP_STLM75_RdBuf[1] << 8) | BSP_STLM75_RdBuf[2]));
+}
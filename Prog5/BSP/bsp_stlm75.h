@@ -80,6 +80,10 @@
 
 #define  BSP_STLM75_I2C_MAX_FREQ             400000
 
+#ifndef  BSP_STLM75_I2C_FREQ
+#define  BSP_STLM75_I2C_FREQ                 BSP_STLM75_I2C_MAX_FREQ
+#endif
+
 
 /*
 *********************************************************************************************************
@@ -121,6 +125,8 @@ CPU_BOOLEAN      BSP_STLM75_Init         (void);
 CPU_BOOLEAN      BSP_STLM75_CfgSet       (BSP_STLM75_CFG   *p_stlm75_cfg);
 CPU_BOOLEAN      BSP_STLM75_TempGet      (CPU_INT08U        units,
                                           CPU_INT16S       *p_temp);
+CPU_BOOLEAN      BSP_STLM75_TempRdStart  (BSP_I2C_DONE_FNCT done_fnct);
+CPU_INT16S       BSP_STLM75_TempRdEnd    (void);
 
                                                                 /* Not Implemented yet                                */
 #if 0